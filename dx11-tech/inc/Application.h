@@ -7,18 +7,21 @@
 #include "AssimpLoader.h"
 
 #include "Graphics/Renderer/ModelRenderer.h"
+#include "Benchmark/FlythroughBenchmark.h"
+#include "Camera/CameraPath.h"
 
 
 class Application
 {
 public:
-	Application();
+	Application(std::optional<FlythroughBenchmark::Settings> flythrough = {});
 	~Application();
 
 	Application& operator=(const Application&) = delete;
 	Application(const Application&) = delete;
 
-	void run();
+	// Returns the process exit code
+	int run();
 
 private:
 	LRESULT custom_win_proc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -27,6 +30,8 @@ private:
 
 	void update(float dt);
 
+	void declare_camera_path_ui();
+
 private:
 	bool m_paused = false;
 	bool m_app_alive = true;
@@ -39,9 +44,21 @@ private:
 	unique_ptr<class FPPCamera> m_cam, m_cam_zoom;
 
 	ModelRenderer* m_model_renderer;
+	unique_ptr<class AssetReloader> m_asset_reloader;		// off while benchmarking
 	ModelHandle m_sponza;
 	ModelHandle m_nanosuit;
 
+	// Camera path recording (see FlythroughBenchmark for replay)
+	CameraPath m_recorded_path;
+	bool m_recording_path = false;
+	float m_record_time = 0.f;
+	std::array<char, 64> m_segment_name{ "Segment" };
+	std::array<char, 256> m_path_file{ "camera_path.json" };
+
+	// Scripted camera replay, replaces the camera controller when active
+	unique_ptr<FlythroughBenchmark> m_flythrough;
+	int m_exit_code = 0;
+
 
 	bool m_resize_allowed = false;
 	bool m_should_resize = false;
@@ -0,0 +1,85 @@
+#pragma once
+#include "MappedFile.h"
+#include <string_view>
+
+/*
+	Single file holding many asset files (e.g models/, shaders/ and cooked/), read through VirtualFile once mounted.
+
+	Layout: header, index, chunk table, path strings, chunk data.
+	The index has one entry per file sorted by a hash of its path (utils::hash_bytes of the normalized generic path,
+	e.g "models/sponza/sponza.obj"), a lookup is a binary search plus a string compare against hash collisions.
+	Files are split into CHUNK_SIZE chunks compressed with lz4 independently, so the chunks of a large file decompress in
+	parallel on the ThreadPool. A chunk lz4 doesn't shrink is stored as is, a file of a single such chunk is read straight
+	from the mapping without a copy (chunk data is 16 byte aligned, see BakedModel).
+
+	The package is memory mapped and validated once when opened, lookups and reads are thread-safe.
+
+	Usage:
+		dx11-tech.exe --build-package assets.dxpk models shaders cooked		(files or directories, relative to the working directory)
+*/
+class AssetPackage
+{
+public:
+	static constexpr uint32_t VERSION = 1;
+	static constexpr uint32_t CHUNK_SIZE = 256 * 1024;
+	static constexpr const char* DEFAULT_PATH = "assets.dxpk";
+
+	struct BuildSettings
+	{
+		std::filesystem::path output = DEFAULT_PATH;
+		std::vector<std::filesystem::path> inputs;
+	};
+
+	struct Stats
+	{
+		uint32_t files = 0;
+		uint32_t chunks = 0;
+		uint64_t bytes = 0;				// uncompressed
+		uint64_t stored_bytes = 0;		// chunk data in the package
+	};
+
+	// Parses the command line, returns nothing if a package build wasn't requested
+	static std::optional<BuildSettings> parse_args(int argc, char** argv);
+
+	// Packs every file of the inputs (directories recursively), written to a temporary first
+	static bool build(const BuildSettings& settings);
+
+	// Key of a path in the index
+	static std::string get_name(const std::filesystem::path& path);
+
+public:
+	AssetPackage(const std::filesystem::path& path);
+
+	AssetPackage& operator=(const AssetPackage&) = delete;
+	AssetPackage(const AssetPackage&) = delete;
+
+	// Mapped and well formed
+	bool is_open() const { return m_well_formed; }
+
+	bool contains(const std::filesystem::path& path) const;
+
+	// False if the file isn't packaged (or its chunks are corrupt).
+	// Otherwise data/size is either a view into the mapping or storage, which receives the decompressed file.
+	bool read(const std::filesystem::path& path, std::vector<uint8_t>& storage, const uint8_t*& data, size_t& size) const;
+
+	const Stats& get_stats() const { return m_stats; }
+
+private:
+	struct Header;
+	struct Entry;
+	struct Chunk;
+
+	const Entry* find(const std::filesystem::path& path) const;
+	std::string_view get_entry_name(const Entry& entry) const;
+
+private:
+	MappedFile m_file;
+	bool m_well_formed = false;
+
+	const Entry* m_entries = nullptr;
+	const Chunk* m_chunks = nullptr;
+	const char* m_names = nullptr;
+	uint32_t m_entry_count = 0;
+
+	Stats m_stats;
+};
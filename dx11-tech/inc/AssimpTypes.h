@@ -7,6 +7,11 @@ struct AssimpMeshData
 	unsigned int index_start = 0;
 	unsigned int index_count = 0;
 	unsigned int vertex_start = 0;
+	unsigned int index_stride = sizeof(uint32_t);		// 2 once optimized to 16 bit indices (see MeshOptimizer)
+	unsigned int cluster_start = 0;						// MeshClusters of the mesh, none unless optimized
+	unsigned int cluster_count = 0;
+	unsigned int lod_start = 0;							// MeshLods of the mesh, none unless optimized
+	unsigned int lod_count = 0;
 };
 
 struct AssimpMaterialData
@@ -0,0 +1,34 @@
+#pragma once
+#include "Benchmark/BenchmarkReport.h"
+
+/*
+	Diffs two benchmark result files (headless benchmark, microbenchmarks or flythrough) metric by metric.
+
+	Usage:
+		dx11-tech.exe --bench-compare baseline.json current.json [--tolerance pct] [--metrics avg_ns,p95_ns]
+
+	Prints every shared entry with its delta and lists entries which only exist in one of the files.
+	Exits with a non-zero code if any of the checked metrics grew beyond the tolerance.
+*/
+class BenchmarkCompare
+{
+public:
+	struct Settings
+	{
+		std::filesystem::path baseline;
+		std::filesystem::path current;
+		float tolerance_pct = 5.f;
+		std::vector<std::string> metrics = {
+			"avg_ms", "p95_ms", "avg_ns", "p50_ns", "p95_ns",
+			"avg_cpu_ms", "p95_cpu_ms", "avg_gpu_ms", "p95_gpu_ms",
+			"allocs_per_frame", "issued_per_frame" };
+	};
+
+	// Parses the command line, returns nothing if a comparison wasn't requested
+	static std::optional<Settings> parse_args(int argc, char** argv);
+
+	// Returns the process exit code
+	static int run(const Settings& settings);
+
+	BenchmarkCompare() = delete;
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include "Json.h"
+
+/*
+	Summary of a set of per-frame (or per-iteration) samples
+*/
+struct SampleStats
+{
+	uint64_t count = 0;
+	float avg = 0.f;
+	float min = 0.f;
+	float max = 0.f;
+	float p50 = 0.f;
+	float p95 = 0.f;
+	float p99 = 0.f;
+
+	static SampleStats from(std::vector<float> samples);
+};
+
+/*
+	Named entries with named metrics, serialized as:
+	{
+		"benchmark": "<name>",
+		"entries": { "<entry>": { "<metric>": value, ... }, ... }
+	}
+
+	All metrics are treated as "lower is better" when comparing against a baseline.
+*/
+class BenchmarkReport
+{
+public:
+	struct Difference
+	{
+		std::string entry;
+		std::string metric;
+		double baseline = 0.0;
+		double current = 0.0;
+		double delta_pct = 0.0;
+	};
+
+public:
+	BenchmarkReport(const std::string& name);
+
+	void set(const std::string& entry, const std::string& metric, double value);
+
+	// Adds avg/min/max/p50/p95/p99 with the given unit suffix (e.g "_ms")
+	void set_samples(const std::string& entry, const std::vector<float>& samples, const std::string& unit_suffix = "_ms");
+
+	const std::string& get_name() const;
+	const std::map<std::string, std::map<std::string, double>>& get_entries() const;
+
+	bool write(const std::filesystem::path& path) const;
+	static std::optional<BenchmarkReport> read(const std::filesystem::path& path);
+
+	// Every metric which exists in both reports
+	std::vector<Difference> compare(const BenchmarkReport& baseline) const;
+
+	// Metrics (from 'metrics') which grew beyond the tolerance (in percent) compared to the baseline
+	std::vector<Difference> find_regressions(const BenchmarkReport& baseline, float tolerance_pct, const std::vector<std::string>& metrics) const;
+
+private:
+	std::string m_name;
+	std::map<std::string, std::map<std::string, double>> m_entries;
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include "Camera/CameraPath.h"
+#include "Profiler/CPUProfiler.h"
+#include "Profiler/GPUProfiler.h"
+
+/*
+	Replays a recorded CameraPath inside the regular Application (real device) with a fixed dt,
+	collecting the full frame CPU and GPU time of every frame.
+
+	Usage:
+		dx11-tech.exe --flythrough path.json [--fixed-dt seconds] [--warmup N] [--out flythrough_results.json]
+
+	Paths are recorded from the "Camera Path" window in the Application.
+
+	Results:
+		- <out>:			BenchmarkReport with CPU/GPU percentiles for the whole path and per path segment
+		- <out>.csv:		frame, path time, segment, cpu ms, gpu ms for every frame
+*/
+class FlythroughBenchmark
+{
+public:
+	struct Settings
+	{
+		std::filesystem::path path;
+		float fixed_dt = 1.f / 60.f;
+		UINT warmup_frames = 60;
+		std::filesystem::path output = "flythrough_results.json";
+	};
+
+	// Parses the command line, returns nothing if a flythrough wasn't requested
+	static std::optional<Settings> parse_args(int argc, char** argv);
+
+public:
+	FlythroughBenchmark(const Settings& settings);
+	~FlythroughBenchmark() = default;
+
+	FlythroughBenchmark& operator=(const FlythroughBenchmark&) = delete;
+	FlythroughBenchmark(const FlythroughBenchmark&) = delete;
+
+	bool is_loaded() const;
+
+	// Poses the camera for the upcoming frame, returns false once the replay is complete
+	bool begin_frame(FPPCamera* cam);
+
+	// Call after the frame has ended on the FrameProfiler
+	void end_frame(const CPUProfiler::FrameData& cpu_stats, const GPUProfiler::FrameData& gpu_stats);
+
+	// Writes the results, returns the process exit code
+	int finish();
+
+private:
+	struct FrameSample
+	{
+		float path_time = 0.f;
+		size_t segment = 0;
+		float cpu_ms = 0.f;
+		float gpu_ms = 0.f;
+	};
+
+	Settings m_settings;
+	std::optional<CameraPath> m_path;
+
+	uint64_t m_frame = 0;
+	uint64_t m_path_frames = 0;
+	std::vector<FrameSample> m_samples;		// one per measured path frame
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include "Graphics/Renderer/ModelRenderer.h"
+
+class FPPCamera;
+
+/*
+	Runs the regular model submission -> bucket sort -> flush path against a headless GfxDevice.
+	No window, no D3D11 device: what is measured is purely the CPU side of the renderer.
+
+	Usage:
+		dx11-tech.exe --headless-bench [--frames N] [--warmup N] [--out results.json] [--baseline old.json] [--tolerance pct]
+			[--call-stream calls.csv] [--quantize-vertices] [--texture-budget MB] [--pack-textures] [--package assets.dxpk]
+
+	When a baseline is supplied, the run fails (non-zero exit code) if the average/p95 times, the per-frame allocation
+	counts or the per-frame issued GfxDevice calls of any entry grew beyond the tolerance.
+
+	GfxDevice call recording is always on for the run, --call-stream additionally dumps every call of the last frame.
+	--quantize-vertices loads the models with the VertexQuantizer streams (the Application default).
+	--texture-budget sets the memory budget of the TextureStreamer, the resident/streamed/evicted totals are reported at the end.
+	--pack-textures packs the material textures into texture arrays (DiskTextureManager::pack), packed textures have to be
+	fully resident so texture streaming is turned off.
+	--package mounts an AssetPackage (see VirtualFile), the package and disk reads of the run are reported.
+*/
+class HeadlessBenchmark
+{
+public:
+	struct Settings
+	{
+		UINT width = 1920;
+		UINT height = 1080;
+		UINT warmup_frames = 60;
+		UINT frames = 600;
+		std::filesystem::path output = "benchmark_results.json";
+		std::optional<std::filesystem::path> baseline;
+		float tolerance_pct = 10.f;
+		std::optional<std::filesystem::path> call_stream;
+		bool quantize_vertices = false;
+		std::optional<uint32_t> texture_budget_mb;
+		bool pack_textures = false;
+		std::optional<std::filesystem::path> package;
+	};
+
+	// Parses the command line, returns nothing if the benchmark wasn't requested
+	static std::optional<Settings> parse_args(int argc, char** argv);
+
+public:
+	HeadlessBenchmark(const Settings& settings);
+	~HeadlessBenchmark();
+
+	HeadlessBenchmark& operator=(const HeadlessBenchmark&) = delete;
+	HeadlessBenchmark(const HeadlessBenchmark&) = delete;
+
+	// Returns the process exit code
+	int run();
+
+private:
+	void submit_scene();
+
+private:
+	Settings m_settings;
+
+	unique_ptr<FPPCamera> m_cam;
+	ModelRenderer* m_model_renderer = nullptr;
+	ModelHandle m_sponza;
+	ModelHandle m_nanosuit;
+
+	float m_load_time = 0.f;
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include "Benchmark/BenchmarkReport.h"
+
+class GPUProfiler;
+
+/*
+	Microbenchmarks for the CPU data structures on the hot render path:
+		- LinearAllocator allocate/reset
+		- ResourceHandlePool get_next_free_handle/look_up/free_handle
+		- GfxCommandBucket add_command/sort/flush at several bucket sizes
+		- aux::bindtable::Filler build path
+		- FrameProfiler CPU scope overhead
+		- Material equality and lookup
+		- MipGenerator on the Sponza albedo textures (scalar vs SIMD, box vs tent, serial vs jobs::pool)
+		- ShaderCache hits through a stub compiler, after checking hit, miss and include invalidation (exit code 1 if a check fails)
+
+	Every entry is reported as nanoseconds per operation (avg/min/max/p50/p95/p99 over the samples),
+	except the mip generator which reports milliseconds per texture set and MB/s of source texels (at most 5 samples).
+
+	Usage:
+		dx11-tech.exe --microbench [--samples N] [--filter substring] [--out microbench_results.json]
+
+	Compare two result files with --bench-compare (see BenchmarkCompare.h).
+*/
+class MicroBenchmarks
+{
+public:
+	struct Settings
+	{
+		UINT samples = 50;
+		std::string filter;
+		std::filesystem::path output = "microbench_results.json";
+	};
+
+	// Parses the command line, returns nothing if the microbenchmarks weren't requested
+	static std::optional<Settings> parse_args(int argc, char** argv);
+
+public:
+	MicroBenchmarks(const Settings& settings);
+	~MicroBenchmarks();
+
+	MicroBenchmarks& operator=(const MicroBenchmarks&) = delete;
+	MicroBenchmarks(const MicroBenchmarks&) = delete;
+
+	// Returns the process exit code
+	int run();
+
+private:
+	void bench_linear_allocator();
+	void bench_handle_pool();
+	void bench_command_bucket();
+	void bench_bindtable();
+	void bench_profiler_scopes();
+	void bench_material();
+	void bench_mip_generator();
+	bool bench_shader_cache();		// false if a check failed
+
+	/*
+		Runs 'setup' (untimed) followed by 'batch' (timed) once per sample.
+		'batch' is expected to perform 'ops' operations, the per operation time is what gets reported.
+	*/
+	template <typename Setup, typename Batch>
+	void measure(const std::string& name, uint32_t ops, Setup&& setup, Batch&& batch);
+
+private:
+	Settings m_settings;
+	BenchmarkReport m_report;
+
+	unique_ptr<GPUProfiler> m_gpu_profiler;
+};
+
@@ -0,0 +1,64 @@
+#pragma once
+#include "Json.h"
+
+class FPPCamera;
+
+struct CameraPose
+{
+	DirectX::SimpleMath::Vector3 position;
+	float yaw = 0.f;
+	float pitch = 0.f;
+};
+
+/*
+	Timestamped camera poses with named segments, recorded from and replayed onto an FPPCamera.
+	Paths start at time 0, poses in between keyframes are linearly interpolated so a path can be replayed at any (fixed) dt.
+
+	Serialized as:
+	{
+		"keyframes": [ { "t": time, "pos": [x, y, z], "yaw": yaw, "pitch": pitch }, ... ],
+		"segments": [ { "name": name, "t": start time }, ... ]
+	}
+*/
+class CameraPath
+{
+public:
+	struct Keyframe
+	{
+		float time = 0.f;
+		CameraPose pose;
+	};
+
+	struct Segment
+	{
+		std::string name;
+		float start_time = 0.f;
+	};
+
+public:
+	static CameraPose capture(const FPPCamera& cam);
+	static void apply(const CameraPose& pose, FPPCamera* cam);
+
+	// Keyframes are expected in increasing time
+	void add_keyframe(float time, const CameraPose& pose);
+
+	// Segment runs until the start of the next one (or the end of the path)
+	void begin_segment(const std::string& name, float start_time);
+
+	CameraPose sample(float time) const;
+
+	// Index into get_segments() for the given time
+	size_t get_segment_index(float time) const;
+	const std::vector<Segment>& get_segments() const;
+
+	float get_duration() const;
+	bool empty() const;
+	void clear();
+
+	bool write(const std::filesystem::path& path) const;
+	static std::optional<CameraPath> read(const std::filesystem::path& path);
+
+private:
+	std::vector<Keyframe> m_keyframes;
+	std::vector<Segment> m_segments;
+};
@@ -31,8 +31,8 @@ public:
 	void set_yaw(float yaw);
 	void set_pitch(float pitch);
 
-	float get_yaw();
-	float get_pitch();
+	float get_yaw() const;
+	float get_pitch() const;
 
 private:
 	// Used to offset yaw so the default viewing point is in forward Z.
@@ -0,0 +1,79 @@
+#pragma once
+#include <unordered_map>
+
+/*
+	Content addressed cache: values are keyed by a hash of the bytes they were created from (utils::hash_bytes),
+	so the same content reached through different paths or files is created once and shared.
+
+	Every lookup that finds an existing entry counts as a hit and adds the size of the entry to bytes_saved,
+	i.e the bytes that would otherwise have been decoded/uploaded again.
+*/
+template <typename T>
+class ContentCache
+{
+public:
+	struct Stats
+	{
+		uint32_t entries = 0;
+		uint32_t hits = 0;
+		uint64_t bytes = 0;				// held by the entries
+		uint64_t bytes_saved = 0;		// by the hits
+	};
+
+public:
+	// nullptr if the content isn't cached
+	const T* find(uint64_t hash)
+	{
+		auto it = m_entries.find(hash);
+		if (it == m_entries.end())
+			return nullptr;
+
+		++m_stats.hits;
+		m_stats.bytes_saved += it->second.bytes;
+		return &it->second.value;
+	}
+
+	bool contains(uint64_t hash) const { return m_entries.find(hash) != m_entries.end(); }
+
+	// Same as find without counting a hit (e.g the owner looking up its own entry)
+	const T* get(uint64_t hash) const
+	{
+		auto it = m_entries.find(hash);
+		return it != m_entries.end() ? &it->second.value : nullptr;
+	}
+
+	// The first insert of a hash wins
+	const T& insert(uint64_t hash, T value, uint64_t bytes)
+	{
+		auto [it, inserted] = m_entries.insert({ hash, Entry{ std::move(value), bytes } });
+		if (inserted)
+		{
+			++m_stats.entries;
+			m_stats.bytes += bytes;
+		}
+		return it->second.value;
+	}
+
+	void erase(uint64_t hash)
+	{
+		auto it = m_entries.find(hash);
+		if (it == m_entries.end())
+			return;
+
+		--m_stats.entries;
+		m_stats.bytes -= it->second.bytes;
+		m_entries.erase(it);
+	}
+
+	const Stats& get_stats() const { return m_stats; }
+
+private:
+	struct Entry
+	{
+		T value;
+		uint64_t bytes = 0;
+	};
+
+	std::unordered_map<uint64_t, Entry> m_entries;
+	Stats m_stats;
+};
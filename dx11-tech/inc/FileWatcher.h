@@ -0,0 +1,62 @@
+#pragma once
+#include "Timer.h"
+#include <unordered_map>
+
+/*
+	Reports the files changed under a directory, polled from the owning thread (e.g once per frame).
+
+	Changes come from an overlapped ReadDirectoryChangesW on the directory, so no thread is needed to wait on it.
+	If the directory can't be watched that way (e.g some network shares) the watcher falls back to comparing last write times
+	of every file each poll_interval_ms.
+
+	Editors often save in several writes (or through a temporary file and a rename), a file is only reported once it has had
+	no changes for debounce_ms, and then once for all of them.
+*/
+class FileWatcher
+{
+public:
+	struct Settings
+	{
+		bool recursive = true;
+		float debounce_ms = 150.f;
+		float poll_interval_ms = 500.f;		// fallback only
+		bool force_polling = false;
+	};
+
+public:
+	FileWatcher(const std::filesystem::path& directory, const Settings& settings);
+	~FileWatcher();
+
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	FileWatcher(const FileWatcher&) = delete;
+
+	// Files (directory / relative path) changed and settled since the last call
+	std::vector<std::filesystem::path> poll();
+
+	bool is_polling() const { return m_handle == INVALID_HANDLE_VALUE; }
+	const std::filesystem::path& get_directory() const { return m_directory; }
+
+private:
+	bool start_read();
+	void stop_watching();
+	void read_changes();
+	void scan(bool report);
+	void mark_changed(const std::filesystem::path& path);
+
+private:
+	std::filesystem::path m_directory;
+	Settings m_settings;
+	Timer m_clock;
+
+	// ReadDirectoryChangesW
+	HANDLE m_handle = INVALID_HANDLE_VALUE;
+	OVERLAPPED m_overlapped{};
+	std::vector<DWORD> m_buffer;			// FILE_NOTIFY_INFORMATION records are DWORD aligned
+
+	// Polling fallback, last write time per file
+	std::unordered_map<std::string, std::filesystem::file_time_type> m_write_times;
+	float m_last_scan = 0.f;
+
+	// Changed file --> time of its last change
+	std::map<std::filesystem::path, float> m_pending;
+};
@@ -15,4 +15,10 @@ namespace perf
 {
 	extern class CPUProfiler* cpu_profiler;		// All purpose CPU profiler (not actively used anywhere for now, everything goes through FrameProfiler)
 	extern class FrameProfiler* profiler;		// Frame profiler
+	extern class StartupProfiler* startup_profiler;		// Initialization timeline, stops recording once startup is done
+}
+
+namespace jobs
+{
+	extern class ThreadPool* pool;				// Worker threads for asynchronous loading and parallel work
 }
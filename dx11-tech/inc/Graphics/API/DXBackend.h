@@ -0,0 +1,63 @@
+#pragma once
+#include "Graphics/API/GfxBackend.h"
+
+/*
+	D3D11 (11.1) backend, every GfxDevice call ends up on the immediate context of the DXDevice.
+*/
+class DXBackend : public GfxBackend
+{
+public:
+	DXBackend(unique_ptr<DXDevice> dev);
+
+	DXDevice* get_dx_device() const override { return m_dev.get(); }
+	AnnotationPtr get_annotation() const override { return m_dev->get_annotation(); }
+	unique_ptr<ShaderCompiler> create_shader_compiler() const override { return make_unique<D3DShaderCompiler>(); }
+
+	std::pair<UINT, UINT> get_sc_dim() const override;
+	void get_backbuffer(GPUTexture* backbuffer) override;
+	void resize_swapchain(UINT width, UINT height, GPUTexture* backbuffer) override;
+	void present(bool vsync) override;
+
+	void frame_start() override;
+	void set_name(const GPUType* device_child, const std::string& name) override;
+
+	void create_buffer(const BufferDesc& desc, GPUBuffer* buffer, std::optional<SubresourceData> subres) override;
+	void create_texture(const TextureDesc& desc, GPUTexture* texture, const std::vector<SubresourceData>& subres) override;
+	void create_sampler(const SamplerDesc& desc, Sampler* sampler) override;
+	void create_shader(ShaderStage stage, const ShaderBytecode& bytecode, Shader* shader) override;
+	void create_pipeline(const PipelineDesc& desc, const Shader* vs, GraphicsPipeline* pipeline) override;
+
+	D3D11_TEXTURE2D_DESC describe_texture(const GPUTexture* texture) const override;
+
+	void begin_pass(const RenderPass* rp, const PassTargets& targets, DepthStencilClear ds_clear) override;
+	void end_pass(const RenderPass* rp, const PassTargets& targets) override;
+
+	void bind_pipeline(const GraphicsPipeline* pipeline, const std::array<const Shader*, 5>& vs_ps_gs_hs_ds, const std::array<FLOAT, 4>& blend_factor, UINT stencil_ref) override;
+	void bind_compute_shader(const Shader* cs) override;
+	void bind_vertex_buffers(UINT start_slot, UINT count, const GPUBuffer* const* buffers, const UINT* strides, const UINT* offsets) override;
+	void bind_index_buffer(const GPUBuffer* buffer, DXGI_FORMAT format, UINT offset) override;
+	void bind_constant_buffer(UINT slot, ShaderStage stage, const GPUBuffer* buffer, UINT offset256s, UINT range256s) override;
+	void bind_resource(UINT slot, ShaderStage stage, const GPUResource* resource) override;
+	void bind_resource_rw(UINT slot, ShaderStage stage, const GPUResource* resource, UINT initial_count) override;
+	void bind_sampler(UINT slot, ShaderStage stage, const Sampler* sampler) override;
+	void bind_viewports(const std::vector<D3D11_VIEWPORT>& viewports) override;
+	void bind_scissors(const std::vector<D3D11_RECT>& rects) override;
+
+	void update_subresource(const GPUResource* dst, const SubresourceData& data, const D3D11_BOX& dst_box, UINT dst_subres_idx) override;
+	void map_copy(const GPUResource* dst, const SubresourceData& data, D3D11_MAP map_type, UINT dst_subres_idx) override;
+	std::pair<float, float> map_read_temp(const GPUBuffer* buffer) override;
+	void copy_resource_region(const GPUResource* dst, const CopyRegionDst& dst_desc, const GPUResource* src, const CopyRegionSrc& src_desc) override;
+	void copy_resource_region(const GPUResource* dst, const CopyRegionDst& dst_desc, const GPUResource* src, UINT src_subres) override;
+
+	void dispatch(UINT blocks_x, UINT blocks_y, UINT blocks_z) override;
+	void draw(UINT vertex_count, UINT start_loc) override;
+	void draw_indexed(UINT index_count, UINT index_start, UINT vertex_start) override;
+
+private:
+	unique_ptr<DXDevice> m_dev;
+
+	// Raster UAVs (bindable to VS, DS, HS, GS, PS), set together with the render targets at begin_pass
+	std::array<ID3D11UnorderedAccessView*, gfxconstants::MAX_BOUND_UAVS> m_raster_uavs{};
+	std::array<UINT, gfxconstants::MAX_BOUND_UAVS> m_raster_uav_initial_counts{};
+	UINT m_raster_rw_range_this_pass = 0;
+};
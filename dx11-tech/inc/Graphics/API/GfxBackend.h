@@ -0,0 +1,150 @@
+#pragma once
+#include "Graphics/API/GfxCommon.h"
+#include "Graphics/API/GfxDescriptorsPrimitive.h"
+#include "Graphics/API/GfxDescriptorsAbstraction.h"
+#include "Graphics/API/GfxHelperTypes.h"
+#include "Graphics/API/ShaderCompiler.h"
+
+#include <array>
+
+struct GPUType;
+struct GPUResource;
+struct GPUTexture;
+struct GPUBuffer;
+struct RenderPass;
+struct GraphicsPipeline;
+struct Shader;
+struct Sampler;
+
+// Textures of a render pass, looked up by GfxDevice (null past the last target)
+struct PassTargets
+{
+	std::array<const GPUTexture*, gfxconstants::MAX_RENDER_TARGETS> targets{};
+	std::array<const GPUTexture*, gfxconstants::MAX_RENDER_TARGETS> resolve_targets{};
+	const GPUTexture* depth_stencil = nullptr;
+};
+
+/*
+	What GfxDevice forwards to the driver.
+
+	GfxDevice owns handles, resource pools, validation, call recording and redundant state filtering,
+	and hands the backend the already looked up resources. A backend only creates the API objects
+	and issues the calls, so everything above it behaves the same whichever backend is in use.
+*/
+class GfxBackend
+{
+public:
+	virtual ~GfxBackend() = default;
+
+	// Null when nothing reaches a D3D11 device (see NullBackend)
+	virtual DXDevice* get_dx_device() const = 0;
+	virtual AnnotationPtr get_annotation() const = 0;
+
+	// Null if shaders are never compiled, GfxDevice then creates shaders from empty bytecode
+	virtual unique_ptr<ShaderCompiler> create_shader_compiler() const = 0;
+
+	// Swapchain
+	virtual std::pair<UINT, UINT> get_sc_dim() const = 0;
+	virtual void get_backbuffer(GPUTexture* backbuffer) = 0;
+	virtual void resize_swapchain(UINT width, UINT height, GPUTexture* backbuffer) = 0;
+	virtual void present(bool vsync) = 0;
+
+	virtual void frame_start() = 0;
+	virtual void set_name(const GPUType* device_child, const std::string& name) = 0;
+
+	// Resource creation (recreated in place if the object already holds one)
+	virtual void create_buffer(const BufferDesc& desc, GPUBuffer* buffer, std::optional<SubresourceData> subres) = 0;
+	virtual void create_texture(const TextureDesc& desc, GPUTexture* texture, const std::vector<SubresourceData>& subres) = 0;
+	virtual void create_sampler(const SamplerDesc& desc, Sampler* sampler) = 0;
+	virtual void create_shader(ShaderStage stage, const ShaderBytecode& bytecode, Shader* shader) = 0;
+	virtual void create_pipeline(const PipelineDesc& desc, const Shader* vs, GraphicsPipeline* pipeline) = 0;
+
+	// Format and sample count of a render target, { 1, 0 } samples if unknown
+	virtual D3D11_TEXTURE2D_DESC describe_texture(const GPUTexture* texture) const = 0;
+
+	// Passes
+	virtual void begin_pass(const RenderPass* rp, const PassTargets& targets, DepthStencilClear ds_clear) = 0;
+	virtual void end_pass(const RenderPass* rp, const PassTargets& targets) = 0;
+
+	// Binds
+	virtual void bind_pipeline(const GraphicsPipeline* pipeline, const std::array<const Shader*, 5>& vs_ps_gs_hs_ds, const std::array<FLOAT, 4>& blend_factor, UINT stencil_ref) = 0;
+	virtual void bind_compute_shader(const Shader* cs) = 0;
+	virtual void bind_vertex_buffers(UINT start_slot, UINT count, const GPUBuffer* const* buffers, const UINT* strides, const UINT* offsets) = 0;
+	virtual void bind_index_buffer(const GPUBuffer* buffer, DXGI_FORMAT format, UINT offset) = 0;
+	virtual void bind_constant_buffer(UINT slot, ShaderStage stage, const GPUBuffer* buffer, UINT offset256s, UINT range256s) = 0;
+	virtual void bind_resource(UINT slot, ShaderStage stage, const GPUResource* resource) = 0;
+	virtual void bind_resource_rw(UINT slot, ShaderStage stage, const GPUResource* resource, UINT initial_count) = 0;		// raster stages are bound at begin_pass
+	virtual void bind_sampler(UINT slot, ShaderStage stage, const Sampler* sampler) = 0;
+	virtual void bind_viewports(const std::vector<D3D11_VIEWPORT>& viewports) = 0;
+	virtual void bind_scissors(const std::vector<D3D11_RECT>& rects) = 0;
+
+	// Transfers
+	virtual void update_subresource(const GPUResource* dst, const SubresourceData& data, const D3D11_BOX& dst_box, UINT dst_subres_idx) = 0;
+	virtual void map_copy(const GPUResource* dst, const SubresourceData& data, D3D11_MAP map_type, UINT dst_subres_idx) = 0;
+	virtual std::pair<float, float> map_read_temp(const GPUBuffer* buffer) = 0;
+	virtual void copy_resource_region(const GPUResource* dst, const CopyRegionDst& dst_desc, const GPUResource* src, const CopyRegionSrc& src_desc) = 0;
+	virtual void copy_resource_region(const GPUResource* dst, const CopyRegionDst& dst_desc, const GPUResource* src, UINT src_subres) = 0;
+
+	// Work
+	virtual void dispatch(UINT blocks_x, UINT blocks_y, UINT blocks_z) = 0;
+	virtual void draw(UINT vertex_count, UINT start_loc) = 0;
+	virtual void draw_indexed(UINT index_count, UINT index_start, UINT vertex_start) = 0;
+};
+
+/*
+	Headless backend: no D3D11 device is created and nothing is forwarded to a driver.
+	Only the CPU side fields GfxDevice relies on are filled in (texture type, shader stage and name, registered pipelines),
+	so the render path can be benchmarked on the CPU alone.
+*/
+class NullBackend : public GfxBackend
+{
+public:
+	NullBackend(UINT width, UINT height);
+
+	DXDevice* get_dx_device() const override { return nullptr; }
+	AnnotationPtr get_annotation() const override { return nullptr; }
+	unique_ptr<ShaderCompiler> create_shader_compiler() const override { return nullptr; }
+
+	std::pair<UINT, UINT> get_sc_dim() const override { return m_dim; }
+	void get_backbuffer(GPUTexture* backbuffer) override;
+	void resize_swapchain(UINT width, UINT height, GPUTexture* backbuffer) override { m_dim = { width, height }; }
+	void present(bool vsync) override {}
+
+	void frame_start() override {}
+	void set_name(const GPUType* device_child, const std::string& name) override {}
+
+	void create_buffer(const BufferDesc& desc, GPUBuffer* buffer, std::optional<SubresourceData> subres) override {}
+	void create_texture(const TextureDesc& desc, GPUTexture* texture, const std::vector<SubresourceData>& subres) override;
+	void create_sampler(const SamplerDesc& desc, Sampler* sampler) override {}
+	void create_shader(ShaderStage stage, const ShaderBytecode& bytecode, Shader* shader) override;
+	void create_pipeline(const PipelineDesc& desc, const Shader* vs, GraphicsPipeline* pipeline) override;
+
+	D3D11_TEXTURE2D_DESC describe_texture(const GPUTexture* texture) const override;
+
+	void begin_pass(const RenderPass* rp, const PassTargets& targets, DepthStencilClear ds_clear) override {}
+	void end_pass(const RenderPass* rp, const PassTargets& targets) override {}
+
+	void bind_pipeline(const GraphicsPipeline* pipeline, const std::array<const Shader*, 5>& vs_ps_gs_hs_ds, const std::array<FLOAT, 4>& blend_factor, UINT stencil_ref) override {}
+	void bind_compute_shader(const Shader* cs) override {}
+	void bind_vertex_buffers(UINT start_slot, UINT count, const GPUBuffer* const* buffers, const UINT* strides, const UINT* offsets) override {}
+	void bind_index_buffer(const GPUBuffer* buffer, DXGI_FORMAT format, UINT offset) override {}
+	void bind_constant_buffer(UINT slot, ShaderStage stage, const GPUBuffer* buffer, UINT offset256s, UINT range256s) override {}
+	void bind_resource(UINT slot, ShaderStage stage, const GPUResource* resource) override {}
+	void bind_resource_rw(UINT slot, ShaderStage stage, const GPUResource* resource, UINT initial_count) override {}
+	void bind_sampler(UINT slot, ShaderStage stage, const Sampler* sampler) override {}
+	void bind_viewports(const std::vector<D3D11_VIEWPORT>& viewports) override {}
+	void bind_scissors(const std::vector<D3D11_RECT>& rects) override {}
+
+	void update_subresource(const GPUResource* dst, const SubresourceData& data, const D3D11_BOX& dst_box, UINT dst_subres_idx) override {}
+	void map_copy(const GPUResource* dst, const SubresourceData& data, D3D11_MAP map_type, UINT dst_subres_idx) override {}
+	std::pair<float, float> map_read_temp(const GPUBuffer* buffer) override { return { 1.f, 0.f }; }		// full (reversed) depth range
+	void copy_resource_region(const GPUResource* dst, const CopyRegionDst& dst_desc, const GPUResource* src, const CopyRegionSrc& src_desc) override {}
+	void copy_resource_region(const GPUResource* dst, const CopyRegionDst& dst_desc, const GPUResource* src, UINT src_subres) override {}
+
+	void dispatch(UINT blocks_x, UINT blocks_y, UINT blocks_z) override {}
+	void draw(UINT vertex_count, UINT start_loc) override {}
+	void draw_indexed(UINT index_count, UINT index_start, UINT vertex_start) override {}
+
+private:
+	std::pair<UINT, UINT> m_dim;
+};
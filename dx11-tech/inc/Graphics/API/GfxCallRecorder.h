@@ -0,0 +1,117 @@
+#pragma once
+#include "Graphics/API/GfxHandles.h"
+#include "Json.h"
+
+enum class GfxCall : uint8_t
+{
+	eCreateBuffer,
+	eCreateTexture,
+	eCreateSampler,
+	eCreateShader,
+	eCreatePipeline,
+	eCreateComputePipeline,
+	eCreateRenderPass,
+	eFree,
+
+	eBeginPass,
+	eEndPass,
+	eBindPipeline,
+	eBindComputePipeline,
+	eBindVertexBuffers,
+	eBindIndexBuffer,
+	eBindConstantBuffer,
+	eBindResource,
+	eBindResourceRW,
+	eBindSampler,
+	eBindViewports,
+	eBindScissors,
+
+	eMapCopy,
+	eUpdateSubresource,
+	eMapRead,
+	eCopyRegion,
+
+	eDraw,
+	eDrawIndexed,
+	eDispatch,
+	ePresent,
+
+	eCount
+};
+
+const char* to_string(GfxCall call);
+
+/*
+	Optional recording layer sitting between the GfxDevice interface and the backend (D3D11 or headless).
+
+	- Counts every call made on the GfxDevice (requested) and how many of them made it past
+	  redundant state filtering down to the backend (issued)
+	- Flags calls made with handles that are stale or were never created
+	- Tracks the state bound at each draw/dispatch
+	- Optionally keeps the full call stream which can be written to disk for offline inspection
+
+	Enabled through GfxDevice::enable_recording(), costs nothing when off.
+*/
+class GfxCallRecorder
+{
+public:
+	struct CallStats
+	{
+		uint64_t requested = 0;
+		uint64_t issued = 0;
+		uint64_t invalid_handles = 0;
+	};
+	using Stats = std::array<CallStats, (size_t)GfxCall::eCount>;
+
+	struct Entry
+	{
+		uint64_t frame;
+		GfxCall call;
+		bool issued;
+		bool valid;
+		res_handle hdl;
+		uint32_t slot;
+	};
+
+	// State bound when the last draw/dispatch was recorded
+	struct BoundState
+	{
+		res_handle pipeline = 0;
+		res_handle compute_pipeline = 0;
+		res_handle index_buffer = 0;
+		res_handle renderpass = 0;
+	};
+
+public:
+	GfxCallRecorder(bool serialize_stream = false);
+
+	void record(GfxCall call, bool issued, res_handle hdl = 0, bool valid = true, uint32_t slot = 0);
+
+	void frame_start();
+
+	void set_serialize_stream(bool serialize);
+	void clear_stream();
+	const std::vector<Entry>& get_stream() const;
+	bool write_stream(const std::filesystem::path& path) const;
+
+	const Stats& get_frame_stats() const;
+	const Stats& get_total_stats() const;
+	const BoundState& get_bound_state() const;
+	uint64_t get_frame() const;
+
+	// Fraction of requested bind calls removed by the redundant state filter
+	static float filter_efficiency(const Stats& stats);
+
+	JsonValue to_json(const Stats& stats) const;
+
+private:
+	bool m_serialize = false;
+	uint64_t m_frame = 0;
+
+	Stats m_frame_stats{};
+	Stats m_total_stats{};
+	BoundState m_bound;
+	BoundState m_tracked;		// latest requested state, promoted to m_bound on draws/dispatches
+
+	std::vector<Entry> m_stream;
+};
@@ -41,6 +41,7 @@ private:
 class PipelineDesc
 {
 	friend class GfxDevice;
+	friend class DXBackend;
 
 	// Strongly typed shaders for safer public interface
 	// https://www.fluentcpp.com/2016/12/08/strong-types-for-strong-interfaces/
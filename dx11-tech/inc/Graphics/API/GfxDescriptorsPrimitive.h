@@ -5,6 +5,7 @@
 class BufferDesc
 {
 	friend class GfxDevice;
+	friend class DXBackend;
 public:
 	BufferDesc() = default;
 	BufferDesc(const D3D11_BUFFER_DESC& desc) : m_desc(desc), m_type(BufferType::eCustom) {}
@@ -33,6 +34,8 @@ class TextureDesc
 	
 
 	friend class GfxDevice;
+	friend class DXBackend;
+	friend class NullBackend;
 public:
 	TextureDesc() = default;
 	TextureDesc(const D3D11_TEXTURE2D_DESC& desc) : m_desc(desc), m_type(TextureType::e2D), m_render_target_clear(RenderTextureClear::black()) {}
@@ -74,6 +77,7 @@ class InputLayoutDesc
 	// https://gamedev.net/forums/topic/631296-what-is-the-point-of-multiple-vertex-buffers/4980091/
 
 	friend class GfxDevice;
+	friend class DXBackend;
 public:
 	InputLayoutDesc() = default;
 	InputLayoutDesc(const std::vector<D3D11_INPUT_ELEMENT_DESC>& descs) : m_input_descs(descs) {}
@@ -95,6 +99,7 @@ private:
 class SamplerDesc
 {
 	friend class GfxDevice;
+	friend class DXBackend;
 public:
 	SamplerDesc() = default;
 	SamplerDesc(const D3D11_SAMPLER_DESC& desc) : m_sampler_desc(desc) {}
@@ -110,6 +115,7 @@ private:
 class RasterizerDesc 
 {
 	friend class GfxDevice;
+	friend class DXBackend;
 public:
 	RasterizerDesc() = default;
 	RasterizerDesc(const D3D11_RASTERIZER_DESC1& desc) : m_rasterizer_desc(desc) {}
@@ -126,6 +132,7 @@ private:
 class BlendDesc 
 {
 	friend class GfxDevice;
+	friend class DXBackend;
 public:
 	BlendDesc() = default;
 	BlendDesc(const D3D11_BLEND_DESC1& desc) : m_blend_desc(desc) {}
@@ -145,6 +152,7 @@ private:
 class DepthStencilDesc 
 {
 	friend class GfxDevice;
+	friend class DXBackend;
 public:
 	DepthStencilDesc()
 	{
@@ -4,8 +4,12 @@
 #include "Graphics/API/GfxCommon.h"
 #include "Graphics/API/GfxDescriptorsPrimitive.h"
 #include "Graphics/API/GfxDescriptorsAbstraction.h"
+#include "Graphics/API/GfxBackend.h"
 #include "Graphics/API/GfxHelperTypes.h"
 #include "Graphics/API/GfxHandles.h"
+#include "Graphics/API/GfxCallRecorder.h"
+#include "Graphics/API/ShaderCache.h"
+#include "Graphics/API/ShaderBatch.h"
 #include "Profiler/GPUProfiler.h"
 #include "ResourceHandlePool.h"
 
@@ -25,6 +29,7 @@ struct Sampler;
 class GfxDevice
 {
 	friend class ImGuiDevice;
+	friend class ShaderBatch;
 public:
 	// Book-keeping (e.g cleanup)
 	void frame_start();	
@@ -35,28 +40,45 @@ public:
 	GPUProfiler* get_profiler();
 	GPUAnnotator* get_annotator();
 
+	bool is_headless() const;
 	std::pair<UINT, UINT> get_sc_dim();
 	void resize_swapchain(UINT width, UINT height);
 	void set_name(BufferHandle res, const std::string& name);
 	void set_name(TextureHandle res, const std::string& name);
 	void set_name(SamplerHandle res, const std::string& name);
 
-	void recompile_pipeline_shaders_by_name(const std::string& name);
+	// Recompiles (in parallel) every loaded shader that is or includes the file, e.g shaders/ShaderInterop_Renderer.h,
+	// and rebuilds only the pipelines using them. Dependencies are recorded whenever a shader is compiled.
+	ShaderReloadStats reload_shaders(const std::filesystem::path& file);
+
+	// Directories of every source and include the loaded shaders were compiled from, e.g shaders and inc
+	std::vector<std::filesystem::path> get_shader_directories() const;
+
+	// Call recording (per call counts, handle validation, bound state, optional call stream)
+	void enable_recording(bool serialize_stream = false);
+	void disable_recording();
+	GfxCallRecorder* get_recorder();
 
 	// Resource creation
 	BufferHandle create_buffer(const BufferDesc& desc, std::optional<SubresourceData> subres = {});
 	TextureHandle create_texture(const TextureDesc& desc, std::optional<SubresourceData> subres = {});
+	TextureHandle create_texture(const TextureDesc& desc, const std::vector<SubresourceData>& subres);		// one per subresource (e.g full mip chain)
+	void replace_texture(TextureHandle hdl, const TextureDesc& desc, const std::vector<SubresourceData>& subres);	// recreated in place, the handle stays valid
+	void trim_texture(TextureHandle hdl, const TextureDesc& desc, UINT first_mip);		// recreated in place from its mips [first_mip, ...) copied on the GPU
 	PipelineHandle create_pipeline(const PipelineDesc& desc);
 	ComputePipelineHandle create_compute_pipeline(const ComputePipelineDesc& desc);
 	RenderPassHandle create_renderpass(const RenderPassDesc& desc);
 
 	ShaderHandle compile_and_create_shader(ShaderStage stage, const std::filesystem::path& fname);
 	ShaderHandle create_shader(ShaderStage stage, const ShaderBytecode& bytecode);
+	ShaderBatch compile_shaders(const std::vector<ShaderBatch::Source>& shaders);		// compiled on jobs::pool, see ShaderBatch
+	ShaderCache::Stats get_shader_cache_stats() const { return m_shader_cache ? m_shader_cache->get_stats() : ShaderCache::Stats{}; }
 	SamplerHandle create_sampler(const SamplerDesc& desc);
 
 	// Resource destruction
 	void free_buffer(BufferHandle hdl);
 	void free_texture(TextureHandle hdl);
+	void discard_texture(TextureHandle hdl);		// GPU memory freed, the handle stays reserved until replace_texture or free_texture
 	void free_sampler(SamplerHandle hdl);
 	void free_shader(ShaderHandle hdl);
 	void free_pipeline(PipelineHandle hdl);
@@ -99,6 +121,7 @@ public:
 	void present(bool vsync = true);
 
 	void copy_resource_region(BufferHandle dst, const CopyRegionDst& dst_dsc, BufferHandle src, const CopyRegionSrc& src_desc);
+	void copy_resource_region(TextureHandle dst, const CopyRegionDst& dst_dsc, TextureHandle src, UINT src_subres);		// whole source subresource (e.g a mip into an array slice)
 
 	// Temporary reader (playing with readback with WIP SDSM)
 	std::pair<float, float> map_read_temp(BufferHandle buf);
@@ -141,50 +164,62 @@ public:
 	// Helper implementations
 private:
 
-	void create_texture(const TextureDesc& desc, GPUTexture* texture, std::optional<SubresourceData> subres = {});
-	void create_buffer(const BufferDesc& desc, GPUBuffer* buffer, std::optional<SubresourceData> subres = {});
+	void create_texture(const TextureDesc& desc, GPUTexture* texture, const std::vector<SubresourceData>& subres = {});
 	void create_shader(ShaderStage stage, const ShaderBytecode& bytecode, Shader* shader);
-	void create_sampler(const SamplerDesc& desc, Sampler* sampler);
 	void compile_shader(ShaderStage stage, const std::filesystem::path& fname, ShaderBytecode* bytecode, bool recompilation);
+	bool compile_shader(ShaderStage stage, const std::filesystem::path& fname, ShaderBytecode* bytecode, std::string& error);		// thread-safe
+	void set_shader_dependencies(const std::string& fname, const std::vector<std::filesystem::path>& files);					// thread-safe
 	void compile_and_create_shader(ShaderStage stage, const std::filesystem::path& fname, Shader* shader, bool recompilation = false);
 	void create_pipeline(const PipelineDesc& desc, GraphicsPipeline* pipeline);
 	void create_renderpass(const RenderPassDesc& desc, RenderPass* RenderPass);
 
+	PassTargets get_pass_targets(const RenderPass* RenderPass);
 	void begin_pass(const RenderPass* RenderPass, DepthStencilClear ds_clear = DepthStencilClear::d1_s0());
 
-	void bind_resource(UINT slot, ShaderStage stage, const GPUResource* resource);
-	void bind_resource_rw(UINT slot, ShaderStage stage, const GPUResource* resource, UINT initial_count);
-	void bind_sampler(UINT slot, ShaderStage stage, const Sampler* sampler);
-	void bind_constant_buffer(UINT slot, ShaderStage stage, const GPUBuffer* buffer, UINT offset256s = 0, UINT range256s = 1);
 	void bind_pipeline(const GraphicsPipeline* pipeline, std::array<FLOAT, 4> blend_factor = { 1.f, 1.f, 1.f, 1.f }, UINT stencil_ref = 0);
-	
-	void update_subresource(const GPUResource* dst, const SubresourceData& data, const D3D11_BOX& dst_box, UINT dst_subres_idx = 0);
 	void map_copy(const GPUResource* dst, const SubresourceData& data, D3D11_MAP map_type = D3D11_MAP_WRITE_DISCARD, UINT dst_subres_idx = 0);
 
+	// Bindings are filtered by handle, the views of a recreated texture must not be considered bound
+	void forget_bound_texture(TextureHandle hdl);
+
+	// Recording hooks, validation is done before the (asserting) pool look up
+	template <typename Pool>
+	void track(GfxCall call, bool issued, const Pool& pool, res_handle hdl, uint32_t slot = 0)
+	{
+		if (m_recorder)
+			m_recorder->record(call, issued, hdl, pool.is_valid(hdl), slot);
+	}
+	void track(GfxCall call, bool issued = true)
+	{
+		if (m_recorder)
+			m_recorder->record(call, issued);
+	}
+
 public:
-	static void initialize(unique_ptr<DXDevice> dx_device);
+	static void initialize(unique_ptr<DXDevice> dx_device);		// DXBackend
+	static void initialize_headless(UINT width, UINT height);		// NullBackend, no D3D11 device, only CPU side bookkeeping (benchmarking)
 	static void shutdown();
 
 	GfxDevice() = delete;
-	GfxDevice(unique_ptr<class DXDevice> dev);
+	GfxDevice(unique_ptr<GfxBackend> backend);
 	~GfxDevice();
 
 	GfxDevice& operator=(const GfxDevice&) = delete;
 	GfxDevice(const GfxDevice&) = delete;
 
 private:
-	// Backend device
-	unique_ptr<DXDevice> m_dev;
+	// Everything forwarded to the driver goes through here
+	unique_ptr<GfxBackend> m_backend;
 
 	// Miscellaneous
 	TextureHandle m_backbuffer;
 	unique_ptr<GPUProfiler> m_profiler;
 	unique_ptr<GPUAnnotator> m_annotator;
+	unique_ptr<GfxCallRecorder> m_recorder;
 
-	// Raster UAVs (bindable to VS, DS, HS, GS, PS)
-	std::array<ID3D11UnorderedAccessView*, gfxconstants::MAX_BOUND_UAVS> m_raster_uavs;
-	std::array<UINT, gfxconstants::MAX_BOUND_UAVS> m_raster_uav_initial_counts;
-	UINT m_raster_rw_range_this_pass = 0;
+	// Shader compilation (bytecode cached on disk)
+	unique_ptr<ShaderCompiler> m_shader_compiler;
+	unique_ptr<ShaderCache> m_shader_cache;
 
 	// State
 	bool m_inside_pass = false;
@@ -208,6 +243,8 @@ private:
 
 	std::array<BufferHandle, gfxconstants::MAX_INPUT_SLOTS> m_bound_vbs;
 	BufferHandle m_bound_ib;
+	DXGI_FORMAT m_bound_ib_format = DXGI_FORMAT_UNKNOWN;		// 16 and 32 bit ranges may share an index buffer
+	UINT m_bound_ib_offset = 0;
 
 	/*
 		TO-DO: We should create Common Samplers which we can return. (Check DXTK for common samplers reference)
@@ -235,7 +272,13 @@ private:
 	// Pipeline reloading by shader name (should be refactored into some PipelineManager)
 	std::map<std::string, std::vector<PipelineHandle>> m_loaded_pipelines;
 	std::map<std::string, std::vector<ComputePipelineHandle>> m_loaded_compute_pipelines;
+	std::map<res_handle, PipelineDesc> m_loaded_pipeline_descs;		// to rebuild input layouts against a recompiled VS
 	bool m_reloading_on = true;
+
+	// Include graph: file (as gathered by ShaderCache) --> shader names depending on it, and the reverse
+	std::map<std::string, std::set<std::string>> m_shader_dependents;
+	std::map<std::string, std::vector<std::string>> m_shader_dependencies;
+	mutable std::mutex m_shader_dependencies_mutex;
 };
 
 
@@ -26,6 +26,7 @@ private:
 class RenderTextureClear
 {
 	friend class GfxDevice;
+	friend class DXBackend;
 public:
 	RenderTextureClear(std::array<float, 4> rgba = { 0.f, 0.f, 0.f, 1.f }) :
 		m_rgba(rgba)
@@ -41,6 +42,7 @@ private:
 class DepthStencilClear
 {
 	friend class GfxDevice;
+	friend class DXBackend;
 public:
 
 #ifdef REVERSE_Z_DEPTH
@@ -90,6 +92,7 @@ private:
 class SubresourceData
 {
 	friend class GfxDevice;
+	friend class DXBackend;
 public:
 	SubresourceData() = default;
 
@@ -108,10 +111,20 @@ struct ShaderBytecode
 	// we can use the extension to check if the pipeline is reloadable
 };
 
+// Result of GfxDevice::reload_shaders
+struct ShaderReloadStats
+{
+	uint32_t shaders = 0;			// recompiled, once per file and stage
+	uint32_t failures = 0;			// kept as they were
+	uint32_t pipelines = 0;			// graphics and compute pipelines rebuilt
+	float ms = 0.f;
+};
+
 
 class CopyRegionDst
 {
 	friend class GfxDevice;
+	friend class DXBackend;
 public:
 	CopyRegionDst() = delete;
 	~CopyRegionDst() = default;
@@ -134,6 +147,7 @@ private:
 class CopyRegionSrc
 {
 	friend class GfxDevice;
+	friend class DXBackend;
 public:
 	CopyRegionSrc() = delete;
 	~CopyRegionSrc() = default;
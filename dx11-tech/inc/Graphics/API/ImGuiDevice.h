@@ -32,5 +32,6 @@ private:
 
 private:
 	std::unordered_map<std::string, std::function<void()>> m_ui_callbacks;
+	bool m_headless = false;
 };
 
@@ -0,0 +1,60 @@
+#pragma once
+#include "Graphics/API/GfxCommon.h"
+#include "Graphics/API/GfxHandles.h"
+#include "Graphics/API/GfxHelperTypes.h"
+#include <future>
+
+class GfxDevice;
+
+/*
+	Shaders compiled concurrently on jobs::pool (through the ShaderCache of the device), created from GfxDevice::compile_shaders.
+
+	Every source starts compiling on construction, get() waits for that one shader only and creates it on the calling
+	thread, so a pipeline can be created as soon as its own shaders are done while the rest keep compiling.
+	Compile errors are reported per file on get(). Sources listed twice are compiled once.
+
+	The owning thread of the GfxDevice has to call get(), destruction waits for the compiles nobody asked for.
+*/
+class ShaderBatch
+{
+public:
+	struct Source
+	{
+		ShaderStage stage = ShaderStage::eNone;
+		std::filesystem::path fname;			// relative to the shader directory, as for compile_and_create_shader
+	};
+
+public:
+	ShaderBatch(GfxDevice* dev, const std::vector<Source>& sources);
+	~ShaderBatch();
+
+	ShaderBatch& operator=(const ShaderBatch&) = delete;
+	ShaderBatch(const ShaderBatch&) = delete;
+	ShaderBatch(ShaderBatch&&) noexcept = default;
+
+	// Invalid handle if the file failed to compile, a file compiled for several stages is one shader per stage
+	ShaderHandle get(ShaderStage stage, const std::filesystem::path& fname);
+
+	uint32_t get_failures() const { return m_failures; }
+
+private:
+	struct Compiled
+	{
+		ShaderBytecode bytecode;
+		std::string error;
+		bool succeeded = false;
+	};
+
+	struct Entry
+	{
+		Source source;
+		std::future<Compiled> compiled;
+		ShaderHandle handle;
+		bool created = false;
+	};
+
+private:
+	GfxDevice* m_dev = nullptr;
+	std::vector<Entry> m_entries;
+	uint32_t m_failures = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include "Graphics/API/ShaderCompiler.h"
+#include <mutex>
+
+/*
+	Persistent bytecode cache in front of a ShaderCompiler.
+
+	The key of a request is a hash (utils::hash_bytes) of the source, every file it transitively includes
+	(#include "..." resolved relative to the including file, e.g ShaderInterop_*.h and ../inc/DepthDefines.h),
+	the entry point, target, flags and compiler version. A matching cache entry skips compilation entirely.
+
+	Entries live under cooked/shaders/, one file per source, entry, target and flags holding the key it was compiled
+	for, so an edit overwrites the stale entry instead of adding another. Failed compilations are never cached.
+	Each entry stores how long its compilation took, a hit counts that minus its lookup time as startup time saved.
+
+	compile() is thread-safe as long as the same request isn't compiled concurrently (see ShaderBatch).
+*/
+class ShaderCache
+{
+public:
+	static constexpr uint32_t VERSION = 1;
+	static constexpr const char* COOKED_DIRECTORY = "cooked/shaders/";
+
+	struct Stats
+	{
+		uint32_t requests = 0;
+		uint32_t hits = 0;
+		uint32_t compiles = 0;
+		uint32_t failures = 0;
+		float compile_ms = 0.f;			// spent compiling misses
+		float lookup_ms = 0.f;			// spent hashing sources and reading entries
+		float saved_ms = 0.f;			// recorded compile time of the hits minus their lookup time
+
+		float get_hit_rate() const { return requests > 0 ? hits / (float)requests : 0.f; }
+	};
+
+public:
+	// The compiler is not owned
+	ShaderCache(ShaderCompiler* compiler, const std::filesystem::path& directory = COOKED_DIRECTORY);
+
+	// files receives what the request depends on (see gather_files), also when the compilation fails
+	bool compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& error, std::vector<std::filesystem::path>* files = nullptr);
+
+	// 0 if the source can't be read
+	uint64_t compute_key(const ShaderCompileRequest& request) const;
+	uint64_t compute_key(const ShaderCompileRequest& request, const std::vector<std::filesystem::path>& files) const;		// files from gather_files
+
+	// Cache file of a request, independent of the source contents
+	std::filesystem::path get_cache_path(const ShaderCompileRequest& request) const;
+
+	// Source followed by its transitive quoted includes, each once, in include order
+	static std::vector<std::filesystem::path> gather_files(const std::filesystem::path& source);
+
+	void set_enabled(bool enabled) { m_enabled = enabled; }
+	Stats get_stats() const;
+
+private:
+	bool load(const std::filesystem::path& path, uint64_t key, std::vector<uint8_t>& bytecode, float& compile_ms) const;
+	bool store(const std::filesystem::path& path, uint64_t key, const std::vector<uint8_t>& bytecode, float compile_ms) const;
+
+private:
+	ShaderCompiler* m_compiler = nullptr;
+	std::filesystem::path m_directory;
+	bool m_enabled = true;
+	mutable std::mutex m_stats_mutex;
+	Stats m_stats;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+struct ShaderCompileRequest
+{
+	std::filesystem::path path;		// HLSL source, includes are resolved relative to the including file
+	std::string entry = "main";
+	std::string target;				// e.g vs_5_0
+	uint32_t flags = 0;				// D3DCOMPILE_*
+};
+
+/*
+	Source to bytecode compilation, GfxDevice compiles through a ShaderCache wrapping one of these.
+	Implementations have to be stateless across requests so the cache can be tested against a stub compiler.
+*/
+class ShaderCompiler
+{
+public:
+	virtual ~ShaderCompiler() = default;
+
+	// error holds the compiler output on failure
+	virtual bool compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& error) = 0;
+
+	// Part of the cache key, bytecode of another compiler version is never reused
+	virtual uint64_t get_version() const = 0;
+};
+
+// D3DCompile of the source and its includes read through VirtualFile (packaged or on disk)
+class D3DShaderCompiler : public ShaderCompiler
+{
+public:
+	bool compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& error) override;
+	uint64_t get_version() const override;
+};
+
+// Compiles nothing: the bytecode is a hash of the source and request, so ShaderCache can be checked without D3DCompile
+class StubShaderCompiler : public ShaderCompiler
+{
+public:
+	bool compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& error) override;
+	uint64_t get_version() const override { return 1; }
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include "FileWatcher.h"
+
+/*
+	Hot reload of the assets in use, driven by FileWatchers on the asset directories and dispatched once per frame by extension:
+		- .hlsl .hlsli .h		GfxDevice::reload_shaders, recompiles the shaders that are or include the file
+		- images				MaterialManager::reload_texture, the texture is recreated in place (or split from the
+								  other paths sharing it by content, see DiskTextureManager::reload)
+		- anything else			ModelManager::reload_models, models from the file or next to it (e.g .mtl, .bin)
+
+	Only loaded assets are touched, changes to files nothing was loaded from are counted as ignored.
+
+	Besides the asset directories, every directory the loaded shaders include from (GfxDevice::get_shader_directories)
+	is watched on its own, non recursively. Create the reloader once the shaders are loaded.
+*/
+class AssetReloader
+{
+public:
+	struct Stats
+	{
+		uint32_t shader_files = 0;
+		uint32_t textures = 0;
+		uint32_t models = 0;
+		uint32_t ignored = 0;
+	};
+
+public:
+	AssetReloader(class GfxDevice* dev, class MaterialManager* mat_mgr, class ModelManager* model_mgr,
+		const std::vector<std::filesystem::path>& directories = { "shaders", "models", "textures" });
+	~AssetReloader() = default;
+
+	AssetReloader& operator=(const AssetReloader&) = delete;
+	AssetReloader(const AssetReloader&) = delete;
+
+	// Reloads what changed since the last call, owning thread only
+	void update();
+
+	const Stats& get_stats() const { return m_stats; }
+
+private:
+	void reload(const std::filesystem::path& file);
+
+private:
+	GfxDevice* m_dev = nullptr;
+	MaterialManager* m_mat_mgr = nullptr;
+	ModelManager* m_model_mgr = nullptr;
+
+	std::vector<unique_ptr<FileWatcher>> m_watchers;
+	Stats m_stats;
+};
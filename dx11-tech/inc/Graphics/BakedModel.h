@@ -0,0 +1,116 @@
+#pragma once
+#include "AssimpTypes.h"
+#include "VirtualFile.h"
+#include "Graphics/MeshCluster.h"
+#include "Graphics/MeshLod.h"
+
+/*
+	Non-owning view of everything a Model is built from, either from an AssimpLoader or a baked file.
+	Vertex data is non-interleaved, same as the AssimpLoader output.
+*/
+struct ModelSourceView
+{
+	const float* positions = nullptr;		// xyz
+	const float* uvs = nullptr;				// uv
+	const float* normals = nullptr;			// xyz
+	uint32_t vertex_count = 0;
+	uint32_t uv_count = 0;					// either 0 or vertex_count
+
+	const uint8_t* indices = nullptr;		// 16 and/or 32 bit, see AssimpMeshData::index_stride
+	uint64_t index_bytes = 0;
+
+	const MeshCluster* clusters = nullptr;	// referenced by AssimpMeshData::cluster_start/count
+	uint32_t cluster_count = 0;
+
+	const MeshLod* lods = nullptr;			// referenced by AssimpMeshData::lod_start/count
+	uint32_t lod_count = 0;
+
+	std::vector<AssimpMeshData> meshes;
+	std::vector<AssimpMaterialData> materials;
+};
+
+/*
+	Cooked AssimpLoader output so models can be loaded without importing the source asset.
+
+	File layout (every section 16 byte aligned, offsets from the start of the file):
+		Header
+		positions		float3 * vertex_count
+		uvs				float2 * uv_count
+		normals			float3 * vertex_count
+		indices			index_bytes (16 bit meshes, then 32 bit meshes, see MeshOptimizer)
+		meshes			AssimpMeshData * mesh_count
+		clusters		MeshCluster * cluster_count
+		lods			MeshLod * lod_count
+		materials		Material * material_count (offsets into the string table)
+		strings			null terminated material texture paths
+
+	The file is memory mapped (or read from an AssetPackage, see VirtualFile) and used in place, nothing is parsed.
+	A cook is stale when the version or the hash of the source asset (see hash_source) differs.
+*/
+class BakedModel
+{
+public:
+	static constexpr uint32_t VERSION = 4;						// bump when the layout or the import flags change
+	static constexpr const char* COOKED_DIRECTORY = "cooked/";
+
+	struct Header
+	{
+		char magic[4] = { 'D', 'X', 'B', 'M' };
+		uint32_t version = VERSION;
+		uint64_t source_hash = 0;
+		uint64_t file_size = 0;
+
+		uint32_t vertex_count = 0;
+		uint32_t uv_count = 0;
+		uint32_t mesh_count = 0;
+		uint32_t material_count = 0;
+		uint64_t index_bytes = 0;
+		uint32_t cluster_count = 0;
+		uint32_t lod_count = 0;
+
+		uint64_t positions_offset = 0;
+		uint64_t uvs_offset = 0;
+		uint64_t normals_offset = 0;
+		uint64_t indices_offset = 0;
+		uint64_t meshes_offset = 0;
+		uint64_t clusters_offset = 0;
+		uint64_t lods_offset = 0;
+		uint64_t materials_offset = 0;
+		uint64_t strings_offset = 0;
+		uint64_t strings_size = 0;
+	};
+
+	struct Material
+	{
+		uint32_t diffuse = 0;
+		uint32_t normal = 0;
+		uint32_t specular = 0;
+		uint32_t opacity = 0;
+	};
+
+public:
+	// Hash of the source asset and the files it references (e.g .mtl for .obj), 0 only if the source can't be read
+	static uint64_t hash_source(const std::filesystem::path& source);
+
+	// e.g models/sponza/sponza.obj --> cooked/models/sponza/sponza.obj.dxbm
+	static std::filesystem::path get_cooked_path(const std::filesystem::path& source);
+
+	static bool cook(const ModelSourceView& source, uint64_t source_hash, const std::filesystem::path& out_path);
+
+public:
+	BakedModel() = default;
+	BakedModel(const std::filesystem::path& path);
+
+	// Mapped, well formed and cooked from a source with the given hash, never for a missing source (hash 0)
+	bool is_valid(uint64_t source_hash) const;
+
+	// Points into the mapped file, valid as long as this BakedModel is alive
+	ModelSourceView get_view() const;
+
+private:
+	const Header* get_header() const;
+
+private:
+	VirtualFile m_file;
+	bool m_well_formed = false;
+};
@@ -15,6 +15,7 @@ namespace gfxcommand
 
 		// Geometry
 		BufferHandle ib;
+		DXGI_FORMAT ib_format = DXGI_FORMAT_R32_UINT;
 		uint32_t index_start = 0;
 		uint32_t index_count = 0;
 		uint32_t vertex_start = 0;
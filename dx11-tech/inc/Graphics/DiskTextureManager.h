@@ -1,8 +1,95 @@
 #pragma once
 #include "Graphics/API/GfxHandles.h"
+#include "Graphics/TextureCooker.h"
+#include "Graphics/TextureStreamer.h"
+#include "ContentCache.h"
 
+/*
+	Loads textures from disk, deduplicated by path and by content: files are hashed first (utils::hash_bytes) and a path
+	whose bytes match an already loaded texture shares its GPU texture without being decoded (see ContentCache).
+	load_batch decodes every new texture of the batch concurrently on jobs::pool and then uploads them in order on the calling thread.
+	Both halves can also be run apart, decode_batch on any thread and upload_batch later on the owning thread.
+
+	With texture cooking on (default), textures are uploaded as block compressed mip chains from the DDS cache under cooked/
+	(see TextureCooker), a missing or stale cache entry is cooked from the decoded source on the spot.
+	Sources the cooker can't handle (dimensions not a multiple of 4) fall back to RGBA8 with GPU generated mips.
+
+	With texture streaming on (default), cooked textures are loaded with their low mips only and handed to the TextureStreamer,
+	which brings in the higher mips on demand. Streaming has to be set before the textures are loaded.
+
+	Textures are shared by reference count (see MaterialManager): release frees a texture once its last reference is gone.
+	Textures never referenced stay loaded until remove.
+
+	reload recreates a loaded texture in place from its changed file (see AssetReloader), materials keep their handle.
+	A texture shared by content with other paths is left to them instead: the edited path gets a new texture, which
+	its materials are moved to (see MaterialManager::reload_texture).
+
+	With texture packing on (off by default), every load_batch ends with pack: the fully resident cooked textures of the batch
+	(i.e not streamed) sharing a format, size and mip count are copied into the slices of one Texture2DArray, so draws using
+	any of them bind the same SRV and pick their slice from per draw data (see ModelRenderer).
+	A packed texture's own GPU memory is discarded once copied, its handle stays valid as the key to get_packed.
+	Reloaded with the same shape it is recreated from its file and copied to its slice again, otherwise it leaves its
+	array and stays recreated on its own. An array is freed with the last of its textures.
+	Packed textures have to be fully resident, so packing is off with streaming on: a benchmark mode (--pack-textures)
+	that the Application doesn't enable.
+*/
 class DiskTextureManager
 {
+public:
+	// Accumulated over every decode done by the manager
+	struct DecodeStats
+	{
+		uint32_t textures = 0;
+		uint64_t file_bytes = 0;		// compressed bytes read
+		uint64_t decoded_bytes = 0;		// bytes produced for upload (RGBA8 or block compressed mip chain)
+		uint32_t cache_hits = 0;		// loaded from the cooked cache, no decode
+		uint32_t cooked = 0;			// decoded and cooked
+		float time_ms = 0.f;			// wall time spent decoding (batches overlap decodes)
+
+		float get_throughput_mb_per_s() const { return time_ms > 0.f ? (decoded_bytes / (1024.f * 1024.f)) / (time_ms / 1000.f) : 0.f; }
+		DecodeStats& operator+=(const DecodeStats& rhs);
+	};
+
+	struct PackedTexture
+	{
+		TextureHandle array;
+		uint32_t slice = 0;
+	};
+
+	struct PackStats
+	{
+		uint32_t arrays = 0;
+		uint32_t slices = 0;			// packed textures
+		uint64_t bytes = 0;				// held by the arrays
+	};
+
+	struct DecodedImage
+	{
+		uint8_t* data = nullptr;
+		int width = 0;
+		int height = 0;
+		uint64_t file_bytes = 0;
+		uint64_t content_hash = 0;
+
+		// Replaces data when valid
+		TextureCooker::CookedTexture cooked;
+		bool cache_hit = false;
+	};
+
+	// Textures decoded ahead of their upload (see decode_batch), what is never uploaded is freed with it
+	struct DecodedBatch
+	{
+		std::vector<std::filesystem::path> paths;		// each once
+		std::vector<uint64_t> hashes;					// by path, 0 if the file can't be read
+		std::vector<DecodedImage> images;				// by path, empty for content decoded for an earlier path or already loaded
+		float decode_ms = 0.f;
+
+		DecodedBatch() = default;
+		~DecodedBatch();
+		DecodedBatch(DecodedBatch&& rhs) noexcept;
+		DecodedBatch& operator=(DecodedBatch&& rhs) noexcept;
+	};
+
 public:
 	static void initialize(class GfxDevice* dev);
 	static void shutdown();
@@ -11,14 +98,120 @@ public:
 	~DiskTextureManager();
 
 	TextureHandle load_from(const std::filesystem::path& fpath);
-	void remove(TextureHandle tex);
+
+	// Handles are returned in the order of the paths, failed loads return TextureHandle{0}
+	std::vector<TextureHandle> load_batch(const std::vector<std::filesystem::path>& fpaths);
+
+	// Thread-safe decode half of load_batch (e.g on the job importing a model), each content of the batch is decoded once.
+	// What is loaded isn't looked at, so the texture settings have to be set beforehand
+	DecodedBatch decode_batch(const std::vector<std::filesystem::path>& fpaths) const;
+
+	// Upload half of load_batch, owning thread only. Paths and content loaded since the decode are shared instead
+	std::vector<TextureHandle> upload_batch(DecodedBatch&& batch, const std::vector<std::filesystem::path>& fpaths);
+
+	// Returns the GPU bytes freed
+	uint64_t remove(TextureHandle tex);
+
+	void add_ref(TextureHandle tex);
+	uint64_t release(TextureHandle tex);		// GPU bytes freed, 0 while other references remain
+
+	// False if the path isn't loaded, its content didn't change or it fails to decode (the texture is kept).
+	// Afterwards get_texture tells whether the path got a new texture
+	bool reload(const std::filesystem::path& fpath);
+
+	// Texture loaded from the path (compared normalized), TextureHandle{0} if none
+	TextureHandle get_texture(const std::filesystem::path& fpath) const;
+
+	// Packs the textures not packed yet into arrays of at least min_slices textures, returns the number of textures packed
+	uint32_t pack(const std::vector<TextureHandle>& textures, uint32_t min_slices = 2);
+
+	// nullptr if the texture isn't packed
+	const PackedTexture* get_packed(TextureHandle tex) const;
+
+	const DecodeStats& get_decode_stats() const { return m_decode_stats; }
+	const ContentCache<TextureHandle>::Stats& get_content_stats() const { return m_content_cache.get_stats(); }
+	const PackStats& get_pack_stats() const { return m_pack_stats; }
+
+	void set_texture_cooking(bool enabled) { m_cook_textures = enabled; }
+	void set_texture_streaming(bool enabled) { m_stream_textures = enabled; }
+	void set_texture_packing(bool enabled) { m_pack_textures = enabled; }
+
+	TextureStreamer* get_streamer() { return &m_streamer; }
+
+private:
+	struct TextureEntry;
+
+	uint32_t get_stream_max_size() const { return m_stream_textures ? m_streamer.get_settings().initial_max_size : 0; }
+
+	// Thread-safe, 0 if the file can't be read
+	static uint64_t hash_file(const std::filesystem::path& fpath);
+
+	// Content already in loaded (if any) is left undecoded
+	DecodedBatch decode_batch(const std::vector<std::filesystem::path>& fpaths, const ContentCache<TextureHandle>* loaded) const;
+
+	// Thread-safe, cooked textures are read up to a top mip of stream_max_size (0 for the full chain)
+	static DecodedImage decode(const std::filesystem::path& fpath, bool cook, uint64_t content_hash, uint32_t stream_max_size);
+
+	// Uploads, frees the decoded data and caches the texture by path and content
+	TextureHandle upload(const std::filesystem::path& fpath, DecodedImage& image);
+
+	// Creates tex from a successfully decoded image, or recreates it in place if valid, fills the bytes and shape of the entry
+	void create_texture(const std::filesystem::path& fpath, DecodedImage& image, TextureHandle& tex, TextureEntry& entry);
+
+	// Copies every mip of the texture to its slice
+	void copy_to_slice(TextureHandle tex, const PackedTexture& packed, uint32_t mip_count);
+
+	// Takes the texture out of its array, returns the GPU bytes freed with the array.
+	// The texture itself has to be recreated if it stays loaded (see reload)
+	uint64_t unpack(TextureHandle tex);
+
+	// Drops the cached content only if tex is the texture cached for it
+	void erase_content(TextureHandle tex, uint64_t content_hash);
+
+	// Another path for an already loaded texture
+	void add_alias(const std::filesystem::path& fpath, TextureHandle tex);
+
+	static DecodeStats measure_decode(const std::vector<DecodedImage>& images, float time_ms);
 
 private:
 	GfxDevice* m_dev;
+	DecodeStats m_decode_stats;
+	bool m_cook_textures = true;
+	bool m_stream_textures = true;
+	bool m_pack_textures = false;
+	TextureStreamer m_streamer;
+
+	struct TextureEntry
+	{
+		uint64_t content_hash = 0;
+		std::vector<std::string> paths;
+		uint64_t bytes = 0;				// uploaded, streamed textures are tracked by the streamer
+		uint32_t refs = 0;
+
+		// Fully resident block compressed textures only (what pack accepts), DXGI_FORMAT_UNKNOWN otherwise
+		DXGI_FORMAT packable_format = DXGI_FORMAT_UNKNOWN;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mip_count = 0;
+	};
 
-	// Bidirectional hash map
-	std::unordered_map<TextureHandle, std::string> m_tex_to_path;
+	std::unordered_map<TextureHandle, TextureEntry> m_textures;
 	std::unordered_map<std::string, TextureHandle> m_path_to_tex;
+	ContentCache<TextureHandle> m_content_cache;
+
+	struct ArrayEntry
+	{
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mip_count = 0;
+		uint32_t live_slices = 0;		// freed at 0
+		uint64_t bytes = 0;
+	};
+
+	std::unordered_map<TextureHandle, PackedTexture> m_packed;
+	std::unordered_map<TextureHandle, ArrayEntry> m_arrays;
+	PackStats m_pack_stats;
 
 
 
@@ -0,0 +1,98 @@
+#pragma once
+#include "Graphics/API/GfxHandles.h"
+#include "Memory/RangeAllocator.h"
+
+/*
+	Shared vertex and index buffers that models are suballocated from (see RangeAllocator), so draws of different models
+	bind the same buffers and the redundant bind filtering of GfxDevice drops the rebinds.
+
+	Vertex streams live in chunks of settings.chunk_vertices vertices, one buffer per stream, a chunk only holds models with
+	the same stream strides (e.g full precision and VertexQuantizer streams are never mixed). Every stream of a model shares
+	one vertex range, so the model's meshes are rebased by one base vertex.
+	Indices live in chunks of settings.chunk_index_bytes bytes, allocations are 4 byte aligned so the 16 and 32 bit ranges of
+	a model stay addressable with their own stride.
+
+	A new chunk is created when no chunk of the kind has room, allocations larger than a chunk get a chunk of their own size.
+	Chunks are freed once their last allocation is.
+*/
+class GeometryHeap
+{
+public:
+	struct Settings
+	{
+		uint32_t chunk_vertices = 1 << 19;
+		uint64_t chunk_index_bytes = 16 * 1024 * 1024;
+	};
+
+	// A vertex stream of a model (data may be nullptr for a stream without data, e.g no texture coordinates)
+	struct Stream
+	{
+		const void* data = nullptr;
+		UINT stride = 0;
+	};
+
+	struct Allocation
+	{
+		uint32_t vertex_chunk = UINT32_MAX;
+		uint32_t index_chunk = UINT32_MAX;
+		uint32_t base_vertex = 0;
+		uint64_t index_offset = 0;		// bytes
+		uint64_t bytes = 0;				// vertex and index data
+		uint64_t vertex_bytes = 0;
+
+		bool is_valid() const { return vertex_chunk != UINT32_MAX && index_chunk != UINT32_MAX; }
+	};
+
+	struct Stats
+	{
+		uint32_t vertex_chunks = 0;
+		uint32_t index_chunks = 0;
+		uint32_t allocations = 0;
+		uint64_t capacity_bytes = 0;
+		uint64_t used_bytes = 0;
+		uint32_t free_ranges = 0;
+		float fragmentation = 0.f;		// per chunk fragmentation, averaged weighted by each chunk's free space
+	};
+
+public:
+	GeometryHeap(class GfxDevice* dev, const Settings& settings);
+	~GeometryHeap();
+
+	GeometryHeap& operator=(const GeometryHeap&) = delete;
+	GeometryHeap(const GeometryHeap&) = delete;
+
+	// Uploads the streams (all vertex_count long) and indices to the first chunks with room
+	Allocation allocate(const std::vector<Stream>& streams, uint32_t vertex_count, const void* indices, uint64_t index_bytes);
+	void free(const Allocation& allocation);
+
+	// Bindings of the chunks holding the allocation (vertex buffer, stride, offset)
+	const std::vector<std::tuple<BufferHandle, UINT, UINT>>& get_vbs(const Allocation& allocation) const;
+	BufferHandle get_ib(const Allocation& allocation) const;
+
+	Stats get_stats() const;
+
+private:
+	struct VertexChunk
+	{
+		std::vector<UINT> strides;
+		std::vector<std::tuple<BufferHandle, UINT, UINT>> vbs;		// empty once freed
+		RangeAllocator vertices;
+	};
+
+	struct IndexChunk
+	{
+		BufferHandle ib;											// 0 once freed
+		RangeAllocator bytes;
+	};
+
+	uint32_t allocate_vertices(const std::vector<UINT>& strides, uint32_t vertex_count, uint32_t& base_vertex);
+	uint32_t allocate_indices(uint64_t index_bytes, uint64_t& offset);
+
+private:
+	GfxDevice* m_dev = nullptr;
+	Settings m_settings;
+
+	// Freed chunks keep their slot (allocations refer to chunks by index) until reused
+	std::vector<VertexChunk> m_vertex_chunks;
+	std::vector<IndexChunk> m_index_chunks;
+};
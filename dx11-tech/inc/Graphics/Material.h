@@ -1,27 +1,45 @@
 #pragma once
 #include "Graphics/API/GfxHandles.h"
 
+/*
+	Fixed size, trivially copyable material: one texture per slot (0 if unused) and a dense 16 bit ID.
 
+	IDs are assigned by MaterialManager when a material is created and reused once it's removed, they stay below
+	MaterialManager::get_id_count() and can be used in sort keys and as indices into per material tables.
+*/
 class Material
 {
+	friend class MaterialManager;
 public:
-	enum class Texture
+	enum class Texture : uint8_t
 	{
 		eAlbedo,
-		eNormal
+		eNormal,
+
+		eCount
 	};
 
+	static constexpr uint16_t INVALID_ID = 0xffff;
+
 public:
 	Material() = default;
 	~Material() = default;
 
+	// The ID isn't part of the content
 	bool operator==(const Material& other) const { return other.m_textures == m_textures; };
 
-	Material& set_texture(Texture type, TextureHandle tex);
-	TextureHandle get_texture(Texture type) const;
+	// Equal materials hash equally (see MaterialManager deduplication)
+	uint64_t get_hash() const;
+
+	Material& set_texture(Texture type, TextureHandle tex) { m_textures[(size_t)type] = tex; return *this; }
+	TextureHandle get_texture(Texture type) const { return m_textures[(size_t)type]; }
+
+	uint16_t get_id() const { return m_id; }
 
 private:
-	std::map<Texture, TextureHandle> m_textures;
+	std::array<TextureHandle, (size_t)Texture::eCount> m_textures{};
+	uint16_t m_id = INVALID_ID;
 
 };
 
+static_assert(std::is_trivially_copyable_v<Material>);
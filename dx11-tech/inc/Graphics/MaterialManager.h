@@ -1,8 +1,22 @@
 #pragma once
-#include <map>
+#include <deque>
+#include <unordered_map>
 #include "Graphics/Material.h"
+#include "Graphics/DiskTextureManager.h"
 #include "AssimpTypes.h"
 
+/*
+	Owns every Material, indexed by its dense ID (see Material). Storage never moves, so the returned pointers stay valid.
+
+	Materials with the same textures are created once: a table keyed by Material::get_hash finds an existing equal material
+	in constant time, so loading n materials is O(n).
+
+	Every material returned by load_material(s) carries a reference for the caller to release. A material holds a reference
+	to each of its textures (DiskTextureManager), the last release of a material removes it and releases its textures.
+
+	Materials also remember the path their albedo was loaded from and are only shared by equal paths, so materials of
+	different files sharing a texture by content can be split apart when one of the files changes (see reload_texture).
+*/
 class MaterialManager
 {
 public:
@@ -12,16 +26,47 @@ public:
 	MaterialManager() = delete;
 
 	const Material* load_material(const AssimpMaterialData& mat_data, const std::string& name = "");
+
+	// Same as load_material for each entry, with all textures loaded through one DiskTextureManager::load_batch
+	std::vector<const Material*> load_materials(const std::vector<AssimpMaterialData>& mat_datas);
+
+	// Same with the textures decoded ahead by decode_textures, only their upload is left
+	std::vector<const Material*> load_materials(const std::vector<AssimpMaterialData>& mat_datas, DiskTextureManager::DecodedBatch&& textures);
+
+	// Thread-safe, DiskTextureManager::decode_batch of the textures of the materials
+	DiskTextureManager::DecodedBatch decode_textures(const std::vector<AssimpMaterialData>& mat_datas) const;
 	const Material* get_material(const std::string& name);
-	void remove_material(const std::string& name);
+	const Material* get_material(uint16_t id) const;
+
+	// Regardless of references, returns the GPU bytes of textures freed with it
+	uint64_t remove_material(const std::string& name);
+
+	uint64_t release(const Material* mat);		// GPU bytes freed, 0 while other references remain
+
+	// DiskTextureManager::reload, materials of the path move to its new texture if it got one
+	bool reload_texture(const std::filesystem::path& fpath);
+
+	// Upper bound of the IDs in use, the size of a table indexed by material ID
+	uint16_t get_id_count() const { return (uint16_t)m_mats.size(); }
 
 private:
 	MaterialManager(DiskTextureManager* disk_tex_mgr);
 
+	// Adds a reference to the new or existing material
+	const Material* add_material(TextureHandle diffuse, const std::filesystem::path& diffuse_path, const std::string& name);
+	uint64_t remove_material(uint16_t id);
+
 private:
 	DiskTextureManager* m_disk_tex_mgr = nullptr;
 	
 	uint64_t m_def_counter = 0;
-	std::map<std::string, Material> m_mats;
-};
+	std::deque<Material> m_mats;						// by ID, removed materials leave an invalid slot until reused
+	std::vector<uint16_t> m_free_ids;
+	std::vector<uint32_t> m_refs;						// by ID
+	std::vector<std::string> m_names;					// by ID
+	std::vector<std::filesystem::path> m_albedo_paths;	// by ID, lexically normal
+	std::unordered_map<std::string, uint16_t> m_ids_by_name;
 
+	// Material::get_hash --> IDs of the materials with that hash
+	std::unordered_multimap<uint64_t, uint16_t> m_ids_by_hash;
+};
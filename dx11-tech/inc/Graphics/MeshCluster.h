@@ -0,0 +1,25 @@
+#pragma once
+
+/*
+	Small contiguous index range of a Mesh (up to 124 triangles / 64 vertices, see MeshOptimizer) with its bounds,
+	the unit of culling in the ModelRenderer. Everything is in model space.
+*/
+struct MeshCluster
+{
+	uint32_t index_start = 0;		// same stride and base as the Mesh it belongs to
+	uint32_t index_count = 0;
+
+	DirectX::SimpleMath::Vector3 center;
+	float radius = 0.f;
+
+	DirectX::SimpleMath::Vector3 aabb_min;
+	DirectX::SimpleMath::Vector3 aabb_max;
+
+	/*
+		Normal cone of the triangles, the whole cluster faces away from an eye when
+			dot(center - eye, cone_axis) >= cone_cutoff * length(center - eye) + radius
+		A cutoff of 1 disables the test (normals too spread out).
+	*/
+	DirectX::SimpleMath::Vector3 cone_axis;
+	float cone_cutoff = 1.f;
+};
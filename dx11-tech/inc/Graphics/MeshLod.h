@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+	One level of detail of a Mesh (see MeshOptimizer/MeshSimplifier): an index range into the same index buffer,
+	referencing the same vertices as the full mesh. Level 0 is the full mesh.
+*/
+struct MeshLod
+{
+	uint32_t index_start = 0;		// same stride and base as the Mesh it belongs to
+	uint32_t index_count = 0;
+	float error = 0.f;				// approximate model space distance to the full mesh
+};
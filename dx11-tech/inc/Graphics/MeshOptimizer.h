@@ -0,0 +1,100 @@
+#pragma once
+#include "Graphics/BakedModel.h"
+#include "Graphics/MeshSimplifier.h"
+
+/*
+	Post-import optimization of AssimpLoader output, run once before a model is cooked (see ModelManager::import_model).
+
+	Per mesh, in order:
+		- Vertex cache		triangles reordered for post-transform cache reuse (Forsyth, LRU of 32 entries)
+		- Overdraw			the cache optimized order is cut into clusters, clusters facing away from the mesh center are drawn first;
+							cuts are only made where the ACMR stays within overdraw_threshold of the cache optimized order
+		- Clusters			connected MeshClusters grown in draw order (up to 124 triangles / 64 vertices), triangles are
+							regrouped so every cluster is a contiguous index range, bounds and normal cone per cluster
+		- LODs				up to lod_count levels simplified from the previous one (MeshSimplifier), each cache optimized;
+							the chain stops once a level can't get below lod_min_reduction of the previous one
+		- Vertex fetch		vertices reordered by first use (unreferenced ones are dropped), indices remapped
+		- Index format		16 bit indices for meshes with at most 65536 vertices, indices are local to the mesh
+
+	The index buffer holds the 16 bit meshes first (padded to 4 bytes) followed by the 32 bit ones.
+	index_start of a mesh counts in its own index stride, so both formats bind the buffer at offset 0.
+	The LODs of a mesh follow its full index range and share its vertices.
+
+	Statistics (FIFO cache of 16 for ACMR, 64 byte lines on the position stream for the fetch ratio) are kept per mesh.
+*/
+class MeshOptimizer
+{
+public:
+	struct Settings
+	{
+		bool vertex_cache = true;
+		bool overdraw = true;
+		float overdraw_threshold = 1.05f;		// ACMR the overdraw pass may give up, relative to the cache optimized order
+		bool vertex_fetch = true;
+		bool index_16bit = true;
+		bool clusters = true;
+		uint32_t cluster_max_triangles = 124;
+		uint32_t cluster_max_vertices = 64;
+		uint32_t lod_count = 4;					// including the full mesh, 1 disables the chain
+		float lod_reduction = 0.5f;				// target triangles relative to the previous level
+		float lod_min_reduction = 0.85f;
+		float lod_max_error = 0.05f;			// relative to the mesh extent
+	};
+
+	struct MeshStats
+	{
+		uint32_t vertex_count = 0;
+		uint32_t triangle_count = 0;
+		uint32_t overdraw_clusters = 0;			// 0 if the pass didn't run
+		uint32_t clusters = 0;					// MeshClusters
+		uint32_t lods = 0;						// levels including the full mesh
+		uint32_t last_lod_triangles = 0;
+
+		float acmr_before = 0.f;				// transformed vertices per triangle
+		float acmr_after = 0.f;
+		float fetch_before = 0.f;				// fetched bytes / vertex bytes
+		float fetch_after = 0.f;
+
+		uint64_t index_bytes_before = 0;
+		uint64_t index_bytes_after = 0;
+	};
+
+	// Owns the optimized geometry, same layout as the source it was built from
+	struct Result
+	{
+		std::vector<float> positions;
+		std::vector<float> uvs;
+		std::vector<float> normals;
+		std::vector<uint8_t> indices;
+		std::vector<AssimpMeshData> meshes;
+		std::vector<AssimpMaterialData> materials;
+		std::vector<MeshCluster> clusters;
+		std::vector<MeshLod> lods;
+
+		std::vector<MeshStats> stats;			// one per mesh
+
+		ModelSourceView get_view() const;
+	};
+
+public:
+	// Source indices have to be 32 bit
+	static Result optimize(const ModelSourceView& source, const Settings& settings);
+
+	static void print_stats(const std::filesystem::path& path, const std::vector<MeshStats>& stats);
+
+	// In place reorder of a triangle list
+	static void optimize_vertex_cache(uint32_t* indices, size_t index_count, uint32_t vertex_count);
+
+	// In place reorder of a cache optimized triangle list, returns the number of clusters
+	static uint32_t optimize_overdraw(uint32_t* indices, size_t index_count, const float* positions, uint32_t vertex_count, float threshold);
+
+	// In place regroup of the triangles into contiguous clusters, index_start of the clusters is relative to indices
+	static std::vector<MeshCluster> build_clusters(uint32_t* indices, size_t index_count, const float* positions, uint32_t vertex_count,
+		uint32_t max_triangles, uint32_t max_vertices);
+
+	// Remaps indices to first use order, remap[new vertex] = old vertex
+	static void optimize_vertex_fetch(uint32_t* indices, size_t index_count, uint32_t vertex_count, std::vector<uint32_t>& remap);
+
+	static float compute_acmr(const uint32_t* indices, size_t index_count, uint32_t vertex_count, uint32_t cache_size = 16);
+	static float compute_fetch_ratio(const uint32_t* indices, size_t index_count, uint32_t vertex_count, uint32_t vertex_stride);
+};
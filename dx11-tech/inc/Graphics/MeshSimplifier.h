@@ -0,0 +1,24 @@
+#pragma once
+
+/*
+	Quadric error edge collapse simplification (Garland & Heckbert) of an indexed triangle list.
+
+	Vertices are only ever collapsed onto other existing vertices, so the simplified index list references
+	the same vertex buffer as the source and needs no new vertex data (see the LOD chain in MeshOptimizer).
+
+	Vertices on open borders and on attribute seams (several vertices sharing a position) are locked,
+	which keeps silhouettes and UV/normal discontinuities intact at the cost of less reduction on heavily seamed meshes.
+
+	Errors are distances in model units: the collapse error is the quadric error divided by the accumulated
+	triangle area, i.e the area weighted squared distance to the original planes.
+*/
+class MeshSimplifier
+{
+public:
+	// Stops at target_index_count or once the next collapse would exceed target_error, returns the new index list
+	static std::vector<uint32_t> simplify(const uint32_t* indices, size_t index_count, const float* positions, uint32_t vertex_count,
+		size_t target_index_count, float target_error, float* result_error = nullptr);
+
+	// Diagonal of the bounds of the referenced vertices, used to make errors relative to the mesh size
+	static float compute_extent(const uint32_t* indices, size_t index_count, const float* positions);
+};
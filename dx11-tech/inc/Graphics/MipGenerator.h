@@ -0,0 +1,73 @@
+#pragma once
+#include <dxgiformat.h>
+
+class SubresourceData;
+
+/*
+	CPU mip chain generation for textures we cook or stream ourselves (instead of GPU GenerateMips).
+
+	Formats:
+		- eRGBA8_SRGB		color is linearized, filtered and re-encoded to sRGB, alpha is filtered as is
+		- eRGBA8_UNORM		filtered as is
+		- eRGBA32_FLOAT		filtered as is
+
+	Filters (2x reduction per level, edges clamped):
+		- eBox				2x2 average
+		- eTent				separable [1 3 3 1] / 8 over 4x4 texels, less aliasing than the box at the cost of a slight blur
+
+	Every texel is filtered as one RGBA float vector: SSE by default, two texels per register with AVX2 when the CPU has it.
+	Rows of a level are spread over jobs::pool, levels are generated in order as each one reads the previous
+	and the small tail levels run on the calling thread.
+*/
+class MipGenerator
+{
+public:
+	enum class Format
+	{
+		eRGBA8_SRGB,
+		eRGBA8_UNORM,
+		eRGBA32_FLOAT
+	};
+
+	enum class Filter
+	{
+		eBox,
+		eTent
+	};
+
+	struct Settings
+	{
+		Filter filter = Filter::eBox;
+		bool simd = true;				// false runs the scalar reference path
+		bool avx2 = true;				// with simd, used if the CPU supports it (false for SSE only)
+		bool parallel = true;
+		uint32_t max_levels = 0;		// 0 for the full chain down to 1x1
+	};
+
+	struct Level
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t row_pitch = 0;
+		size_t offset = 0;				// into MipChain::data
+	};
+
+	struct MipChain
+	{
+		Format format = Format::eRGBA8_SRGB;
+		std::vector<Level> levels;		// level 0 is a copy of the input
+		std::vector<uint8_t> data;		// levels packed back to back
+
+		const uint8_t* get_level_data(uint32_t level) const { return data.data() + levels[level].offset; }
+		DXGI_FORMAT get_dxgi_format() const;
+
+		// One per level, ready for GfxDevice::create_texture (points into data)
+		std::vector<SubresourceData> get_subresources() const;
+	};
+
+public:
+	static MipChain generate(const void* pixels, uint32_t width, uint32_t height, Format format, const Settings& settings);
+
+	static uint32_t get_bytes_per_texel(Format format);
+	static uint32_t get_level_count(uint32_t width, uint32_t height);
+};
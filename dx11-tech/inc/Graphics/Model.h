@@ -1,11 +1,25 @@
 #pragma once
 #include "Graphics/Material.h"
+#include "Graphics/MeshCluster.h"
+#include "Graphics/MeshLod.h"
 
 struct Mesh
 {
 	UINT index_start = 0;
 	UINT index_count = 0;
 	UINT vertex_start = 0;
+	UINT index_stride = sizeof(uint32_t);		// index_start counts in this stride
+	UINT cluster_start = 0;						// into Model::get_clusters()
+	UINT cluster_count = 0;
+	UINT lod_start = 0;							// into Model::get_lods(), lod 0 is the mesh itself
+	UINT lod_count = 0;
+};
+
+// Texture streaming input of a mesh (see ModelRenderer::submit), model space
+struct MeshTexelDensity
+{
+	DirectX::BoundingSphere bounds;
+	float uv_per_unit = 0.f;		// sqrt(uv area / surface area), texture coordinate span of one model unit
 };
 
 class Model
@@ -18,6 +32,16 @@ public:
 	Model& set_ib(BufferHandle ib);
 	Model& add_mesh(Mesh mesh, const Material* mat);
 
+	// Vertex streams are VertexQuantizer encoded, the matrix maps quantized positions to model space
+	Model& set_dequantization(const DirectX::SimpleMath::Matrix& dequantization);
+	Model& set_clusters(std::vector<MeshCluster> clusters);
+
+	// After the meshes are added, also gathers the per level errors of the whole model
+	Model& set_lods(std::vector<MeshLod> lods, const DirectX::BoundingSphere& bounds);
+
+	// One per mesh
+	Model& set_texel_densities(std::vector<MeshTexelDensity> densities);
+
 	//const std::vector<GPUBuffer>& get_vbs() const;
 	//const std::vector<UINT>& get_vb_strides() const;
 	//const GPUBuffer* get_ib() const;
@@ -28,11 +52,34 @@ public:
 	const std::vector<Mesh>& get_meshes() const;
 	const std::vector<const Material*>& get_materials() const;
 
+	const std::vector<MeshCluster>& get_clusters() const { return m_clusters; }
+	const std::vector<MeshLod>& get_lods() const { return m_lods; }
+	const std::vector<MeshTexelDensity>& get_texel_densities() const { return m_texel_densities; }
+
+	// Levels available to the model (at least 1), meshes with fewer levels keep using their last one
+	uint32_t get_lod_count() const { return (uint32_t)m_lod_errors.size(); }
+	float get_lod_error(uint32_t level) const { return m_lod_errors[level]; }
+	const DirectX::BoundingSphere& get_bounds() const { return m_bounds; }
+
+	// Index range of a mesh at a level
+	const MeshLod get_mesh_lod(const Mesh& mesh, uint32_t level) const;
+
+	bool is_quantized() const { return m_quantized; }
+	const DirectX::SimpleMath::Matrix& get_dequantization() const { return m_dequantization; }
+
 private:
 	std::vector<std::tuple<BufferHandle, UINT, UINT>> m_vbs_strides_offsets;
 	BufferHandle m_ib;
 
 	std::vector<Mesh> m_meshes;
 	std::vector<const Material*> m_materials;
+	std::vector<MeshCluster> m_clusters;
+	std::vector<MeshLod> m_lods;
+	std::vector<MeshTexelDensity> m_texel_densities;
+	std::vector<float> m_lod_errors = { 0.f };		// largest error of any mesh per level
+	DirectX::BoundingSphere m_bounds;				// model space
+
+	bool m_quantized = false;
+	DirectX::SimpleMath::Matrix m_dequantization;
 };
 
@@ -1,6 +1,39 @@
 #pragma once
 #include "Graphics/Model.h"
+#include "Graphics/BakedModel.h"
+#include "Graphics/MeshOptimizer.h"
+#include "Graphics/GeometryHeap.h"
+#include "Graphics/DiskTextureManager.h"
+#include "ContentCache.h"
 
+/*
+	CPU side result of loading a model file (baked or imported through Assimp), ready for GPU resource creation.
+	Producing it touches no shared state, so it can be done on any thread.
+*/
+struct ModelImport
+{
+	std::filesystem::path path;
+	ModelSourceView source;			// points into either the optimized import or the baked file
+	uint64_t geometry_hash = 0;		// vertex and index data of source, see ModelManager::create_model
+
+	MeshOptimizer::Result optimized;
+	BakedModel baked;
+
+	// Textures of the materials decoded along the import (see ModelManager::decode_textures), otherwise create_model decodes them
+	std::optional<DiskTextureManager::DecodedBatch> textures;
+
+	ModelImport();
+	~ModelImport();
+	ModelImport(ModelImport&&) noexcept;
+	ModelImport& operator=(ModelImport&&) noexcept;
+};
+
+/*
+	Loads models and owns their GPU geometry and material references.
+
+	Vertex and index data are suballocated from a GeometryHeap rather than getting buffers per model, the meshes, clusters and
+	LODs of a model are rebased to its ranges so draws of different models bind the same buffers.
+*/
 class ModelManager
 {
 public:
@@ -10,20 +43,75 @@ public:
 	ModelManager() = delete;
 	~ModelManager() = default;
 
+	// Blocking import + GPU resource creation
 	const Model* load_model(const std::filesystem::path& path, const std::string& name = "");
+
+	// Thread-safe import step of load_model
+	static ModelImport import_model(const std::filesystem::path& path);
+
+	// Thread-safe, decodes the textures of an import so create_model only uploads them (see DiskTextureManager::decode_batch)
+	void decode_textures(ModelImport& import) const;
+
+	// GPU resource creation step of load_model, owning thread only
+	const Model* create_model(ModelImport&& import, const std::string& name = "");
+
+	// Already loaded model for the path (nullptr otherwise)
+	const Model* find_model(const std::filesystem::path& path);
+
 	const Model* get_model(const std::string& name);
-	void remove_model(const std::string& name);
+
+	// Releases the model's materials (and through them its textures) and its geometry, resources still used
+	// by other models stay. Returns the GPU bytes freed, geometry counts once its ranges are back in the GeometryHeap.
+	uint64_t remove_model(const std::string& name);
+	uint64_t remove_model(const Model* model);
+
+	// Rebuilds in place (pointers stay valid) the models loaded from a changed file, or from the same directory if
+	// it is one they reference (e.g .mtl). Returns the number of models reloaded.
+	uint32_t reload_models(const std::filesystem::path& file);
+
+	// Models created afterwards use the VertexQuantizer streams (16 instead of 32 bytes per vertex)
+	void set_vertex_quantization(bool enabled) { m_quantize_vertices = enabled; }
+	bool get_vertex_quantization() const { return m_quantize_vertices; }
+
+	// Vertex buffer memory of every model created so far
+	uint64_t get_vertex_bytes() const { return m_vertex_bytes; }
+
+	// Models with identical vertex/index data (e.g the same mesh in different files) share their GPU ranges
+	struct SharedGeometry
+	{
+		GeometryHeap::Allocation allocation;
+		bool quantized = false;
+		DirectX::SimpleMath::Matrix dequantization;
+	};
+	const ContentCache<SharedGeometry>::Stats& get_geometry_content_stats() const { return m_geometry_cache.get_stats(); }
+	GeometryHeap::Stats get_geometry_heap_stats() const { return m_geometry_heap.get_stats(); }
 
 private:
 	ModelManager(GfxDevice* dev, MaterialManager* mat_mgr);
 
+	struct LoadedModel
+	{
+		Model model;
+		uint64_t geometry_key = 0;		// into m_geometry_cache
+	};
+
+	// References the materials and geometry it uses
+	LoadedModel build_model(ModelImport& import);
+	uint64_t release(const LoadedModel& loaded);
+
 private:
 	GfxDevice* m_dev = nullptr;
 	MaterialManager* m_mat_mgr = nullptr;
 
 	uint64_t m_def_counter = 0;
+	bool m_quantize_vertices = false;
+	uint64_t m_vertex_bytes = 0;
 	std::map<std::filesystem::path, std::string> m_path_mapper;
-	std::map<std::string, Model> m_models;
+	std::map<std::string, LoadedModel> m_models;
+
+	GeometryHeap m_geometry_heap;
+	ContentCache<SharedGeometry> m_geometry_cache;
+	std::unordered_map<uint64_t, uint32_t> m_geometry_refs;		// models per geometry
 
 };
 
@@ -3,7 +3,10 @@
 #include "Graphics/API/GfxHandles.h"
 #include "Graphics/API/GfxCommon.h"
 #include "Graphics/Model.h"
+#include "Graphics/ModelManager.h"
 #include "Memory/Allocator.h"
+#include <DirectXCollision.h>
+#include <future>
 
 class Renderer;
 struct RendererSharedResources;
@@ -17,6 +20,27 @@ struct ModelRenderSpec
 
 /*
 	System responsible for models which owns models and renders them.
+
+	Models loaded with load_model_async are imported, textures decoded included, on the worker threads (jobs::pool)
+	while their GPU resources are created and uploaded on the owning thread in process_loads (called by begin()).
+	Until then the handle is valid but not renderable, submitting it is a no-op.
+
+	Geometry pass draws are culled per MeshCluster (frustum + normal cone) against the camera of the master renderer,
+	consecutive visible clusters of a mesh are merged into one draw. Shadow draws always cover the whole mesh.
+	The frustum is brought to model space once per submission, which assumes world matrices without non-uniform scale.
+
+	Each submission picks one level of the model's LOD chain: the coarsest level whose simplification error, projected
+	at the distance of the model bounds, stays below the threshold (a fraction of the screen height).
+	Moving to a coarser level than last frame requires the error to be lod_hysteresis below the threshold, so models
+	near a switching distance don't flicker between levels. The previous level is tracked per handle and submission order.
+
+	Every mesh in the view frustum requests the albedo mip it needs from the TextureStreamer: the texture coordinate span
+	of one pixel at the distance of the mesh bounds (MeshTexelDensity). The streamer is updated in begin().
+
+	Meshes whose albedo is packed into a texture array (DiskTextureManager::pack) bind the array and draw with the array
+	pipeline, the slice comes with the per object data: a submission has one entry per distinct slice it draws, all with
+	the same world matrix. Opaque draws are sorted by the texture or array they bind first, so runs of packed draws
+	bind their albedo once.
 */
 class ModelRenderer
 {
@@ -29,10 +53,49 @@ public:
 	void end();
 
 	ModelHandle load_model(const std::filesystem::path& rel_path);
-	void free_model(ModelHandle hdl);
+	ModelHandle load_model_async(const std::filesystem::path& rel_path);
+	// Unloads the model (ModelManager::remove_model) once its last handle is freed, returns the GPU bytes freed
+	uint64_t free_model(ModelHandle hdl);
+
+	bool is_ready(ModelHandle hdl);
+	uint32_t get_pending_loads() const { return (uint32_t)m_pending_loads.size(); }
+
+	// Creates the GPU resources of finished imports, call on the owning thread
+	void process_loads();
+
+	// Blocks until every pending load is renderable
+	void wait_for_loads();
 
 	void submit(ModelHandle hdl, const DirectX::SimpleMath::Matrix& mat, ModelRenderSpec spec = {});
 
+	// Per frame, reset in begin()
+	struct ClusterStats
+	{
+		uint32_t clusters = 0;				// tested
+		uint32_t culled_frustum = 0;
+		uint32_t culled_backface = 0;
+		uint32_t draws = 0;					// geometry pass draws after merging
+	};
+
+	void set_cluster_culling(bool enabled) { m_cluster_culling = enabled; }
+	bool get_cluster_culling() const { return m_cluster_culling; }
+	const ClusterStats& get_cluster_stats() const { return m_cluster_stats; }
+
+	// Per frame, reset in begin(), geometry pass only
+	struct LodStats
+	{
+		uint64_t triangles_full = 0;		// at full detail without culling
+		uint64_t triangles_submitted = 0;	// after LOD selection and cluster culling
+		std::array<uint32_t, 8> submissions_per_level = {};
+	};
+
+	void set_lod_selection(bool enabled) { m_lod_selection = enabled; }
+	void set_lod_threshold(float screen_fraction) { m_lod_threshold = screen_fraction; }
+	bool get_lod_selection() const { return m_lod_selection; }
+	const LodStats& get_lod_stats() const { return m_lod_stats; }
+
+	void set_texture_streaming(bool enabled) { m_texture_streaming = enabled; }
+
 
 private:
 	Renderer* m_master_renderer;
@@ -41,30 +104,70 @@ private:
 	struct ModelInternal
 	{
 		res_handle handle;
-		const Model* data;			// temporarily a pointer
+		const Model* data = nullptr;			// temporarily a pointer, nullptr while loading
+
+		// Selected LOD per submission of this handle in a frame, for the hysteresis
+		std::vector<uint8_t> lod_levels;
+		uint64_t frame = 0;
+		uint32_t frame_submissions = 0;
 
-		void free() {};
+		void free() { lod_levels.clear(); };
 	};
 
 	ResourceHandlePool<ModelInternal> m_loaded_models;
 	uint64_t m_counter = 0;
+	std::unordered_map<const Model*, uint32_t> m_model_users;		// live handles per model
+
+	// In-flight imports, handles requesting the same path share one import
+	struct PendingLoad
+	{
+		std::future<ModelImport> import;
+		std::vector<res_handle> handles;
+	};
+	std::map<std::filesystem::path, PendingLoad> m_pending_loads;
+
+private:
+	void finish_load(const std::filesystem::path& path, PendingLoad& load);
+	uint32_t select_lod(const Model* model, const DirectX::SimpleMath::Matrix& wm, uint32_t previous) const;
 
 private:
 	DirectX::SimpleMath::Matrix m_view_mat;
 
+	// Cluster culling, camera state captured in begin()
+	bool m_cluster_culling = true;
+	bool m_has_camera = false;
+	DirectX::BoundingFrustum m_frustum;		// world space
+	DirectX::SimpleMath::Vector3 m_eye;
+	ClusterStats m_cluster_stats;
+
+	// LOD selection
+	bool m_lod_selection = true;
+	float m_lod_threshold = 1.f / 1080.f;		// ~1 pixel at 1080p
+	static constexpr float LOD_HYSTERESIS = 0.25f;
+	float m_proj_scale = 1.f;					// cot(fov_y / 2)
+	float m_screen_height = 1080.f;
+	uint64_t m_frame = 0;
+	LodStats m_lod_stats;
+
+	bool m_texture_streaming = true;
+
 	// Per Object data
 	struct alignas(gfxconstants::MIN_CB_SIZE_FOR_RANGES) PerObjectData
 	{
 		DirectX::XMMATRIX world_mat;
+		uint32_t albedo_slice = 0;
 	};
 	BufferHandle m_per_object_cb;
 
-	// Max model submissions per frame
+	// Max per object entries per frame (one per submission, plus one per extra texture array slice it draws)
 	static constexpr UINT MAX_SUBMISSION_PER_FRAME = 1000;
 
 	unique_ptr<Allocator> m_per_object_data_allocator;
 	PerObjectData* m_per_object_data = nullptr;
-	uint32_t m_submission_count = 0;
+	uint32_t m_object_count = 0;
+
+	// Entry per texture array slice of the current submission (UINT32_MAX if none yet), reused across submissions
+	std::vector<uint32_t> m_slice_objects;
 
 		
 
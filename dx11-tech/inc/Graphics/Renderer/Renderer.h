@@ -28,9 +28,13 @@ struct RendererSharedResources
 {
 	// Common
 	PipelineHandle depth_only_pipe;
+	PipelineHandle depth_only_quantized_pipe;			// VertexQuantizer positions
 
 	// Deferred specific
 	PipelineHandle deferred_gpass_pipe;
+	PipelineHandle deferred_gpass_quantized_pipe;		// VertexQuantizer streams
+	PipelineHandle deferred_gpass_array_pipe;			// albedo from a texture array slice
+	PipelineHandle deferred_gpass_array_quantized_pipe;
 };
 
 class Renderer
@@ -61,6 +65,9 @@ public:
 	void end();
 
 	void set_camera(class Camera* cam);
+	class Camera* get_camera() const { return m_main_cam; }
+	std::pair<UINT, UINT> get_resolution() const { return m_curr_resolution; }
+	void set_vsync(bool enabled) { m_vsync = enabled; };
 
 	void render();
 
@@ -73,7 +80,7 @@ private:
 	Renderer();
 	~Renderer() = default;
 
-	void setup_SDSM();
+	void setup_SDSM(class ShaderBatch& shaders);
 	void compute_SDSM();
 
 	void declare_ui();
@@ -184,6 +191,7 @@ private:
 	std::set<std::string> shader_filenames;
 	bool do_once = true;
 	const char* selected_item = "";
+	ShaderReloadStats last_shader_reload;
 
 
 
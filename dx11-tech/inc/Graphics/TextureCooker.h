@@ -0,0 +1,77 @@
+#pragma once
+#include <dxgiformat.h>
+
+/*
+	CPU cooking of RGBA8 (sRGB) textures into block compressed mip chains.
+
+		- Mips are generated with the tent filter of MipGenerator (in linear space, re-encoded to sRGB)
+		- Every mip is encoded to BC1, BC3 or BC7 (mode 6 only: single subset RGBA with 4 bit indices)
+		- Cooked textures are cached as DDS files (DX10 header) under cooked/, the source hash and cooker version
+		  are stored in the reserved header fields so stale caches are detected on load
+
+	The top mip has to be a multiple of 4 in both dimensions (D3D11 requirement for block compressed textures), see can_cook.
+	Cooked files can be read partially (from first_mip down), which is what texture streaming loads (see TextureStreamer).
+*/
+class TextureCooker
+{
+public:
+	static constexpr uint32_t VERSION = 2;				// bump when the mip filter or the encoders change
+	static constexpr const char* COOKED_DIRECTORY = "cooked/";
+
+	enum class Format
+	{
+		eAuto,		// BC1 for opaque textures, BC3 otherwise
+		eBC1,		// alpha is dropped
+		eBC3,
+		eBC7
+	};
+
+	struct Mip
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t row_pitch = 0;		// bytes per row of blocks
+		uint64_t offset = 0;		// into CookedTexture::data
+		uint64_t size = 0;
+	};
+
+	struct CookedTexture
+	{
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+		uint32_t width = 0;				// of the full chain, mips[0] is smaller if first_mip > 0
+		uint32_t height = 0;
+		uint32_t first_mip = 0;			// of the full chain held by mips[0]
+		uint32_t mip_count = 0;			// of the full chain
+		std::vector<Mip> mips;
+		std::vector<uint8_t> data;
+
+		bool is_valid() const { return !mips.empty(); }
+	};
+
+public:
+	static bool can_cook(uint32_t width, uint32_t height);
+
+	static CookedTexture cook(const uint8_t* rgba, uint32_t width, uint32_t height, Format format = Format::eAuto);
+
+	// 4x4 RGBA8 block (row major) to a compressed block
+	static void encode_bc1_block(const uint8_t* block, uint8_t* out);		// 8 bytes
+	static void encode_bc3_block(const uint8_t* block, uint8_t* out);		// 16 bytes
+	static void encode_bc7_block(const uint8_t* block, uint8_t* out);		// 16 bytes
+
+	// e.g models/sponza/Sponza_Floor_diffuse.png --> cooked/models/sponza/Sponza_Floor_diffuse.png.dds
+	static std::filesystem::path get_cooked_path(const std::filesystem::path& source);
+
+	static bool write_dds(const CookedTexture& texture, uint64_t source_hash, const std::filesystem::path& path);
+
+	/*
+		Invalid texture if the file is missing, malformed or was cooked from another source/cooker version.
+		Only reads the mips from first_mip down, first_mip is raised until the top mip fits in max_top_size (0 for no limit).
+	*/
+	static CookedTexture read_dds(const std::filesystem::path& path, uint64_t source_hash, uint32_t first_mip = 0, uint32_t max_top_size = 0);
+
+	// Clamps a requested first mip to one that can be the top of a block compressed texture (multiple of 4 in both dimensions)
+	static uint32_t get_valid_first_mip(uint32_t width, uint32_t height, uint32_t mip_count, uint32_t first_mip, uint32_t max_top_size = 0);
+
+	// Bytes of the block compressed mips from first_mip down
+	static uint64_t get_chain_size(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mip_count, uint32_t first_mip = 0);
+};
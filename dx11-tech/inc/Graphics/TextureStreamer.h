@@ -0,0 +1,114 @@
+#pragma once
+#include "Graphics/API/GfxHandles.h"
+#include "Graphics/TextureCooker.h"
+#include <future>
+#include <unordered_map>
+
+/*
+	Mip streaming of cooked (block compressed) textures under a memory budget, owned by DiskTextureManager.
+
+	Textures start with only their low mips resident (top mip at most initial_max_size). Renderers request the mip
+	a texture needs every frame from its screen space texel density (see ModelRenderer::submit), update() then:
+		- Applies loads finished on jobs::pool
+		- Starts loads for textures wanting finer mips than resident, largest gain first (up to max_in_flight)
+		- Makes room within budget_bytes by evicting the top mips of the least recently requested textures,
+		  a load that still doesn't fit is clamped to the finest mip that does
+
+	D3D11 has no partially resident textures here, a texture changing mips is recreated under the same handle.
+	Finer mips are read from its cooked DDS file on jobs::pool (GfxDevice::replace_texture), evicting copies the
+	remaining mips on the GPU (GfxDevice::trim_texture) without touching the file. Textures requested in the current
+	frame are never evicted. Budget and statistics only cover streamed textures.
+*/
+class TextureStreamer
+{
+public:
+	struct Settings
+	{
+		uint64_t budget_bytes = 256ull * 1024 * 1024;
+		uint32_t initial_max_size = 64;			// top mip of the initially resident chain
+		uint32_t max_in_flight = 8;				// loads
+	};
+
+	struct Stats
+	{
+		uint32_t textures = 0;
+		uint64_t resident_bytes = 0;
+		uint64_t full_bytes = 0;				// if every streamed texture was fully resident
+		uint32_t pending = 0;					// loads in flight
+		uint32_t streamed_in = 0;				// finished loads, accumulated
+		uint32_t evicted = 0;					// evictions, accumulated
+		uint32_t clamped = 0;					// loads reduced to fit the budget, accumulated
+	};
+
+public:
+	TextureStreamer(class GfxDevice* dev);
+	~TextureStreamer();
+
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+	TextureStreamer(const TextureStreamer&) = delete;
+
+	// Takes over a texture created from cooked (partially read from cooked_path)
+	void add(TextureHandle tex, const std::filesystem::path& cooked_path, uint64_t source_hash, const TextureCooker::CookedTexture& cooked);
+	void remove(TextureHandle tex);
+	bool is_streamed(TextureHandle tex) const { return m_textures.find(tex) != m_textures.end(); }
+
+	// uv_per_pixel: texture coordinate span of one pixel, the finest request of a frame wins
+	void request(TextureHandle tex, float uv_per_pixel);
+
+	// Once per frame, owning thread only
+	void update();
+
+	// Resident mip of the full chain, 0 if not streamed
+	uint32_t get_resident_mip(TextureHandle tex) const;
+	uint64_t get_resident_bytes(TextureHandle tex) const;		// 0 if not streamed
+
+	void set_settings(const Settings& settings) { m_settings = settings; }
+	const Settings& get_settings() const { return m_settings; }
+	const Stats& get_stats() const { return m_stats; }
+
+private:
+	struct StreamedTexture
+	{
+		std::filesystem::path cooked_path;
+		uint64_t source_hash = 0;
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mip_count = 0;
+
+		uint32_t base_mip = 0;					// initially resident, never evicted
+		uint32_t resident_mip = 0;
+		uint32_t requested_mip = UINT32_MAX;	// this frame
+		uint64_t resident_bytes = 0;
+		uint64_t last_used_frame = 0;
+
+		std::future<TextureCooker::CookedTexture> load;
+		uint64_t load_bytes = 0;
+	};
+
+	uint64_t get_size(const StreamedTexture& texture, uint32_t first_mip) const;
+
+	// Recreates the texture from the mips of cooked, returns false if cooked is invalid
+	bool apply(TextureHandle tex, StreamedTexture& texture, const TextureCooker::CookedTexture& cooked);
+
+	// Recreates the texture without the mips above first_mip, copied on the GPU from the resident mips
+	void trim(TextureHandle tex, StreamedTexture& texture, uint32_t first_mip);
+
+	// Unused this frame, not loading and with top mips above its initial ones
+	bool is_evictable(const StreamedTexture& texture) const;
+
+	// Budget left if every evictable top mip was evicted
+	uint64_t get_available_bytes() const;
+
+	// Evicts top mips of textures unused this frame until bytes more fit in the budget, false if they can't
+	bool make_room(uint64_t bytes);
+
+private:
+	GfxDevice* m_dev = nullptr;
+	Settings m_settings;
+	Stats m_stats;
+	uint64_t m_frame = 1;
+
+	std::unordered_map<TextureHandle, StreamedTexture> m_textures;
+	uint64_t m_pending_bytes = 0;			// growth of the resident bytes once in flight loads are applied
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include "Graphics/BakedModel.h"
+
+class InputLayoutDesc;
+
+/*
+	Quantized vertex streams for the geometry pass (16 bytes per vertex instead of 32):
+
+		Stream		Format					Bytes	Encoding
+		POSITION	R16G16B16A16_UNORM		8		xyz normalized to the model bounds, w = 1
+		UV			R16G16_FLOAT			4		half floats
+		NORMAL		R16G16_SNORM			4		octahedral
+
+	Positions are brought back by the dequantization matrix (bounds scale + offset) which is folded into the world matrix,
+	so only the normal decode needs a dedicated vertex shader (gpassQuantizedVS.hlsl). Depth only passes use depthOnlyVS as is.
+
+	The bounds cover the whole model rather than each mesh, that keeps a single per object constant per submission.
+*/
+class VertexQuantizer
+{
+public:
+	struct Position { uint16_t x, y, z, w; };
+	struct UV { uint16_t u, v; };
+	struct Normal { int16_t x, y; };
+
+	// Round trip errors of the encoded streams
+	struct Errors
+	{
+		float max_position = 0.f;			// model units
+		float avg_position = 0.f;
+		float max_normal_degrees = 0.f;
+		float avg_normal_degrees = 0.f;
+		float max_uv = 0.f;
+		float avg_uv = 0.f;
+	};
+
+	struct Result
+	{
+		std::vector<Position> positions;
+		std::vector<UV> uvs;
+		std::vector<Normal> normals;
+
+		DirectX::SimpleMath::Vector3 bounds_min;
+		DirectX::SimpleMath::Vector3 bounds_max;
+		Errors errors;
+
+		// Quantized [0, 1] position --> model space, row vector convention like the world matrices
+		DirectX::SimpleMath::Matrix get_dequantization() const;
+	};
+
+public:
+	static Result quantize(const ModelSourceView& source);
+
+	static void print_report(const std::filesystem::path& path, const Result& result);
+
+	// Layouts matching the streams above, same slots as the full precision layouts (position 0, uv 1, normal 2)
+	static InputLayoutDesc get_input_layout();
+	static InputLayoutDesc get_position_layout();
+
+	static Position encode_position(const DirectX::SimpleMath::Vector3& p, const DirectX::SimpleMath::Vector3& min, const DirectX::SimpleMath::Vector3& extent);
+	static DirectX::SimpleMath::Vector3 decode_position(const Position& p, const DirectX::SimpleMath::Vector3& min, const DirectX::SimpleMath::Vector3& extent);
+
+	static Normal encode_normal(const DirectX::SimpleMath::Vector3& n);
+	static DirectX::SimpleMath::Vector3 decode_normal(const Normal& n);
+
+	static UV encode_uv(const DirectX::SimpleMath::Vector2& uv);
+	static DirectX::SimpleMath::Vector2 decode_uv(const UV& uv);
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <optional>
+
+/*
+	Minimal JSON value with a writer and reader.
+	Only meant for our own tooling output (benchmarks, traces, recorded paths), not as a general purpose parser.
+
+	Objects keep insertion order so written files are stable and easy to diff.
+*/
+class JsonValue
+{
+public:
+	using Array = std::vector<JsonValue>;
+	using Object = std::vector<std::pair<std::string, JsonValue>>;
+
+	JsonValue() = default;
+	JsonValue(std::nullptr_t) {}
+	JsonValue(bool b) : m_value(b) {}
+	JsonValue(double num) : m_value(num) {}
+	JsonValue(float num) : m_value((double)num) {}
+	JsonValue(int num) : m_value((double)num) {}
+	JsonValue(uint32_t num) : m_value((double)num) {}
+	JsonValue(int64_t num) : m_value((double)num) {}
+	JsonValue(uint64_t num) : m_value((double)num) {}
+	JsonValue(const char* str) : m_value(std::string(str)) {}
+	JsonValue(const std::string& str) : m_value(str) {}
+	JsonValue(Array arr) : m_value(std::move(arr)) {}
+	JsonValue(Object obj) : m_value(std::move(obj)) {}
+
+	static JsonValue array() { return JsonValue(Array()); }
+	static JsonValue object() { return JsonValue(Object()); }
+
+	bool is_null() const { return std::holds_alternative<std::nullptr_t>(m_value); }
+	bool is_bool() const { return std::holds_alternative<bool>(m_value); }
+	bool is_number() const { return std::holds_alternative<double>(m_value); }
+	bool is_string() const { return std::holds_alternative<std::string>(m_value); }
+	bool is_array() const { return std::holds_alternative<Array>(m_value); }
+	bool is_object() const { return std::holds_alternative<Object>(m_value); }
+
+	bool as_bool() const { return std::get<bool>(m_value); }
+	double as_number() const { return std::get<double>(m_value); }
+	const std::string& as_string() const { return std::get<std::string>(m_value); }
+	const Array& as_array() const { return std::get<Array>(m_value); }
+	const Object& as_object() const { return std::get<Object>(m_value); }
+	Array& as_array() { return std::get<Array>(m_value); }
+	Object& as_object() { return std::get<Object>(m_value); }
+
+	// Object access (inserts on non-const access)
+	JsonValue& operator[](const std::string& key);
+	const JsonValue* find(const std::string& key) const;
+
+	// Array append
+	JsonValue& push_back(JsonValue value);
+
+	std::string dump(bool pretty = true) const;
+	static std::optional<JsonValue> parse(const std::string& text);
+
+	bool write_file(const std::filesystem::path& path, bool pretty = true) const;
+	static std::optional<JsonValue> read_file(const std::filesystem::path& path);
+
+private:
+	void dump_internal(std::string& out, bool pretty, uint32_t depth) const;
+
+private:
+	std::variant<std::nullptr_t, bool, double, std::string, Array, Object> m_value = nullptr;
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+/*
+	LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md) codec, used for the chunks of an AssetPackage.
+	Blocks are compatible with LZ4_compress_default/LZ4_decompress_safe, there is no frame format around them.
+
+	The compressor is the greedy single hash table variant: fast to build packages with, not the best ratio.
+	The decompressor is bounds checked against both buffers, a corrupt block fails instead of reading or writing outside them.
+*/
+namespace lz4
+{
+	// Largest compressed size of size bytes (incompressible input grows slightly)
+	size_t compress_bound(size_t size);
+
+	// Returns the compressed size, 0 if it doesn't fit in capacity
+	size_t compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+
+	// True if the block decompressed to exactly size bytes
+	bool decompress(const uint8_t* src, size_t compressed_size, uint8_t* dst, size_t size);
+}
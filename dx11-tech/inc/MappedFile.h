@@ -0,0 +1,32 @@
+#pragma once
+
+/*
+	Read-only memory mapped file.
+	The mapping lives as long as the object, data() is nullptr if the file couldn't be opened (or is empty).
+*/
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const std::filesystem::path& path);
+	~MappedFile();
+
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(const MappedFile&) = delete;
+
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(MappedFile&& other) noexcept;
+
+	bool is_open() const;
+	const uint8_t* data() const;
+	size_t size() const;
+
+private:
+	void close();
+
+private:
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <map>
+#include <unordered_map>
+
+/*
+	Suballocates ranges [offset, offset + size) of a fixed capacity without owning any memory, e.g regions of a GPU buffer.
+
+	Free ranges are kept by offset (neighbours are merged when a range is freed) and by size, an allocation takes the
+	smallest free range it fits in (best fit), O(log n) in the number of free ranges.
+	Alignment padding in front of an allocation stays a free range of its own.
+*/
+class RangeAllocator
+{
+public:
+	static constexpr uint64_t INVALID_OFFSET = UINT64_MAX;
+
+	struct Stats
+	{
+		uint64_t capacity = 0;
+		uint64_t used = 0;
+		uint64_t largest_free = 0;
+		uint32_t allocations = 0;
+		uint32_t free_ranges = 0;
+
+		uint64_t get_free() const { return capacity - used; }
+
+		// 0 when all free space is one range, towards 1 as it splits into small ranges
+		float get_fragmentation() const { return get_free() > 0 ? 1.f - (float)largest_free / get_free() : 0.f; }
+	};
+
+public:
+	RangeAllocator(uint64_t capacity);
+
+	// INVALID_OFFSET if no free range fits, alignment is a power of two
+	uint64_t allocate(uint64_t size, uint64_t alignment = 1);
+	void free(uint64_t offset);
+
+	bool is_empty() const { return m_allocations.empty(); }
+	Stats get_stats() const;
+
+private:
+	void add_free(uint64_t offset, uint64_t size);
+	void remove_free(std::map<uint64_t, uint64_t>::iterator it);
+
+private:
+	uint64_t m_capacity = 0;
+	uint64_t m_used = 0;
+
+	std::map<uint64_t, uint64_t> m_free_by_offset;			// offset --> size
+	std::multimap<uint64_t, uint64_t> m_free_by_size;		// size --> offset
+	std::unordered_map<uint64_t, uint64_t> m_allocations;	// offset --> size
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+/*
+	Counts the heap allocations going through the global operator new (over-aligned forms included) while an
+	AllocationTracking is alive, e.g during the headless benchmark run. Otherwise the replaced operators only check a flag.
+	Totals are process-wide and monotonic, take the difference of two snapshots to measure a scope.
+*/
+namespace perf
+{
+	struct AllocationStats
+	{
+		uint64_t count = 0;
+		uint64_t bytes = 0;
+
+		AllocationStats operator-(const AllocationStats& rh) const { return { count - rh.count, bytes - rh.bytes }; }
+	};
+
+	AllocationStats get_allocation_stats();
+
+	// Not nestable, counting stops when the first one is destroyed
+	struct AllocationTracking
+	{
+		AllocationTracking();
+		~AllocationTracking();
+
+		AllocationTracking& operator=(const AllocationTracking&) = delete;
+		AllocationTracking(const AllocationTracking&) = delete;
+	};
+}
@@ -21,6 +21,7 @@ public:
 	void end_accum(const std::string& name);
 
 	const FrameData& get_frame_statistics();
+	const FrameData& get_last_frame_statistics() const;		// last completed frame, callable mid-frame
 
 	void frame_start();
 	void frame_end();
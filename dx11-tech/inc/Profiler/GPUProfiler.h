@@ -35,7 +35,7 @@ private:
 	void frame_end();
 
 private:
-	DXDevice* m_dev;
+	DXDevice* m_dev;		// null when the GfxDevice is headless
 
 	struct ProfileData
 	{
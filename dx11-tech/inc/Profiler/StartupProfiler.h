@@ -0,0 +1,81 @@
+#pragma once
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+/*
+	Hierarchical timeline of the one-off work done on startup (device init, shader compiles, model imports,
+	texture decodes and uploads, ..). Scopes nest per thread and can be opened from any thread.
+
+	Recording stops on finish(), which prints a report (timeline, per category totals and the slowest scopes)
+	and optionally writes a trace in the Chrome trace event format (chrome://tracing or https://ui.perfetto.dev).
+	Scopes opened after finish() are no-ops, so instrumented code shared with runtime paths (e.g shader reloading) costs nothing later on.
+*/
+class StartupProfiler
+{
+public:
+	static void initialize();
+	static void shutdown();
+
+	class Scoped
+	{
+	public:
+		Scoped() = delete;
+		Scoped& operator=(const Scoped&) = delete;
+		Scoped(const Scoped&) = delete;
+
+		// Category is expected to be a string literal
+		Scoped(const std::string& name, const char* category = "startup");
+		~Scoped();
+
+	private:
+		bool m_active = false;
+	};
+
+	struct Event
+	{
+		std::string name;
+		const char* category = nullptr;
+		uint32_t thread = 0;		// 0 is the thread which initialized the profiler
+		uint32_t depth = 0;
+		double start_ms = 0.0;		// relative to initialize()
+		double duration_ms = 0.0;
+	};
+
+public:
+	StartupProfiler& operator=(const StartupProfiler&) = delete;
+	StartupProfiler(const StartupProfiler&) = delete;
+
+	bool is_recording() const;
+
+	void begin(const std::string& name, const char* category);
+	void end();
+
+	// Stops recording, prints the report and writes the trace (if a path is given)
+	void finish(const std::optional<std::filesystem::path>& trace_path = {});
+
+	const std::vector<Event>& get_events() const;
+	double get_total_time() const;
+
+	// Summed time per category, nested scopes of the same category are not counted twice
+	std::map<std::string, double> get_category_totals() const;
+
+private:
+	StartupProfiler();
+
+	double now_ms() const;
+	uint32_t get_thread_index(std::thread::id id);
+
+	void print_report() const;
+	bool write_trace(const std::filesystem::path& path) const;
+
+private:
+	std::chrono::steady_clock::time_point m_start;
+	double m_total_ms = 0.0;
+	bool m_recording = true;
+
+	mutable std::mutex m_mutex;
+	std::vector<Event> m_events;
+	std::map<std::thread::id, uint32_t> m_thread_indices;
+	std::map<uint32_t, std::vector<size_t>> m_open_scopes;		// per thread stack of indices into m_events
+};
@@ -150,6 +150,13 @@ public:
 		return &resources[idx];
 	}
 
+	// Non-asserting check whether the handle refers to a live resource (e.g for validation layers)
+	bool is_valid(full_key hdl) const
+	{
+		half_key idx = (half_key)(hdl & SLOT_MASK);
+		return hdl > 0 && idx < total_elements && resources[idx].handle == hdl;
+	}
+
 	uint64_t get_memory_footprint()
 	{
 		return total_resource_bytes + total_bookkeeping_bytes + 3 * sizeof(uint64_t) + sizeof(half_key);
@@ -0,0 +1,105 @@
+#pragma once
+#include <mutex>
+#include <thread>
+#include <future>
+#include <deque>
+#include <atomic>
+#include <condition_variable>
+
+/*
+	Fixed set of worker threads consuming a shared FIFO queue of jobs.
+
+	submit() returns a future to the job result.
+	parallel_for() splits an index range over the workers, the calling thread works on the range too.
+
+	wait() should be used instead of future::get() when waiting from a job, the waiting thread then runs
+	queued jobs in the meantime so jobs spawning (and waiting on) jobs can't starve the pool.
+*/
+class ThreadPool
+{
+public:
+	// Thread count of 0 uses hardware concurrency - 1 (the owning thread is expected to stay busy)
+	static void initialize(uint32_t thread_count = 0);
+	static void shutdown();
+
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	ThreadPool(const ThreadPool&) = delete;
+
+	template <typename Func>
+	auto submit(Func&& func) -> std::future<std::invoke_result_t<Func>>;
+
+	// func(uint32_t index) for every index in [0, count), returns once all are done
+	template <typename Func>
+	void parallel_for(uint32_t count, Func&& func);
+
+	template <typename T>
+	T wait(std::future<T>& future);
+
+	uint32_t get_thread_count() const { return (uint32_t)m_threads.size(); }
+
+private:
+	ThreadPool(uint32_t thread_count);
+	~ThreadPool();
+
+	void push(std::function<void()>&& job);
+
+	// Runs a single queued job on the calling thread, returns false if the queue was empty
+	bool run_pending_job();
+
+	void worker_loop();
+
+private:
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::deque<std::function<void()>> m_jobs;
+	bool m_stop = false;
+};
+
+template <typename Func>
+auto ThreadPool::submit(Func&& func) -> std::future<std::invoke_result_t<Func>>
+{
+	using Result = std::invoke_result_t<Func>;
+
+	// std::function requires a copyable callable
+	auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+	auto future = task->get_future();
+	push([task]() { (*task)(); });
+	return future;
+}
+
+template <typename Func>
+void ThreadPool::parallel_for(uint32_t count, Func&& func)
+{
+	if (count == 0)
+		return;
+
+	std::atomic<uint32_t> next = 0;
+	auto work = [&]()
+	{
+		for (uint32_t i = next++; i < count; i = next++)
+			func(i);
+	};
+
+	const uint32_t helpers = (std::min)(get_thread_count(), count - 1);
+	std::vector<std::future<void>> done;
+	done.reserve(helpers);
+	for (uint32_t i = 0; i < helpers; ++i)
+		done.push_back(submit(work));
+
+	work();
+	for (auto& f : done)
+		wait(f);
+}
+
+template <typename T>
+T ThreadPool::wait(std::future<T>& future)
+{
+	while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		if (!run_pending_job())
+			std::this_thread::yield();
+	}
+	return future.get();
+}
@@ -6,6 +6,10 @@ namespace utils
 	std::wstring to_wstr(std::string str);
 	std::vector<uint8_t> read_file(const std::filesystem::path& filePath);
 
+	// xxHash64 (XXH64), 8 bytes per step so content hashing of whole files stays cheap.
+	// Pass a previous result as seed to hash several buffers as one.
+	uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0);
+
 	void constrained_incr(float& num, float min, float max);
 	void constrained_decr(float& num, float min, float max);
 	float constrained_add(float lh, float rh, float min, float max);
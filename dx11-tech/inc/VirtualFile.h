@@ -0,0 +1,55 @@
+#pragma once
+#include "MappedFile.h"
+
+class AssetPackage;
+
+/*
+	Read-only file looked up in the mounted AssetPackages first (last mounted first) and on disk otherwise,
+	a drop-in for MappedFile where assets are read (textures, cooked textures and models, shader sources and bytecode).
+
+	The contents are a view into a package mapping, a decompressed copy or a mapping of the file on disk, valid as
+	long as the object. data() is nullptr if the file couldn't be opened (or is empty).
+
+	Packages are mounted and unmounted while no files are open (startup and shutdown), lookups don't lock.
+	A packaged file shadows the file on disk: edits on disk, hot reloads included, aren't seen until the package is rebuilt.
+	Writes (e.g cooking) still go to disk.
+*/
+class VirtualFile
+{
+public:
+	struct Stats
+	{
+		uint32_t package_reads = 0;
+		uint32_t disk_reads = 0;
+		uint64_t decompressed_bytes = 0;
+		float package_read_ms = 0.f;		// lookups and decompression
+	};
+
+	static bool mount(const std::filesystem::path& package);
+	static void unmount_all();
+
+	// Files and bytes of the mounted packages
+	static uint32_t get_package_files();
+	static uint64_t get_package_bytes();
+
+	static Stats get_stats();
+
+public:
+	VirtualFile() = default;
+	VirtualFile(const std::filesystem::path& path);
+
+	bool is_open() const { return data() != nullptr; }
+	const uint8_t* data() const;
+	size_t size() const;
+
+	// Read from a package rather than disk
+	bool is_packaged() const { return m_packaged; }
+
+private:
+	MappedFile m_disk;
+
+	bool m_packaged = false;
+	std::vector<uint8_t> m_storage;
+	const uint8_t* m_view = nullptr;
+	size_t m_size = 0;
+};
@@ -0,0 +1,36 @@
+#include "ShaderInterop_Common.h"
+
+/*
+    gpassPS for albedos packed into a texture array (DiskTextureManager::pack), the slice comes from the per draw data
+*/
+struct PixelInput
+{
+    float4 position : SV_POSITION;
+    float3 world : WORLD;
+    float2 uv : UV;
+    float3 normal : NORMAL;
+    nointerpolation uint albedo_slice : ALBEDO_SLICE;
+};
+
+struct PixelOutput
+{
+    float4 albedo : SV_TARGET0;
+    float4 normal : SV_TARGET1;
+    float4 world : SV_TARGET2;
+};
+
+READ_RESOURCE(Texture2DArray, main_tex, 0)
+SAMPLER(repeat_samp, 1)
+
+PixelOutput main(PixelInput input)
+{
+    float3 col = main_tex.Sample(repeat_samp, float3(input.uv, input.albedo_slice)).rgb;
+    
+    PixelOutput output = (PixelOutput) 0;
+
+    output.albedo = float4(col, 1.f);
+    output.normal = float4(normalize(float3(input.normal)), 1.f);
+    output.world = float4(input.world, 1.f);
+
+    return output;
+}
@@ -0,0 +1,56 @@
+#include "ShaderInterop_Renderer.h"
+
+/*
+    gpassVS for the VertexQuantizer streams:
+        position    R16G16B16A16_UNORM, dequantized by the world matrix (bounds scale + offset folded in)
+        uv          R16G16_FLOAT
+        normal      R16G16_SNORM, octahedral
+*/
+struct VertexInput
+{
+    float4 position : POSITION;
+    float2 uv : UV;
+    float2 normal : NORMAL;
+};
+
+struct VertexOutput
+{
+    float4 position : SV_POSITION;
+    float3 world : WORLD;
+    float2 uv : UV;
+    float3 normal : NORMAL;
+    nointerpolation uint albedo_slice : ALBEDO_SLICE;     // read by gpassArrayPS only
+};
+
+CBUFFER(PerFrameCB, GLOBAL_PER_FRAME_CB_SLOT)
+{
+    PerFrameData g_per_frame;
+}
+
+cbuffer PerDraw : register(b1)
+{
+    matrix g_world_mat; 
+    uint g_albedo_slice;
+}
+
+float3 oct_decode(float2 e)
+{
+    float3 n = float3(e.xy, 1.f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.f ? -t : t;
+    return normalize(n);
+}
+
+VertexOutput main(VertexInput input)
+{
+    VertexOutput output = (VertexOutput) 0;
+    
+    float4 world = mul(g_world_mat, float4(input.position.xyz, 1.f));
+    output.world = world.rgb;
+    output.position = mul(g_per_frame.proj_mat, mul(g_per_frame.view_mat, world));
+    output.uv = input.uv;
+    output.albedo_slice = g_albedo_slice;
+    output.normal = oct_decode(input.normal);
+    
+    return output;
+}
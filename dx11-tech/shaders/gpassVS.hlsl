@@ -13,6 +13,7 @@ struct VertexOutput
     float3 world : WORLD;
     float2 uv : UV;
     float3 normal : NORMAL;
+    nointerpolation uint albedo_slice : ALBEDO_SLICE;     // read by gpassArrayPS only
 };
 
 CBUFFER(PerFrameCB, GLOBAL_PER_FRAME_CB_SLOT)
@@ -23,6 +24,7 @@ CBUFFER(PerFrameCB, GLOBAL_PER_FRAME_CB_SLOT)
 cbuffer PerDraw : register(b1)
 {
     matrix g_world_mat; 
+    uint g_albedo_slice;
 }
 
 VertexOutput main(VertexInput input)
@@ -33,6 +35,7 @@ VertexOutput main(VertexInput input)
     output.world = world.rgb;
     output.position = mul(g_per_frame.proj_mat, mul(g_per_frame.view_mat, world));
     output.uv = input.uv;
+    output.albedo_slice = g_albedo_slice;
     output.normal = input.normal;
     
     return output;
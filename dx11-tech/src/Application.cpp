@@ -7,11 +7,16 @@
 #include "Camera/FPCController.h"
 #include "Camera/FPPCamera.h"
 
+#include "Graphics/AssetReloader.h"
 #include "Graphics/DiskTextureManager.h"
 #include "Graphics/MaterialManager.h"
 #include "Graphics/ModelManager.h"
 #include "Graphics/Model.h"
 #include "Graphics/Renderer/Renderer.h"
+#include "Profiler/StartupProfiler.h"
+#include "ThreadPool.h"
+#include "AssetPackage.h"
+#include "VirtualFile.h"
 
 // Important that Globals is defined last, as the extern members need to be defined!
 // We can define GfxGlobals.h if we want to have a separation layer later 
@@ -20,7 +25,7 @@
 // Just an idea.
 #include "Globals.h"
 
-Application::Application()
+Application::Application(std::optional<FlythroughBenchmark::Settings> flythrough)
 {
 	/*
 
@@ -42,22 +47,50 @@ Application::Application()
 	constexpr UINT WIDTH = WIN_WIDTH;
 	constexpr UINT HEIGHT = WIN_HEIGHT;
 
+	StartupProfiler::initialize();
+
 	// Initialize window and input
-	auto win_proc = [this](HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) -> LRESULT { return this->custom_win_proc(hwnd, uMsg, wParam, lParam); };
-	m_win = make_unique<Window>(GetModuleHandle(NULL), win_proc, WIN_WIDTH, WIN_HEIGHT);
-	m_input = make_unique<Input>(m_win->get_hwnd());
+	{
+		auto _ = StartupProfiler::Scoped("Window + Input");
+		auto win_proc = [this](HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) -> LRESULT { return this->custom_win_proc(hwnd, uMsg, wParam, lParam); };
+		m_win = make_unique<Window>(GetModuleHandle(NULL), win_proc, WIN_WIDTH, WIN_HEIGHT);
+		m_input = make_unique<Input>(m_win->get_hwnd());
+	}
 
 	// Initialize systems
+	ThreadPool::initialize();
 	CPUProfiler::initialize();
-	GfxDevice::initialize(make_unique<DXDevice>(m_win->get_hwnd(), WIDTH, HEIGHT));
+
+	// Assets are read from the package when one was built (--build-package), disk otherwise
+	if (std::filesystem::exists(AssetPackage::DEFAULT_PATH))
+	{
+		auto _ = StartupProfiler::Scoped("Asset package");
+		VirtualFile::mount(AssetPackage::DEFAULT_PATH);
+	}
+
+	{
+		auto _ = StartupProfiler::Scoped("GfxDevice");
+		GfxDevice::initialize(make_unique<DXDevice>(m_win->get_hwnd(), WIDTH, HEIGHT));
+	}
 	FrameProfiler::initialize(perf::cpu_profiler, gfx::dev->get_profiler());
-	ImGuiDevice::initialize(gfx::dev);
+	{
+		auto _ = StartupProfiler::Scoped("ImGui");
+		ImGuiDevice::initialize(gfx::dev);
+	}
 
 	DiskTextureManager::initialize(gfx::dev);
 	MaterialManager::initialize(gfx::tex_mgr);
 	ModelManager::initialize(gfx::dev, gfx::mat_mgr);
+	gfx::model_mgr->set_vertex_quantization(true);		// half the vertex memory and fetch bandwidth, see VertexQuantizer
 	
-	Renderer::initialize();
+	{
+		auto _ = StartupProfiler::Scoped("Renderer");
+		Renderer::initialize();
+	}
+
+	const auto& shader_stats = gfx::dev->get_shader_cache_stats();
+	fmt::print("Shaders: {} requests, {} from the bytecode cache ({:.0f}% hit rate), {:.1f} ms compiling, ~{:.1f} ms of compilation saved\n",
+		shader_stats.requests, shader_stats.hits, shader_stats.get_hit_rate() * 100.f, shader_stats.compile_ms, shader_stats.saved_ms);
 
 	// Create perspective camera
 	m_cam = make_unique<FPPCamera>(90.f, (float)WIDTH/HEIGHT, 0.1f, 600.f);
@@ -72,14 +105,37 @@ Application::Application()
 	gfx::rend->set_camera(m_camera_controller->get_active_camera());
 	
 	// Renderer
+	// Models are imported in the background and show up once loaded (startup profile is finished on the frame they do)
 	m_model_renderer = new ModelRenderer(gfx::rend);
-	m_sponza = m_model_renderer->load_model("models/sponza/sponza.obj");
-	m_nanosuit = m_model_renderer->load_model("models/nanosuit/nanosuit.obj");
+	m_sponza = m_model_renderer->load_model_async("models/sponza/sponza.obj");
+	m_nanosuit = m_model_renderer->load_model_async("models/nanosuit/nanosuit.obj");
+
+	ImGuiDevice::add_ui("camera path", [&]() { declare_camera_path_ui(); });
+
+	if (flythrough)
+	{
+		// Every frame of the replay has to render the full scene
+		m_model_renderer->wait_for_loads();
+
+		m_flythrough = make_unique<FlythroughBenchmark>(*flythrough);
+		if (!m_flythrough->is_loaded())
+		{
+			m_exit_code = 1;
+			m_app_alive = false;
+		}
 
+		// Measure frames, not the display refresh rate
+		gfx::rend->set_vsync(false);
+	}
+	else
+		m_asset_reloader = make_unique<AssetReloader>(gfx::dev, gfx::mat_mgr, gfx::model_mgr);
 }
 
 Application::~Application()
 {
+	m_asset_reloader.reset();
+	// in-flight imports read through the mounted packages and the managers below
+	m_model_renderer->wait_for_loads();
 	delete m_model_renderer;
 
 	Renderer::shutdown();
@@ -89,9 +145,13 @@ Application::~Application()
 	ImGuiDevice::shutdown();
 	FrameProfiler::shutdown();
 	GfxDevice::shutdown();
+	ThreadPool::shutdown();
+	VirtualFile::unmount_all();		// after the pool, no job may still read a package
+	CPUProfiler::shutdown();
+	StartupProfiler::shutdown();
 }
 
-void Application::run()
+int Application::run()
 {
 	float dt = 0.f;
 	while (m_win->is_alive() && m_app_alive)
@@ -109,7 +169,20 @@ void Application::run()
 		m_input->begin();
 
 		// Update CPU states
-		update(dt);
+		if (m_flythrough)
+		{
+			if (!m_flythrough->begin_frame(m_cam.get()))
+			{
+				m_exit_code = m_flythrough->finish();
+				break;
+			}
+		}
+		else
+			update(dt);
+
+		// Pick up edited shaders, textures and models
+		if (m_asset_reloader)
+			m_asset_reloader->update();
 
 		// Render GPU
 		gfx::rend->begin();
@@ -129,6 +202,9 @@ void Application::run()
 		*/
 		m_model_renderer->begin();
 
+		if (perf::startup_profiler->is_recording() && m_model_renderer->get_pending_loads() == 0)
+			perf::startup_profiler->finish("startup_trace.json");
+
 		// Submit sponza
 		m_model_renderer->submit(m_sponza, DirectX::SimpleMath::Matrix::CreateScale(0.07f));
 
@@ -164,7 +240,12 @@ void Application::run()
 		// End frame
 		dt = frame_time.elapsed(Timer::Unit::Seconds);
 		perf::profiler->frame_end();
+
+		if (m_flythrough)
+			m_flythrough->end_frame(perf::cpu_profiler->get_last_frame_statistics(), gfx::dev->get_profiler()->get_frame_statistics());
 	}
+
+	return m_exit_code;
 }
 
 void Application::on_resize(UINT width, UINT height)
@@ -184,6 +265,51 @@ void Application::update(float dt)
 	// Update camera controller
 	m_camera_controller->update(dt);
 
+	if (m_recording_path)
+	{
+		m_record_time += dt;
+		auto cam = static_cast<FPPCamera*>(m_camera_controller->get_active_camera());		// Controller only drives FPP cameras
+		m_recorded_path.add_keyframe(m_record_time, CameraPath::capture(*cam));
+	}
+}
+
+void Application::declare_camera_path_ui()
+{
+	ImGui::Begin("Camera Path");
+
+	if (!m_recording_path)
+	{
+		if (ImGui::Button("Record"))
+		{
+			m_recorded_path.clear();
+			m_record_time = 0.f;
+			m_recorded_path.begin_segment(m_segment_name.data(), 0.f);
+			m_recording_path = true;
+		}
+	}
+	else if (ImGui::Button("Stop"))
+		m_recording_path = false;
+
+	ImGui::InputText("Segment", m_segment_name.data(), m_segment_name.size());
+	if (m_recording_path)
+	{
+		ImGui::SameLine();
+		if (ImGui::Button("Begin Segment"))
+			m_recorded_path.begin_segment(m_segment_name.data(), m_record_time);
+	}
+
+	ImGui::Text(fmt::format("Recorded: {:.2f} s, {} segment(s)", m_recorded_path.get_duration(), m_recorded_path.get_segments().size()).c_str());
+
+	ImGui::InputText("File", m_path_file.data(), m_path_file.size());
+	if (!m_recording_path && !m_recorded_path.empty() && ImGui::Button("Save"))
+	{
+		if (m_recorded_path.write(m_path_file.data()))
+			fmt::print("Camera path saved to {}, replay with --flythrough {}\n", m_path_file.data(), m_path_file.data());
+		else
+			fmt::print(fg(fmt::color::red), "Failed to save camera path to {}\n", m_path_file.data());
+	}
+
+	ImGui::End();
 }
 
 LRESULT Application::custom_win_proc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
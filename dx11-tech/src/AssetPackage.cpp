@@ -0,0 +1,413 @@
+#include "pch.h"
+#include "AssetPackage.h"
+#include "Lz4.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <cstring>
+#include <fstream>
+
+namespace jobs { extern ThreadPool* pool; }
+
+struct AssetPackage::Header
+{
+	char magic[4] = { 'D', 'X', 'P', 'K' };
+	uint32_t version = VERSION;
+	uint64_t file_size = 0;
+	uint32_t chunk_size = CHUNK_SIZE;
+	uint32_t entry_count = 0;
+	uint32_t chunk_count = 0;
+	uint32_t pad = 0;
+	uint64_t entries_offset = 0;
+	uint64_t chunks_offset = 0;
+	uint64_t names_offset = 0;
+	uint64_t names_size = 0;
+};
+
+struct AssetPackage::Entry
+{
+	uint64_t path_hash = 0;
+	uint64_t size = 0;
+	uint32_t first_chunk = 0;
+	uint32_t chunk_count = 0;
+	uint32_t name_offset = 0;
+	uint32_t name_size = 0;
+};
+
+struct AssetPackage::Chunk
+{
+	uint64_t offset = 0;
+	uint32_t stored_size = 0;		// == size if stored uncompressed
+	uint32_t size = 0;
+};
+
+namespace
+{
+	constexpr uint64_t s_alignment = 16;
+
+	uint64_t align_up(uint64_t offset)
+	{
+		return (offset + s_alignment - 1) & ~(s_alignment - 1);
+	}
+
+	uint64_t hash_name(std::string_view name)
+	{
+		return utils::hash_bytes(name.data(), name.size());
+	}
+
+	void gather_files(const std::filesystem::path& input, std::vector<std::filesystem::path>& files)
+	{
+		std::error_code ec;
+		if (std::filesystem::is_regular_file(input, ec))
+		{
+			files.push_back(input);
+			return;
+		}
+
+		for (auto it = std::filesystem::recursive_directory_iterator(input, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+		{
+			if (it->is_regular_file(ec))
+				files.push_back(it->path());
+		}
+		if (ec)
+			fmt::print(fg(fmt::color::red), "Failed to list {}\n", input.string());
+	}
+}
+
+std::optional<AssetPackage::BuildSettings> AssetPackage::parse_args(int argc, char** argv)
+{
+	BuildSettings settings{};
+	bool requested = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--build-package" && i + 1 < argc)
+		{
+			requested = true;
+			settings.output = argv[++i];
+
+			// Everything up to the next option is an input
+			while (i + 1 < argc && std::string_view(argv[i + 1]).rfind("--", 0) != 0)
+				settings.inputs.push_back(argv[++i]);
+		}
+	}
+
+	if (!requested)
+		return {};
+	return settings;
+}
+
+std::string AssetPackage::get_name(const std::filesystem::path& path)
+{
+	return path.lexically_normal().generic_string();
+}
+
+bool AssetPackage::build(const BuildSettings& settings)
+{
+	std::vector<std::filesystem::path> paths;
+	for (const auto& input : settings.inputs)
+		gather_files(input, paths);
+
+	struct PackedFile
+	{
+		std::string name;
+		std::filesystem::path path;
+		uint64_t size = 0;
+		uint32_t first_chunk = 0;
+		uint32_t chunk_count = 0;
+	};
+
+	// Sorted by name first so the output doesn't depend on directory iteration order, a file listed twice is packed once
+	// The output itself is skipped when packaging the directory it is written to
+	const auto output_name = get_name(settings.output);
+	std::vector<PackedFile> files;
+	for (const auto& path : paths)
+	{
+		auto name = get_name(path);
+		if (name != output_name && name != output_name + ".tmp")
+			files.push_back({ std::move(name), path });
+	}
+	std::sort(files.begin(), files.end(), [](const PackedFile& a, const PackedFile& b) { return a.name < b.name; });
+	files.erase(std::unique(files.begin(), files.end(), [](const PackedFile& a, const PackedFile& b) { return a.name == b.name; }), files.end());
+
+	std::vector<MappedFile> sources;
+	struct PendingChunk
+	{
+		uint32_t file = 0;
+		uint64_t offset = 0;		// in the source file
+		uint32_t size = 0;
+		std::vector<uint8_t> compressed;	// empty if stored uncompressed
+	};
+	std::vector<PendingChunk> chunks;
+
+	for (uint32_t i = 0; i < (uint32_t)files.size(); ++i)
+	{
+		sources.emplace_back(files[i].path);
+		auto& file = files[i];
+		file.size = sources.back().size();
+		file.first_chunk = (uint32_t)chunks.size();
+		for (uint64_t offset = 0; offset < file.size; offset += CHUNK_SIZE)
+			chunks.push_back({ i, offset, (uint32_t)(std::min)((uint64_t)CHUNK_SIZE, file.size - offset) });
+		file.chunk_count = (uint32_t)chunks.size() - file.first_chunk;
+	}
+
+	auto compress_chunk = [&](uint32_t i)
+	{
+		auto& chunk = chunks[i];
+		const uint8_t* src = sources[chunk.file].data() + chunk.offset;
+
+		chunk.compressed.resize(lz4::compress_bound(chunk.size));
+		const size_t compressed_size = lz4::compress(src, chunk.size, chunk.compressed.data(), chunk.compressed.size());
+		if (compressed_size == 0 || compressed_size >= chunk.size)
+			chunk.compressed = {};
+		else
+			chunk.compressed.resize(compressed_size);
+	};
+	if (jobs::pool)
+		jobs::pool->parallel_for((uint32_t)chunks.size(), compress_chunk);
+	else
+	{
+		for (uint32_t i = 0; i < (uint32_t)chunks.size(); ++i)
+			compress_chunk(i);
+	}
+
+	// Index sorted by hash, names in file order
+	Header hdr;
+	hdr.entry_count = (uint32_t)files.size();
+	hdr.chunk_count = (uint32_t)chunks.size();
+
+	std::vector<Entry> entries;
+	std::string names;
+	for (const auto& file : files)
+	{
+		Entry entry;
+		entry.path_hash = hash_name(file.name);
+		entry.size = file.size;
+		entry.first_chunk = file.first_chunk;
+		entry.chunk_count = file.chunk_count;
+		entry.name_offset = (uint32_t)names.size();
+		entry.name_size = (uint32_t)file.name.size();
+		entries.push_back(entry);
+		names += file.name;
+	}
+	std::sort(entries.begin(), entries.end(), [&](const Entry& a, const Entry& b) { return a.path_hash < b.path_hash; });
+
+	hdr.entries_offset = sizeof(Header);
+	hdr.chunks_offset = align_up(hdr.entries_offset + entries.size() * sizeof(Entry));
+	hdr.names_offset = hdr.chunks_offset + chunks.size() * sizeof(Chunk);
+	hdr.names_size = names.size();
+
+	std::vector<Chunk> chunk_table;
+	uint64_t offset = align_up(hdr.names_offset + hdr.names_size);
+	for (const auto& chunk : chunks)
+	{
+		const uint32_t stored_size = chunk.compressed.empty() ? chunk.size : (uint32_t)chunk.compressed.size();
+		chunk_table.push_back({ offset, stored_size, chunk.size });
+		offset = align_up(offset + stored_size);
+	}
+	hdr.file_size = offset;
+
+	std::error_code ec;
+	if (settings.output.has_parent_path())
+		std::filesystem::create_directories(settings.output.parent_path(), ec);
+
+	// Write to a temporary first so a partially written file is never picked up
+	auto tmp_path = settings.output;
+	tmp_path += ".tmp";
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			fmt::print(fg(fmt::color::red), "Failed to open {}\n", tmp_path.string());
+			return false;
+		}
+
+		static const uint8_t zeroes[s_alignment] = {};
+		auto pad_to = [&](uint64_t target) { file.write((const char*)zeroes, target - (uint64_t)file.tellp()); };
+
+		file.write((const char*)&hdr, sizeof(hdr));
+		file.write((const char*)entries.data(), entries.size() * sizeof(Entry));
+		pad_to(hdr.chunks_offset);
+		file.write((const char*)chunk_table.data(), chunk_table.size() * sizeof(Chunk));
+		file.write(names.data(), names.size());
+
+		for (size_t i = 0; i < chunks.size(); ++i)
+		{
+			pad_to(chunk_table[i].offset);
+			const auto& chunk = chunks[i];
+			if (chunk.compressed.empty())
+				file.write((const char*)sources[chunk.file].data() + chunk.offset, chunk.size);
+			else
+				file.write((const char*)chunk.compressed.data(), chunk.compressed.size());
+		}
+		pad_to(hdr.file_size);
+
+		if (!file.good())
+		{
+			fmt::print(fg(fmt::color::red), "Failed to write {}\n", tmp_path.string());
+			return false;
+		}
+	}
+
+	// The sources (possibly an older package among them) are still mapped
+	sources.clear();
+	std::filesystem::rename(tmp_path, settings.output, ec);
+	if (ec)
+	{
+		fmt::print(fg(fmt::color::red), "Failed to write {}\n", settings.output.string());
+		return false;
+	}
+
+	uint64_t bytes = 0;
+	for (const auto& file : files)
+		bytes += file.size;
+	fmt::print("Packed {} files ({:.1f} MB) into {} ({:.1f} MB)\n", files.size(), bytes / (1024.0 * 1024.0),
+		settings.output.string(), hdr.file_size / (1024.0 * 1024.0));
+	return true;
+}
+
+AssetPackage::AssetPackage(const std::filesystem::path& path) :
+	m_file(path)
+{
+	static_assert(sizeof(Header) == 64 && sizeof(Entry) == 32 && sizeof(Chunk) == 16);
+
+	if (!m_file.is_open() || m_file.size() < sizeof(Header))
+		return;
+
+	const auto base = m_file.data();
+	const auto hdr = (const Header*)base;
+	if (std::memcmp(hdr->magic, Header().magic, sizeof(hdr->magic)) != 0 || hdr->version != VERSION || hdr->file_size != m_file.size() ||
+		hdr->chunk_size == 0)
+		return;
+
+	// Sections must lie within the file, chunks within the chunk table and names
+	auto in_file = [&](uint64_t offset, uint64_t size) { return offset <= m_file.size() && size <= m_file.size() - offset; };
+	if (!in_file(hdr->entries_offset, (uint64_t)hdr->entry_count * sizeof(Entry)) ||
+		!in_file(hdr->chunks_offset, (uint64_t)hdr->chunk_count * sizeof(Chunk)) ||
+		!in_file(hdr->names_offset, hdr->names_size) ||
+		hdr->entries_offset % alignof(Entry) != 0 || hdr->chunks_offset % alignof(Chunk) != 0)
+		return;
+
+	m_entries = (const Entry*)(base + hdr->entries_offset);
+	m_chunks = (const Chunk*)(base + hdr->chunks_offset);
+	m_names = (const char*)(base + hdr->names_offset);
+	m_entry_count = hdr->entry_count;
+
+	for (uint32_t i = 0; i < hdr->chunk_count; ++i)
+	{
+		const auto& chunk = m_chunks[i];
+		if (!in_file(chunk.offset, chunk.stored_size) || chunk.size > hdr->chunk_size || chunk.stored_size > chunk.size)
+			return;
+		m_stats.stored_bytes += chunk.stored_size;
+	}
+
+	for (uint32_t i = 0; i < m_entry_count; ++i)
+	{
+		const auto& entry = m_entries[i];
+		if ((uint64_t)entry.first_chunk + entry.chunk_count > hdr->chunk_count ||
+			(uint64_t)entry.name_offset + entry.name_size > hdr->names_size ||
+			(i > 0 && m_entries[i - 1].path_hash > entry.path_hash))
+			return;
+
+		// Full chunks but the last one, which the reads rely on
+		uint64_t size = 0;
+		for (uint32_t c = 0; c < entry.chunk_count; ++c)
+		{
+			const auto& chunk = m_chunks[entry.first_chunk + c];
+			if (c + 1 < entry.chunk_count && chunk.size != hdr->chunk_size)
+				return;
+			size += chunk.size;
+		}
+		if (size != entry.size)
+			return;
+
+		m_stats.bytes += entry.size;
+	}
+
+	m_stats.files = m_entry_count;
+	m_stats.chunks = hdr->chunk_count;
+	m_well_formed = true;
+}
+
+std::string_view AssetPackage::get_entry_name(const Entry& entry) const
+{
+	return std::string_view(m_names + entry.name_offset, entry.name_size);
+}
+
+const AssetPackage::Entry* AssetPackage::find(const std::filesystem::path& path) const
+{
+	if (!m_well_formed)
+		return nullptr;
+
+	const auto name = get_name(path);
+	const uint64_t path_hash = hash_name(name);
+
+	const auto end = m_entries + m_entry_count;
+	for (auto it = std::lower_bound(m_entries, end, path_hash, [](const Entry& entry, uint64_t h) { return entry.path_hash < h; });
+		it != end && it->path_hash == path_hash; ++it)
+	{
+		if (get_entry_name(*it) == name)
+			return it;
+	}
+	return nullptr;
+}
+
+bool AssetPackage::contains(const std::filesystem::path& path) const
+{
+	return find(path) != nullptr;
+}
+
+bool AssetPackage::read(const std::filesystem::path& path, std::vector<uint8_t>& storage, const uint8_t*& data, size_t& size) const
+{
+	const auto entry = find(path);
+	if (!entry)
+		return false;
+
+	data = nullptr;
+	size = 0;
+	if (entry->size == 0)
+		return true;
+
+	const auto base = m_file.data();
+	const auto chunks = m_chunks + entry->first_chunk;
+	if (entry->chunk_count == 1 && chunks[0].stored_size == chunks[0].size)
+	{
+		data = base + chunks[0].offset;
+		size = (size_t)entry->size;
+		return true;
+	}
+
+	const uint64_t chunk_size = ((const Header*)base)->chunk_size;
+	storage.resize((size_t)entry->size);
+
+	std::atomic<bool> corrupt = false;
+	auto read_chunk = [&](uint32_t i)
+	{
+		const auto& chunk = chunks[i];
+		uint8_t* dst = storage.data() + i * chunk_size;
+		if (chunk.stored_size == chunk.size)
+			std::memcpy(dst, base + chunk.offset, chunk.size);
+		else if (!lz4::decompress(base + chunk.offset, chunk.stored_size, dst, chunk.size))
+			corrupt = true;
+	};
+
+	// A parallel_for from a pool job is fine, the caller works on the range too
+	if (entry->chunk_count > 1 && jobs::pool)
+		jobs::pool->parallel_for(entry->chunk_count, read_chunk);
+	else
+	{
+		for (uint32_t i = 0; i < entry->chunk_count; ++i)
+			read_chunk(i);
+	}
+
+	if (corrupt)
+	{
+		fmt::print(fg(fmt::color::red), "Corrupt chunk in package entry {}\n", get_entry_name(*entry));
+		storage = {};
+		return false;
+	}
+
+	data = storage.data();
+	size = storage.size();
+	return true;
+}
@@ -1,11 +1,14 @@
 #include "pch.h"
 #include "AssimpLoader.h"
+#include "Profiler/StartupProfiler.h"
 
 using namespace DirectX::SimpleMath;
 
 AssimpLoader::AssimpLoader(const std::filesystem::path& fpath) :
 	m_directory(std::filesystem::path(fpath.parent_path().string() + "/"))
 {
+	auto _ = StartupProfiler::Scoped("Assimp import: " + fpath.filename().string(), "import");
+
 	// Load assimp scene
 	Assimp::Importer importer;
 	const aiScene* scene = importer.ReadFile(
@@ -21,8 +24,9 @@ AssimpLoader::AssimpLoader(const std::filesystem::path& fpath) :
 		aiProcess_CalcTangentSpace |
 
 		// Extra flags (http://assimp.sourceforge.net/lib_html/postprocess_8h.html#a64795260b95f5a4b3f3dc1be4f52e410a444a6c9d8b63e6dc9e1e2e1edd3cbcd4)
-		aiProcess_JoinIdenticalVertices |
-		aiProcess_ImproveCacheLocality
+		aiProcess_JoinIdenticalVertices
+
+		// Triangle and vertex order is left to the MeshOptimizer
 	);
 
 	if (!scene)
@@ -96,8 +100,11 @@ void AssimpLoader::process_mesh(aiMesh* mesh, const aiScene* scene)
 		m_positions.push_back(mesh->mVertices[i]);
 		m_normals.push_back(mesh->mNormals[i]);
 
+		// Every vertex gets a uv so that the streams stay aligned
 		if (mesh->mTextureCoords[0])
 			m_uvs.push_back({ mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y });
+		else
+			m_uvs.push_back({ 0.f, 0.f });
 
 		if (mesh->mTangents)
 			m_tangents.push_back(mesh->mTangents[i]);
@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "Benchmark/BenchmarkCompare.h"
+#include <algorithm>
+#include <sstream>
+
+std::optional<BenchmarkCompare::Settings> BenchmarkCompare::parse_args(int argc, char** argv)
+{
+	Settings settings{};
+	bool requested = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--bench-compare" && i + 2 < argc)
+		{
+			requested = true;
+			settings.baseline = argv[++i];
+			settings.current = argv[++i];
+		}
+		else if (arg == "--tolerance" && i + 1 < argc)
+			settings.tolerance_pct = std::stof(argv[++i]);
+		else if (arg == "--metrics" && i + 1 < argc)
+		{
+			settings.metrics.clear();
+			std::stringstream ss(argv[++i]);
+			std::string metric;
+			while (std::getline(ss, metric, ','))
+				if (!metric.empty())
+					settings.metrics.push_back(metric);
+		}
+	}
+
+	if (!requested)
+		return {};
+	return settings;
+}
+
+int BenchmarkCompare::run(const Settings& settings)
+{
+	const auto baseline = BenchmarkReport::read(settings.baseline);
+	const auto current = BenchmarkReport::read(settings.current);
+	if (!baseline || !current)
+	{
+		fmt::print(fg(fmt::color::red), "Failed to read {}\n", !baseline ? settings.baseline.string() : settings.current.string());
+		return 1;
+	}
+
+	if (baseline->get_name() != current->get_name())
+		fmt::print(fg(fmt::color::yellow), "Comparing different benchmarks: '{}' vs '{}'\n", baseline->get_name(), current->get_name());
+
+	auto is_checked = [&](const std::string& metric)
+	{
+		return std::find(settings.metrics.cbegin(), settings.metrics.cend(), metric) != settings.metrics.cend();
+	};
+
+	// Only print the checked metrics, the rest (min/max/samples..) is noise in a diff
+	std::string last_entry;
+	for (const auto& diff : current->compare(*baseline))
+	{
+		if (!is_checked(diff.metric))
+			continue;
+
+		if (diff.entry != last_entry)
+		{
+			fmt::print("{}\n", diff.entry);
+			last_entry = diff.entry;
+		}
+
+		const auto color =
+			diff.delta_pct > settings.tolerance_pct ? fmt::color::red :
+			diff.delta_pct < -settings.tolerance_pct ? fmt::color::green :
+			fmt::color::white;
+		fmt::print(fg(color), "    {:<20} {:14.4f} -> {:14.4f} ({:+7.1f}%)\n", diff.metric, diff.baseline, diff.current, diff.delta_pct);
+	}
+
+	// Entries which can't be compared
+	for (const auto& [entry, _] : baseline->get_entries())
+		if (current->get_entries().count(entry) == 0)
+			fmt::print(fg(fmt::color::yellow), "Removed: {}\n", entry);
+	for (const auto& [entry, _] : current->get_entries())
+		if (baseline->get_entries().count(entry) == 0)
+			fmt::print(fg(fmt::color::yellow), "Added: {}\n", entry);
+
+	const auto regressions = current->find_regressions(*baseline, settings.tolerance_pct, settings.metrics);
+	if (!regressions.empty())
+	{
+		fmt::print(fg(fmt::color::red), "{} regression(s) beyond {:.1f}% tolerance\n", regressions.size(), settings.tolerance_pct);
+		return 1;
+	}
+
+	fmt::print(fg(fmt::color::green), "No regressions (tolerance {:.1f}%)\n", settings.tolerance_pct);
+	return 0;
+}
@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "Benchmark/BenchmarkReport.h"
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+
+SampleStats SampleStats::from(std::vector<float> samples)
+{
+	SampleStats stats{};
+	if (samples.empty())
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+
+	// Nearest rank
+	auto percentile = [&samples](float pct) -> float
+	{
+		const auto rank = (size_t)std::ceil(pct / 100.f * samples.size());
+		return samples[(std::min)((std::max)(rank, (size_t)1) - 1, samples.size() - 1)];
+	};
+
+	stats.count = samples.size();
+	stats.avg = (float)(std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size());
+	stats.min = samples.front();
+	stats.max = samples.back();
+	stats.p50 = percentile(50.f);
+	stats.p95 = percentile(95.f);
+	stats.p99 = percentile(99.f);
+	return stats;
+}
+
+BenchmarkReport::BenchmarkReport(const std::string& name) :
+	m_name(name)
+{
+}
+
+void BenchmarkReport::set(const std::string& entry, const std::string& metric, double value)
+{
+	m_entries[entry][metric] = value;
+}
+
+void BenchmarkReport::set_samples(const std::string& entry, const std::vector<float>& samples, const std::string& unit_suffix)
+{
+	const auto stats = SampleStats::from(samples);
+	auto& metrics = m_entries[entry];
+	metrics["samples"] = (double)stats.count;
+	metrics["avg" + unit_suffix] = stats.avg;
+	metrics["min" + unit_suffix] = stats.min;
+	metrics["max" + unit_suffix] = stats.max;
+	metrics["p50" + unit_suffix] = stats.p50;
+	metrics["p95" + unit_suffix] = stats.p95;
+	metrics["p99" + unit_suffix] = stats.p99;
+}
+
+const std::string& BenchmarkReport::get_name() const
+{
+	return m_name;
+}
+
+const std::map<std::string, std::map<std::string, double>>& BenchmarkReport::get_entries() const
+{
+	return m_entries;
+}
+
+bool BenchmarkReport::write(const std::filesystem::path& path) const
+{
+	auto root = JsonValue::object();
+	root["benchmark"] = m_name;
+
+	auto& entries = root["entries"];
+	entries = JsonValue::object();
+	for (const auto& [entry, metrics] : m_entries)
+	{
+		auto& json_metrics = entries[entry];
+		json_metrics = JsonValue::object();
+		for (const auto& [metric, value] : metrics)
+			json_metrics[metric] = value;
+	}
+
+	return root.write_file(path);
+}
+
+std::optional<BenchmarkReport> BenchmarkReport::read(const std::filesystem::path& path)
+{
+	auto root = JsonValue::read_file(path);
+	if (!root || !root->is_object())
+		return {};
+
+	const auto name = root->find("benchmark");
+	const auto entries = root->find("entries");
+	if (!name || !name->is_string() || !entries || !entries->is_object())
+		return {};
+
+	BenchmarkReport report(name->as_string());
+	for (const auto& [entry, metrics] : entries->as_object())
+	{
+		if (!metrics.is_object())
+			continue;
+
+		for (const auto& [metric, value] : metrics.as_object())
+			if (value.is_number())
+				report.set(entry, metric, value.as_number());
+	}
+	return report;
+}
+
+std::vector<BenchmarkReport::Difference> BenchmarkReport::compare(const BenchmarkReport& baseline) const
+{
+	std::vector<Difference> diffs;
+	for (const auto& [entry, metrics] : m_entries)
+	{
+		auto base_entry = baseline.m_entries.find(entry);
+		if (base_entry == baseline.m_entries.cend())
+			continue;
+
+		for (const auto& [metric, value] : metrics)
+		{
+			auto base_metric = base_entry->second.find(metric);
+			if (base_metric == base_entry->second.cend())
+				continue;
+
+			Difference diff{ entry, metric, base_metric->second, value, 0.0 };
+			if (diff.baseline != 0.0)
+				diff.delta_pct = (diff.current - diff.baseline) / std::abs(diff.baseline) * 100.0;
+			else if (diff.current != 0.0)
+				diff.delta_pct = 100.0;		// something appeared from nothing (e.g allocations in a previously allocation free scope)
+			diffs.push_back(diff);
+		}
+	}
+	return diffs;
+}
+
+std::vector<BenchmarkReport::Difference> BenchmarkReport::find_regressions(const BenchmarkReport& baseline, float tolerance_pct, const std::vector<std::string>& metrics) const
+{
+	std::vector<Difference> regressions;
+	for (const auto& diff : compare(baseline))
+	{
+		if (std::find(metrics.cbegin(), metrics.cend(), diff.metric) == metrics.cend())
+			continue;
+
+		if (diff.delta_pct > tolerance_pct)
+			regressions.push_back(diff);
+	}
+	return regressions;
+}
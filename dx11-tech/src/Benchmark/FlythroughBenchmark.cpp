@@ -0,0 +1,171 @@
+#include "pch.h"
+#include "Benchmark/FlythroughBenchmark.h"
+#include "Benchmark/BenchmarkReport.h"
+#include "Graphics/API/GfxCommon.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const std::string s_full_frame = "*** Full Frame ***";
+
+	// GPU frame data handed out after frame N belongs to frame N - (QUERY_LATENCY - 1)
+	constexpr uint64_t s_gpu_lag = gfxconstants::QUERY_LATENCY - 1;
+}
+
+std::optional<FlythroughBenchmark::Settings> FlythroughBenchmark::parse_args(int argc, char** argv)
+{
+	Settings settings{};
+	bool requested = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+
+		if (arg == "--flythrough" && has_value)
+		{
+			requested = true;
+			settings.path = argv[++i];
+		}
+		else if (arg == "--fixed-dt" && has_value)
+			settings.fixed_dt = std::stof(argv[++i]);
+		else if (arg == "--warmup" && has_value)
+			settings.warmup_frames = (UINT)std::stoul(argv[++i]);
+		else if (arg == "--out" && has_value)
+			settings.output = argv[++i];
+	}
+
+	if (!requested)
+		return {};
+	return settings;
+}
+
+FlythroughBenchmark::FlythroughBenchmark(const Settings& settings) :
+	m_settings(settings)
+{
+	assert(m_settings.fixed_dt > 0.f);
+
+	m_path = CameraPath::read(m_settings.path);
+	if (!m_path)
+	{
+		fmt::print(fg(fmt::color::red), "Failed to load camera path {}\n", m_settings.path.string());
+		return;
+	}
+
+	m_path_frames = (uint64_t)std::floor(m_path->get_duration() / m_settings.fixed_dt) + 1;
+	m_samples.resize(m_path_frames);
+
+	fmt::print("Flythrough: {} ({:.2f} s, {} segment(s)) at fixed dt {:.4f} s -> {} frames\n",
+		m_settings.path.string(), m_path->get_duration(), m_path->get_segments().size(), m_settings.fixed_dt, m_path_frames);
+}
+
+bool FlythroughBenchmark::is_loaded() const
+{
+	return m_path.has_value();
+}
+
+bool FlythroughBenchmark::begin_frame(FPPCamera* cam)
+{
+	if (!m_path)
+		return false;
+
+	// Warmup holds the first pose, trailing frames hold the last pose until the GPU timings have caught up
+	const uint64_t total_frames = m_settings.warmup_frames + m_path_frames + s_gpu_lag;
+	if (m_frame >= total_frames)
+		return false;
+
+	const auto path_frame = (int64_t)m_frame - (int64_t)m_settings.warmup_frames;
+	const float time = std::clamp(path_frame * m_settings.fixed_dt, 0.f, m_path->get_duration());
+
+	CameraPath::apply(m_path->sample(time), cam);
+	return true;
+}
+
+void FlythroughBenchmark::end_frame(const CPUProfiler::FrameData& cpu_stats, const GPUProfiler::FrameData& gpu_stats)
+{
+	auto get_full_frame = [](const std::map<std::string, float>& profiles)
+	{
+		auto it = profiles.find(s_full_frame);
+		return it != profiles.cend() ? it->second : 0.f;
+	};
+
+	const auto path_frame = (int64_t)m_frame - (int64_t)m_settings.warmup_frames;
+	if (path_frame >= 0 && path_frame < (int64_t)m_path_frames)
+	{
+		auto& sample = m_samples[path_frame];
+		sample.path_time = (std::min)(path_frame * m_settings.fixed_dt, m_path->get_duration());
+		sample.segment = m_path->get_segment_index(sample.path_time);
+		sample.cpu_ms = get_full_frame(cpu_stats.profiles);
+	}
+
+	const auto gpu_frame = path_frame - (int64_t)s_gpu_lag;
+	if (gpu_frame >= 0 && gpu_frame < (int64_t)m_path_frames)
+		m_samples[gpu_frame].gpu_ms = get_full_frame(gpu_stats.profiles);
+
+	++m_frame;
+}
+
+int FlythroughBenchmark::finish()
+{
+	if (!m_path)
+		return 1;
+
+	const auto& segments = m_path->get_segments();
+
+	std::vector<float> cpu_all, gpu_all;
+	std::vector<std::vector<float>> cpu_segments(segments.size()), gpu_segments(segments.size());
+	for (const auto& sample : m_samples)
+	{
+		cpu_all.push_back(sample.cpu_ms);
+		gpu_all.push_back(sample.gpu_ms);
+		if (!segments.empty())
+		{
+			cpu_segments[sample.segment].push_back(sample.cpu_ms);
+			gpu_segments[sample.segment].push_back(sample.gpu_ms);
+		}
+	}
+
+	BenchmarkReport report("flythrough: " + m_settings.path.filename().string());
+	report.set_samples("Path", cpu_all, "_cpu_ms");
+	report.set_samples("Path", gpu_all, "_gpu_ms");
+	report.set("Path", "fixed_dt", m_settings.fixed_dt);
+
+	for (size_t i = 0; i < segments.size(); ++i)
+	{
+		// Index prefix keeps identically named segments apart and the report in path order
+		const auto entry = fmt::format("Segment {:02}: {}", i, segments[i].name);
+		report.set_samples(entry, cpu_segments[i], "_cpu_ms");
+		report.set_samples(entry, gpu_segments[i], "_gpu_ms");
+		report.set(entry, "start_time", segments[i].start_time);
+	}
+
+	for (const auto& [entry, metrics] : report.get_entries())
+	{
+		fmt::print("{:<40} CPU avg {:7.3f} ms  p95 {:7.3f} ms   GPU avg {:7.3f} ms  p95 {:7.3f} ms\n", entry,
+			metrics.at("avg_cpu_ms"), metrics.at("p95_cpu_ms"), metrics.at("avg_gpu_ms"), metrics.at("p95_gpu_ms"));
+	}
+
+	if (!report.write(m_settings.output))
+	{
+		fmt::print(fg(fmt::color::red), "Failed to write flythrough results to {}\n", m_settings.output.string());
+		return 1;
+	}
+
+	auto csv_path = m_settings.output;
+	csv_path.replace_extension(".csv");
+	std::ofstream csv(csv_path);
+	if (csv.is_open())
+	{
+		csv << "frame,time,segment,cpu_ms,gpu_ms\n";
+		for (size_t i = 0; i < m_samples.size(); ++i)
+		{
+			const auto& s = m_samples[i];
+			const auto segment = segments.empty() ? std::string() : segments[s.segment].name;
+			csv << fmt::format("{},{:.4f},{},{:.4f},{:.4f}\n", i, s.path_time, segment, s.cpu_ms, s.gpu_ms);
+		}
+	}
+
+	fmt::print("Flythrough results written to {} and {}\n", m_settings.output.string(), csv_path.string());
+	return 0;
+}
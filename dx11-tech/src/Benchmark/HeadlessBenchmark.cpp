@@ -0,0 +1,407 @@
+#include "pch.h"
+#include "Benchmark/HeadlessBenchmark.h"
+#include "Benchmark/BenchmarkReport.h"
+#include "Profiler/AllocationTracker.h"
+#include "Profiler/FrameProfiler.h"
+#include "Profiler/StartupProfiler.h"
+#include "Timer.h"
+#include "ThreadPool.h"
+#include "VirtualFile.h"
+
+#include "Camera/FPPCamera.h"
+
+#include "Graphics/API/GfxDevice.h"
+#include "Graphics/API/ImGuiDevice.h"
+#include "Graphics/DiskTextureManager.h"
+#include "Graphics/MaterialManager.h"
+#include "Graphics/ModelManager.h"
+#include "Graphics/Renderer/Renderer.h"
+
+#include "Globals.h"
+
+std::optional<HeadlessBenchmark::Settings> HeadlessBenchmark::parse_args(int argc, char** argv)
+{
+	Settings settings{};
+	bool requested = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+
+		if (arg == "--headless-bench")
+			requested = true;
+		else if (arg == "--frames" && has_value)
+			settings.frames = (UINT)std::stoul(argv[++i]);
+		else if (arg == "--warmup" && has_value)
+			settings.warmup_frames = (UINT)std::stoul(argv[++i]);
+		else if (arg == "--out" && has_value)
+			settings.output = argv[++i];
+		else if (arg == "--baseline" && has_value)
+			settings.baseline = argv[++i];
+		else if (arg == "--tolerance" && has_value)
+			settings.tolerance_pct = std::stof(argv[++i]);
+		else if (arg == "--call-stream" && has_value)
+			settings.call_stream = argv[++i];
+		else if (arg == "--quantize-vertices")
+			settings.quantize_vertices = true;
+		else if (arg == "--texture-budget" && has_value)
+			settings.texture_budget_mb = (uint32_t)std::stoul(argv[++i]);
+		else if (arg == "--pack-textures")
+			settings.pack_textures = true;
+		else if (arg == "--package" && has_value)
+			settings.package = argv[++i];
+	}
+
+	if (!requested)
+		return {};
+	return settings;
+}
+
+HeadlessBenchmark::HeadlessBenchmark(const Settings& settings) :
+	m_settings(settings)
+{
+	// Same system setup as the Application, minus window/input and with a headless device
+	StartupProfiler::initialize();
+	ThreadPool::initialize();
+	CPUProfiler::initialize();
+	if (m_settings.package)
+		VirtualFile::mount(*m_settings.package);
+	GfxDevice::initialize_headless(m_settings.width, m_settings.height);
+	gfx::dev->enable_recording();
+	FrameProfiler::initialize(perf::cpu_profiler, gfx::dev->get_profiler());
+	ImGuiDevice::initialize(gfx::dev);
+
+	DiskTextureManager::initialize(gfx::dev);
+	if (m_settings.texture_budget_mb)
+	{
+		auto streaming = gfx::tex_mgr->get_streamer()->get_settings();
+		streaming.budget_bytes = (uint64_t)*m_settings.texture_budget_mb * 1024 * 1024;
+		gfx::tex_mgr->get_streamer()->set_settings(streaming);
+	}
+	if (m_settings.pack_textures)
+	{
+		gfx::tex_mgr->set_texture_streaming(false);
+		gfx::tex_mgr->set_texture_packing(true);
+	}
+	MaterialManager::initialize(gfx::tex_mgr);
+	ModelManager::initialize(gfx::dev, gfx::mat_mgr);
+	gfx::model_mgr->set_vertex_quantization(m_settings.quantize_vertices);
+
+	Renderer::initialize();
+
+	m_cam = make_unique<FPPCamera>(90.f, (float)m_settings.width / m_settings.height, 0.1f, 600.f);
+	m_cam->set_position(0.f, 10.f, 0.f);
+	m_cam->set_sensitivity(1.f);
+	gfx::rend->set_camera(m_cam.get());
+
+	m_model_renderer = new ModelRenderer(gfx::rend);
+	m_model_renderer->set_texture_streaming(!m_settings.pack_textures);
+
+	Timer load_timer;
+	m_sponza = m_model_renderer->load_model_async("models/sponza/sponza.obj");
+	m_nanosuit = m_model_renderer->load_model_async("models/nanosuit/nanosuit.obj");
+	m_model_renderer->wait_for_loads();
+	m_load_time = load_timer.elapsed();
+
+	perf::startup_profiler->finish();
+}
+
+HeadlessBenchmark::~HeadlessBenchmark()
+{
+	// in-flight imports read through the mounted packages and the managers below
+	m_model_renderer->wait_for_loads();
+	delete m_model_renderer;
+
+	Renderer::shutdown();
+	ModelManager::shutdown();
+	MaterialManager::shutdown();
+	DiskTextureManager::shutdown();
+	ImGuiDevice::shutdown();
+	FrameProfiler::shutdown();
+	GfxDevice::shutdown();
+	ThreadPool::shutdown();
+	VirtualFile::unmount_all();		// after the pool, no job may still read a package
+	CPUProfiler::shutdown();
+	StartupProfiler::shutdown();
+}
+
+void HeadlessBenchmark::submit_scene()
+{
+	// Mirrors the scene submitted by the Application
+	m_model_renderer->begin();
+
+	m_model_renderer->submit(m_sponza, DirectX::SimpleMath::Matrix::CreateScale(0.07f));
+	for (int i = 0; i < 10; ++i)
+	{
+		ModelRenderSpec spec{};
+		spec.casts_shadow = i % 2 != 0;
+
+		m_model_renderer->submit(m_nanosuit, DirectX::SimpleMath::Matrix::CreateScale(1.0) *
+			DirectX::SimpleMath::Matrix::CreateTranslation(-45.f + i * 8.f, 0.f, 0.f), spec);
+	}
+
+	m_model_renderer->end();
+}
+
+int HeadlessBenchmark::run()
+{
+	struct PhaseSamples
+	{
+		std::vector<float> times;
+		std::vector<float> allocs;
+		std::vector<float> alloc_bytes;
+
+		void add(float time, const perf::AllocationStats& alloc_delta)
+		{
+			times.push_back(time);
+			allocs.push_back((float)alloc_delta.count);
+			alloc_bytes.push_back((float)alloc_delta.bytes);
+		}
+	};
+
+	std::map<std::string, PhaseSamples> phases;
+	std::map<std::string, std::vector<float>> scopes;		// FrameProfiler CPU scopes
+
+	// Full camera turn over the measured frames so the submission isn't identical every frame
+	const float yaw_step = 360.f / (std::max)(m_settings.frames, 1u);
+	const UINT total_frames = m_settings.warmup_frames + m_settings.frames;
+
+	fmt::print("Headless benchmark: {} warmup frames, {} measured frames\n", m_settings.warmup_frames, m_settings.frames);
+
+	auto recorder = gfx::dev->get_recorder();
+	std::map<std::string, std::pair<std::vector<float>, std::vector<float>>> calls;		// { requested, issued } per frame
+	std::vector<float> filter_efficiency;
+	std::vector<float> cluster_tested, cluster_frustum, cluster_backface, cluster_draws;
+	std::vector<float> triangles_full, triangles_submitted;
+
+	// Allocations are only counted for the benchmark frames, the regular app doesn't pay for it
+	perf::AllocationTracking allocation_tracking;
+
+	for (UINT frame = 0; frame < total_frames; ++frame)
+	{
+		const bool measured = frame >= m_settings.warmup_frames;
+		const bool last_frame = frame + 1 == total_frames;
+
+		if (last_frame && m_settings.call_stream)
+			recorder->set_serialize_stream(true);
+
+		perf::profiler->frame_start();
+		const auto frame_allocs = perf::get_allocation_stats();
+		Timer frame_timer;
+
+		m_cam->update_orientation(-yaw_step, 0.f, 0.f);
+		m_cam->update_matrices();
+
+		gfx::rend->begin();
+		gfx::rend->set_camera(m_cam.get());
+
+		const auto submit_allocs = perf::get_allocation_stats();
+		Timer submit_timer;
+		submit_scene();
+		const float submit_time = submit_timer.elapsed();
+		const auto submit_alloc_delta = perf::get_allocation_stats() - submit_allocs;
+
+		const auto render_allocs = perf::get_allocation_stats();
+		Timer render_timer;
+		gfx::rend->render();
+		const float render_time = render_timer.elapsed();
+		const auto render_alloc_delta = perf::get_allocation_stats() - render_allocs;
+
+		gfx::rend->end();
+
+		const float frame_time = frame_timer.elapsed();
+		const auto frame_alloc_delta = perf::get_allocation_stats() - frame_allocs;
+
+		perf::profiler->frame_end();
+
+		if (!measured)
+			continue;
+
+		phases["Frame"].add(frame_time, frame_alloc_delta);
+		phases["Submit"].add(submit_time, submit_alloc_delta);
+		phases["Render (sort + flush)"].add(render_time, render_alloc_delta);
+
+		for (const auto& [name, time] : perf::cpu_profiler->get_last_frame_statistics().profiles)
+			scopes[name].push_back(time);
+
+		const auto& call_stats = recorder->get_frame_stats();
+		for (size_t i = 0; i < call_stats.size(); ++i)
+		{
+			if (call_stats[i].requested == 0)
+				continue;
+			auto& [requested, issued] = calls[to_string((GfxCall)i)];
+			requested.push_back((float)call_stats[i].requested);
+			issued.push_back((float)call_stats[i].issued);
+		}
+		filter_efficiency.push_back(GfxCallRecorder::filter_efficiency(call_stats));
+
+		const auto& cluster_stats = m_model_renderer->get_cluster_stats();
+		cluster_tested.push_back((float)cluster_stats.clusters);
+		cluster_frustum.push_back((float)cluster_stats.culled_frustum);
+		cluster_backface.push_back((float)cluster_stats.culled_backface);
+		cluster_draws.push_back((float)cluster_stats.draws);
+
+		const auto& lod_stats = m_model_renderer->get_lod_stats();
+		triangles_full.push_back((float)lod_stats.triangles_full);
+		triangles_submitted.push_back((float)lod_stats.triangles_submitted);
+	}
+
+	if (m_settings.call_stream)
+	{
+		if (recorder->write_stream(*m_settings.call_stream))
+			fmt::print("GfxDevice call stream of the last frame written to {}\n", m_settings.call_stream->string());
+		else
+			fmt::print(fg(fmt::color::red), "Failed to write call stream to {}\n", m_settings.call_stream->string());
+	}
+
+	uint64_t invalid_handles = 0;
+	for (const auto& stats : recorder->get_total_stats())
+		invalid_handles += stats.invalid_handles;
+
+	// Gather report
+	BenchmarkReport report("headless_renderer");
+	report.set("Startup: Model Loading", "time_ms", m_load_time);
+	report.set("Startup: Total", "time_ms", perf::startup_profiler->get_total_time());
+	for (const auto& [category, time] : perf::startup_profiler->get_category_totals())
+		report.set("Startup: " + category, "time_ms", time);
+
+	const auto& decode_stats = gfx::tex_mgr->get_decode_stats();
+	report.set("Startup: Texture decode", "textures", decode_stats.textures);
+	report.set("Startup: Texture decode", "decoded_mb", decode_stats.decoded_bytes / (1024.0 * 1024.0));
+	report.set("Startup: Texture decode", "wall_time_ms", decode_stats.time_ms);
+	report.set("Startup: Texture decode", "throughput_mb_per_s", decode_stats.get_throughput_mb_per_s());
+	report.set("Startup: Texture decode", "cooked_cache_hits", decode_stats.cache_hits);
+	report.set("Startup: Vertex data", "vertex_mb", gfx::model_mgr->get_vertex_bytes() / (1024.0 * 1024.0));
+	report.set("Startup: Vertex data", "quantized", m_settings.quantize_vertices ? 1.0 : 0.0);
+
+	const auto heap = gfx::model_mgr->get_geometry_heap_stats();
+	report.set("Startup: Geometry heap", "vertex_chunks", heap.vertex_chunks);
+	report.set("Startup: Geometry heap", "index_chunks", heap.index_chunks);
+	report.set("Startup: Geometry heap", "allocations", heap.allocations);
+	report.set("Startup: Geometry heap", "capacity_mb", heap.capacity_bytes / (1024.0 * 1024.0));
+	report.set("Startup: Geometry heap", "used_mb", heap.used_bytes / (1024.0 * 1024.0));
+	report.set("Startup: Geometry heap", "free_ranges", heap.free_ranges);
+	report.set("Startup: Geometry heap", "fragmentation", heap.fragmentation);
+
+	const auto& texture_content = gfx::tex_mgr->get_content_stats();
+	const auto& geometry_content = gfx::model_mgr->get_geometry_content_stats();
+	report.set("Startup: Content cache", "textures_shared", texture_content.hits);
+	report.set("Startup: Content cache", "texture_mb_saved", texture_content.bytes_saved / (1024.0 * 1024.0));
+	report.set("Startup: Content cache", "geometry_shared", geometry_content.hits);
+	report.set("Startup: Content cache", "geometry_mb_saved", geometry_content.bytes_saved / (1024.0 * 1024.0));
+
+	const auto& packing = gfx::tex_mgr->get_pack_stats();
+	report.set("Startup: Texture packing", "arrays", packing.arrays);
+	report.set("Startup: Texture packing", "textures_packed", packing.slices);
+	report.set("Startup: Texture packing", "array_mb", packing.bytes / (1024.0 * 1024.0));
+
+	const auto file_reads = VirtualFile::get_stats();
+	report.set("Startup: Asset package", "files", VirtualFile::get_package_files());
+	report.set("Startup: Asset package", "package_mb", VirtualFile::get_package_bytes() / (1024.0 * 1024.0));
+	report.set("Startup: Asset package", "package_reads", file_reads.package_reads);
+	report.set("Startup: Asset package", "disk_reads", file_reads.disk_reads);
+	report.set("Startup: Asset package", "decompressed_mb", file_reads.decompressed_bytes / (1024.0 * 1024.0));
+	report.set("Startup: Asset package", "read_ms", file_reads.package_read_ms);
+
+	for (const auto& [name, samples] : phases)
+	{
+		const auto entry = "Phase: " + name;
+		report.set_samples(entry, samples.times);
+		report.set(entry, "allocs_per_frame", SampleStats::from(samples.allocs).avg);
+		report.set(entry, "alloc_bytes_per_frame", SampleStats::from(samples.alloc_bytes).avg);
+	}
+
+	for (const auto& [name, samples] : scopes)
+		report.set_samples("Scope: " + name, samples);
+
+	for (const auto& [name, samples] : calls)
+	{
+		const auto entry = "GfxCall: " + name;
+		report.set(entry, "requested_per_frame", SampleStats::from(samples.first).avg);
+		report.set(entry, "issued_per_frame", SampleStats::from(samples.second).avg);
+	}
+	report.set("GfxCall: Totals", "invalid_handles", (double)invalid_handles);
+	report.set("GfxCall: Totals", "bind_filter_efficiency", SampleStats::from(filter_efficiency).avg);
+	report.set("Culling: Clusters", "tested_per_frame", SampleStats::from(cluster_tested).avg);
+	report.set("Culling: Clusters", "culled_frustum_per_frame", SampleStats::from(cluster_frustum).avg);
+	report.set("Culling: Clusters", "culled_backface_per_frame", SampleStats::from(cluster_backface).avg);
+	report.set("Culling: Clusters", "gpass_draws_per_frame", SampleStats::from(cluster_draws).avg);
+	report.set("Culling: Triangles", "full_detail_per_frame", SampleStats::from(triangles_full).avg);
+	report.set("Culling: Triangles", "submitted_per_frame", SampleStats::from(triangles_submitted).avg);
+
+	const auto& streaming = gfx::tex_mgr->get_streamer()->get_stats();
+	report.set("Streaming: Textures", "textures", streaming.textures);
+	report.set("Streaming: Textures", "resident_mb", streaming.resident_bytes / (1024.0 * 1024.0));
+	report.set("Streaming: Textures", "full_mb", streaming.full_bytes / (1024.0 * 1024.0));
+	report.set("Streaming: Textures", "budget_mb", gfx::tex_mgr->get_streamer()->get_settings().budget_bytes / (1024.0 * 1024.0));
+	report.set("Streaming: Textures", "streamed_in", streaming.streamed_in);
+	report.set("Streaming: Textures", "evicted", streaming.evicted);
+	report.set("Streaming: Textures", "clamped", streaming.clamped);
+
+	// Level transition: unloading the scene has to return its GPU memory
+	Timer unload_timer;
+	const uint64_t freed_bytes = m_model_renderer->free_model(m_sponza) + m_model_renderer->free_model(m_nanosuit);
+	report.set("Unload: Models", "time_ms", unload_timer.elapsed());
+	report.set("Unload: Models", "freed_mb", freed_bytes / (1024.0 * 1024.0));
+	report.set("Unload: Models", "vertex_mb_left", gfx::model_mgr->get_vertex_bytes() / (1024.0 * 1024.0));
+	report.set("Unload: Models", "textures_left", gfx::tex_mgr->get_streamer()->get_stats().textures);
+	report.set("Unload: Models", "geometry_chunks_left", gfx::model_mgr->get_geometry_heap_stats().vertex_chunks);
+
+	// Print summary
+	for (const auto& [entry, metrics] : report.get_entries())
+	{
+		auto avg = metrics.find("avg_ms");
+		auto p95 = metrics.find("p95_ms");
+		auto allocs = metrics.find("allocs_per_frame");
+		if (avg == metrics.cend())
+			continue;
+
+		fmt::print("{:<45} avg {:8.4f} ms   p95 {:8.4f} ms", entry, avg->second, p95->second);
+		if (allocs != metrics.cend())
+			fmt::print("   allocs/frame {:8.1f}", allocs->second);
+		fmt::print("\n");
+	}
+
+	for (const auto& [name, samples] : calls)
+	{
+		fmt::print("{:<45} requested/frame {:8.1f}   issued/frame {:8.1f}\n", "GfxCall: " + name,
+			SampleStats::from(samples.first).avg, SampleStats::from(samples.second).avg);
+	}
+	fmt::print("Redundant bind filtering removed {:.1f}% of bind calls, {} invalid handle use(s)\n",
+		SampleStats::from(filter_efficiency).avg * 100.f, invalid_handles);
+
+	if (!report.write(m_settings.output))
+	{
+		fmt::print(fg(fmt::color::red), "Failed to write benchmark results to {}\n", m_settings.output.string());
+		return 1;
+	}
+	fmt::print("Benchmark results written to {}\n", m_settings.output.string());
+
+	// Regression check
+	if (!m_settings.baseline)
+		return 0;
+
+	auto baseline = BenchmarkReport::read(*m_settings.baseline);
+	if (!baseline)
+	{
+		fmt::print(fg(fmt::color::red), "Failed to read baseline {}\n", m_settings.baseline->string());
+		return 1;
+	}
+
+	const auto regressions = report.find_regressions(*baseline, m_settings.tolerance_pct, { "avg_ms", "p95_ms", "allocs_per_frame", "issued_per_frame", "invalid_handles" });
+	for (const auto& r : regressions)
+	{
+		fmt::print(fg(fmt::color::red), "REGRESSION {} [{}]: {:.4f} -> {:.4f} ({:+.1f}%)\n",
+			r.entry, r.metric, r.baseline, r.current, r.delta_pct);
+	}
+
+	if (!regressions.empty())
+	{
+		fmt::print(fg(fmt::color::red), "{} regression(s) beyond {:.1f}% tolerance\n", regressions.size(), m_settings.tolerance_pct);
+		return 1;
+	}
+
+	fmt::print(fg(fmt::color::green), "No regressions against {} (tolerance {:.1f}%)\n", m_settings.baseline->string(), m_settings.tolerance_pct);
+	return 0;
+}
@@ -0,0 +1,594 @@
+#include "pch.h"
+#include "Benchmark/MicroBenchmarks.h"
+#include "Memory/LinearAllocator.h"
+#include "ResourceHandlePool.h"
+#include "Graphics/CommandBucket/GfxCommandBucket.h"
+#include "Graphics/CommandBucket/GfxCommand.h"
+#include "Graphics/Material.h"
+#include "Graphics/MipGenerator.h"
+#include "Graphics/API/ShaderCache.h"
+#include "Profiler/FrameProfiler.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+
+namespace
+{
+	// Sink for results so the measured work isn't optimized away
+	volatile uint64_t s_sink = 0;
+
+	void consume(uint64_t value) { s_sink = s_sink + value; }
+	void consume(const void* ptr) { consume((uint64_t)ptr); }
+
+	// Minimal resource satisfying the ResourceHandlePool requirements
+	struct BenchResource
+	{
+		res_handle handle = RES_INVALID_HANDLE;
+		uint64_t payload[4]{};
+
+		void free() {}
+	};
+
+	// Draw sized command with a no-op dispatch: measures the bucket itself and not the GfxDevice behind it
+	struct NopDraw
+	{
+		static const GfxCommandDispatch DISPATCH;
+		gfxcommand::Draw draw;
+	};
+	const GfxCommandDispatch NopDraw::DISPATCH = [](const void* data) { consume(data); };
+
+	// Same binding table as the opaque ModelRenderer submission (3 VBs, per object CB, albedo)
+	gfxcommand::aux::bindtable::Header model_header()
+	{
+		return gfxcommand::aux::bindtable::Header()
+			.set_vbs(3)
+			.set_cbs(1)
+			.set_tex_reads(1);
+	}
+
+	void fill_model_bindings(void* memory, const gfxcommand::aux::bindtable::Header& hdr, uint32_t i)
+	{
+		gfxcommand::aux::bindtable::Filler(memory, hdr)
+			.add_vb(BufferHandle{ 1 }, sizeof(float) * 3, 0)
+			.add_vb(BufferHandle{ 2 }, sizeof(float) * 2, 0)
+			.add_vb(BufferHandle{ 3 }, sizeof(float) * 3, 0)
+			.add_cb(ShaderStage::eVertex, 1, BufferHandle{ 4 }, i)
+			.add_read_tex(ShaderStage::ePixel, 0, TextureHandle{ i % 64 + 1 });
+	}
+}
+
+std::optional<MicroBenchmarks::Settings> MicroBenchmarks::parse_args(int argc, char** argv)
+{
+	Settings settings{};
+	bool requested = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+
+		if (arg == "--microbench")
+			requested = true;
+		else if (arg == "--samples" && has_value)
+			settings.samples = (std::max)((UINT)std::stoul(argv[++i]), 1u);
+		else if (arg == "--filter" && has_value)
+			settings.filter = argv[++i];
+		else if (arg == "--out" && has_value)
+			settings.output = argv[++i];
+	}
+
+	if (!requested)
+		return {};
+	return settings;
+}
+
+MicroBenchmarks::MicroBenchmarks(const Settings& settings) :
+	m_settings(settings),
+	m_report("microbenchmarks")
+{
+	// CPU scopes only, the GPU profiler is never begun but FrameProfiler requires one
+	CPUProfiler::initialize();
+	m_gpu_profiler = make_unique<GPUProfiler>(nullptr);
+	FrameProfiler::initialize(perf::cpu_profiler, m_gpu_profiler.get());
+
+	ThreadPool::initialize();
+}
+
+MicroBenchmarks::~MicroBenchmarks()
+{
+	ThreadPool::shutdown();
+	FrameProfiler::shutdown();
+	CPUProfiler::shutdown();
+}
+
+template <typename Setup, typename Batch>
+void MicroBenchmarks::measure(const std::string& name, uint32_t ops, Setup&& setup, Batch&& batch)
+{
+	if (!m_settings.filter.empty() && name.find(m_settings.filter) == std::string::npos)
+		return;
+
+	// Warm caches and branch predictors before sampling
+	setup();
+	batch();
+
+	std::vector<float> samples;
+	samples.reserve(m_settings.samples);
+	for (UINT i = 0; i < m_settings.samples; ++i)
+	{
+		setup();
+		Timer timer;
+		batch();
+		samples.push_back(timer.elapsed() * 1000000.f / ops);		// ms -> ns per op
+	}
+
+	m_report.set_samples(name, samples, "_ns");
+	m_report.set(name, "ops_per_sample", (double)ops);
+
+	const auto stats = SampleStats::from(samples);
+	fmt::print("{:<60} avg {:10.2f} ns   p50 {:10.2f} ns   p95 {:10.2f} ns\n", name, stats.avg, stats.p50, stats.p95);
+}
+
+void MicroBenchmarks::bench_linear_allocator()
+{
+	constexpr uint32_t allocs = 10000;
+	LinearAllocator allocator(allocs * 512);
+
+	measure("LinearAllocator: allocate 64 B", allocs,
+		[&]() { allocator.reset(); },
+		[&]()
+		{
+			for (uint32_t i = 0; i < allocs; ++i)
+				consume(allocator.allocate(64));
+		});
+
+	// Odd sizes so that the alignment path is taken
+	std::vector<size_t> sizes(allocs);
+	std::mt19937 rng(1337);
+	std::uniform_int_distribution<size_t> size_dist(1, 256);
+	for (auto& size : sizes)
+		size = size_dist(rng);
+
+	measure("LinearAllocator: allocate mixed 1-256 B", allocs,
+		[&]() { allocator.reset(); },
+		[&]()
+		{
+			for (uint32_t i = 0; i < allocs; ++i)
+				consume(allocator.allocate(sizes[i]));
+		});
+
+	measure("LinearAllocator: reset", allocs,
+		[]() {},
+		[&]()
+		{
+			for (uint32_t i = 0; i < allocs; ++i)
+				allocator.reset();
+		});
+}
+
+void MicroBenchmarks::bench_handle_pool()
+{
+	constexpr uint32_t handles = 4096;
+	auto pool = make_unique<ResourceHandlePool<BenchResource>>();
+	std::vector<res_handle> live;
+	live.reserve(handles);
+
+	auto free_all = [&]()
+	{
+		for (auto hdl : live)
+			pool->free_handle(hdl);
+		live.clear();
+	};
+	auto allocate_all = [&]()
+	{
+		for (uint32_t i = 0; i < handles; ++i)
+			live.push_back(pool->get_next_free_handle().first);
+	};
+
+	measure("ResourceHandlePool: get_next_free_handle", handles,
+		free_all,
+		[&]()
+		{
+			for (uint32_t i = 0; i < handles; ++i)
+				live.push_back(pool->get_next_free_handle().first);
+		});
+
+	measure("ResourceHandlePool: free_handle", handles,
+		[&]() { free_all(); allocate_all(); },
+		free_all);
+
+	// Lookups in a scattered order, the way draws reference resources
+	free_all();
+	allocate_all();
+	std::vector<res_handle> lookups = live;
+	std::shuffle(lookups.begin(), lookups.end(), std::mt19937(1337));
+
+	measure("ResourceHandlePool: look_up (sequential)", handles,
+		[]() {},
+		[&]()
+		{
+			for (auto hdl : live)
+				consume(pool->look_up(hdl)->payload[0]);
+		});
+
+	measure("ResourceHandlePool: look_up (shuffled)", handles,
+		[]() {},
+		[&]()
+		{
+			for (auto hdl : lookups)
+				consume(pool->look_up(hdl)->payload[0]);
+		});
+
+	free_all();
+}
+
+void MicroBenchmarks::bench_command_bucket()
+{
+	const auto hdr = model_header();
+	auto bucket = make_unique<GfxCommandBucket<uint64_t>>();
+
+	std::mt19937_64 rng(1337);
+	std::vector<uint64_t> keys(5000);
+	for (auto& key : keys)
+		key = rng();
+
+	auto fill = [&](uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			auto cmd = bucket->add_command<NopDraw>(keys[i], hdr.size());
+			cmd->draw.index_count = i;
+			fill_model_bindings(gfxcommandpacket::get_aux_memory(cmd), hdr, i);
+		}
+	};
+
+	for (uint32_t count : { 100u, 1000u, 5000u })
+	{
+		const auto suffix = fmt::format(" ({} cmds)", count);
+
+		measure("GfxCommandBucket: add_command + bindtable" + suffix, count,
+			[&]() { bucket->flush(); },
+			[&]() { fill(count); });
+
+		measure("GfxCommandBucket: sort" + suffix, count,
+			[&]() { bucket->flush(); fill(count); },
+			[&]() { bucket->sort(); });
+
+		measure("GfxCommandBucket: flush" + suffix, count,
+			[&]() { bucket->flush(); fill(count); bucket->sort(); },
+			[&]() { bucket->flush(); });
+	}
+
+	bucket->flush();
+}
+
+void MicroBenchmarks::bench_bindtable()
+{
+	constexpr uint32_t builds = 10000;
+	const auto hdr = model_header();
+	std::vector<char> memory(hdr.size() * builds);
+
+	measure("bindtable::Filler: build (3 VB, 1 CB, 1 tex)", builds,
+		[]() {},
+		[&]()
+		{
+			for (uint32_t i = 0; i < builds; ++i)
+				fill_model_bindings(memory.data() + i * hdr.size(), hdr, i);
+		});
+
+	const auto shadow_hdr = gfxcommand::aux::bindtable::Header()
+		.set_vbs(1)
+		.set_cbs(1);
+
+	measure("bindtable::Filler: build shadow (1 VB, 1 CB)", builds,
+		[]() {},
+		[&]()
+		{
+			for (uint32_t i = 0; i < builds; ++i)
+			{
+				gfxcommand::aux::bindtable::Filler(memory.data() + i * shadow_hdr.size(), shadow_hdr)
+					.add_vb(BufferHandle{ 1 }, sizeof(float) * 3, 0)
+					.add_cb(ShaderStage::eVertex, 1, BufferHandle{ 4 }, i);
+			}
+		});
+}
+
+void MicroBenchmarks::bench_profiler_scopes()
+{
+	constexpr uint32_t scopes = 10000;
+
+	measure("FrameProfiler: ScopedCPU", scopes,
+		[]() {},
+		[&]()
+		{
+			for (uint32_t i = 0; i < scopes; ++i)
+				auto _ = FrameProfiler::ScopedCPU("Microbench Scope");
+		});
+
+	measure("FrameProfiler: ScopedCPUAccum", scopes,
+		[]() {},
+		[&]()
+		{
+			for (uint32_t i = 0; i < scopes; ++i)
+				auto _ = FrameProfiler::ScopedCPUAccum("Microbench Accum Scope");
+		});
+
+	measure("FrameProfiler: begin_cpu_scope/end_cpu_scope", scopes,
+		[]() {},
+		[&]()
+		{
+			for (uint32_t i = 0; i < scopes; ++i)
+			{
+				perf::profiler->begin_cpu_scope("Microbench Scope");
+				perf::profiler->end_cpu_scope("Microbench Scope");
+			}
+		});
+}
+
+void MicroBenchmarks::bench_material()
+{
+	constexpr uint32_t ops = 10000;
+	constexpr uint32_t material_count = 64;
+
+	// Mirrors the MaterialManager storage: materials by dense ID, names and content hashes map to IDs
+	std::vector<Material> materials;
+	std::unordered_map<std::string, uint16_t> ids_by_name;
+	std::unordered_multimap<uint64_t, uint16_t> ids_by_hash;
+	for (uint32_t i = 0; i < material_count; ++i)
+	{
+		materials.push_back(Material()
+			.set_texture(Material::Texture::eAlbedo, TextureHandle{ i + 1 })
+			.set_texture(Material::Texture::eNormal, TextureHandle{ i + 1 + material_count }));
+		ids_by_name.insert({ "Mat" + std::to_string(i), (uint16_t)i });
+		ids_by_hash.insert({ materials.back().get_hash(), (uint16_t)i });
+	}
+
+	const Material& a = materials[0];
+	const Material b = a;
+	const Material& c = materials[1];
+
+	measure("Material: operator== (equal)", ops,
+		[]() {},
+		[&]()
+		{
+			for (uint32_t i = 0; i < ops; ++i)
+				consume(a == b);
+		});
+
+	measure("Material: operator== (different)", ops,
+		[]() {},
+		[&]()
+		{
+			for (uint32_t i = 0; i < ops; ++i)
+				consume(a == c);
+		});
+
+	measure("Material: get_texture", ops,
+		[]() {},
+		[&]()
+		{
+			for (uint32_t i = 0; i < ops; ++i)
+				consume(a.get_texture(Material::Texture::eAlbedo).hdl);
+		});
+
+	std::vector<std::string> names;
+	for (uint32_t i = 0; i < ops; ++i)
+		names.push_back("Mat" + std::to_string(i % material_count));
+
+	measure(fmt::format("MaterialManager: lookup by name ({} materials)", material_count), ops,
+		[]() {},
+		[&]()
+		{
+			for (const auto& name : names)
+				consume(&materials[ids_by_name.find(name)->second]);
+		});
+
+	measure(fmt::format("MaterialManager: lookup by ID ({} materials)", material_count), ops,
+		[]() {},
+		[&]()
+		{
+			for (uint32_t i = 0; i < ops; ++i)
+				consume(materials[i % material_count].get_texture(Material::Texture::eAlbedo).hdl);
+		});
+
+	// The material isn't loaded yet: hash it and check the (empty) bucket
+	const auto missing = Material().set_texture(Material::Texture::eAlbedo, TextureHandle{ 9999 });
+	constexpr uint32_t lookups = 1000;
+	measure(fmt::format("MaterialManager: dedup lookup ({} materials)", material_count), lookups,
+		[]() {},
+		[&]()
+		{
+			for (uint32_t i = 0; i < lookups; ++i)
+			{
+				bool found = false;
+				auto [first, last] = ids_by_hash.equal_range(missing.get_hash());
+				for (auto it = first; it != last && !found; ++it)
+					found = materials[it->second] == missing;
+				consume(found);
+			}
+		});
+}
+
+void MicroBenchmarks::bench_mip_generator()
+{
+	struct Image
+	{
+		std::vector<uint8_t> rgba;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	// Albedo textures only, these are the ones we cook as sRGB
+	std::vector<Image> images;
+	size_t source_bytes = 0;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator("models/sponza", ec))
+	{
+		const auto fname = entry.path().filename().string();
+		if (fname.find("Albedo") == std::string::npos && fname.find("diffuse") == std::string::npos)
+			continue;
+
+		int w = 0, h = 0, channels = 0;
+		stbi_uc* pixels = stbi_load(entry.path().string().c_str(), &w, &h, &channels, STBI_rgb_alpha);
+		if (!pixels)
+			continue;
+
+		Image img;
+		img.rgba.assign(pixels, pixels + (size_t)w * h * 4);
+		img.width = (uint32_t)w;
+		img.height = (uint32_t)h;
+		source_bytes += img.rgba.size();
+		images.push_back(std::move(img));
+		stbi_image_free(pixels);
+	}
+
+	if (images.empty())
+	{
+		fmt::print(fg(fmt::color::yellow), "MipGenerator: no textures found under models/sponza, skipping\n");
+		return;
+	}
+
+	// Whole chains are expensive, a handful of samples is plenty
+	const UINT sample_count = (std::min)(m_settings.samples, 5u);
+
+	auto bench = [&](const std::string& name, const MipGenerator::Settings& settings)
+	{
+		if (!m_settings.filter.empty() && name.find(m_settings.filter) == std::string::npos)
+			return;
+
+		std::vector<float> samples;
+		samples.reserve(sample_count);
+		for (UINT i = 0; i < sample_count; ++i)
+		{
+			Timer timer;
+			for (const auto& img : images)
+				consume(MipGenerator::generate(img.rgba.data(), img.width, img.height, MipGenerator::Format::eRGBA8_SRGB, settings).data.size());
+			samples.push_back(timer.elapsed());
+		}
+
+		const auto stats = SampleStats::from(samples);
+		const double mb_per_s = stats.avg > 0.f ? (source_bytes / (1024.0 * 1024.0)) / (stats.avg / 1000.0) : 0.0;
+
+		m_report.set_samples(name, samples, "_ms");
+		m_report.set(name, "textures", (double)images.size());
+		m_report.set(name, "mb_per_s", mb_per_s);
+		fmt::print("{:<60} avg {:10.2f} ms   p50 {:10.2f} ms   {:8.1f} MB/s\n", name, stats.avg, stats.p50, mb_per_s);
+	};
+
+	for (auto filter : { MipGenerator::Filter::eBox, MipGenerator::Filter::eTent })
+	{
+		const std::string filter_name = filter == MipGenerator::Filter::eBox ? "box" : "tent";
+		MipGenerator::Settings settings;
+		settings.filter = filter;
+
+		settings.simd = false;
+		settings.parallel = false;
+		bench(fmt::format("MipGenerator: {} scalar ({} textures)", filter_name, images.size()), settings);
+
+		settings.simd = true;
+		settings.avx2 = false;
+		bench(fmt::format("MipGenerator: {} SSE ({} textures)", filter_name, images.size()), settings);
+
+		settings.avx2 = true;
+		bench(fmt::format("MipGenerator: {} SIMD ({} textures)", filter_name, images.size()), settings);
+
+		settings.parallel = true;
+		bench(fmt::format("MipGenerator: {} SIMD + jobs::pool ({} textures)", filter_name, images.size()), settings);
+	}
+}
+
+bool MicroBenchmarks::bench_shader_cache()
+{
+	if (!m_settings.filter.empty() && std::string("ShaderCache: checks").find(m_settings.filter) == std::string::npos)
+		return true;
+
+	// A source with one include in a scratch directory, the stub compiler keeps D3DCompile out of the timings
+	const auto directory = std::filesystem::temp_directory_path() / "dx11-tech-shader-cache";
+	std::error_code ec;
+	std::filesystem::remove_all(directory, ec);
+	std::filesystem::create_directories(directory, ec);
+
+	auto write = [](const std::filesystem::path& path, const std::string& text)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << text;
+	};
+	write(directory / "main.hlsl", "#include \"common.h\"\nfloat4 main() : SV_TARGET { return COLOR; }\n");
+	write(directory / "common.h", "#define COLOR float4(1, 0, 0, 1)\n");
+
+	StubShaderCompiler compiler;
+	ShaderCache cache(&compiler, directory / "cooked");
+
+	ShaderCompileRequest request;
+	request.path = directory / "main.hlsl";
+	request.target = "ps_5_0";
+
+	std::vector<uint8_t> bytecode;
+	std::string error;
+	bool passed = true;
+
+	// Every step expects the cache to end up with the given hits and compiles
+	auto check = [&](const std::string& step, uint32_t hits, uint32_t compiles)
+	{
+		const bool compiled = cache.compile(request, bytecode, error);
+		const auto stats = cache.get_stats();
+		if (!compiled || stats.hits != hits || stats.compiles != compiles)
+		{
+			fmt::print(fg(fmt::color::red), "ShaderCache: {} failed, {} hits and {} compiles instead of {} and {}\n", step, stats.hits, stats.compiles, hits, compiles);
+			passed = false;
+		}
+	};
+
+	check("first compile misses", 0, 1);
+	check("unchanged source hits", 1, 1);
+	write(directory / "common.h", "#define COLOR float4(0, 1, 0, 1)\n");
+	check("include edit misses", 1, 2);
+	check("edited source hits", 2, 2);
+	request.target = "ps_5_1";
+	check("other target misses", 2, 3);
+	request.target = "ps_5_0";
+	check("stored entry hits", 3, 3);		// the other target has an entry of its own
+
+	if (passed)
+	{
+		fmt::print("{:<60} hit, miss and include invalidation as expected\n", "ShaderCache: checks");
+
+		// Lookup cost of a hit: the source and include are hashed and the entry read back
+		measure("ShaderCache: hit (source + 1 include)", 100,
+			[]() {},
+			[&]()
+			{
+				for (uint32_t i = 0; i < 100; ++i)
+					consume(cache.compile(request, bytecode, error));
+			});
+	}
+	m_report.set("ShaderCache: checks", "passed", passed ? 1.0 : 0.0);
+
+	std::filesystem::remove_all(directory, ec);
+	return passed;
+}
+
+int MicroBenchmarks::run()
+{
+	fmt::print("Microbenchmarks: {} samples per entry\n", m_settings.samples);
+
+	bench_linear_allocator();
+	bench_handle_pool();
+	bench_command_bucket();
+	bench_bindtable();
+	bench_profiler_scopes();
+	bench_material();
+	bench_mip_generator();
+	const bool shader_cache_passed = bench_shader_cache();
+
+	if (!m_report.write(m_settings.output))
+	{
+		fmt::print(fg(fmt::color::red), "Failed to write microbenchmark results to {}\n", m_settings.output.string());
+		return 1;
+	}
+	fmt::print("Microbenchmark results written to {}\n", m_settings.output.string());
+	return shader_cache_passed ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+#include "pch.h"
+#include "Camera/CameraPath.h"
+#include "Camera/FPPCamera.h"
+#include <algorithm>
+
+CameraPose CameraPath::capture(const FPPCamera& cam)
+{
+	const auto& pos = cam.get_position();
+	return CameraPose{ { pos.x, pos.y, pos.z }, cam.get_yaw(), cam.get_pitch() };
+}
+
+void CameraPath::apply(const CameraPose& pose, FPPCamera* cam)
+{
+	cam->set_position(DirectX::SimpleMath::Vector4(pose.position.x, pose.position.y, pose.position.z, 1.f));
+	cam->set_yaw(pose.yaw);
+	cam->set_pitch(pose.pitch);
+
+	// No delta, simply rebuilds the directions from the new yaw/pitch
+	cam->update_orientation(0.f, 0.f, 0.f);
+	cam->update_matrices();
+}
+
+void CameraPath::add_keyframe(float time, const CameraPose& pose)
+{
+	assert(m_keyframes.empty() || m_keyframes.back().time <= time);
+
+	// FPPCamera wraps the yaw to 0 past +-360, unwrap so interpolation takes the short way around
+	auto unwrapped = pose;
+	if (!m_keyframes.empty())
+	{
+		const float prev_yaw = m_keyframes.back().pose.yaw;
+		while (unwrapped.yaw - prev_yaw > 180.f)
+			unwrapped.yaw -= 360.f;
+		while (unwrapped.yaw - prev_yaw < -180.f)
+			unwrapped.yaw += 360.f;
+	}
+
+	m_keyframes.push_back({ time, unwrapped });
+}
+
+void CameraPath::begin_segment(const std::string& name, float start_time)
+{
+	m_segments.push_back({ name, start_time });
+}
+
+CameraPose CameraPath::sample(float time) const
+{
+	assert(!m_keyframes.empty());
+
+	auto next = std::upper_bound(m_keyframes.cbegin(), m_keyframes.cend(), time, [](float t, const Keyframe& kf) { return t < kf.time; });
+	if (next == m_keyframes.cbegin())
+		return m_keyframes.front().pose;
+	if (next == m_keyframes.cend())
+		return m_keyframes.back().pose;
+
+	const auto& a = *(next - 1);
+	const auto& b = *next;
+	const float span = b.time - a.time;
+	const float f = span > 0.f ? (time - a.time) / span : 1.f;
+
+	CameraPose pose;
+	pose.position = DirectX::SimpleMath::Vector3::Lerp(a.pose.position, b.pose.position, f);
+	pose.yaw = a.pose.yaw + (b.pose.yaw - a.pose.yaw) * f;
+	pose.pitch = a.pose.pitch + (b.pose.pitch - a.pose.pitch) * f;
+	return pose;
+}
+
+size_t CameraPath::get_segment_index(float time) const
+{
+	size_t idx = 0;
+	for (size_t i = 0; i < m_segments.size(); ++i)
+		if (m_segments[i].start_time <= time)
+			idx = i;
+	return idx;
+}
+
+const std::vector<CameraPath::Segment>& CameraPath::get_segments() const
+{
+	return m_segments;
+}
+
+float CameraPath::get_duration() const
+{
+	if (m_keyframes.empty())
+		return 0.f;
+	return m_keyframes.back().time;
+}
+
+bool CameraPath::empty() const
+{
+	return m_keyframes.empty();
+}
+
+void CameraPath::clear()
+{
+	m_keyframes.clear();
+	m_segments.clear();
+}
+
+bool CameraPath::write(const std::filesystem::path& path) const
+{
+	auto root = JsonValue::object();
+
+	auto& keyframes = root["keyframes"];
+	keyframes = JsonValue::array();
+	for (const auto& kf : m_keyframes)
+	{
+		auto json_kf = JsonValue::object();
+		json_kf["t"] = kf.time;
+		auto& pos = json_kf["pos"];
+		pos = JsonValue::array();
+		pos.push_back(kf.pose.position.x);
+		pos.push_back(kf.pose.position.y);
+		pos.push_back(kf.pose.position.z);
+		json_kf["yaw"] = kf.pose.yaw;
+		json_kf["pitch"] = kf.pose.pitch;
+		keyframes.push_back(std::move(json_kf));
+	}
+
+	auto& segments = root["segments"];
+	segments = JsonValue::array();
+	for (const auto& seg : m_segments)
+	{
+		auto json_seg = JsonValue::object();
+		json_seg["name"] = seg.name;
+		json_seg["t"] = seg.start_time;
+		segments.push_back(std::move(json_seg));
+	}
+
+	// Compact, paths get long
+	return root.write_file(path, false);
+}
+
+std::optional<CameraPath> CameraPath::read(const std::filesystem::path& path)
+{
+	auto root = JsonValue::read_file(path);
+	if (!root || !root->is_object())
+		return {};
+
+	const auto keyframes = root->find("keyframes");
+	if (!keyframes || !keyframes->is_array())
+		return {};
+
+	CameraPath cam_path;
+	for (const auto& kf : keyframes->as_array())
+	{
+		const auto t = kf.find("t");
+		const auto pos = kf.find("pos");
+		const auto yaw = kf.find("yaw");
+		const auto pitch = kf.find("pitch");
+		if (!t || !pos || !yaw || !pitch || !t->is_number() || !yaw->is_number() || !pitch->is_number())
+			return {};
+		if (!pos->is_array() || pos->as_array().size() != 3)
+			return {};
+		for (const auto& component : pos->as_array())
+			if (!component.is_number())
+				return {};
+
+		CameraPose pose;
+		pose.position = {
+			(float)pos->as_array()[0].as_number(),
+			(float)pos->as_array()[1].as_number(),
+			(float)pos->as_array()[2].as_number() };
+		pose.yaw = (float)yaw->as_number();
+		pose.pitch = (float)pitch->as_number();
+		cam_path.m_keyframes.push_back({ (float)t->as_number(), pose });
+	}
+
+	if (const auto segments = root->find("segments"); segments && segments->is_array())
+	{
+		for (const auto& seg : segments->as_array())
+		{
+			const auto name = seg.find("name");
+			const auto t = seg.find("t");
+			if (name && t && name->is_string() && t->is_number())
+				cam_path.begin_segment(name->as_string(), (float)t->as_number());
+		}
+	}
+
+	if (cam_path.m_keyframes.empty())
+		return {};
+	return cam_path;
+}
@@ -178,12 +178,12 @@ void FPPCamera::set_pitch(float pitch)
 	m_pitch = pitch;
 }
 
-float FPPCamera::get_yaw()
+float FPPCamera::get_yaw() const
 {
 	return m_yaw;;
 }
 
-float FPPCamera::get_pitch()
+float FPPCamera::get_pitch() const
 {
 	return m_pitch;
 }
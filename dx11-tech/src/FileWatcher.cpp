@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "FileWatcher.h"
+
+FileWatcher::FileWatcher(const std::filesystem::path& directory, const Settings& settings) :
+	m_directory(directory.lexically_normal()),
+	m_settings(settings)
+{
+	if (!m_settings.force_polling)
+	{
+		m_handle = CreateFileW(m_directory.wstring().c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		m_overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		m_buffer.resize(16 * 1024);
+
+		if (m_handle != INVALID_HANDLE_VALUE && m_overlapped.hEvent && start_read())
+			return;
+
+		fmt::print(fg(fmt::color::red), "Can't watch {} for changes, polling it instead\n", m_directory.string());
+		stop_watching();
+	}
+
+	// Baseline of the polling fallback
+	scan(false);
+}
+
+FileWatcher::~FileWatcher()
+{
+	stop_watching();
+}
+
+bool FileWatcher::start_read()
+{
+	const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+	return ReadDirectoryChangesW(m_handle, m_buffer.data(), (DWORD)(m_buffer.size() * sizeof(DWORD)), m_settings.recursive, filter,
+		nullptr, &m_overlapped, nullptr);
+}
+
+void FileWatcher::stop_watching()
+{
+	if (m_handle != INVALID_HANDLE_VALUE)
+	{
+		// The pending read writes into m_buffer until it is cancelled
+		DWORD bytes = 0;
+		if (CancelIoEx(m_handle, &m_overlapped) || GetLastError() != ERROR_NOT_FOUND)
+			GetOverlappedResult(m_handle, &m_overlapped, &bytes, TRUE);
+		CloseHandle(m_handle);
+		m_handle = INVALID_HANDLE_VALUE;
+	}
+
+	if (m_overlapped.hEvent)
+	{
+		CloseHandle(m_overlapped.hEvent);
+		m_overlapped.hEvent = nullptr;
+	}
+}
+
+void FileWatcher::mark_changed(const std::filesystem::path& path)
+{
+	m_pending[path.lexically_normal()] = m_clock.elapsed();
+}
+
+void FileWatcher::read_changes()
+{
+	// Several reads may have completed since the last poll
+	DWORD bytes = 0;
+	while (GetOverlappedResult(m_handle, &m_overlapped, &bytes, FALSE))
+	{
+		if (bytes == 0)
+			fmt::print(fg(fmt::color::red), "Too many changes under {} at once, some were missed\n", m_directory.string());
+
+		const uint8_t* record = (const uint8_t*)m_buffer.data();
+		while (bytes > 0)
+		{
+			const auto info = (const FILE_NOTIFY_INFORMATION*)record;
+
+			// Removed files have nothing to reload
+			if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME)
+				mark_changed(m_directory / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+
+			if (info->NextEntryOffset == 0)
+				break;
+			record += info->NextEntryOffset;
+		}
+
+		ResetEvent(m_overlapped.hEvent);
+		if (!start_read())
+			break;
+	}
+
+	if (GetLastError() == ERROR_IO_INCOMPLETE)
+		return;
+
+	fmt::print(fg(fmt::color::red), "Lost the watch on {}, polling it instead\n", m_directory.string());
+	stop_watching();
+	scan(false);
+}
+
+void FileWatcher::scan(bool report)
+{
+	m_last_scan = m_clock.elapsed();
+
+	auto visit = [&](const std::filesystem::directory_entry& entry)
+	{
+		std::error_code ec;
+		if (!entry.is_regular_file(ec))
+			return;
+
+		const auto write_time = entry.last_write_time(ec);
+		if (ec)
+			return;
+
+		// New files count as changed
+		auto [it, inserted] = m_write_times.insert({ entry.path().string(), write_time });
+		if (!inserted && it->second == write_time)
+			return;
+
+		it->second = write_time;
+		if (report)
+			mark_changed(entry.path());
+	};
+
+	std::error_code ec;
+	if (m_settings.recursive)
+	{
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(m_directory, ec))
+			visit(entry);
+	}
+	else
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(m_directory, ec))
+			visit(entry);
+	}
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll()
+{
+	if (!is_polling())
+		read_changes();
+	else if (m_clock.elapsed() - m_last_scan >= m_settings.poll_interval_ms)
+		scan(true);
+
+	std::vector<std::filesystem::path> settled;
+	const float now = m_clock.elapsed();
+	for (auto it = m_pending.begin(); it != m_pending.end();)
+	{
+		if (now - it->second < m_settings.debounce_ms)
+		{
+			++it;
+			continue;
+		}
+
+		// Directories get change notifications too
+		std::error_code ec;
+		if (std::filesystem::is_regular_file(it->first, ec))
+			settled.push_back(it->first);
+		it = m_pending.erase(it);
+	}
+	return settled;
+}
@@ -0,0 +1,1015 @@
+#include "pch.h"
+#include "Graphics/API/DXBackend.h"
+#include "Graphics/API/GfxTypes.h"
+
+namespace gfxconstants
+{
+	// For unbinding state
+	const void* const NULL_RESOURCE[gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS] = {};
+}
+
+
+DXBackend::DXBackend(unique_ptr<DXDevice> dev) :
+	m_dev(std::move(dev))
+{
+}
+
+std::pair<UINT, UINT> DXBackend::get_sc_dim() const
+{
+	auto sc_desc = m_dev->get_sc_desc();
+	return { sc_desc.BufferDesc.Width, sc_desc.BufferDesc.Height };
+}
+
+void DXBackend::get_backbuffer(GPUTexture* backbuffer)
+{
+	backbuffer->m_internal_resource = m_dev->get_bb_texture();
+	backbuffer->m_rtv = m_dev->get_bb_target();
+	backbuffer->m_type = TextureType::e2D;
+}
+
+void DXBackend::resize_swapchain(UINT width, UINT height, GPUTexture* backbuffer)
+{
+	// Release the primitive texture
+	backbuffer->m_internal_resource.ReleaseAndGetAddressOf();
+	backbuffer->m_rtv.ReleaseAndGetAddressOf();
+
+	// Recreate
+	m_dev->resize_swapchain(width, height);
+
+	// Retrieve new swapchain resources
+	get_backbuffer(backbuffer);
+}
+
+void DXBackend::present(bool vsync)
+{
+	//m_profiler->begin("Presentation", false, false);
+	m_dev->get_sc()->Present(vsync ? 1 : 0, 0);
+	//m_profiler->end("Presentation");
+}
+
+
+
+void DXBackend::frame_start()
+{
+	auto& ctx = m_dev->get_context();
+	ctx->RSSetScissorRects(gfxconstants::MAX_SCISSORS, (const D3D11_RECT*)gfxconstants::NULL_RESOURCE);
+
+	// nuke all SRVs
+	// https://stackoverflow.com/questions/20300778/are-there-directx-guidelines-for-binding-and-unbinding-resources-between-draw-ca
+	ctx->VSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+	ctx->HSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+	ctx->DSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+	ctx->GSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+	ctx->PSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+	ctx->CSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+
+	//ctx->VSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
+	//ctx->HSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
+	//ctx->DSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
+	//ctx->GSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
+	//ctx->PSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
+	//ctx->CSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
+}
+
+void DXBackend::set_name(const GPUType* device_child, const std::string& name)
+{
+	if (!device_child->m_internal_resource)
+		return;
+	HRCHECK(device_child->m_internal_resource->SetPrivateData(WKPDID_D3DDebugObjectName, (UINT)name.size(), name.data()));
+}
+
+
+
+void DXBackend::create_buffer(const BufferDesc& desc, GPUBuffer* buffer, std::optional<SubresourceData> subres)
+{
+	const auto& d3d_desc = desc.m_desc;
+
+	HRCHECK(m_dev->get_device()->CreateBuffer(
+		&d3d_desc,
+		subres ? &subres->m_subres : nullptr,
+		(ID3D11Buffer**)buffer->m_internal_resource.ReleaseAndGetAddressOf()));
+
+	// constant buffers dont need views
+	if (desc.m_type == BufferType::eConstant)
+		return;
+
+	// Create views
+	if (d3d_desc.BindFlags & D3D11_BIND_SHADER_RESOURCE)
+	{
+		D3D11_SRV_DIMENSION view_dim = D3D11_SRV_DIMENSION_BUFFER;
+		UINT flags = 0;
+
+		auto srv_desc = D3D11_SHADER_RESOURCE_VIEW_DESC();
+		srv_desc.Format = DXGI_FORMAT_UNKNOWN;
+		srv_desc.ViewDimension = view_dim;
+		srv_desc.Buffer.FirstElement = desc.m_start_and_count.first;
+		srv_desc.Buffer.NumElements = desc.m_start_and_count.second;
+		
+		// Handle RAW BUFFER (BufferEx) some other time
+
+
+		m_dev->get_device()->CreateShaderResourceView(
+			(ID3D11Resource*)buffer->m_internal_resource.Get(),
+			&srv_desc,
+			buffer->m_srv.GetAddressOf());
+
+		//assert(false && "Buffer Shader Access view is not supported right now");
+	}
+	
+	if (d3d_desc.BindFlags & D3D11_BIND_UNORDERED_ACCESS)
+	{
+		D3D11_UAV_DIMENSION view_dim = D3D11_UAV_DIMENSION_BUFFER;
+		UINT flags = 0;
+
+		switch (desc.m_type)
+		{
+		case BufferType::eRaw:
+			flags = D3D11_BUFFER_UAV_FLAG_RAW;
+			break;
+		case BufferType::eAppendConsume:	// AppendConsume Structured Buffer
+			flags = D3D11_BUFFER_UAV_FLAG_APPEND;
+			flags |= D3D11_BUFFER_UAV_FLAG_COUNTER;		// enable access to Increment/DecrementCounter
+			break;
+
+
+		}
+
+		auto uav_desc = CD3D11_UNORDERED_ACCESS_VIEW_DESC
+		(
+			(ID3D11Buffer*)buffer->m_internal_resource.Get(),
+			DXGI_FORMAT_UNKNOWN, desc.m_start_and_count.first, desc.m_start_and_count.second, flags
+		);
+
+		// spec requirement https://docs.microsoft.com/en-us/windows/win32/api/d3d11/ne-d3d11-d3d11_buffer_uav_flag
+		if ((flags & D3D11_BUFFER_UAV_FLAG_COUNTER) == D3D11_BUFFER_UAV_FLAG_COUNTER)
+			assert(uav_desc.Format == DXGI_FORMAT_UNKNOWN);
+
+		m_dev->get_device()->CreateUnorderedAccessView(
+			(ID3D11Resource*)buffer->m_internal_resource.Get(),
+			&uav_desc,
+			buffer->m_uav.GetAddressOf());
+
+		//assert(false && "Buffer Unordered Access View is not supported right now");
+	}
+}
+
+void DXBackend::create_texture(const TextureDesc& desc, GPUTexture* texture, const std::vector<SubresourceData>& subres)
+{
+	auto d3d_desc = desc.m_desc;
+
+	//texture->m_desc.m_type = desc.m_type;
+
+	// Grab misc. data
+	bool is_array = d3d_desc.ArraySize > 1 ? true : false;
+	bool ms_on = d3d_desc.SampleDesc.Count > 1 ? true : false;
+	bool is_cube = d3d_desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE ? true : false;
+	bool misc_gen_mips = d3d_desc.MiscFlags & D3D11_RESOURCE_MISC_GENERATE_MIPS ? true : false;
+
+	// auto gen using GenerateMips requires texture to be written to (other subres)
+	// we automatically append this incase user forgets
+	if (misc_gen_mips)
+		d3d_desc.BindFlags |= D3D11_BIND_RENDER_TARGET;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> init_data;
+	init_data.reserve(subres.size());
+	for (const auto& data : subres)
+		init_data.push_back(data.m_subres);
+
+	// check max multisample support
+	UINT max_sample_quality_levels = 0;
+	if (d3d_desc.SampleDesc.Count > 1)
+	{
+		m_dev->get_device()->CheckMultisampleQualityLevels(d3d_desc.Format, d3d_desc.SampleDesc.Count, &max_sample_quality_levels);
+		d3d_desc.SampleDesc.Quality = (std::min)(d3d_desc.SampleDesc.Quality, max_sample_quality_levels - 1);
+		std::cout << "Sample Quality: " << d3d_desc.SampleDesc.Quality << "\n";
+	}
+
+	// Create texture
+	switch (desc.m_type)
+	{
+	case TextureType::e1D:
+		assert(false && "Texture1D is not supported right now");
+		break;
+	case TextureType::e2D:
+	{
+		/*
+			Using Generate Mips Misc Flag disallows using initial data
+			https://stackoverflow.com/questions/53569263/directx-11-id3ddevicecreatetexture2d-with-initial-data-fail
+			We will load it at top-level manually through context
+		*/
+		HRCHECK(m_dev->get_device()->CreateTexture2D(
+			&d3d_desc,
+			!misc_gen_mips && !init_data.empty() ? init_data.data() : nullptr,
+			(ID3D11Texture2D**)texture->m_internal_resource.ReleaseAndGetAddressOf()));
+		break;
+	}
+	case TextureType::e3D:
+		assert(false && "Texture3D is not supported right now");
+		break;
+	default:
+		assert(false);
+		break;
+	}
+
+	texture->m_type = desc.m_type;
+	//texture->m_desc.m_desc = d3d_desc;
+
+	// Create views
+	if (d3d_desc.BindFlags & D3D11_BIND_SHADER_RESOURCE)
+	{
+		// Find dimension
+		D3D11_SRV_DIMENSION view_dim = D3D11_SRV_DIMENSION_UNKNOWN;
+		switch (desc.m_type)
+		{
+		case TextureType::e1D:
+			if (is_array)
+				view_dim = D3D11_SRV_DIMENSION_TEXTURE1DARRAY;
+			else
+				view_dim = D3D11_SRV_DIMENSION_TEXTURE1D;
+			break;
+		case TextureType::e2D:
+		{
+			if (is_array)
+			{
+				if (is_cube)
+				{
+					view_dim = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+					break;
+				}
+
+				if (ms_on)
+					view_dim = D3D11_SRV_DIMENSION_TEXTURE2DMSARRAY;
+				else
+					view_dim = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+			}
+			else
+			{
+				if (is_cube)
+				{
+					view_dim = D3D11_SRV_DIMENSION_TEXTURECUBE;
+					break;
+				}
+
+				if (ms_on)
+					view_dim = D3D11_SRV_DIMENSION_TEXTURE2DMS;
+				else
+					view_dim = D3D11_SRV_DIMENSION_TEXTURE2D;
+			}
+			break;
+		}
+		case TextureType::e3D:
+			view_dim = D3D11_SRV_DIMENSION_TEXTURE3D;
+			break;
+		default:
+			assert(false);
+			break;
+		}
+		if (view_dim == D3D11_SRV_DIMENSION_UNKNOWN)
+			assert(false);
+
+		// Create desc
+		D3D11_SHADER_RESOURCE_VIEW_DESC v_desc{};
+		switch (desc.m_type)
+		{
+		case TextureType::e1D:
+			assert(false && "SRV for Texture 1D is currently not supported");
+			break;
+		case TextureType::e2D:
+			v_desc = CD3D11_SHADER_RESOURCE_VIEW_DESC(
+				(ID3D11Texture2D*)texture->m_internal_resource.Get(),
+				view_dim,
+				DXGI_FORMAT_UNKNOWN,	// setting to unknown --> auto resolves to the underlying texture format
+				0,						// most detailed mip idx
+				-1,						// max mips down to the least detailed
+				0,						// first array slice	
+				-1);					// array size (auto calc from tex)
+
+			// Depth-stencil as read (read only depth part)
+			if (v_desc.Format == DXGI_FORMAT_R32_TYPELESS)
+				v_desc.Format = DXGI_FORMAT_R32_FLOAT;
+			else if (v_desc.Format == DXGI_FORMAT_R32G8X24_TYPELESS)
+				v_desc.Format = DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS;
+			else if (v_desc.Format == DXGI_FORMAT_R24G8_TYPELESS)
+				v_desc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+			else if (v_desc.Format == DXGI_FORMAT_R16_TYPELESS)
+				v_desc.Format = DXGI_FORMAT_R16_UNORM;
+
+
+			break;
+		case TextureType::e3D:
+			assert(false && "SRV for Texture 3D is currently not supported");
+			break;
+		default:
+			assert(false);
+			break;
+		}
+
+		// Create view
+		HRCHECK(m_dev->get_device()->CreateShaderResourceView(
+			(ID3D11Resource*)texture->m_internal_resource.Get(),
+			&v_desc,
+			texture->m_srv.ReleaseAndGetAddressOf()
+		));
+
+		// Auto-gen mips
+		if (misc_gen_mips)
+		{
+			// Copy texture to top level first (initialization through CreateTexture2D is disabled when MISC_GEN_MIPS is on)
+
+			/*
+				We dont need to make staging resource because UpdateSubresource does that for us!
+				https://stackoverflow.com/questions/50396189/d3d11-usage-staging-what-kind-of-gpu-cpu-memory-is-used
+			*/
+			m_dev->get_context()->UpdateSubresource((ID3D11Texture2D*)texture->m_internal_resource.Get(),
+				0, nullptr, init_data[0].pSysMem, init_data[0].SysMemPitch, 0);
+
+			assert(d3d_desc.BindFlags & D3D11_BIND_RENDER_TARGET);
+			m_dev->get_context()->GenerateMips(texture->m_srv.Get());
+		}
+
+	}
+
+	if (d3d_desc.BindFlags & D3D11_BIND_RENDER_TARGET)
+	{
+		// Find dimension
+		D3D11_RTV_DIMENSION view_dim = D3D11_RTV_DIMENSION_UNKNOWN;
+		D3D11_RENDER_TARGET_VIEW_DESC v_desc{};
+		switch (desc.m_type)
+		{
+		case TextureType::e1D:
+			if (is_array)
+				view_dim = D3D11_RTV_DIMENSION_TEXTURE1DARRAY;
+			else
+				view_dim = D3D11_RTV_DIMENSION_TEXTURE1D;
+			break;
+		case TextureType::e2D:
+			if (is_array)
+			{
+				if (ms_on)
+					view_dim = D3D11_RTV_DIMENSION_TEXTURE2DMSARRAY;
+				else
+				{
+					view_dim = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+				}
+			}
+			else
+			{
+				if (ms_on)
+					view_dim = D3D11_RTV_DIMENSION_TEXTURE2DMS;
+				else
+					view_dim = D3D11_RTV_DIMENSION_TEXTURE2D;
+			}
+			break;
+		case TextureType::e3D:
+			view_dim = D3D11_RTV_DIMENSION_TEXTURE3D;
+			break;
+		default:
+			assert(false);
+			break;
+		}
+		if (view_dim == D3D11_RTV_DIMENSION_UNKNOWN)
+			assert(false);
+
+		// Create desc
+		switch (desc.m_type)
+		{
+		case TextureType::e1D:
+			assert(false && "RTV for Texture 1D is currently not supported");
+			break;
+		case TextureType::e2D:
+
+			if (view_dim == D3D11_RTV_DIMENSION_TEXTURE2D)
+			{
+				v_desc = CD3D11_RENDER_TARGET_VIEW_DESC(
+					(ID3D11Texture2D*)texture->m_internal_resource.Get(),
+					view_dim,
+					DXGI_FORMAT_UNKNOWN,
+					0,
+					0,
+					-1);	// array size (auto calc from tex)
+			}
+			else if (view_dim == D3D11_RTV_DIMENSION_TEXTURE2DARRAY)
+			{
+				v_desc = CD3D11_RENDER_TARGET_VIEW_DESC(
+					(ID3D11Texture2D*)texture->m_internal_resource.Get(),
+					view_dim,
+					DXGI_FORMAT_UNKNOWN,
+					0,
+					0,						// start at subres idx 0
+					d3d_desc.ArraySize);	// array size
+			}
+			break;
+		case TextureType::e3D:
+			assert(false && "RTV for Texture 3D is currently not supported");
+			break;
+		default:
+			assert(false);
+			break;
+		}
+
+		// Create view
+		HRCHECK(m_dev->get_device()->CreateRenderTargetView(
+			(ID3D11Resource*)texture->m_internal_resource.Get(),
+			&v_desc,
+			texture->m_rtv.ReleaseAndGetAddressOf()
+		));
+	}
+
+	if (d3d_desc.BindFlags & D3D11_BIND_UNORDERED_ACCESS)
+	{
+		// Find dimension
+		D3D11_UAV_DIMENSION view_dim = D3D11_UAV_DIMENSION_UNKNOWN;
+		D3D11_UNORDERED_ACCESS_VIEW_DESC v_desc{};
+		switch (desc.m_type)
+		{
+		case TextureType::e1D:
+			if (is_array)
+				view_dim = D3D11_UAV_DIMENSION_TEXTURE1DARRAY;
+			else
+				view_dim = D3D11_UAV_DIMENSION_TEXTURE1D;
+			break;
+		case TextureType::e2D:
+			if (is_array)
+			{
+				view_dim = D3D11_UAV_DIMENSION_TEXTURE2DARRAY;
+			}
+			else
+			{
+				view_dim = D3D11_UAV_DIMENSION_TEXTURE2D;
+			}
+			break;
+		case TextureType::e3D:
+			view_dim = D3D11_UAV_DIMENSION_TEXTURE3D;
+			break;
+		default:
+			assert(false);
+			break;
+		}
+		if (view_dim == D3D11_UAV_DIMENSION_UNKNOWN)
+			assert(false);
+
+
+		// Create desc
+		switch (desc.m_type)
+		{
+		case TextureType::e1D:
+			assert(false && "UAV for Texture 1D is currently not supported");
+			break;
+		case TextureType::e2D:
+
+			if (view_dim == D3D11_UAV_DIMENSION_TEXTURE2D)
+			{
+				v_desc = CD3D11_UNORDERED_ACCESS_VIEW_DESC(
+					(ID3D11Texture2D*)texture->m_internal_resource.Get(),
+					view_dim,
+					DXGI_FORMAT_UNKNOWN,
+					0,
+					0,
+					-1);	// array size (auto calc from tex)
+			}
+			else if (view_dim == D3D11_UAV_DIMENSION_TEXTURE2DARRAY)
+			{
+				v_desc = CD3D11_UNORDERED_ACCESS_VIEW_DESC(
+					(ID3D11Texture2D*)texture->m_internal_resource.Get(),
+					view_dim,
+					DXGI_FORMAT_UNKNOWN,
+					0,
+					0,						// start at subres idx 0
+					d3d_desc.ArraySize);	// array size
+			}
+			break;
+		case TextureType::e3D:
+			assert(false && "UAV for Texture 3D is currently not supported");
+			break;
+		default:
+			assert(false);
+			break;
+		}
+
+		// Create view
+		HRCHECK(m_dev->get_device()->CreateUnorderedAccessView(
+			(ID3D11Resource*)texture->m_internal_resource.Get(),
+			&v_desc,
+			texture->m_uav.ReleaseAndGetAddressOf()
+		));
+	}
+
+	if (d3d_desc.BindFlags & D3D11_BIND_DEPTH_STENCIL)
+	{
+		// Find dimension
+		D3D11_DSV_DIMENSION view_dim = D3D11_DSV_DIMENSION_UNKNOWN;
+		switch (desc.m_type)
+		{
+		case TextureType::e1D:
+			if (is_array)
+				view_dim = D3D11_DSV_DIMENSION_TEXTURE1DARRAY;
+			else
+				view_dim = D3D11_DSV_DIMENSION_TEXTURE1D;
+			break;
+		case TextureType::e2D:
+			if (is_array)
+			{
+				if (ms_on)
+					view_dim = D3D11_DSV_DIMENSION_TEXTURE2DMSARRAY;
+				else
+					view_dim = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+			}
+			else
+			{
+				if (ms_on)
+					view_dim = D3D11_DSV_DIMENSION_TEXTURE2DMS;
+				else
+					view_dim = D3D11_DSV_DIMENSION_TEXTURE2D;
+			}
+			break;
+		case TextureType::e3D:
+			assert(false);
+			break;
+		default:
+			assert(false);
+			break;
+		}
+		if (view_dim == D3D11_DSV_DIMENSION_UNKNOWN)
+			assert(false);
+
+		// Create desc
+		D3D11_DEPTH_STENCIL_VIEW_DESC v_desc{};
+		switch (desc.m_type)
+		{
+		case TextureType::e1D:
+			assert(false && "RTV for Texture 1D is currently not supported");
+			break;
+		case TextureType::e2D:
+			v_desc = CD3D11_DEPTH_STENCIL_VIEW_DESC(
+				(ID3D11Texture2D*)texture->m_internal_resource.Get(),
+				view_dim,
+				DXGI_FORMAT_UNKNOWN,
+				0,
+				0,
+				-1);	// array size (auto calc from tex)
+
+			// Interpret depth stencil 
+			if (v_desc.Format == DXGI_FORMAT_R32_TYPELESS)
+				v_desc.Format = DXGI_FORMAT_D32_FLOAT;
+			else if (v_desc.Format == DXGI_FORMAT_R32G8X24_TYPELESS)
+				v_desc.Format = DXGI_FORMAT_D32_FLOAT_S8X24_UINT;
+			else if (v_desc.Format == DXGI_FORMAT_R24G8_TYPELESS)
+				v_desc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+			else if (v_desc.Format == DXGI_FORMAT_R16_TYPELESS)
+				v_desc.Format = DXGI_FORMAT_D16_UNORM;
+
+			break;
+		case TextureType::e3D:
+			assert(false && "RTV for Texture 3D is currently not supported");
+			break;
+		default:
+			assert(false);
+			break;
+		}
+
+		// Create view
+		HRCHECK(m_dev->get_device()->CreateDepthStencilView(
+			(ID3D11Resource*)texture->m_internal_resource.Get(),
+			&v_desc,
+			texture->m_dsv.ReleaseAndGetAddressOf()
+		));
+	}
+
+}
+
+void DXBackend::create_sampler(const SamplerDesc& desc, Sampler* sampler)
+{
+	HRCHECK(m_dev->get_device()->CreateSamplerState(&desc.m_sampler_desc,
+		(ID3D11SamplerState**)sampler->m_internal_resource.ReleaseAndGetAddressOf()));
+}
+
+void DXBackend::create_shader(ShaderStage stage, const ShaderBytecode& bytecode, Shader* shader)
+{
+	switch (stage)
+	{
+	case ShaderStage::eVertex:
+		HRCHECK(m_dev->get_device()->CreateVertexShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11VertexShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
+		shader->m_stage = ShaderStage::eVertex;
+		shader->m_blob = bytecode;
+		break;
+	case ShaderStage::ePixel:
+		HRCHECK(m_dev->get_device()->CreatePixelShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11PixelShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
+		shader->m_stage = ShaderStage::ePixel;
+		break;
+	case ShaderStage::eHull:
+		HRCHECK(m_dev->get_device()->CreateHullShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11HullShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
+		shader->m_stage = ShaderStage::eHull;
+		break;
+	case ShaderStage::eDomain:
+		HRCHECK(m_dev->get_device()->CreateDomainShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11DomainShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
+		shader->m_stage = ShaderStage::eDomain;
+		break;
+	case ShaderStage::eGeometry:
+		HRCHECK(m_dev->get_device()->CreateGeometryShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11GeometryShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
+		shader->m_stage = ShaderStage::eGeometry;
+		break;
+	case ShaderStage::eCompute:
+		HRCHECK(m_dev->get_device()->CreateComputeShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11ComputeShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
+		shader->m_stage = ShaderStage::eCompute;
+		break;
+	}
+
+	shader->m_blob = bytecode;
+}
+
+void DXBackend::create_pipeline(const PipelineDesc& desc, const Shader* vs, GraphicsPipeline* pipeline)
+{
+	auto& dev = m_dev->get_device();
+
+	// create rasterizer state (default state if user dont supply)
+	HRCHECK(dev->CreateRasterizerState1(&desc.m_rasterizer_desc.m_rasterizer_desc,
+		(ID3D11RasterizerState1**)pipeline->m_rasterizer.m_internal_resource.ReleaseAndGetAddressOf()));
+
+	// create blend state (default state if user dont supply)
+	HRCHECK(dev->CreateBlendState1(&desc.m_blend_desc.m_blend_desc,
+		(ID3D11BlendState1**)pipeline->m_blend.m_internal_resource.ReleaseAndGetAddressOf()));
+
+	HRCHECK(dev->CreateDepthStencilState(&desc.m_depth_stencil_desc.m_depth_stencil_desc,
+		(ID3D11DepthStencilState**)pipeline->m_depth_stencil.m_internal_resource.ReleaseAndGetAddressOf()));
+
+	// create input layout (duplicates may be created here, we will ignore this for simplicity)
+	if (!desc.m_input_desc.m_input_descs.empty())
+	{
+		HRCHECK(dev->CreateInputLayout(
+			desc.m_input_desc.m_input_descs.data(),
+			(UINT)desc.m_input_desc.m_input_descs.size(),
+			vs->m_blob.code->data(),
+			(UINT)vs->m_blob.code->size(),
+			(ID3D11InputLayout**)pipeline->m_input_layout.m_internal_resource.ReleaseAndGetAddressOf()));
+	}
+
+	pipeline->m_is_registered = true;
+}
+
+D3D11_TEXTURE2D_DESC DXBackend::describe_texture(const GPUTexture* texture) const
+{
+	D3D11_TEXTURE2D_DESC desc{};
+	desc.SampleDesc = { 1, 0 };
+	if (texture->m_internal_resource)
+		((ID3D11Texture2D*)texture->m_internal_resource.Get())->GetDesc(&desc);
+	return desc;
+}
+
+
+
+
+void DXBackend::begin_pass(const RenderPass* rp, const PassTargets& targets, DepthStencilClear ds_clear)
+{
+	auto& ctx = m_dev->get_context();
+
+	// clear RenderPass and get render targets
+	ID3D11RenderTargetView* rtvs[gfxconstants::MAX_RENDER_TARGETS] = {};
+	for (int i = 0; i < rp->m_targets.size(); ++i)
+	{
+		// get target
+		if (!targets.targets[i])
+			break;
+		rtvs[i] = targets.targets[i]->m_rtv.Get();
+
+		// clear target
+		ctx->ClearRenderTargetView(rtvs[i], std::get<RenderTextureClear>(rp->m_targets[i]).m_rgba.data());
+	}
+
+	ID3D11DepthStencilView* dsv = nullptr;
+	if (targets.depth_stencil)
+	{
+		dsv = targets.depth_stencil->m_dsv.Get();
+		ctx->ClearDepthStencilView(dsv, ds_clear.m_clear_flags, ds_clear.m_depth, ds_clear.m_stencil);
+	}
+
+	if (m_raster_rw_range_this_pass > 0)
+	{
+		ctx->OMSetRenderTargetsAndUnorderedAccessViews(
+			gfxconstants::MAX_RENDER_TARGETS, rtvs, dsv,
+			0, gfxconstants::MAX_BOUND_UAVS, m_raster_uavs.data(), m_raster_uav_initial_counts.data());
+	}
+	else
+	{
+		ctx->OMSetRenderTargets(gfxconstants::MAX_RENDER_TARGETS, rtvs, dsv);
+	}
+}
+
+void DXBackend::end_pass(const RenderPass* rp, const PassTargets& targets)
+{
+	auto& ctx = m_dev->get_context();
+
+	// set render targets / raster uavs 
+	if (m_raster_rw_range_this_pass > 0)
+	{
+		ctx->OMSetRenderTargetsAndUnorderedAccessViews(
+			gfxconstants::MAX_RENDER_TARGETS, (ID3D11RenderTargetView* const*)gfxconstants::NULL_RESOURCE, nullptr,
+			0, gfxconstants::MAX_BOUND_UAVS, (ID3D11UnorderedAccessView* const*)gfxconstants::NULL_RESOURCE, nullptr);
+		m_raster_rw_range_this_pass = 0;
+	}
+	else
+	{
+		ctx->OMSetRenderTargets(gfxconstants::MAX_RENDER_TARGETS, (ID3D11RenderTargetView* const*)gfxconstants::NULL_RESOURCE, nullptr);
+	}
+
+
+	// resolve any ms targets if any
+	if (!rp->m_resolve_targets.empty())
+	{
+		for (int i = 0; i < rp->m_targets.size(); ++i)
+		{
+			auto src = (ID3D11Texture2D*)targets.targets[i]->m_internal_resource.Get();
+			auto dst = (ID3D11Texture2D*)targets.resolve_targets[i]->m_internal_resource.Get();
+			auto format = std::get<DXGI_FORMAT>(rp->m_targets[i]);
+			ctx->ResolveSubresource(dst, 0, src, 0, format);
+		}
+	}
+
+	// TO-DO: resolve depth target using compute shader
+	// https://wickedengine.net/2016/11/13/how-to-resolve-an-msaa-depthbuffer/#comments
+
+	ctx->VSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+	ctx->HSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+	ctx->DSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+	ctx->GSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+	ctx->PSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+}
+
+
+
+void DXBackend::bind_pipeline(const GraphicsPipeline* pipeline, const std::array<const Shader*, 5>& vs_ps_gs_hs_ds, const std::array<FLOAT, 4>& blend_factor, UINT stencil_ref)
+{
+	auto& ctx = m_dev->get_context();
+
+	if (pipeline->m_input_layout.is_valid())
+		ctx->IASetInputLayout((ID3D11InputLayout*)pipeline->m_input_layout.m_internal_resource.Get());
+	else
+		ctx->IASetInputLayout(nullptr);
+
+
+	// bind shaders
+	const auto& [vs, ps, gs, hs, ds] = vs_ps_gs_hs_ds;
+	ctx->VSSetShader((ID3D11VertexShader*)vs->m_internal_resource.Get(), nullptr, 0);
+	ctx->PSSetShader((ID3D11PixelShader*)ps->m_internal_resource.Get(), nullptr, 0);
+
+	if (gs)
+		ctx->GSSetShader((ID3D11GeometryShader*)gs->m_internal_resource.Get(), nullptr, 0);
+	else
+		ctx->GSSetShader(nullptr, nullptr, 0);
+
+	if (hs)
+		ctx->HSSetShader((ID3D11HullShader*)hs->m_internal_resource.Get(), nullptr, 0);
+	else
+		ctx->HSSetShader(nullptr, nullptr, 0);
+
+	if (ds)
+		ctx->DSSetShader((ID3D11DomainShader*)ds->m_internal_resource.Get(), nullptr, 0);
+	else
+		ctx->DSSetShader(nullptr, nullptr, 0);
+
+	ctx->IASetPrimitiveTopology(pipeline->m_topology);
+	ctx->RSSetState((ID3D11RasterizerState*)pipeline->m_rasterizer.m_internal_resource.Get());
+	ctx->OMSetDepthStencilState((ID3D11DepthStencilState*)pipeline->m_depth_stencil.m_internal_resource.Get(), stencil_ref);
+	ctx->OMSetBlendState((ID3D11BlendState*)pipeline->m_blend.m_internal_resource.Get(), blend_factor.data(), pipeline->m_sample_mask);
+}
+
+void DXBackend::bind_compute_shader(const Shader* cs)
+{
+	m_dev->get_context()->CSSetShader((ID3D11ComputeShader*)cs->m_internal_resource.Get(), nullptr, 0);
+}
+
+void DXBackend::bind_vertex_buffers(UINT start_slot, UINT count, const GPUBuffer* const* buffers, const UINT* strides, const UINT* offsets)
+{
+	ID3D11Buffer* vbs[gfxconstants::MAX_INPUT_SLOTS] = {};
+	for (UINT i = 0; i < count; ++i)
+		vbs[i] = (ID3D11Buffer*)buffers[i]->m_internal_resource.Get();
+
+	m_dev->get_context()->IASetVertexBuffers(
+		start_slot, count,
+		vbs,
+		strides ? strides : (UINT*)gfxconstants::NULL_RESOURCE,
+		offsets ? offsets : (UINT*)gfxconstants::NULL_RESOURCE);
+}
+
+void DXBackend::bind_index_buffer(const GPUBuffer* buffer, DXGI_FORMAT format, UINT offset)
+{
+	m_dev->get_context()->IASetIndexBuffer((ID3D11Buffer*)buffer->m_internal_resource.Get(), format, offset);
+}
+
+
+void DXBackend::bind_constant_buffer(UINT slot, ShaderStage stage, const GPUBuffer* buffer, UINT offset256s, UINT range256s)
+{
+	ID3D11Buffer* cbs[] = { (ID3D11Buffer*)buffer->m_internal_resource.Get() };
+	auto& ctx = m_dev->get_context();
+
+	UINT first_constant = offset256s * 16;
+	UINT num_constants = range256s * 16;
+
+	switch (stage)
+	{
+	case ShaderStage::eVertex:
+		//ctx->VSSetConstantBuffers(slot, 1, cbs);
+		ctx->VSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
+		break;
+	case ShaderStage::ePixel:
+		//ctx->PSSetConstantBuffers(slot, 1, cbs);
+		ctx->PSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
+		break;
+	case ShaderStage::eHull:
+		//ctx->HSSetConstantBuffers(slot, 1, cbs);
+		ctx->HSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
+		break;
+	case ShaderStage::eDomain:
+		//ctx->DSSetConstantBuffers(slot, 1, cbs);
+		ctx->DSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
+		break;
+	case ShaderStage::eGeometry:
+		//ctx->GSSetConstantBuffers(slot, 1, cbs);
+		ctx->GSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
+		break;
+	case ShaderStage::eCompute:
+		//ctx->CSSetConstantBuffers(slot, 1, cbs);
+		ctx->CSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
+		break;
+	}
+}
+
+void DXBackend::bind_resource(UINT slot, ShaderStage stage, const GPUResource* resource)
+{
+	ID3D11ShaderResourceView* srvs[] = { resource ? resource->m_srv.Get() : nullptr };
+	auto& ctx = m_dev->get_context();
+
+	switch (stage)
+	{
+	case ShaderStage::eVertex:
+		ctx->VSSetShaderResources(slot, 1, srvs);
+		break;
+	case ShaderStage::ePixel:
+		ctx->PSSetShaderResources(slot, 1, srvs);
+		break;
+	case ShaderStage::eHull:
+		ctx->HSSetShaderResources(slot, 1, srvs);
+		break;
+	case ShaderStage::eDomain:
+		ctx->DSSetShaderResources(slot, 1, srvs);
+		break;
+	case ShaderStage::eGeometry:
+		ctx->GSSetShaderResources(slot, 1, srvs);
+		break;
+	case ShaderStage::eCompute:
+		ctx->CSSetShaderResources(slot, 1, srvs);
+		break;
+	}
+}
+
+void DXBackend::bind_resource_rw(UINT slot, ShaderStage stage, const GPUResource* resource, UINT initial_count)
+{
+	//assert(m_inside_pass == true && "Resource RWs must be bound prior to begin_pass()");
+
+	ID3D11UnorderedAccessView* uavs[] = { resource->m_uav.Get() };
+
+	switch (stage)
+	{
+		// https://docs.microsoft.com/en-us/windows/win32/direct3d11/direct3d-11-1-features#use-uavs-at-every-pipeline-stage
+		// 11.1, use UAVs at every pipeline stage
+	case ShaderStage::eVertex:
+	case ShaderStage::ePixel:
+	case ShaderStage::eHull:
+	case ShaderStage::eDomain:
+	case ShaderStage::eGeometry:
+	{
+		m_raster_uavs[slot] = resource->m_uav.Get();
+		m_raster_uav_initial_counts[slot] = initial_count;
+		auto range = m_raster_rw_range_this_pass;
+		// https://github.com/assimp/assimp/issues/2271 paranthesis solves DEFINE NOMINMAX
+		m_raster_rw_range_this_pass = (std::max)(range, slot);
+		break;
+	}
+	case ShaderStage::eCompute:
+		m_dev->get_context()->CSSetUnorderedAccessViews(slot, 1, uavs, &initial_count);
+		break;
+	}
+
+}
+
+void DXBackend::bind_sampler(UINT slot, ShaderStage stage, const Sampler* sampler)
+{
+	ID3D11SamplerState* samplers[] = { (ID3D11SamplerState*)sampler->m_internal_resource.Get() };
+	auto& ctx = m_dev->get_context();
+
+	switch (stage)
+	{
+	case ShaderStage::eVertex:
+		ctx->VSSetSamplers(slot, 1, samplers);
+		break;
+	case ShaderStage::ePixel:
+		ctx->PSSetSamplers(slot, 1, samplers);
+		break;
+	case ShaderStage::eHull:
+		ctx->HSSetSamplers(slot, 1, samplers);
+		break;
+	case ShaderStage::eDomain:
+		ctx->DSSetSamplers(slot, 1, samplers);
+		break;
+	case ShaderStage::eGeometry:
+		ctx->GSSetSamplers(slot, 1, samplers);
+		break;
+	case ShaderStage::eCompute:
+		ctx->CSSetSamplers(slot, 1, samplers);
+		break;
+	}
+}
+
+void DXBackend::bind_viewports(const std::vector<D3D11_VIEWPORT>& viewports)
+{
+	auto& ctx = m_dev->get_context();
+	ctx->RSSetViewports((UINT)viewports.size(), viewports.data());
+}
+
+void DXBackend::bind_scissors(const std::vector<D3D11_RECT>& rects)
+{
+	auto& ctx = m_dev->get_context();
+	ctx->RSSetScissorRects((UINT)rects.size(), rects.data());
+}
+
+
+
+
+void DXBackend::update_subresource(const GPUResource* dst, const SubresourceData& data, const D3D11_BOX& dst_box, UINT dst_subres_idx)
+{
+	m_dev->get_context()->UpdateSubresource((ID3D11Resource*)dst->m_internal_resource.Get(),
+		dst_subres_idx, &dst_box, data.m_subres.pSysMem, data.m_subres.SysMemPitch, data.m_subres.SysMemSlicePitch);
+}
+
+void DXBackend::map_copy(const GPUResource* dst, const SubresourceData& data, D3D11_MAP map_type, UINT dst_subres_idx)
+{
+	auto& ctx = m_dev->get_context();
+	D3D11_MAPPED_SUBRESOURCE mapped_subres{};
+	HRCHECK(ctx->Map((ID3D11Resource*)dst->m_internal_resource.Get(), dst_subres_idx, map_type, 0, &mapped_subres));
+	std::memcpy(mapped_subres.pData, data.m_subres.pSysMem, data.m_subres.SysMemPitch);		// not handling slice pitch for now
+	ctx->Unmap((ID3D11Resource*)dst->m_internal_resource.Get(), dst_subres_idx);
+}
+
+std::pair<float, float> DXBackend::map_read_temp(const GPUBuffer* buffer)
+{
+	auto res = (ID3D11Resource*)buffer->m_internal_resource.Get();
+
+	D3D11_MAPPED_SUBRESOURCE subr;
+	m_dev->get_context()->Map(res, 0, D3D11_MAP_READ, 0, &subr);
+
+	float minmax[2] = { 0, 0 };
+	for (int i = 0; i < 2; ++i)
+	{
+		minmax[i] = ((float*)subr.pData)[i];
+	}
+
+	fmt::print("Min: {:.8f}, Max: {:.8f}\n", minmax[1], minmax[0]);
+
+
+	m_dev->get_context()->Unmap(res, 0);
+
+	return { minmax[0], minmax[1] };
+}
+
+void DXBackend::copy_resource_region(const GPUResource* dst, const CopyRegionDst& dst_desc, const GPUResource* src, const CopyRegionSrc& src_desc)
+{
+	m_dev->get_context()->CopySubresourceRegion1(
+		(ID3D11Resource*)dst->m_internal_resource.Get(), dst_desc.m_subres, dst_desc.m_x, dst_desc.m_y, dst_desc.m_z,
+		(ID3D11Resource*)src->m_internal_resource.Get(), src_desc.m_subres, &src_desc.m_box, src_desc.m_copy_flags);
+}
+
+void DXBackend::copy_resource_region(const GPUResource* dst, const CopyRegionDst& dst_desc, const GPUResource* src, UINT src_subres)
+{
+	// No box, block compressed mips smaller than a block are copied whole
+	m_dev->get_context()->CopySubresourceRegion(
+		(ID3D11Resource*)dst->m_internal_resource.Get(), dst_desc.m_subres, dst_desc.m_x, dst_desc.m_y, dst_desc.m_z,
+		(ID3D11Resource*)src->m_internal_resource.Get(), src_subres, nullptr);
+}
+
+
+
+
+void DXBackend::dispatch(UINT blocks_x, UINT blocks_y, UINT blocks_z)
+{
+	track(GfxCall::eDispatch);
+	auto& ctx = m_dev->get_context();
+
+	ctx->Dispatch(blocks_x, blocks_y, blocks_z);
+
+	// https://on-demand.gputechconf.com/gtc/2010/presentations/S12312-DirectCompute-Pre-Conference-Tutorial.pdf
+	// How do you know when it is safe to Unbind UAVs from Compute Shader???
+	// Ans: Check GP Discord, DirectX section, answer from jwki
+	// No need to sync with Fence
+	// https://stackoverflow.com/questions/55005420/how-to-do-a-blocking-wait-for-a-compute-shader-with-direct3d11
+	ctx->CSSetUnorderedAccessViews(0, gfxconstants::MAX_BOUND_UAVS, (ID3D11UnorderedAccessView* const*)gfxconstants::NULL_RESOURCE, (const UINT*)gfxconstants::NULL_RESOURCE);
+	ctx->CSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+}
+
+void DXBackend::draw(UINT vertex_count, UINT start_loc)
+{
+	m_dev->get_context()->Draw(vertex_count, start_loc);
+}
+
+void DXBackend::draw_indexed(UINT index_count, UINT index_start, UINT vertex_start)
+{
+	m_dev->get_context()->DrawIndexed(index_count, index_start, vertex_start);
+}
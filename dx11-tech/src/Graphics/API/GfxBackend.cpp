@@ -0,0 +1,38 @@
+#include "pch.h"
+#include "Graphics/API/GfxBackend.h"
+#include "Graphics/API/GfxTypes.h"
+
+NullBackend::NullBackend(UINT width, UINT height) :
+	m_dim({ width, height })
+{
+	fmt::print("GfxDevice running headless ({}x{})\n", width, height);
+}
+
+void NullBackend::get_backbuffer(GPUTexture* backbuffer)
+{
+	backbuffer->m_type = TextureType::e2D;
+}
+
+void NullBackend::create_texture(const TextureDesc& desc, GPUTexture* texture, const std::vector<SubresourceData>& subres)
+{
+	texture->m_type = desc.m_type;
+}
+
+void NullBackend::create_shader(ShaderStage stage, const ShaderBytecode& bytecode, Shader* shader)
+{
+	// Shader names are what pipelines are tracked by for reloading
+	shader->m_stage = stage;
+	shader->m_blob = bytecode;
+}
+
+void NullBackend::create_pipeline(const PipelineDesc& desc, const Shader* vs, GraphicsPipeline* pipeline)
+{
+	pipeline->m_is_registered = true;
+}
+
+D3D11_TEXTURE2D_DESC NullBackend::describe_texture(const GPUTexture* texture) const
+{
+	D3D11_TEXTURE2D_DESC desc{};
+	desc.SampleDesc = { 1, 0 };
+	return desc;
+}
@@ -0,0 +1,183 @@
+#include "pch.h"
+#include "Graphics/API/GfxCallRecorder.h"
+
+const char* to_string(GfxCall call)
+{
+	switch (call)
+	{
+	case GfxCall::eCreateBuffer:			return "create_buffer";
+	case GfxCall::eCreateTexture:			return "create_texture";
+	case GfxCall::eCreateSampler:			return "create_sampler";
+	case GfxCall::eCreateShader:			return "create_shader";
+	case GfxCall::eCreatePipeline:			return "create_pipeline";
+	case GfxCall::eCreateComputePipeline:	return "create_compute_pipeline";
+	case GfxCall::eCreateRenderPass:		return "create_renderpass";
+	case GfxCall::eFree:					return "free";
+	case GfxCall::eBeginPass:				return "begin_pass";
+	case GfxCall::eEndPass:					return "end_pass";
+	case GfxCall::eBindPipeline:			return "bind_pipeline";
+	case GfxCall::eBindComputePipeline:		return "bind_compute_pipeline";
+	case GfxCall::eBindVertexBuffers:		return "bind_vertex_buffers";
+	case GfxCall::eBindIndexBuffer:			return "bind_index_buffer";
+	case GfxCall::eBindConstantBuffer:		return "bind_constant_buffer";
+	case GfxCall::eBindResource:			return "bind_resource";
+	case GfxCall::eBindResourceRW:			return "bind_resource_rw";
+	case GfxCall::eBindSampler:				return "bind_sampler";
+	case GfxCall::eBindViewports:			return "bind_viewports";
+	case GfxCall::eBindScissors:			return "bind_scissors";
+	case GfxCall::eMapCopy:					return "map_copy";
+	case GfxCall::eUpdateSubresource:		return "update_subresource";
+	case GfxCall::eMapRead:					return "map_read";
+	case GfxCall::eCopyRegion:				return "copy_resource_region";
+	case GfxCall::eDraw:					return "draw";
+	case GfxCall::eDrawIndexed:				return "draw_indexed";
+	case GfxCall::eDispatch:				return "dispatch";
+	case GfxCall::ePresent:					return "present";
+	default:
+		assert(false);
+		return "unknown";
+	}
+}
+
+GfxCallRecorder::GfxCallRecorder(bool serialize_stream) :
+	m_serialize(serialize_stream)
+{
+}
+
+void GfxCallRecorder::record(GfxCall call, bool issued, res_handle hdl, bool valid, uint32_t slot)
+{
+	auto& frame = m_frame_stats[(size_t)call];
+	auto& total = m_total_stats[(size_t)call];
+	++frame.requested;
+	++total.requested;
+	if (issued)
+	{
+		++frame.issued;
+		++total.issued;
+	}
+	if (!valid)
+	{
+		++frame.invalid_handles;
+		++total.invalid_handles;
+		fmt::print(fg(fmt::color::red), "GfxCallRecorder: {} called with invalid handle {:#x} (frame {})\n", to_string(call), hdl, m_frame);
+	}
+
+	// State tracking
+	switch (call)
+	{
+	case GfxCall::eBindPipeline:
+		m_tracked.pipeline = hdl;
+		break;
+	case GfxCall::eBindComputePipeline:
+		m_tracked.compute_pipeline = hdl;
+		break;
+	case GfxCall::eBindIndexBuffer:
+		m_tracked.index_buffer = hdl;
+		break;
+	case GfxCall::eBeginPass:
+		m_tracked.renderpass = hdl;
+		break;
+	case GfxCall::eEndPass:
+		m_tracked.renderpass = 0;
+		break;
+	case GfxCall::eDraw:
+	case GfxCall::eDrawIndexed:
+	case GfxCall::eDispatch:
+		m_bound = m_tracked;
+		break;
+	default:
+		break;
+	}
+
+	if (m_serialize)
+		m_stream.push_back({ m_frame, call, issued, valid, hdl, slot });
+}
+
+void GfxCallRecorder::frame_start()
+{
+	++m_frame;
+	m_frame_stats = {};
+}
+
+void GfxCallRecorder::set_serialize_stream(bool serialize)
+{
+	m_serialize = serialize;
+}
+
+void GfxCallRecorder::clear_stream()
+{
+	m_stream.clear();
+}
+
+const std::vector<GfxCallRecorder::Entry>& GfxCallRecorder::get_stream() const
+{
+	return m_stream;
+}
+
+bool GfxCallRecorder::write_stream(const std::filesystem::path& path) const
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+		return false;
+
+	// Plain CSV, one call per line
+	file << "frame,call,issued,valid,handle,slot\n";
+	for (const auto& e : m_stream)
+		file << fmt::format("{},{},{},{},{:#x},{}\n", e.frame, to_string(e.call), (int)e.issued, (int)e.valid, e.hdl, e.slot);
+
+	return file.good();
+}
+
+const GfxCallRecorder::Stats& GfxCallRecorder::get_frame_stats() const
+{
+	return m_frame_stats;
+}
+
+const GfxCallRecorder::Stats& GfxCallRecorder::get_total_stats() const
+{
+	return m_total_stats;
+}
+
+const GfxCallRecorder::BoundState& GfxCallRecorder::get_bound_state() const
+{
+	return m_bound;
+}
+
+uint64_t GfxCallRecorder::get_frame() const
+{
+	return m_frame;
+}
+
+float GfxCallRecorder::filter_efficiency(const Stats& stats)
+{
+	uint64_t requested = 0;
+	uint64_t issued = 0;
+	for (auto call = (size_t)GfxCall::eBindPipeline; call <= (size_t)GfxCall::eBindSampler; ++call)
+	{
+		requested += stats[call].requested;
+		issued += stats[call].issued;
+	}
+
+	if (requested == 0)
+		return 0.f;
+	return (float)(requested - issued) / requested;
+}
+
+JsonValue GfxCallRecorder::to_json(const Stats& stats) const
+{
+	auto root = JsonValue::object();
+	auto& calls = root["calls"];
+	calls = JsonValue::object();
+	for (size_t i = 0; i < stats.size(); ++i)
+	{
+		if (stats[i].requested == 0)
+			continue;
+
+		auto& c = calls[to_string((GfxCall)i)];
+		c["requested"] = stats[i].requested;
+		c["issued"] = stats[i].issued;
+		c["invalid_handles"] = stats[i].invalid_handles;
+	}
+	root["bind_filter_efficiency"] = filter_efficiency(stats);
+	return root;
+}
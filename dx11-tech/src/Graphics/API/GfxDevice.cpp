@@ -1,7 +1,12 @@
 #include "pch.h"
 #include "Graphics/API/GfxDevice.h"
+#include "Graphics/API/DXBackend.h"
 #include "Graphics/API/GfxTypes.h"
 #include "Profiler/FrameProfiler.h"
+#include "Profiler/StartupProfiler.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+#include <algorithm>
 
 // Globals
 namespace gfx
@@ -10,18 +15,13 @@ namespace gfx
 	GPUAnnotator* annotator = nullptr;
 }
 
+namespace jobs { extern ThreadPool* pool; }
+
 //namespace perf
 //{
 //	extern FrameProfiler* profiler;
 //}
 
-namespace gfxconstants
-{
-	// For unbinding state
-	const void* const NULL_RESOURCE[gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS] = {};
-}
-
-
 void GfxDevice::initialize(unique_ptr<DXDevice> dx_device)
 {
 	//if (!s_gfx_device)
@@ -30,7 +30,17 @@ void GfxDevice::initialize(unique_ptr<DXDevice> dx_device)
 	//	assert(false);	// dont try initializing multiple times..
 
 	if (!gfx::dev)
-		gfx::dev = new GfxDevice(std::move(dx_device));
+		gfx::dev = new GfxDevice(make_unique<DXBackend>(std::move(dx_device)));
+	else
+		assert(false);	// dont try initializing multiple times..
+
+	gfx::annotator = gfx::dev->get_annotator();
+}
+
+void GfxDevice::initialize_headless(UINT width, UINT height)
+{
+	if (!gfx::dev)
+		gfx::dev = new GfxDevice(make_unique<NullBackend>(width, height));
 	else
 		assert(false);	// dont try initializing multiple times..
 
@@ -52,22 +62,25 @@ void GfxDevice::shutdown()
 
 
 
-GfxDevice::GfxDevice(std::unique_ptr<DXDevice> dev) :
-	m_dev(std::move(dev))
+GfxDevice::GfxDevice(unique_ptr<GfxBackend> backend) :
+	m_backend(std::move(backend))
 {
 	// Initialize backbuffer texture primitive
 	auto [bb_hdl, bb_res] = m_textures.get_next_free_handle();
 	bb_res->handle = bb_hdl;
-	bb_res->m_internal_resource = m_dev->get_bb_texture();
-	bb_res->m_rtv = m_dev->get_bb_target();
-	bb_res->m_type = TextureType::e2D;
+	m_backend->get_backbuffer(bb_res);
 	m_backbuffer = TextureHandle{ bb_hdl };
 
 	// Initialize annotator
-	m_annotator = make_unique<GPUAnnotator>(m_dev->get_annotation());
+	m_annotator = make_unique<GPUAnnotator>(m_backend->get_annotation());
+
+	// Initialize profiler (does nothing without a D3D11 device)
+	m_profiler = make_unique<GPUProfiler>(m_backend->get_dx_device());
 
-	// Initialize profiler
-	m_profiler = make_unique<GPUProfiler>(m_dev.get());
+	// No compiler, no cache (see compile_shader)
+	m_shader_compiler = m_backend->create_shader_compiler();
+	if (m_shader_compiler)
+		m_shader_cache = make_unique<ShaderCache>(m_shader_compiler.get());
 
 	uint64_t storage_mem_footprint = 0;
 	storage_mem_footprint += m_buffers.get_memory_footprint();
@@ -86,27 +99,13 @@ GfxDevice::~GfxDevice()
 
 void GfxDevice::frame_start()
 {
+	if (m_recorder)
+		m_recorder->frame_start();
+
 	if (m_profiler)
 		m_profiler->frame_start();
 
-	auto& ctx = m_dev->get_context();
-	ctx->RSSetScissorRects(gfxconstants::MAX_SCISSORS, (const D3D11_RECT*)gfxconstants::NULL_RESOURCE);
-
-	// nuke all SRVs
-	// https://stackoverflow.com/questions/20300778/are-there-directx-guidelines-for-binding-and-unbinding-resources-between-draw-ca
-	ctx->VSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
-	ctx->HSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
-	ctx->DSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
-	ctx->GSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
-	ctx->PSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
-	ctx->CSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS - 64, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
-
-	//ctx->VSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
-	//ctx->HSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
-	//ctx->DSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
-	//ctx->GSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
-	//ctx->PSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
-	//ctx->CSSetConstantBuffers(0, gfxconstants::MAX_CB_SLOTS, (ID3D11Buffer* const*)gfxconstants::NULL_RESOURCE);
+	m_backend->frame_start();
 }
 
 void GfxDevice::frame_end()
@@ -127,12 +126,25 @@ void GfxDevice::frame_end()
 
 void GfxDevice::compile_and_create_shader(ShaderStage stage, const std::filesystem::path& fname, Shader* shader, bool recompilation)
 {
+	auto _ = StartupProfiler::Scoped("Shader: " + fname.string(), "shader");
 	ShaderBytecode bc;
 	compile_shader(stage, fname, &bc, recompilation);
 	create_shader(stage, bc, shader);
 }
 
 void GfxDevice::compile_shader(ShaderStage stage, const std::filesystem::path& fname, ShaderBytecode* bytecode, bool recompilation)
+{
+	std::string error;
+	if (!compile_shader(stage, fname, bytecode, error))
+	{
+		OutputDebugStringA(error.c_str());
+		std::cout << error << "\n";
+		if (!recompilation)	
+			assert(false);
+	}
+}
+
+bool GfxDevice::compile_shader(ShaderStage stage, const std::filesystem::path& fname, ShaderBytecode* bytecode, std::string& error)
 {
 	std::string target;
 	switch (stage)
@@ -166,129 +178,209 @@ void GfxDevice::compile_shader(ShaderStage stage, const std::filesystem::path& f
 	flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
 #endif
 
-	auto new_target = std::string(gfxconstants::SHADER_DIRECTORY) + fname.string();
-	auto new_fpath = std::filesystem::path(new_target);
-
-	BlobPtr shader_blob;
-	BlobPtr error_blob;
-	auto HR = D3DCompileFromFile(
-		new_fpath.wstring().c_str(),
-		nullptr,
-		D3D_COMPILE_STANDARD_FILE_INCLUDE, // This default include handler includes files that are relative to the current directory
-		"main",
-		target.c_str(),
-		flags, 0,
-		shader_blob.ReleaseAndGetAddressOf(), error_blob.ReleaseAndGetAddressOf()
-	);
-	if (FAILED(HR))
+	// Nothing to compile with (NullBackend), keep the name around so pipelines can still be tracked for reloading
+	if (!m_shader_cache)
 	{
-		if (error_blob)
-		{
-			OutputDebugStringA((char*)error_blob->GetBufferPointer());
-			std::cout << (char*)error_blob->GetBufferPointer() << "\n";
-			if (!recompilation)	
-				assert(false);
-			return;
-		}
+		bytecode->code = std::make_shared<std::vector<uint8_t>>();
+		bytecode->fname = fname.string();
+		return true;
 	}
+
+	ShaderCompileRequest request;
+	request.path = std::filesystem::path(std::string(gfxconstants::SHADER_DIRECTORY) + fname.string());
+	request.target = target;
+	request.flags = flags;
+
+	// Unchanged sources (and includes) are loaded from the bytecode cache
+	auto code = std::make_shared<std::vector<uint8_t>>();
+	std::vector<std::filesystem::path> files;
+	const bool compiled = m_shader_cache->compile(request, *code, error, &files);
+
+	// Recorded on failure too, fixing an include has to reach the shader
+	set_shader_dependencies(fname.string(), files);
+	if (!compiled)
+		return false;
 	
-	bytecode->code = std::make_shared<std::vector<uint8_t>>();
-	bytecode->code->resize(shader_blob->GetBufferSize());
-	std::memcpy(bytecode->code->data(), shader_blob->GetBufferPointer(), shader_blob->GetBufferSize());
+	bytecode->code = std::move(code);
 	bytecode->fname = fname.string();
+	return true;
 }
 
-void GfxDevice::recompile_pipeline_shaders_by_name(const std::string& name)
+ShaderBatch GfxDevice::compile_shaders(const std::vector<ShaderBatch::Source>& shaders)
 {
-	if (!m_reloading_on)
-		return;
+	return ShaderBatch(this, shaders);
+}
 
-	auto fname = name + std::string(".hlsl");		// append extension
+ShaderReloadStats GfxDevice::reload_shaders(const std::filesystem::path& file)
+{
+	ShaderReloadStats stats;
+	if (!m_reloading_on)
+		return stats;
 
-	bool graphics_pipe = false;
-	bool compute_pipe = false;
-	auto graphics_it = m_loaded_pipelines.find(fname);
-	auto compute_it = m_loaded_compute_pipelines.find(fname);
+	Timer timer;
+	const auto path = file.lexically_normal().generic_string();
 
-	// find pipelines associated with the shader name
-	if (graphics_it != m_loaded_pipelines.end())
+	std::set<std::string> fnames;
 	{
-		graphics_pipe = true;
+		std::lock_guard lock(m_shader_dependencies_mutex);
+		auto it = m_shader_dependents.find(path);
+		if (it != m_shader_dependents.end())
+			fnames = it->second;
 	}
-	// try looking for compute if it didnt find in normal render pipelines list
-	else if (compute_it != m_loaded_compute_pipelines.end())
-	{
-		compute_pipe = true;
-	}
-	
-	assert(graphics_pipe || compute_pipe);	// if/else with this assertion serves as an XOR: we must find either exactly a gph pipe or compute pipe
+	if (fnames.empty())
+		return stats;		// no loaded shader uses the file
 
-	/*
-		"Recompile every pipeline".
+	struct Compiled
+	{
+		bool succeeded = false;
+		ShaderBytecode bytecode;
+		std::string error;
+	};
 
-		It is currently redundantly recompiling shaders. It does it more than once (since its recompiling for every pipeline).
-		As recompilation is a cold-feature (for rare debug or rapid experimentation), I'll just ignore this for now.
-	*/
-	if (graphics_pipe)
+	// One compilation per file and stage, shared by every shader object created from it
+	struct Reload
 	{
-		auto& pipelines = graphics_it->second;
-		/*
-			we recompile everything for every pipeline that is related to the reloaded shader.
-			if we e.g change output of VS, changes in HS/DS/GS/PS (input) is likely to be changed as well.
-			So lets just recompile em all, even if it is slightly redundant
-		*/
-		for (auto& p : pipelines)
-		{
-			auto existing_pipeline = m_pipelines.look_up(p.hdl);
+		ShaderStage stage;
+		std::string fname;
+		std::vector<Shader*> shaders;
+		std::future<Compiled> compiled;
+	};
+	std::vector<Reload> reloads;
 
-			// get filenames to all shaders in the pipelines
-			auto existing_vs = m_shaders.look_up(existing_pipeline->m_vs.hdl);
-			auto existing_ps = m_shaders.look_up(existing_pipeline->m_ps.hdl);
-			const auto& vs_name = existing_vs->m_blob.fname;
-			const auto& ps_name = existing_ps->m_blob.fname;
+	auto add_shader = [&](res_handle hdl)
+	{
+		if (hdl == 0)
+			return;
 
-			// compile shaders
-			compile_and_create_shader(ShaderStage::eVertex, vs_name, existing_vs, true);
-			compile_and_create_shader(ShaderStage::ePixel, ps_name, existing_ps, true);
+		auto shader = m_shaders.look_up(hdl);
+		if (fnames.count(shader->m_blob.fname) == 0)
+			return;
 
-			if (existing_pipeline->m_gs.hdl != 0)
+		auto it = std::find_if(reloads.begin(), reloads.end(), [&](const Reload& reload)
 			{
-				auto existing_gs = m_shaders.look_up(existing_pipeline->m_gs.hdl);
-				if (const auto& gs_name = existing_gs->m_blob.fname; !gs_name.empty())
-					compile_and_create_shader(ShaderStage::eGeometry, gs_name, existing_gs, true);
-			}
+				return reload.stage == shader->get_stage() && reload.fname == shader->m_blob.fname;
+			});
+		if (it == reloads.end())
+		{
+			reloads.push_back(Reload{ shader->get_stage(), shader->m_blob.fname });
+			it = std::prev(reloads.end());
+		}
+		if (std::find(it->shaders.cbegin(), it->shaders.cend(), shader) == it->shaders.cend())
+			it->shaders.push_back(shader);
+	};
 
-			if (existing_pipeline->m_hs.hdl != 0)
-			{
-				auto existing_hs = m_shaders.look_up(existing_pipeline->m_hs.hdl);
-				if (const auto& hs_name = existing_hs->m_blob.fname; !hs_name.empty())
-					compile_and_create_shader(ShaderStage::eHull, hs_name, existing_hs, true);
-			}
+	// Only shaders used by pipelines are reachable (and matter)
+	std::set<res_handle> pipelines, compute_pipelines;
+	for (const auto& fname : fnames)
+	{
+		if (auto it = m_loaded_pipelines.find(fname); it != m_loaded_pipelines.end())
+		{
+			for (const auto& p : it->second)
+				pipelines.insert(p.hdl);
+		}
+		if (auto it = m_loaded_compute_pipelines.find(fname); it != m_loaded_compute_pipelines.end())
+		{
+			for (const auto& p : it->second)
+				compute_pipelines.insert(p.hdl);
+		}
+	}
+
+	for (auto hdl : pipelines)
+	{
+		auto pipeline = m_pipelines.look_up(hdl);
+		add_shader(pipeline->m_vs.hdl);
+		add_shader(pipeline->m_ps.hdl);
+		add_shader(pipeline->m_gs.hdl);
+		add_shader(pipeline->m_hs.hdl);
+		add_shader(pipeline->m_ds.hdl);
+	}
+	for (auto hdl : compute_pipelines)
+		add_shader(m_compute_pipelines.look_up(hdl)->cs.hdl);
 
-			if (existing_pipeline->m_ds.hdl != 0)
+	for (auto& reload : reloads)
+	{
+		reload.compiled = jobs::pool->submit([this, stage = reload.stage, fname = reload.fname]()
 			{
-				auto existing_ds = m_shaders.look_up(existing_pipeline->m_ds.hdl);
-				if (const auto& ds_name = existing_ds->m_blob.fname; !ds_name.empty())
-					compile_and_create_shader(ShaderStage::eDomain, ds_name, existing_ds, true);
-			}
-		}
+				Compiled compiled;
+				compiled.succeeded = compile_shader(stage, fname, &compiled.bytecode, compiled.error);
+				return compiled;
+			});
 	}
-	else // compute
+
+	// Failed shaders keep their previous bytecode
+	std::set<const Shader*> recreated;
+	for (auto& reload : reloads)
 	{
-		ShaderBytecode bc;
-		compile_shader(ShaderStage::eCompute, fname, &bc, true);
+		const auto compiled = jobs::pool->wait(reload.compiled);
+		if (!compiled.succeeded)
+		{
+			++stats.failures;
+			OutputDebugStringA(compiled.error.c_str());
+			fmt::print(fg(fmt::color::red), "Failed to reload {}:\n{}\n", reload.fname, compiled.error);
+			continue;
+		}
 
-		auto& pipelines = compute_it->second;
-		for (auto& p : pipelines)
+		++stats.shaders;
+		for (auto shader : reload.shaders)
 		{
-			auto existing_pipeline = m_compute_pipelines.look_up(p.hdl);
-			auto existing_cs = m_shaders.look_up(existing_pipeline->cs.hdl);
-			
-			// simply recreate internal resource without modifying handles
-			create_shader(ShaderStage::eCompute, bc, existing_cs);
+			create_shader(reload.stage, compiled.bytecode, shader);
+			recreated.insert(shader);
 		}
 	}
 
+	// Handles stay valid, the input layout is the only state created against a shader (VS signature)
+	auto is_recreated = [&](res_handle hdl) { return hdl != 0 && recreated.count(m_shaders.look_up(hdl)) != 0; };
+	for (auto hdl : pipelines)
+	{
+		auto pipeline = m_pipelines.look_up(hdl);
+		if (!is_recreated(pipeline->m_vs.hdl) && !is_recreated(pipeline->m_ps.hdl) && !is_recreated(pipeline->m_gs.hdl) &&
+			!is_recreated(pipeline->m_hs.hdl) && !is_recreated(pipeline->m_ds.hdl))
+			continue;
+
+		if (auto desc = m_loaded_pipeline_descs.find(hdl); desc != m_loaded_pipeline_descs.end())
+			create_pipeline(desc->second, pipeline);
+		++stats.pipelines;
+	}
+	for (auto hdl : compute_pipelines)
+	{
+		if (is_recreated(m_compute_pipelines.look_up(hdl)->cs.hdl))
+			++stats.pipelines;
+	}
+
+	stats.ms = timer.elapsed();
+	fmt::print("Reloaded {}: {} shader(s) recompiled, {} failed, {} pipeline(s) rebuilt in {:.1f} ms\n",
+		path, stats.shaders, stats.failures, stats.pipelines, stats.ms);
+	return stats;
+}
+
+std::vector<std::filesystem::path> GfxDevice::get_shader_directories() const
+{
+	std::lock_guard lock(m_shader_dependencies_mutex);
+
+	std::set<std::filesystem::path> directories;
+	for (const auto& [file, fnames] : m_shader_dependents)
+	{
+		if (!fnames.empty())
+			directories.insert(std::filesystem::path(file).parent_path());
+	}
+	return { directories.begin(), directories.end() };
+}
+
+void GfxDevice::set_shader_dependencies(const std::string& fname, const std::vector<std::filesystem::path>& files)
+{
+	std::lock_guard lock(m_shader_dependencies_mutex);
+
+	// Includes may have been added or removed since the last compilation
+	auto& dependencies = m_shader_dependencies[fname];
+	for (const auto& file : dependencies)
+		m_shader_dependents[file].erase(fname);
+	dependencies.clear();
+
+	for (const auto& file : files)
+	{
+		dependencies.push_back(file.generic_string());
+		m_shader_dependents[dependencies.back()].insert(fname);
+	}
 }
 
 
@@ -308,46 +400,52 @@ GPUAnnotator* GfxDevice::get_annotator()
 	return m_annotator.get();
 }
 
-std::pair<UINT, UINT> GfxDevice::get_sc_dim()
+void GfxDevice::enable_recording(bool serialize_stream)
 {
-	auto sc_desc = m_dev->get_sc_desc();
-	return { sc_desc.BufferDesc.Width, sc_desc.BufferDesc.Height };
+	if (!m_recorder)
+		m_recorder = make_unique<GfxCallRecorder>(serialize_stream);
+	else
+		m_recorder->set_serialize_stream(serialize_stream);
 }
 
-void GfxDevice::resize_swapchain(UINT width, UINT height)
+void GfxDevice::disable_recording()
 {
-	// Release the primitive texture
-	auto bb = m_textures.look_up(m_backbuffer.hdl);
-	bb->m_internal_resource.ReleaseAndGetAddressOf();
-	bb->m_rtv.ReleaseAndGetAddressOf();
+	m_recorder.reset();
+}
 
-	// Recreate
-	m_dev->resize_swapchain(width, height);
+GfxCallRecorder* GfxDevice::get_recorder()
+{
+	return m_recorder.get();
+}
 
-	// Retrieve new swapchain resources
-	bb->m_internal_resource = m_dev->get_bb_texture();
-	bb->m_rtv = m_dev->get_bb_target();
-	bb->m_type = TextureType::e2D;
+bool GfxDevice::is_headless() const
+{
+	return m_backend->get_dx_device() == nullptr;
 }
 
-void set_name_internal(GPUType* device_child, const std::string& name)
+std::pair<UINT, UINT> GfxDevice::get_sc_dim()
 {
-	HRCHECK(device_child->m_internal_resource->SetPrivateData(WKPDID_D3DDebugObjectName, (UINT)name.size(), name.data()));
+	return m_backend->get_sc_dim();
+}
+
+void GfxDevice::resize_swapchain(UINT width, UINT height)
+{
+	m_backend->resize_swapchain(width, height, m_textures.look_up(m_backbuffer.hdl));
 }
 
 void GfxDevice::set_name(BufferHandle res, const std::string& name)
 {
-	set_name_internal(m_buffers.look_up(res.hdl), name);
+	m_backend->set_name(m_buffers.look_up(res.hdl), name);
 }
 
 void GfxDevice::set_name(TextureHandle res, const std::string& name)
 {
-	set_name_internal(m_textures.look_up(res.hdl), name);
+	m_backend->set_name(m_textures.look_up(res.hdl), name);
 }
 
 void GfxDevice::set_name(SamplerHandle res, const std::string& name)
 {
-	set_name_internal(m_samplers.look_up(res.hdl), name);
+	m_backend->set_name(m_samplers.look_up(res.hdl), name);
 }
 
 
@@ -360,6 +458,7 @@ ShaderHandle GfxDevice::compile_and_create_shader(ShaderStage stage, const std::
 	auto [hdl, shader] = m_shaders.get_next_free_handle();
 	shader->handle = hdl;
 	compile_and_create_shader(stage, fname, shader);
+	track(GfxCall::eCreateShader);
 	return ShaderHandle{ hdl };
 }
 
@@ -368,6 +467,7 @@ ShaderHandle GfxDevice::create_shader(ShaderStage stage, const ShaderBytecode& b
 	auto [hdl, shader] = m_shaders.get_next_free_handle();
 	shader->handle = hdl;
 	create_shader(stage, bytecode, shader);
+	track(GfxCall::eCreateShader);
 	return ShaderHandle{ hdl };
 }
 
@@ -375,29 +475,81 @@ SamplerHandle GfxDevice::create_sampler(const SamplerDesc& desc)
 {
 	auto [hdl, sampler] = m_samplers.get_next_free_handle();
 	sampler->handle = hdl;
-	create_sampler(desc, sampler);
+	m_backend->create_sampler(desc, sampler);
+	track(GfxCall::eCreateSampler);
 	return SamplerHandle{ hdl };
 }
 
 TextureHandle GfxDevice::create_texture(const TextureDesc& desc, std::optional<SubresourceData> subres)
+{
+	std::vector<SubresourceData> subresources;
+	if (subres)
+		subresources.push_back(*subres);
+	return create_texture(desc, subresources);
+}
+
+TextureHandle GfxDevice::create_texture(const TextureDesc& desc, const std::vector<SubresourceData>& subres)
 {
 	auto [hdl, texture] = m_textures.get_next_free_handle();
 	texture->handle = hdl;
 	create_texture(desc, texture, subres);
+	track(GfxCall::eCreateTexture);
 	return TextureHandle{ hdl };
 }
 
+void GfxDevice::replace_texture(TextureHandle hdl, const TextureDesc& desc, const std::vector<SubresourceData>& subres)
+{
+	auto texture = m_textures.look_up(hdl.hdl);
+	texture->free();
+	create_texture(desc, texture, subres);
+	track(GfxCall::eCreateTexture);
+	forget_bound_texture(hdl);
+}
+
+void GfxDevice::trim_texture(TextureHandle hdl, const TextureDesc& desc, UINT first_mip)
+{
+	auto texture = m_textures.look_up(hdl.hdl);
+
+	GPUTexture trimmed;
+	create_texture(desc, &trimmed);
+	track(GfxCall::eCreateTexture);
+
+	// Copied before the old resource goes away, no CPU side data or disk read needed
+	for (UINT mip = 0; mip < desc.m_desc.MipLevels; ++mip)
+		m_backend->copy_resource_region(&trimmed, CopyRegionDst(mip), texture, first_mip + mip);
+	track(GfxCall::eCopyRegion, true, m_textures, hdl.hdl);
+
+	trimmed.handle = texture->handle;
+	*texture = std::move(trimmed);
+	forget_bound_texture(hdl);
+}
+
+void GfxDevice::forget_bound_texture(TextureHandle hdl)
+{
+	for (auto& stage : m_bound_read_textures)
+	{
+		for (auto& bound : stage)
+		{
+			if (bound.hdl == hdl.hdl)
+				bound = TextureHandle{0};
+		}
+	}
+}
+
 PipelineHandle GfxDevice::create_pipeline(const PipelineDesc& desc)
 {
 	auto [hdl, pipeline] = m_pipelines.get_next_free_handle();
 	pipeline->handle = hdl;
 	create_pipeline(desc, pipeline);
+	track(GfxCall::eCreatePipeline);
 
 	auto ret_hdl = PipelineHandle{ hdl };
 
 	// Add to lookup for reloading
 	if (m_reloading_on)
 	{
+		m_loaded_pipeline_descs.insert({ hdl, desc });
+
 		// add pipeline to lookup table
 		auto load_to_cache = [&](const std::string& fname)
 		{
@@ -445,6 +597,7 @@ ComputePipelineHandle GfxDevice::create_compute_pipeline(const ComputePipelineDe
 	
 	pipeline->cs = desc.m_cs;
 	pipeline->is_registered = true;
+	track(GfxCall::eCreateComputePipeline);
 
 	auto ret_hdl = ComputePipelineHandle{ hdl };
 
@@ -472,6 +625,7 @@ RenderPassHandle GfxDevice::create_renderpass(const RenderPassDesc& desc)
 	auto [hdl, rp] = m_renderpasses.get_next_free_handle();
 	rp->handle = hdl;
 	create_renderpass(desc, rp);
+	track(GfxCall::eCreateRenderPass);
 	return RenderPassHandle{ hdl };
 }
 
@@ -479,7 +633,8 @@ BufferHandle GfxDevice::create_buffer(const BufferDesc& desc, std::optional<Subr
 {
 	auto [hdl, buffer] = m_buffers.get_next_free_handle();
 	buffer->handle = hdl;
-	create_buffer(desc, buffer, subres);
+	m_backend->create_buffer(desc, buffer, subres);
+	track(GfxCall::eCreateBuffer);
 	return BufferHandle{ hdl };
 }
 
@@ -488,31 +643,44 @@ BufferHandle GfxDevice::create_buffer(const BufferDesc& desc, std::optional<Subr
 
 void GfxDevice::free_buffer(BufferHandle hdl)
 {
+	track(GfxCall::eFree, true, m_buffers, hdl.hdl);
 	m_buffers.free_handle(hdl.hdl);
 }
 
 void GfxDevice::free_texture(TextureHandle hdl)
 {
+	track(GfxCall::eFree, true, m_textures, hdl.hdl);
 	m_textures.free_handle(hdl.hdl);
 }
 
+void GfxDevice::discard_texture(TextureHandle hdl)
+{
+	track(GfxCall::eFree, true, m_textures, hdl.hdl);
+	m_textures.look_up(hdl.hdl)->free();
+	forget_bound_texture(hdl);
+}
+
 void GfxDevice::free_sampler(SamplerHandle hdl)
 {
+	track(GfxCall::eFree, true, m_samplers, hdl.hdl);
 	m_samplers.free_handle(hdl.hdl);
 }
 
 void GfxDevice::free_shader(ShaderHandle hdl)
 {
+	track(GfxCall::eFree, true, m_shaders, hdl.hdl);
 	m_shaders.free_handle(hdl.hdl);
 }
 
 void GfxDevice::free_pipeline(PipelineHandle hdl)
 {
+	track(GfxCall::eFree, true, m_pipelines, hdl.hdl);
 	m_pipelines.free_handle(hdl.hdl);
 }
 
 void GfxDevice::free_renderpass(RenderPassHandle hdl)
 {
+	track(GfxCall::eFree, true, m_renderpasses, hdl.hdl);
 	m_renderpasses.free_handle(hdl.hdl);
 }
 
@@ -520,6 +688,7 @@ void GfxDevice::free_renderpass(RenderPassHandle hdl)
 
 void GfxDevice::begin_pass(RenderPassHandle rp, DepthStencilClear ds_clear)
 {
+	track(GfxCall::eBeginPass, true, m_renderpasses, rp.hdl);
 	begin_pass(m_renderpasses.look_up(rp.hdl), ds_clear);
 }
 
@@ -527,44 +696,9 @@ void GfxDevice::end_pass()
 {
 	assert(m_inside_pass == true);
 	m_inside_pass = false;
-	auto& ctx = m_dev->get_context();
-
-	// set render targets / raster uavs 
-	if (m_raster_rw_range_this_pass > 0)
-	{
-		ctx->OMSetRenderTargetsAndUnorderedAccessViews(
-			gfxconstants::MAX_RENDER_TARGETS, (ID3D11RenderTargetView* const*)gfxconstants::NULL_RESOURCE, nullptr,
-			0, gfxconstants::MAX_BOUND_UAVS, (ID3D11UnorderedAccessView* const*)gfxconstants::NULL_RESOURCE, nullptr);
-		m_raster_rw_range_this_pass = 0;
-	}
-	else
-	{
-		ctx->OMSetRenderTargets(gfxconstants::MAX_RENDER_TARGETS, (ID3D11RenderTargetView* const*)gfxconstants::NULL_RESOURCE, nullptr);
-	}
-
-
-	// resolve any ms targets if any
-	if (!m_active_rp->m_resolve_targets.empty())
-	{
-		for (int i = 0; i < m_active_rp->m_targets.size(); ++i)
-		{
-			auto src = (ID3D11Texture2D*)m_textures.look_up(std::get<TextureHandle>(m_active_rp->m_targets[i]).hdl)->m_internal_resource.Get();
-			auto dst = (ID3D11Texture2D*)m_textures.look_up(m_active_rp->m_resolve_targets[i].hdl)->m_internal_resource.Get();
-			auto format = std::get<DXGI_FORMAT>(m_active_rp->m_targets[i]);
-			ctx->ResolveSubresource(dst, 0, src, 0, format);
-		}
-	}
-
-	// TO-DO: resolve depth target using compute shader
-	// https://wickedengine.net/2016/11/13/how-to-resolve-an-msaa-depthbuffer/#comments
-
-	ctx->VSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
-	ctx->HSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
-	ctx->DSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
-	ctx->GSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
-	ctx->PSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
-
+	track(GfxCall::eEndPass);
 
+	m_backend->end_pass(m_active_rp, get_pass_targets(m_active_rp));
 	m_active_rp = nullptr;
 }
 
@@ -572,13 +706,14 @@ void GfxDevice::end_pass()
 
 void GfxDevice::bind_compute_pipeline(ComputePipelineHandle pipeline)
 {
+	track(GfxCall::eBindComputePipeline, true, m_compute_pipelines, pipeline.hdl);
 	const auto p = m_compute_pipelines.look_up(pipeline.hdl);
-	const auto cs = m_shaders.look_up(p->cs.hdl);
-	m_dev->get_context()->CSSetShader((ID3D11ComputeShader*)cs->m_internal_resource.Get(), nullptr, 0);
+	m_backend->bind_compute_shader(m_shaders.look_up(p->cs.hdl));
 }
 
 void GfxDevice::bind_pipeline(PipelineHandle pipeline, std::array<FLOAT, 4> blend_factor, UINT stencil_ref)
 {
+	track(GfxCall::eBindPipeline, !m_curr_pipeline || m_curr_pipeline->handle != pipeline.hdl, m_pipelines, pipeline.hdl);
 	bind_pipeline(m_pipelines.look_up(pipeline.hdl), blend_factor, stencil_ref);
 }
 
@@ -594,33 +729,34 @@ void GfxDevice::bind_vertex_buffers(UINT start_slot, const std::vector<std::tupl
 		if (buffer_handle.hdl == m_bound_vbs[start_slot + i].hdl)
 			++identical;
 	}
+	if (m_recorder)
+	{
+		bool valid = true;
+		for (const auto& bso : buffers_strides_offsets)
+			valid &= m_buffers.is_valid(std::get<BufferHandle>(bso).hdl);
+		m_recorder->record(GfxCall::eBindVertexBuffers, identical != buffers_strides_offsets.size(), std::get<BufferHandle>(buffers_strides_offsets[0]).hdl, valid, start_slot);
+	}
+
 	if (identical == buffers_strides_offsets.size())
 		return;
 
 
 	// Refactor this later. We want to remove the redundant Handle -> GPUBuffer -> D3D11Resource
 	assert(buffers_strides_offsets.size() <= 12);
-	ID3D11Buffer* vbs[gfxconstants::MAX_INPUT_SLOTS] = {};
+	const GPUBuffer* vbs[gfxconstants::MAX_INPUT_SLOTS] = {};
 	UINT strides[gfxconstants::MAX_INPUT_SLOTS] = {};
 	UINT offsets[gfxconstants::MAX_INPUT_SLOTS] = {};
 	for (int i = 0; i < buffers_strides_offsets.size(); ++i)
 	{
 		const auto& buffer_handle = std::get<BufferHandle>(buffers_strides_offsets[i]);
-		vbs[i] = (ID3D11Buffer*)(m_buffers.look_up(buffer_handle.hdl)->m_internal_resource.Get());
+		vbs[i] = m_buffers.look_up(buffer_handle.hdl);
 		strides[i] = std::get<1>(buffers_strides_offsets[i]);
 		offsets[i] = std::get<2>(buffers_strides_offsets[i]);
 
 		m_bound_vbs[start_slot + i] = buffer_handle;
 	}
 
-	m_dev->get_context()->IASetVertexBuffers(
-		start_slot, (UINT)buffers_strides_offsets.size(), 
-		vbs,
-		strides ? strides : (UINT*)gfxconstants::NULL_RESOURCE,
-		offsets ? offsets : (UINT*)gfxconstants::NULL_RESOURCE);
-
-	
-
+	m_backend->bind_vertex_buffers(start_slot, (UINT)buffers_strides_offsets.size(), vbs, strides, offsets);
 }
 
 void GfxDevice::bind_vertex_buffers(UINT start_slot, void* buffers_strides_offsets, uint8_t count)
@@ -644,73 +780,86 @@ void GfxDevice::bind_vertex_buffers(UINT start_slot, void* buffers_strides_offse
 		if (buffer_handle.hdl == m_bound_vbs[start_slot + i].hdl)
 			++identical;
 	}
+	if (m_recorder)
+	{
+		bool valid = true;
+		for (int i = 0; i < count; ++i)
+			valid &= m_buffers.is_valid(bso[i].hdl.hdl);
+		m_recorder->record(GfxCall::eBindVertexBuffers, identical != count, bso[0].hdl.hdl, valid, start_slot);
+	}
+
 	if (identical == count)
 		return;
 
 
 	// Refactor this later. We want to remove the redundant Handle -> GPUBuffer -> D3D11Resource
 	assert(count <= 12);
-	ID3D11Buffer* vbs[gfxconstants::MAX_INPUT_SLOTS] = {};
+	const GPUBuffer* vbs[gfxconstants::MAX_INPUT_SLOTS] = {};
 	UINT strides[gfxconstants::MAX_INPUT_SLOTS] = {};
 	UINT offsets[gfxconstants::MAX_INPUT_SLOTS] = {};
 	for (int i = 0; i < count; ++i)
 	{
 		const auto& buffer_handle = bso[i].hdl;
-		vbs[i] = (ID3D11Buffer*)(m_buffers.look_up(buffer_handle.hdl)->m_internal_resource.Get());
+		vbs[i] = m_buffers.look_up(buffer_handle.hdl);
 		strides[i] = bso[i].stride;
 		offsets[i] = bso[i].offset;
 
 		m_bound_vbs[start_slot + i] = buffer_handle;
 	}
 
-	m_dev->get_context()->IASetVertexBuffers(
-		start_slot, (UINT)count,
-		vbs,
-		strides ? strides : (UINT*)gfxconstants::NULL_RESOURCE,
-		offsets ? offsets : (UINT*)gfxconstants::NULL_RESOURCE);
+	m_backend->bind_vertex_buffers(start_slot, (UINT)count, vbs, strides, offsets);
 }
 
 
 
 void GfxDevice::bind_index_buffer(BufferHandle buffer, DXGI_FORMAT format, UINT offset)
 {
-	if (buffer.hdl == m_bound_ib.hdl)
+	const bool bound = buffer.hdl == m_bound_ib.hdl && format == m_bound_ib_format && offset == m_bound_ib_offset;
+	track(GfxCall::eBindIndexBuffer, !bound, m_buffers, buffer.hdl);
+	if (bound)
 		return;
-	m_dev->get_context()->IASetIndexBuffer((ID3D11Buffer*)m_buffers.look_up(buffer.hdl)->m_internal_resource.Get(), format, offset);
-
+	m_backend->bind_index_buffer(m_buffers.look_up(buffer.hdl), format, offset);
 	m_bound_ib = buffer;
+	m_bound_ib_format = format;
+	m_bound_ib_offset = offset;
 }
 
 void GfxDevice::map_copy(BufferHandle dst, const SubresourceData& data, D3D11_MAP map_type, UINT dst_subres_idx)
 {
+	track(GfxCall::eMapCopy, true, m_buffers, dst.hdl);
 	map_copy(m_buffers.look_up(dst.hdl), data, map_type, dst_subres_idx);
 }
 
 void GfxDevice::map_copy(TextureHandle dst, const SubresourceData& data, D3D11_MAP map_type, UINT dst_subres_idx)
 {
+	track(GfxCall::eMapCopy, true, m_textures, dst.hdl);
 	map_copy(m_textures.look_up(dst.hdl), data, map_type, dst_subres_idx);
 }
 
 void GfxDevice::update_subresource(BufferHandle dst, const SubresourceData& data, const D3D11_BOX& dst_box, UINT dst_subres_idx)
 {
-	update_subresource(m_buffers.look_up(dst.hdl), data, dst_box, dst_subres_idx);
+	track(GfxCall::eUpdateSubresource, true, m_buffers, dst.hdl);
+	m_backend->update_subresource(m_buffers.look_up(dst.hdl), data, dst_box, dst_subres_idx);
 }
 
 void GfxDevice::update_subresource(TextureHandle dst, const SubresourceData& data, const D3D11_BOX& dst_box, UINT dst_subres_idx)
 {
-	update_subresource(m_textures.look_up(dst.hdl), data, dst_box, dst_subres_idx);
+	track(GfxCall::eUpdateSubresource, true, m_textures, dst.hdl);
+	m_backend->update_subresource(m_textures.look_up(dst.hdl), data, dst_box, dst_subres_idx);
 }
 
 void GfxDevice::bind_constant_buffer(UINT slot, ShaderStage stage, BufferHandle buffer, UINT offset256s, UINT range256s)
 {
 	auto& curr_bound = m_bound_cbuffers[(UINT)stage - 1][slot];
 
-	if (std::get<BufferHandle>(curr_bound).hdl == buffer.hdl &&
+	const bool redundant = std::get<BufferHandle>(curr_bound).hdl == buffer.hdl &&
 		std::get<1>(curr_bound) == offset256s &&
-		std::get<2>(curr_bound) == range256s)
+		std::get<2>(curr_bound) == range256s;
+	track(GfxCall::eBindConstantBuffer, !redundant, m_buffers, buffer.hdl, slot);
+	if (redundant)
 		return;
 
-	bind_constant_buffer(slot, stage, m_buffers.look_up(buffer.hdl), offset256s, range256s);
+	m_backend->bind_constant_buffer(slot, stage, m_buffers.look_up(buffer.hdl), offset256s, range256s);
 	std::get<BufferHandle>(curr_bound) = buffer;
 	std::get<1>(curr_bound) = offset256s;
 	std::get<2>(curr_bound) = range256s;
@@ -718,48 +867,53 @@ void GfxDevice::bind_constant_buffer(UINT slot, ShaderStage stage, BufferHandle
 
 void GfxDevice::bind_resource(UINT slot, ShaderStage stage, BufferHandle resource)
 {
+	track(GfxCall::eBindResource, m_bound_read_bufs[(UINT)stage - 1][slot].hdl != resource.hdl, m_buffers, resource.hdl, slot);
 	if (m_bound_read_bufs[(UINT)stage - 1][slot].hdl == resource.hdl)
 		return;
-	bind_resource(slot, stage, m_buffers.look_up(resource.hdl));
+	m_backend->bind_resource(slot, stage, m_buffers.look_up(resource.hdl));
 	m_bound_read_bufs[(UINT)stage - 1][slot] = resource;
 }
 
 void GfxDevice::bind_resource(UINT slot, ShaderStage stage, TextureHandle resource)
 {
+	track(GfxCall::eBindResource, m_bound_read_textures[(UINT)stage - 1][slot].hdl != resource.hdl, m_textures, resource.hdl, slot);
 	if (m_bound_read_textures[(UINT)stage - 1][slot].hdl == resource.hdl)
 		return;
-	bind_resource(slot, stage, m_textures.look_up(resource.hdl));
+	m_backend->bind_resource(slot, stage, m_textures.look_up(resource.hdl));
 	m_bound_read_textures[(UINT)stage - 1][slot] = resource;
 }
 
 void GfxDevice::bind_resource_rw(UINT slot, ShaderStage stage, BufferHandle resource, UINT initial_count)
 {
-	bind_resource_rw(slot, stage, m_buffers.look_up(resource.hdl), initial_count);
+	track(GfxCall::eBindResourceRW, true, m_buffers, resource.hdl, slot);
+	m_backend->bind_resource_rw(slot, stage, m_buffers.look_up(resource.hdl), initial_count);
 }
 
 void GfxDevice::bind_resource_rw(UINT slot, ShaderStage stage, TextureHandle resource, UINT initial_count)
 {
-	bind_resource_rw(slot, stage, m_textures.look_up(resource.hdl), initial_count);
+	track(GfxCall::eBindResourceRW, true, m_textures, resource.hdl, slot);
+	m_backend->bind_resource_rw(slot, stage, m_textures.look_up(resource.hdl), initial_count);
 }
 
 void GfxDevice::bind_sampler(UINT slot, ShaderStage stage, SamplerHandle sampler)
 {
+	track(GfxCall::eBindSampler, m_bound_samplers[(UINT)stage - 1][slot].hdl != sampler.hdl, m_samplers, sampler.hdl, slot);
 	if (m_bound_samplers[(UINT)stage - 1][slot].hdl == sampler.hdl)
 		return;
-	bind_sampler(slot, stage, m_samplers.look_up(sampler.hdl));
+	m_backend->bind_sampler(slot, stage, m_samplers.look_up(sampler.hdl));
 	m_bound_samplers[(UINT)stage - 1][slot] = sampler;
 }
 
 void GfxDevice::bind_viewports(const std::vector<D3D11_VIEWPORT>& viewports)
 {
-	auto& ctx = m_dev->get_context();
-	ctx->RSSetViewports((UINT)viewports.size(), viewports.data());
+	track(GfxCall::eBindViewports);
+	m_backend->bind_viewports(viewports);
 }
 
 void GfxDevice::bind_scissors(const std::vector<D3D11_RECT>& rects)
 {
-	auto& ctx = m_dev->get_context();
-	ctx->RSSetScissorRects((UINT)rects.size(), rects.data());
+	track(GfxCall::eBindScissors);
+	m_backend->bind_scissors(rects);
 }
 
 
@@ -768,65 +922,45 @@ void GfxDevice::bind_scissors(const std::vector<D3D11_RECT>& rects)
 
 void GfxDevice::dispatch(UINT blocks_x, UINT blocks_y, UINT blocks_z)
 {
-	auto& ctx = m_dev->get_context();
-
-	ctx->Dispatch(blocks_x, blocks_y, blocks_z);
-
-	// https://on-demand.gputechconf.com/gtc/2010/presentations/S12312-DirectCompute-Pre-Conference-Tutorial.pdf
-	// How do you know when it is safe to Unbind UAVs from Compute Shader???
-	// Ans: Check GP Discord, DirectX section, answer from jwki
-	// No need to sync with Fence
-	// https://stackoverflow.com/questions/55005420/how-to-do-a-blocking-wait-for-a-compute-shader-with-direct3d11
-	ctx->CSSetUnorderedAccessViews(0, gfxconstants::MAX_BOUND_UAVS, (ID3D11UnorderedAccessView* const*)gfxconstants::NULL_RESOURCE, (const UINT*)gfxconstants::NULL_RESOURCE);
-	ctx->CSSetShaderResources(0, gfxconstants::MAX_SHADER_INPUT_RESOURCE_SLOTS, (ID3D11ShaderResourceView* const*)gfxconstants::NULL_RESOURCE);
+	track(GfxCall::eDispatch);
+	m_backend->dispatch(blocks_x, blocks_y, blocks_z);
 }
 
 void GfxDevice::draw(UINT vertex_count, UINT start_loc)
 {
 	assert(m_inside_pass == true && "Draw call must be inside a Pass scope!");
-	m_dev->get_context()->Draw(vertex_count, start_loc);
+	track(GfxCall::eDraw);
+	m_backend->draw(vertex_count, start_loc);
 }
 
 void GfxDevice::draw_indexed(UINT index_count, UINT index_start, UINT vertex_start)
 {
-	m_dev->get_context()->DrawIndexed(index_count, index_start, vertex_start);
+	track(GfxCall::eDrawIndexed);
+	m_backend->draw_indexed(index_count, index_start, vertex_start);
 }
 
 void GfxDevice::present(bool vsync)
 {
-	//m_profiler->begin("Presentation", false, false);
-	m_dev->get_sc()->Present(vsync ? 1 : 0, 0);
-	//m_profiler->end("Presentation");
+	track(GfxCall::ePresent);
+	m_backend->present(vsync);
 }
 
 void GfxDevice::copy_resource_region(BufferHandle dst, const CopyRegionDst& dst_desc, BufferHandle src, const CopyRegionSrc& src_desc)
 {
-	auto dst_b = (ID3D11Resource*)m_buffers.look_up(dst.hdl)->m_internal_resource.Get();
-	auto src_b = (ID3D11Resource*)m_buffers.look_up(src.hdl)->m_internal_resource.Get();
+	track(GfxCall::eCopyRegion, true, m_buffers, dst.hdl);
+	m_backend->copy_resource_region(m_buffers.look_up(dst.hdl), dst_desc, m_buffers.look_up(src.hdl), src_desc);
+}
 
-	m_dev->get_context()->CopySubresourceRegion1(
-		dst_b, dst_desc.m_subres, dst_desc.m_x, dst_desc.m_y, dst_desc.m_z,
-		src_b, src_desc.m_subres, &src_desc.m_box, src_desc.m_copy_flags);
+void GfxDevice::copy_resource_region(TextureHandle dst, const CopyRegionDst& dst_desc, TextureHandle src, UINT src_subres)
+{
+	track(GfxCall::eCopyRegion, true, m_textures, dst.hdl);
+	m_backend->copy_resource_region(m_textures.look_up(dst.hdl), dst_desc, m_textures.look_up(src.hdl), src_subres);
 }
 
 std::pair<float, float> GfxDevice::map_read_temp(BufferHandle buf)
 {
-	auto res = (ID3D11Resource*)m_buffers.look_up(buf.hdl)->m_internal_resource.Get();
-	D3D11_MAPPED_SUBRESOURCE subr;
-	m_dev->get_context()->Map(res, 0, D3D11_MAP_READ, 0, &subr);
-
-	float minmax[2] = { 0, 0 };
-	for (int i = 0; i < 2; ++i)
-	{
-		minmax[i] = ((float*)subr.pData)[i];
-	}
-
-	fmt::print("Min: {:.8f}, Max: {:.8f}\n", minmax[1], minmax[0]);
-
-
-	m_dev->get_context()->Unmap(res, 0);
-
-	return { minmax[0], minmax[1] };
+	track(GfxCall::eMapRead, true, m_buffers, buf.hdl);
+	return m_backend->map_read_temp(m_buffers.look_up(buf.hdl));
 }
 
 
@@ -844,505 +978,20 @@ std::pair<float, float> GfxDevice::map_read_temp(BufferHandle buf)
 */
 
 
-void GfxDevice::create_buffer(const BufferDesc& desc, GPUBuffer* buffer, std::optional<SubresourceData> subres)
+void GfxDevice::create_texture(const TextureDesc& desc, GPUTexture* texture, const std::vector<SubresourceData>& subres)
 {
 	const auto& d3d_desc = desc.m_desc;
-
-	HRCHECK(m_dev->get_device()->CreateBuffer(
-		&d3d_desc,
-		subres ? &subres->m_subres : nullptr,
-		(ID3D11Buffer**)buffer->m_internal_resource.ReleaseAndGetAddressOf()));
-
-	// constant buffers dont need views
-	if (desc.m_type == BufferType::eConstant)
-		return;
-
-	// Create views
-	if (d3d_desc.BindFlags & D3D11_BIND_SHADER_RESOURCE)
-	{
-		D3D11_SRV_DIMENSION view_dim = D3D11_SRV_DIMENSION_BUFFER;
-		UINT flags = 0;
-
-		auto srv_desc = D3D11_SHADER_RESOURCE_VIEW_DESC();
-		srv_desc.Format = DXGI_FORMAT_UNKNOWN;
-		srv_desc.ViewDimension = view_dim;
-		srv_desc.Buffer.FirstElement = desc.m_start_and_count.first;
-		srv_desc.Buffer.NumElements = desc.m_start_and_count.second;
-		
-		// Handle RAW BUFFER (BufferEx) some other time
-
-
-		m_dev->get_device()->CreateShaderResourceView(
-			(ID3D11Resource*)buffer->m_internal_resource.Get(),
-			&srv_desc,
-			buffer->m_srv.GetAddressOf());
-
-		//assert(false && "Buffer Shader Access view is not supported right now");
-	}
-	
-	if (d3d_desc.BindFlags & D3D11_BIND_UNORDERED_ACCESS)
-	{
-		D3D11_UAV_DIMENSION view_dim = D3D11_UAV_DIMENSION_BUFFER;
-		UINT flags = 0;
-
-		switch (desc.m_type)
-		{
-		case BufferType::eRaw:
-			flags = D3D11_BUFFER_UAV_FLAG_RAW;
-			break;
-		case BufferType::eAppendConsume:	// AppendConsume Structured Buffer
-			flags = D3D11_BUFFER_UAV_FLAG_APPEND;
-			flags |= D3D11_BUFFER_UAV_FLAG_COUNTER;		// enable access to Increment/DecrementCounter
-			break;
-
-
-		}
-
-		auto uav_desc = CD3D11_UNORDERED_ACCESS_VIEW_DESC
-		(
-			(ID3D11Buffer*)buffer->m_internal_resource.Get(),
-			DXGI_FORMAT_UNKNOWN, desc.m_start_and_count.first, desc.m_start_and_count.second, flags
-		);
-
-		// spec requirement https://docs.microsoft.com/en-us/windows/win32/api/d3d11/ne-d3d11-d3d11_buffer_uav_flag
-		if ((flags & D3D11_BUFFER_UAV_FLAG_COUNTER) == D3D11_BUFFER_UAV_FLAG_COUNTER)
-			assert(uav_desc.Format == DXGI_FORMAT_UNKNOWN);
-
-		m_dev->get_device()->CreateUnorderedAccessView(
-			(ID3D11Resource*)buffer->m_internal_resource.Get(),
-			&uav_desc,
-			buffer->m_uav.GetAddressOf());
-
-		//assert(false && "Buffer Unordered Access View is not supported right now");
-	}
-}
-
-void GfxDevice::create_texture(const TextureDesc& desc, GPUTexture* texture, std::optional<SubresourceData> subres)
-{
-	auto d3d_desc = desc.m_desc;
-
-	//texture->m_desc.m_type = desc.m_type;
-
-	// Grab misc. data
-	bool is_array = d3d_desc.ArraySize > 1 ? true : false;
 	bool ms_on = d3d_desc.SampleDesc.Count > 1 ? true : false;
-	bool is_cube = d3d_desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE ? true : false;
 	bool misc_gen_mips = d3d_desc.MiscFlags & D3D11_RESOURCE_MISC_GENERATE_MIPS ? true : false;
 
-	// auto gen using GenerateMips requires texture to be written to (other subres)
-	// we automatically append this incase user forgets
-	if (misc_gen_mips)
-		d3d_desc.BindFlags |= D3D11_BIND_RENDER_TARGET;
-
 	if (ms_on && d3d_desc.MipLevels != 1)
 		assert(false);		// https://docs.microsoft.com/en-us/windows/win32/api/d3d11/ns-d3d11-d3d11_texture2d_desc MipLevels = 1 required for MS
 
-	// check max multisample support
-	UINT max_sample_quality_levels = 0;
-	if (d3d_desc.SampleDesc.Count > 1)
-	{
-		m_dev->get_device()->CheckMultisampleQualityLevels(d3d_desc.Format, d3d_desc.SampleDesc.Count, &max_sample_quality_levels);
-		d3d_desc.SampleDesc.Quality = (std::min)(d3d_desc.SampleDesc.Quality, max_sample_quality_levels - 1);
-		std::cout << "Sample Quality: " << d3d_desc.SampleDesc.Quality << "\n";
-	}
-
-	// Create texture
-	switch (desc.m_type)
-	{
-	case TextureType::e1D:
-		assert(false && "Texture1D is not supported right now");
-		break;
-	case TextureType::e2D:
-	{
-		/*
-			Using Generate Mips Misc Flag disallows using initial data
-			https://stackoverflow.com/questions/53569263/directx-11-id3ddevicecreatetexture2d-with-initial-data-fail
-			We will load it at top-level manually through context
-		*/
-		HRCHECK(m_dev->get_device()->CreateTexture2D(
-			&d3d_desc,
-			!misc_gen_mips && subres ? &subres->m_subres : nullptr,
-			(ID3D11Texture2D**)texture->m_internal_resource.ReleaseAndGetAddressOf()));
-		break;
-	}
-	case TextureType::e3D:
-		assert(false && "Texture3D is not supported right now");
-		break;
-	default:
+	// Initial data has to cover every subresource (D3D11 reads MipLevels * ArraySize entries)
+	if (!misc_gen_mips && !subres.empty() && subres.size() != (size_t)d3d_desc.MipLevels * d3d_desc.ArraySize)
 		assert(false);
-		break;
-	}
-
-	texture->m_type = desc.m_type;
-	//texture->m_desc.m_desc = d3d_desc;
-
-	// Create views
-	if (d3d_desc.BindFlags & D3D11_BIND_SHADER_RESOURCE)
-	{
-		// Find dimension
-		D3D11_SRV_DIMENSION view_dim = D3D11_SRV_DIMENSION_UNKNOWN;
-		switch (desc.m_type)
-		{
-		case TextureType::e1D:
-			if (is_array)
-				view_dim = D3D11_SRV_DIMENSION_TEXTURE1DARRAY;
-			else
-				view_dim = D3D11_SRV_DIMENSION_TEXTURE1D;
-			break;
-		case TextureType::e2D:
-		{
-			if (is_array)
-			{
-				if (is_cube)
-				{
-					view_dim = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
-					break;
-				}
-
-				if (ms_on)
-					view_dim = D3D11_SRV_DIMENSION_TEXTURE2DMSARRAY;
-				else
-					view_dim = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
-			}
-			else
-			{
-				if (is_cube)
-				{
-					view_dim = D3D11_SRV_DIMENSION_TEXTURECUBE;
-					break;
-				}
-
-				if (ms_on)
-					view_dim = D3D11_SRV_DIMENSION_TEXTURE2DMS;
-				else
-					view_dim = D3D11_SRV_DIMENSION_TEXTURE2D;
-			}
-			break;
-		}
-		case TextureType::e3D:
-			view_dim = D3D11_SRV_DIMENSION_TEXTURE3D;
-			break;
-		default:
-			assert(false);
-			break;
-		}
-		if (view_dim == D3D11_SRV_DIMENSION_UNKNOWN)
-			assert(false);
-
-		// Create desc
-		D3D11_SHADER_RESOURCE_VIEW_DESC v_desc{};
-		switch (desc.m_type)
-		{
-		case TextureType::e1D:
-			assert(false && "SRV for Texture 1D is currently not supported");
-			break;
-		case TextureType::e2D:
-			v_desc = CD3D11_SHADER_RESOURCE_VIEW_DESC(
-				(ID3D11Texture2D*)texture->m_internal_resource.Get(),
-				view_dim,
-				DXGI_FORMAT_UNKNOWN,	// setting to unknown --> auto resolves to the underlying texture format
-				0,						// most detailed mip idx
-				-1,						// max mips down to the least detailed
-				0,						// first array slice	
-				-1);					// array size (auto calc from tex)
-
-			// Depth-stencil as read (read only depth part)
-			if (v_desc.Format == DXGI_FORMAT_R32_TYPELESS)
-				v_desc.Format = DXGI_FORMAT_R32_FLOAT;
-			else if (v_desc.Format == DXGI_FORMAT_R32G8X24_TYPELESS)
-				v_desc.Format = DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS;
-			else if (v_desc.Format == DXGI_FORMAT_R24G8_TYPELESS)
-				v_desc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
-			else if (v_desc.Format == DXGI_FORMAT_R16_TYPELESS)
-				v_desc.Format = DXGI_FORMAT_R16_UNORM;
-
-
-			break;
-		case TextureType::e3D:
-			assert(false && "SRV for Texture 3D is currently not supported");
-			break;
-		default:
-			assert(false);
-			break;
-		}
-
-		// Create view
-		HRCHECK(m_dev->get_device()->CreateShaderResourceView(
-			(ID3D11Resource*)texture->m_internal_resource.Get(),
-			&v_desc,
-			texture->m_srv.ReleaseAndGetAddressOf()
-		));
-
-		// Auto-gen mips
-		if (misc_gen_mips)
-		{
-			// Copy texture to top level first (initialization through CreateTexture2D is disabled when MISC_GEN_MIPS is on)
-
-			/*
-				We dont need to make staging resource because UpdateSubresource does that for us!
-				https://stackoverflow.com/questions/50396189/d3d11-usage-staging-what-kind-of-gpu-cpu-memory-is-used
-			*/
-			m_dev->get_context()->UpdateSubresource((ID3D11Texture2D*)texture->m_internal_resource.Get(),
-				0, nullptr, subres->m_subres.pSysMem, subres->m_subres.SysMemPitch, 0);
-
-			assert(d3d_desc.BindFlags & D3D11_BIND_RENDER_TARGET);
-			m_dev->get_context()->GenerateMips(texture->m_srv.Get());
-		}
-
-	}
-
-	if (d3d_desc.BindFlags & D3D11_BIND_RENDER_TARGET)
-	{
-		// Find dimension
-		D3D11_RTV_DIMENSION view_dim = D3D11_RTV_DIMENSION_UNKNOWN;
-		D3D11_RENDER_TARGET_VIEW_DESC v_desc{};
-		switch (desc.m_type)
-		{
-		case TextureType::e1D:
-			if (is_array)
-				view_dim = D3D11_RTV_DIMENSION_TEXTURE1DARRAY;
-			else
-				view_dim = D3D11_RTV_DIMENSION_TEXTURE1D;
-			break;
-		case TextureType::e2D:
-			if (is_array)
-			{
-				if (ms_on)
-					view_dim = D3D11_RTV_DIMENSION_TEXTURE2DMSARRAY;
-				else
-				{
-					view_dim = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
-				}
-			}
-			else
-			{
-				if (ms_on)
-					view_dim = D3D11_RTV_DIMENSION_TEXTURE2DMS;
-				else
-					view_dim = D3D11_RTV_DIMENSION_TEXTURE2D;
-			}
-			break;
-		case TextureType::e3D:
-			view_dim = D3D11_RTV_DIMENSION_TEXTURE3D;
-			break;
-		default:
-			assert(false);
-			break;
-		}
-		if (view_dim == D3D11_RTV_DIMENSION_UNKNOWN)
-			assert(false);
-
-		// Create desc
-		switch (desc.m_type)
-		{
-		case TextureType::e1D:
-			assert(false && "RTV for Texture 1D is currently not supported");
-			break;
-		case TextureType::e2D:
-
-			if (view_dim == D3D11_RTV_DIMENSION_TEXTURE2D)
-			{
-				v_desc = CD3D11_RENDER_TARGET_VIEW_DESC(
-					(ID3D11Texture2D*)texture->m_internal_resource.Get(),
-					view_dim,
-					DXGI_FORMAT_UNKNOWN,
-					0,
-					0,
-					-1);	// array size (auto calc from tex)
-			}
-			else if (view_dim == D3D11_RTV_DIMENSION_TEXTURE2DARRAY)
-			{
-				v_desc = CD3D11_RENDER_TARGET_VIEW_DESC(
-					(ID3D11Texture2D*)texture->m_internal_resource.Get(),
-					view_dim,
-					DXGI_FORMAT_UNKNOWN,
-					0,
-					0,						// start at subres idx 0
-					d3d_desc.ArraySize);	// array size
-			}
-			break;
-		case TextureType::e3D:
-			assert(false && "RTV for Texture 3D is currently not supported");
-			break;
-		default:
-			assert(false);
-			break;
-		}
-
-		// Create view
-		HRCHECK(m_dev->get_device()->CreateRenderTargetView(
-			(ID3D11Resource*)texture->m_internal_resource.Get(),
-			&v_desc,
-			texture->m_rtv.ReleaseAndGetAddressOf()
-		));
-	}
-
-	if (d3d_desc.BindFlags & D3D11_BIND_UNORDERED_ACCESS)
-	{
-		// Find dimension
-		D3D11_UAV_DIMENSION view_dim = D3D11_UAV_DIMENSION_UNKNOWN;
-		D3D11_UNORDERED_ACCESS_VIEW_DESC v_desc{};
-		switch (desc.m_type)
-		{
-		case TextureType::e1D:
-			if (is_array)
-				view_dim = D3D11_UAV_DIMENSION_TEXTURE1DARRAY;
-			else
-				view_dim = D3D11_UAV_DIMENSION_TEXTURE1D;
-			break;
-		case TextureType::e2D:
-			if (is_array)
-			{
-				view_dim = D3D11_UAV_DIMENSION_TEXTURE2DARRAY;
-			}
-			else
-			{
-				view_dim = D3D11_UAV_DIMENSION_TEXTURE2D;
-			}
-			break;
-		case TextureType::e3D:
-			view_dim = D3D11_UAV_DIMENSION_TEXTURE3D;
-			break;
-		default:
-			assert(false);
-			break;
-		}
-		if (view_dim == D3D11_UAV_DIMENSION_UNKNOWN)
-			assert(false);
-
-
-		// Create desc
-		switch (desc.m_type)
-		{
-		case TextureType::e1D:
-			assert(false && "UAV for Texture 1D is currently not supported");
-			break;
-		case TextureType::e2D:
-
-			if (view_dim == D3D11_UAV_DIMENSION_TEXTURE2D)
-			{
-				v_desc = CD3D11_UNORDERED_ACCESS_VIEW_DESC(
-					(ID3D11Texture2D*)texture->m_internal_resource.Get(),
-					view_dim,
-					DXGI_FORMAT_UNKNOWN,
-					0,
-					0,
-					-1);	// array size (auto calc from tex)
-			}
-			else if (view_dim == D3D11_UAV_DIMENSION_TEXTURE2DARRAY)
-			{
-				v_desc = CD3D11_UNORDERED_ACCESS_VIEW_DESC(
-					(ID3D11Texture2D*)texture->m_internal_resource.Get(),
-					view_dim,
-					DXGI_FORMAT_UNKNOWN,
-					0,
-					0,						// start at subres idx 0
-					d3d_desc.ArraySize);	// array size
-			}
-			break;
-		case TextureType::e3D:
-			assert(false && "UAV for Texture 3D is currently not supported");
-			break;
-		default:
-			assert(false);
-			break;
-		}
-
-		// Create view
-		HRCHECK(m_dev->get_device()->CreateUnorderedAccessView(
-			(ID3D11Resource*)texture->m_internal_resource.Get(),
-			&v_desc,
-			texture->m_uav.ReleaseAndGetAddressOf()
-		));
-	}
-
-	if (d3d_desc.BindFlags & D3D11_BIND_DEPTH_STENCIL)
-	{
-		// Find dimension
-		D3D11_DSV_DIMENSION view_dim = D3D11_DSV_DIMENSION_UNKNOWN;
-		switch (desc.m_type)
-		{
-		case TextureType::e1D:
-			if (is_array)
-				view_dim = D3D11_DSV_DIMENSION_TEXTURE1DARRAY;
-			else
-				view_dim = D3D11_DSV_DIMENSION_TEXTURE1D;
-			break;
-		case TextureType::e2D:
-			if (is_array)
-			{
-				if (ms_on)
-					view_dim = D3D11_DSV_DIMENSION_TEXTURE2DMSARRAY;
-				else
-					view_dim = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
-			}
-			else
-			{
-				if (ms_on)
-					view_dim = D3D11_DSV_DIMENSION_TEXTURE2DMS;
-				else
-					view_dim = D3D11_DSV_DIMENSION_TEXTURE2D;
-			}
-			break;
-		case TextureType::e3D:
-			assert(false);
-			break;
-		default:
-			assert(false);
-			break;
-		}
-		if (view_dim == D3D11_DSV_DIMENSION_UNKNOWN)
-			assert(false);
-
-		// Create desc
-		D3D11_DEPTH_STENCIL_VIEW_DESC v_desc{};
-		switch (desc.m_type)
-		{
-		case TextureType::e1D:
-			assert(false && "RTV for Texture 1D is currently not supported");
-			break;
-		case TextureType::e2D:
-			v_desc = CD3D11_DEPTH_STENCIL_VIEW_DESC(
-				(ID3D11Texture2D*)texture->m_internal_resource.Get(),
-				view_dim,
-				DXGI_FORMAT_UNKNOWN,
-				0,
-				0,
-				-1);	// array size (auto calc from tex)
-
-			// Interpret depth stencil 
-			if (v_desc.Format == DXGI_FORMAT_R32_TYPELESS)
-				v_desc.Format = DXGI_FORMAT_D32_FLOAT;
-			else if (v_desc.Format == DXGI_FORMAT_R32G8X24_TYPELESS)
-				v_desc.Format = DXGI_FORMAT_D32_FLOAT_S8X24_UINT;
-			else if (v_desc.Format == DXGI_FORMAT_R24G8_TYPELESS)
-				v_desc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-			else if (v_desc.Format == DXGI_FORMAT_R16_TYPELESS)
-				v_desc.Format = DXGI_FORMAT_D16_UNORM;
-
-			break;
-		case TextureType::e3D:
-			assert(false && "RTV for Texture 3D is currently not supported");
-			break;
-		default:
-			assert(false);
-			break;
-		}
-
-		// Create view
-		HRCHECK(m_dev->get_device()->CreateDepthStencilView(
-			(ID3D11Resource*)texture->m_internal_resource.Get(),
-			&v_desc,
-			texture->m_dsv.ReleaseAndGetAddressOf()
-		));
-	}
 
-}
-
-void GfxDevice::create_sampler(const SamplerDesc& desc, Sampler* sampler)
-{
-	HRCHECK(m_dev->get_device()->CreateSamplerState(&desc.m_sampler_desc,
-		(ID3D11SamplerState**)sampler->m_internal_resource.ReleaseAndGetAddressOf()));
+	m_backend->create_texture(desc, texture, subres);
 }
 
 void GfxDevice::create_shader(ShaderStage stage, const ShaderBytecode& bytecode, Shader* shader)
@@ -1353,36 +1002,7 @@ void GfxDevice::create_shader(ShaderStage stage, const ShaderBytecode& bytecode,
 		return;
 	}
 
-	switch (stage)
-	{
-	case ShaderStage::eVertex:
-		HRCHECK(m_dev->get_device()->CreateVertexShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11VertexShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
-		shader->m_stage = ShaderStage::eVertex;
-		shader->m_blob = bytecode;
-		break;
-	case ShaderStage::ePixel:
-		HRCHECK(m_dev->get_device()->CreatePixelShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11PixelShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
-		shader->m_stage = ShaderStage::ePixel;
-		break;
-	case ShaderStage::eHull:
-		HRCHECK(m_dev->get_device()->CreateHullShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11HullShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
-		shader->m_stage = ShaderStage::eHull;
-		break;
-	case ShaderStage::eDomain:
-		HRCHECK(m_dev->get_device()->CreateDomainShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11DomainShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
-		shader->m_stage = ShaderStage::eDomain;
-		break;
-	case ShaderStage::eGeometry:
-		HRCHECK(m_dev->get_device()->CreateGeometryShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11GeometryShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
-		shader->m_stage = ShaderStage::eGeometry;
-		break;
-	case ShaderStage::eCompute:
-		HRCHECK(m_dev->get_device()->CreateComputeShader(bytecode.code->data(), bytecode.code->size(), nullptr, (ID3D11ComputeShader**)shader->m_internal_resource.ReleaseAndGetAddressOf()));
-		shader->m_stage = ShaderStage::eCompute;
-		break;
-	}
-
-	shader->m_blob = bytecode;
+	m_backend->create_shader(stage, bytecode, shader);
 }
 
 void GfxDevice::create_renderpass(const RenderPassDesc& desc, RenderPass* RenderPass)
@@ -1402,8 +1022,7 @@ void GfxDevice::create_renderpass(const RenderPassDesc& desc, RenderPass* Render
 	{
 		const auto& tex = m_textures.look_up(std::get<TextureHandle>(desc.m_targets[0]).hdl);
 		assert(tex->m_type == TextureType::e2D);
-		D3D11_TEXTURE2D_DESC d3d_desc_0{};
-		((ID3D11Texture2D*)tex->m_internal_resource.Get())->GetDesc(&d3d_desc_0);
+		const auto d3d_desc_0 = m_backend->describe_texture(tex);
 		/*
 			https://docs.microsoft.com/en-us/windows/win32/api/d3d11/nf-d3d11-id3d11devicecontext-omsetrendertargets
 			If render targets use multisample anti-aliasing, all bound render targets and depth buffer
@@ -1421,20 +1040,15 @@ void GfxDevice::create_renderpass(const RenderPassDesc& desc, RenderPass* Render
 			{
 				const auto& other_tex = m_textures.look_up(std::get<TextureHandle>(desc.m_targets[i]).hdl);
 				assert(other_tex->m_type == TextureType::e2D);
-				D3D11_TEXTURE2D_DESC d3d_desc_n{};
-				((ID3D11Texture2D*)other_tex->m_internal_resource.Get())->GetDesc(&d3d_desc_n);
-
-				assert(d3d_desc_n.SampleDesc.Count == samp_count);
+				assert(m_backend->describe_texture(other_tex).SampleDesc.Count == samp_count);
 			}
 
 			// Verify with depth stencil target if exists
 			if (desc.m_depth_stencil_target.hdl != 0)
 			{
-				assert(m_textures.look_up(desc.m_depth_stencil_target.hdl)->m_type == TextureType::e2D);
-				D3D11_TEXTURE2D_DESC ds_desc{};
-				((ID3D11Texture2D*)m_textures.look_up(desc.m_depth_stencil_target.hdl)->m_internal_resource.Get())->GetDesc(&ds_desc);
-
-				assert(ds_desc.SampleDesc.Count == samp_count);
+				const auto& ds_tex = m_textures.look_up(desc.m_depth_stencil_target.hdl);
+				assert(ds_tex->m_type == TextureType::e2D);
+				assert(m_backend->describe_texture(ds_tex).SampleDesc.Count == samp_count);
 			}
 
 		}
@@ -1458,8 +1072,7 @@ void GfxDevice::create_renderpass(const RenderPassDesc& desc, RenderPass* Render
 	{
 		const auto& other_tex = m_textures.look_up(std::get<TextureHandle>(desc.m_targets[i]).hdl);
 		assert(other_tex->m_type == TextureType::e2D);
-		D3D11_TEXTURE2D_DESC d3d_desc_n{};
-		((ID3D11Texture2D*)other_tex->m_internal_resource.Get())->GetDesc(&d3d_desc_n);
+		const auto d3d_desc_n = m_backend->describe_texture(other_tex);
 
 		if (std::get<TextureHandle>(desc.m_targets[i]).hdl != 0)
 		{
@@ -1478,19 +1091,6 @@ void GfxDevice::create_renderpass(const RenderPassDesc& desc, RenderPass* Render
 
 void GfxDevice::create_pipeline(const PipelineDesc& desc, GraphicsPipeline* pipeline)
 {
-	auto& dev = m_dev->get_device();
-
-	// create rasterizer state (default state if user dont supply)
-	HRCHECK(dev->CreateRasterizerState1(&desc.m_rasterizer_desc.m_rasterizer_desc,
-		(ID3D11RasterizerState1**)pipeline->m_rasterizer.m_internal_resource.ReleaseAndGetAddressOf()));
-
-	// create blend state (default state if user dont supply)
-	HRCHECK(dev->CreateBlendState1(&desc.m_blend_desc.m_blend_desc,
-		(ID3D11BlendState1**)pipeline->m_blend.m_internal_resource.ReleaseAndGetAddressOf()));
-
-	HRCHECK(dev->CreateDepthStencilState(&desc.m_depth_stencil_desc.m_depth_stencil_desc,
-		(ID3D11DepthStencilState**)pipeline->m_depth_stencil.m_internal_resource.ReleaseAndGetAddressOf()));
-
 	// Check shader validity
 	auto vs = m_shaders.look_up(desc.m_vs.hdl);
 	auto ps = m_shaders.look_up(desc.m_ps.hdl);
@@ -1517,29 +1117,27 @@ void GfxDevice::create_pipeline(const PipelineDesc& desc, GraphicsPipeline* pipe
 	}
 
 
-	// create input layout (duplicates may be created here, we will ignore this for simplicity)
-	if (!desc.m_input_desc.m_input_descs.empty())
-	{
-		auto vs = m_shaders.look_up(desc.m_vs.hdl);
-
-		HRCHECK(dev->CreateInputLayout(
-			desc.m_input_desc.m_input_descs.data(),
-			(UINT)desc.m_input_desc.m_input_descs.size(),
-			vs->m_blob.code->data(),
-			(UINT)vs->m_blob.code->size(),
-			(ID3D11InputLayout**)pipeline->m_input_layout.m_internal_resource.ReleaseAndGetAddressOf()));
-	}
-
 	// add shaders
 	pipeline->m_vs = desc.m_vs;
 	pipeline->m_ps = desc.m_ps;
 
-
-	pipeline->m_is_registered = true;
+	m_backend->create_pipeline(desc, vs, pipeline);
 }
 
 
 
+PassTargets GfxDevice::get_pass_targets(const RenderPass* RenderPass)
+{
+	PassTargets targets;
+	for (int i = 0; i < RenderPass->m_targets.size(); ++i)
+		targets.targets[i] = m_textures.look_up(std::get<TextureHandle>(RenderPass->m_targets[i]).hdl);
+	for (int i = 0; i < RenderPass->m_resolve_targets.size(); ++i)
+		targets.resolve_targets[i] = m_textures.look_up(RenderPass->m_resolve_targets[i].hdl);
+	if (RenderPass->m_depth_stencil_target.hdl != 0)
+		targets.depth_stencil = m_textures.look_up(RenderPass->m_depth_stencil_target.hdl);
+	return targets;
+}
+
 void GfxDevice::begin_pass(const RenderPass* RenderPass, DepthStencilClear ds_clear)
 {
 	if (!RenderPass->m_is_registered)
@@ -1551,171 +1149,7 @@ void GfxDevice::begin_pass(const RenderPass* RenderPass, DepthStencilClear ds_cl
 	m_active_rp = RenderPass;
 	m_inside_pass = true;
 
-	auto& ctx = m_dev->get_context();
-	auto& depth_tex = RenderPass->m_depth_stencil_target;
-
-	// clear RenderPass and get render targets
-	ID3D11RenderTargetView* rtvs[gfxconstants::MAX_RENDER_TARGETS] = {};
-	for (int i = 0; i < RenderPass->m_targets.size(); ++i)
-	{
-		// get target
-		auto& target = RenderPass->m_targets[i];
-		if (std::get<TextureHandle>(target).hdl == 0)
-			break;
-		rtvs[i] = m_textures.look_up(std::get<TextureHandle>(target).hdl)->m_rtv.Get();
-
-		// clear target
-		ctx->ClearRenderTargetView(m_textures.look_up(std::get<TextureHandle>(target).hdl)->m_rtv.Get(), std::get<RenderTextureClear>(target).m_rgba.data());
-	}
-
-	ID3D11DepthStencilView* dsv = nullptr;
-	if (depth_tex.hdl != 0)
-	{
-		dsv = m_textures.look_up(depth_tex.hdl)->m_dsv.Get();
-		ctx->ClearDepthStencilView(dsv, ds_clear.m_clear_flags, ds_clear.m_depth, ds_clear.m_stencil);
-	}
-
-	if (m_raster_rw_range_this_pass > 0)
-	{
-		ctx->OMSetRenderTargetsAndUnorderedAccessViews(
-			gfxconstants::MAX_RENDER_TARGETS, rtvs, dsv,
-			0, gfxconstants::MAX_BOUND_UAVS, m_raster_uavs.data(), m_raster_uav_initial_counts.data());
-	}
-	else
-	{
-		ctx->OMSetRenderTargets(gfxconstants::MAX_RENDER_TARGETS, rtvs, dsv);
-	}
-
-}
-
-void GfxDevice::bind_constant_buffer(UINT slot, ShaderStage stage, const GPUBuffer* buffer, UINT offset256s, UINT range256s)
-{
-	ID3D11Buffer* cbs[] = { (ID3D11Buffer*)buffer->m_internal_resource.Get() };
-	auto& ctx = m_dev->get_context();
-
-	UINT first_constant = offset256s * 16;
-	UINT num_constants = range256s * 16;
-
-	switch (stage)
-	{
-	case ShaderStage::eVertex:
-		//ctx->VSSetConstantBuffers(slot, 1, cbs);
-		ctx->VSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
-		break;
-	case ShaderStage::ePixel:
-		//ctx->PSSetConstantBuffers(slot, 1, cbs);
-		ctx->PSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
-		break;
-	case ShaderStage::eHull:
-		//ctx->HSSetConstantBuffers(slot, 1, cbs);
-		ctx->HSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
-		break;
-	case ShaderStage::eDomain:
-		//ctx->DSSetConstantBuffers(slot, 1, cbs);
-		ctx->DSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
-		break;
-	case ShaderStage::eGeometry:
-		//ctx->GSSetConstantBuffers(slot, 1, cbs);
-		ctx->GSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
-		break;
-	case ShaderStage::eCompute:
-		//ctx->CSSetConstantBuffers(slot, 1, cbs);
-		ctx->CSSetConstantBuffers1(slot, 1, cbs, &first_constant, &num_constants);
-		break;
-	}
-}
-
-void GfxDevice::bind_resource(UINT slot, ShaderStage stage, const GPUResource* resource)
-{
-	ID3D11ShaderResourceView* srvs[] = { resource ? resource->m_srv.Get() : nullptr };
-	auto& ctx = m_dev->get_context();
-
-	switch (stage)
-	{
-	case ShaderStage::eVertex:
-		ctx->VSSetShaderResources(slot, 1, srvs);
-		break;
-	case ShaderStage::ePixel:
-		ctx->PSSetShaderResources(slot, 1, srvs);
-		break;
-	case ShaderStage::eHull:
-		ctx->HSSetShaderResources(slot, 1, srvs);
-		break;
-	case ShaderStage::eDomain:
-		ctx->DSSetShaderResources(slot, 1, srvs);
-		break;
-	case ShaderStage::eGeometry:
-		ctx->GSSetShaderResources(slot, 1, srvs);
-		break;
-	case ShaderStage::eCompute:
-		ctx->CSSetShaderResources(slot, 1, srvs);
-		break;
-	}
-}
-
-void GfxDevice::bind_resource_rw(UINT slot, ShaderStage stage, const GPUResource* resource, UINT initial_count)
-{
-	//assert(m_inside_pass == true && "Resource RWs must be bound prior to begin_pass()");
-
-	ID3D11UnorderedAccessView* uavs[] = { resource->m_uav.Get() };
-	auto& ctx = m_dev->get_context();
-
-	switch (stage)
-	{
-		// https://docs.microsoft.com/en-us/windows/win32/direct3d11/direct3d-11-1-features#use-uavs-at-every-pipeline-stage
-		// 11.1, use UAVs at every pipeline stage
-	case ShaderStage::eVertex:
-	case ShaderStage::ePixel:
-	case ShaderStage::eHull:
-	case ShaderStage::eDomain:
-	case ShaderStage::eGeometry:
-	{
-		m_raster_uavs[slot] = resource->m_uav.Get();
-		m_raster_uav_initial_counts[slot] = initial_count;
-		auto range = m_raster_rw_range_this_pass;
-		// https://github.com/assimp/assimp/issues/2271 paranthesis solves DEFINE NOMINMAX
-		m_raster_rw_range_this_pass = (std::max)(range, slot);
-		break;
-	}
-	case ShaderStage::eCompute:
-		ctx->CSSetUnorderedAccessViews(slot, 1, uavs, &initial_count);
-		break;
-	}
-
-}
-
-void GfxDevice::bind_sampler(UINT slot, ShaderStage stage, const Sampler* sampler)
-{
-	ID3D11SamplerState* samplers[] = { (ID3D11SamplerState*)sampler->m_internal_resource.Get() };
-	auto& ctx = m_dev->get_context();
-
-	switch (stage)
-	{
-	case ShaderStage::eVertex:
-		ctx->VSSetSamplers(slot, 1, samplers);
-		break;
-	case ShaderStage::ePixel:
-		ctx->PSSetSamplers(slot, 1, samplers);
-		break;
-	case ShaderStage::eHull:
-		ctx->HSSetSamplers(slot, 1, samplers);
-		break;
-	case ShaderStage::eDomain:
-		ctx->DSSetSamplers(slot, 1, samplers);
-		break;
-	case ShaderStage::eGeometry:
-		ctx->GSSetSamplers(slot, 1, samplers);
-		break;
-	case ShaderStage::eCompute:
-		ctx->CSSetSamplers(slot, 1, samplers);
-		break;
-	}
-}
-
-void GfxDevice::update_subresource(const GPUResource* dst, const SubresourceData& data, const D3D11_BOX& dst_box, UINT dst_subres_idx)
-{
-	m_dev->get_context()->UpdateSubresource((ID3D11Resource*)dst->m_internal_resource.Get(),
-		dst_subres_idx, &dst_box, data.m_subres.pSysMem, data.m_subres.SysMemPitch, data.m_subres.SysMemSlicePitch);
+	m_backend->begin_pass(RenderPass, get_pass_targets(RenderPass), ds_clear);
 }
 
 void GfxDevice::map_copy(const GPUResource* dst, const SubresourceData& data, D3D11_MAP map_type, UINT dst_subres_idx)
@@ -1724,11 +1158,7 @@ void GfxDevice::map_copy(const GPUResource* dst, const SubresourceData& data, D3
 		return;
 
 	assert(data.m_subres.pSysMem != nullptr && data.m_subres.SysMemPitch != 0);
-	auto& ctx = m_dev->get_context();
-	D3D11_MAPPED_SUBRESOURCE mapped_subres{};
-	HRCHECK(ctx->Map((ID3D11Resource*)dst->m_internal_resource.Get(), dst_subres_idx, map_type, 0, &mapped_subres));
-	std::memcpy(mapped_subres.pData, data.m_subres.pSysMem, data.m_subres.SysMemPitch);		// not handling slice pitch for now
-	ctx->Unmap((ID3D11Resource*)dst->m_internal_resource.Get(), dst_subres_idx);
+	m_backend->map_copy(dst, data, map_type, dst_subres_idx);
 }
 
 void GfxDevice::bind_pipeline(const GraphicsPipeline* pipeline, std::array<FLOAT, 4> blend_factor, UINT stencil_ref)
@@ -1746,37 +1176,9 @@ void GfxDevice::bind_pipeline(const GraphicsPipeline* pipeline, std::array<FLOAT
 
 	m_curr_pipeline = pipeline;
 
-	auto& ctx = m_dev->get_context();
-
-	if (pipeline->m_input_layout.is_valid())
-		ctx->IASetInputLayout((ID3D11InputLayout*)pipeline->m_input_layout.m_internal_resource.Get());
-	else
-		ctx->IASetInputLayout(nullptr);
-
-
-	// bind shaders
-	ctx->VSSetShader((ID3D11VertexShader*)m_shaders.look_up(pipeline->m_vs.hdl)->m_internal_resource.Get(), nullptr, 0);
-	ctx->PSSetShader((ID3D11PixelShader*)m_shaders.look_up(pipeline->m_ps.hdl)->m_internal_resource.Get(), nullptr, 0);
-
-	if (pipeline->m_gs.hdl != 0)
-		ctx->GSSetShader((ID3D11GeometryShader*)m_shaders.look_up(pipeline->m_gs.hdl)->m_internal_resource.Get(), nullptr, 0);
-	else
-		ctx->GSSetShader(nullptr, nullptr, 0);
-
-	if (pipeline->m_hs.hdl != 0)
-		ctx->HSSetShader((ID3D11HullShader*)m_shaders.look_up(pipeline->m_hs.hdl)->m_internal_resource.Get(), nullptr, 0);
-	else
-		ctx->HSSetShader(nullptr, nullptr, 0);
-
-	if (pipeline->m_ds.hdl != 0)
-		ctx->DSSetShader((ID3D11DomainShader*)m_shaders.look_up(pipeline->m_ds.hdl)->m_internal_resource.Get(), nullptr, 0);
-	else
-		ctx->DSSetShader(nullptr, nullptr, 0);
-
-	ctx->IASetPrimitiveTopology(pipeline->m_topology);
-	ctx->RSSetState((ID3D11RasterizerState*)pipeline->m_rasterizer.m_internal_resource.Get());
-	ctx->OMSetDepthStencilState((ID3D11DepthStencilState*)pipeline->m_depth_stencil.m_internal_resource.Get(), stencil_ref);
-	ctx->OMSetBlendState((ID3D11BlendState*)pipeline->m_blend.m_internal_resource.Get(), blend_factor.data(), pipeline->m_sample_mask);
+	auto optional_shader = [&](ShaderHandle hdl) -> const Shader* { return hdl.hdl != 0 ? m_shaders.look_up(hdl.hdl) : nullptr; };
+	m_backend->bind_pipeline(pipeline,
+		{ m_shaders.look_up(pipeline->m_vs.hdl), m_shaders.look_up(pipeline->m_ps.hdl),
+		  optional_shader(pipeline->m_gs), optional_shader(pipeline->m_hs), optional_shader(pipeline->m_ds) },
+		blend_factor, stencil_ref);
 }
-
-
@@ -44,11 +44,31 @@ void ImGuiDevice::start_docking()
     ImGui::DockSpaceOverViewport(ImGui::GetMainViewport(), flags);
 }
 
-ImGuiDevice::ImGuiDevice(GfxDevice* dev)
+ImGuiDevice::ImGuiDevice(GfxDevice* dev) :
+    m_headless(dev->is_headless())
 {
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
+
+    /*
+        Headless: no platform/renderer backends.
+        UI callbacks still run every frame (they are part of the CPU cost we want to measure),
+        the draw data is simply never submitted.
+    */
+    if (m_headless)
+    {
+        auto [width, height] = dev->get_sc_dim();
+        io.DisplaySize = ImVec2((float)width, (float)height);
+        io.IniFilename = nullptr;
+        io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+
+        unsigned char* pixels = nullptr;
+        int tex_w = 0, tex_h = 0;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &tex_w, &tex_h);
+        return;
+    }
+
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;       // Enable Keyboard Controls
     io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;           // Enable Docking
     io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;         // Enable Multi-Viewport / Platform Windows
@@ -67,13 +87,20 @@ ImGuiDevice::ImGuiDevice(GfxDevice* dev)
     }
 
     // Setup Platform/Renderer backends
-    ImGui_ImplWin32_Init(dev->m_dev->get_hwnd());
-    ImGui_ImplDX11_Init(dev->m_dev->get_device().Get(), dev->m_dev->get_context().Get());
+    auto dx_dev = dev->m_backend->get_dx_device();
+    ImGui_ImplWin32_Init(dx_dev->get_hwnd());
+    ImGui_ImplDX11_Init(dx_dev->get_device().Get(), dx_dev->get_context().Get());
 
 }
 
 ImGuiDevice::~ImGuiDevice()
 {
+    if (m_headless)
+    {
+        ImGui::DestroyContext();
+        return;
+    }
+
     ImGui_ImplWin32_Shutdown();
     ImGui_ImplDX11_Shutdown();
     ImGui::DestroyContext();
@@ -82,8 +109,13 @@ ImGuiDevice::~ImGuiDevice()
 void ImGuiDevice::begin_frame()
 {
     // Start the Dear ImGui frame
-    ImGui_ImplDX11_NewFrame();
-    ImGui_ImplWin32_NewFrame();
+    if (m_headless)
+        ImGui::GetIO().DeltaTime = 1.f / 60.f;
+    else
+    {
+        ImGui_ImplDX11_NewFrame();
+        ImGui_ImplWin32_NewFrame();
+    }
     ImGui::NewFrame();
 
     start_docking();
@@ -103,7 +135,8 @@ void ImGuiDevice::draw()
         ImGUI sets its own Viewport, which is based on the swapchain backbuffer size
     */
     ImGui::Render();
-    ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+    if (!m_headless)
+        ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
 }
 
 void ImGuiDevice::end_frame()
@@ -122,6 +155,9 @@ extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg
 
 bool ImGuiDevice::win_proc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
+    if (m_headless)
+        return false;
+
     if (ImGui_ImplWin32_WndProcHandler(hwnd, uMsg, wParam, lParam))
         return true;
     return false;
@@ -0,0 +1,71 @@
+#include "pch.h"
+#include "Graphics/API/ShaderBatch.h"
+#include "Graphics/API/GfxDevice.h"
+#include "Profiler/StartupProfiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace jobs { extern ThreadPool* pool; }
+
+ShaderBatch::ShaderBatch(GfxDevice* dev, const std::vector<Source>& sources) :
+	m_dev(dev)
+{
+	m_entries.reserve(sources.size());
+	for (const auto& source : sources)
+	{
+		auto duplicate = std::find_if(m_entries.cbegin(), m_entries.cend(), [&](const Entry& entry)
+			{
+				return entry.source.stage == source.stage && entry.source.fname == source.fname;
+			});
+		if (duplicate != m_entries.cend())
+			continue;
+
+		Entry entry;
+		entry.source = source;
+		entry.compiled = jobs::pool->submit([dev, source]()
+			{
+				auto _ = StartupProfiler::Scoped("Shader: " + source.fname.string(), "shader");
+				Compiled compiled;
+				compiled.succeeded = dev->compile_shader(source.stage, source.fname, &compiled.bytecode, compiled.error);
+				return compiled;
+			});
+		m_entries.push_back(std::move(entry));
+	}
+}
+
+ShaderBatch::~ShaderBatch()
+{
+	for (auto& entry : m_entries)
+	{
+		if (entry.compiled.valid())
+			jobs::pool->wait(entry.compiled);
+	}
+}
+
+ShaderHandle ShaderBatch::get(ShaderStage stage, const std::filesystem::path& fname)
+{
+	auto it = std::find_if(m_entries.begin(), m_entries.end(), [&](const Entry& entry) { return entry.source.stage == stage && entry.source.fname == fname; });
+	if (it == m_entries.end())
+	{
+		assert(false);		// not part of the batch
+		return ShaderHandle{};
+	}
+
+	auto& entry = *it;
+	if (entry.created)
+		return entry.handle;
+
+	const auto compiled = jobs::pool->wait(entry.compiled);
+	entry.created = true;
+	if (!compiled.succeeded)
+	{
+		++m_failures;
+		OutputDebugStringA(compiled.error.c_str());
+		fmt::print(fg(fmt::color::red), "Failed to compile {}:\n{}\n", fname.string(), compiled.error);
+		assert(false);
+		return entry.handle;
+	}
+
+	entry.handle = m_dev->create_shader(entry.source.stage, compiled.bytecode);
+	return entry.handle;
+}
@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "Graphics/API/ShaderCache.h"
+#include "Timer.h"
+#include "VirtualFile.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
+namespace
+{
+	struct CacheHeader
+	{
+		char magic[4] = { 'D', 'X', 'S', 'C' };
+		uint32_t version = ShaderCache::VERSION;
+		uint64_t key = 0;
+		uint64_t bytecode_size = 0;
+		float compile_ms = 0.f;
+		uint32_t pad = 0;
+	};
+	static_assert(sizeof(CacheHeader) == 32);
+
+	void gather_files_recursive(const std::filesystem::path& file, std::vector<std::filesystem::path>& files, std::set<std::string>& visited)
+	{
+		const auto normal = file.lexically_normal();
+		if (!visited.insert(normal.generic_string()).second)
+			return;
+		files.push_back(normal);
+
+		VirtualFile source(normal);
+		if (!source.is_open())
+			return;
+
+		// Conservative: includes inside comments or inactive branches are followed too
+		const std::string_view text((const char*)source.data(), source.size());
+		for (size_t pos = text.find("#include"); pos != std::string_view::npos; pos = text.find("#include", pos + 1))
+		{
+			const auto line = text.substr(pos, text.find('\n', pos) - pos);
+			const size_t open = line.find('"');
+			const size_t close = open != std::string_view::npos ? line.find('"', open + 1) : std::string_view::npos;
+			if (close == std::string_view::npos)
+				continue;		// <system> includes aren't part of the shader sources
+
+			gather_files_recursive(normal.parent_path() / std::string(line.substr(open + 1, close - open - 1)), files, visited);
+		}
+	}
+}
+
+ShaderCache::ShaderCache(ShaderCompiler* compiler, const std::filesystem::path& directory) :
+	m_compiler(compiler),
+	m_directory(directory)
+{
+}
+
+std::vector<std::filesystem::path> ShaderCache::gather_files(const std::filesystem::path& source)
+{
+	std::vector<std::filesystem::path> files;
+	std::set<std::string> visited;
+	gather_files_recursive(source, files, visited);
+	return files;
+}
+
+uint64_t ShaderCache::compute_key(const ShaderCompileRequest& request) const
+{
+	return compute_key(request, gather_files(request.path));
+}
+
+uint64_t ShaderCache::compute_key(const ShaderCompileRequest& request, const std::vector<std::filesystem::path>& files) const
+{
+	if (files.empty())
+		return 0;
+
+	const uint64_t compiler_version = m_compiler->get_version();
+	uint64_t key = utils::hash_bytes(&VERSION, sizeof(VERSION));
+	key = utils::hash_bytes(&compiler_version, sizeof(compiler_version), key);
+	key = utils::hash_bytes(request.entry.data(), request.entry.size(), key);
+	key = utils::hash_bytes(request.target.data(), request.target.size(), key);
+	key = utils::hash_bytes(&request.flags, sizeof(request.flags), key);
+
+	for (const auto& file : files)
+	{
+		// A missing include still contributes its name, the compile fails and is not cached anyway
+		const auto name = file.generic_string();
+		key = utils::hash_bytes(name.data(), name.size(), key);
+
+		VirtualFile contents(file);
+		if (contents.is_open())
+			key = utils::hash_bytes(contents.data(), contents.size(), key);
+		else if (&file == &files.front())
+			return 0;
+	}
+	return key != 0 ? key : 1;
+}
+
+std::filesystem::path ShaderCache::get_cache_path(const ShaderCompileRequest& request) const
+{
+	const auto source = request.path.lexically_normal().generic_string();
+	uint64_t slot = utils::hash_bytes(source.data(), source.size());
+	slot = utils::hash_bytes(request.entry.data(), request.entry.size(), slot);
+	slot = utils::hash_bytes(request.target.data(), request.target.size(), slot);
+	slot = utils::hash_bytes(&request.flags, sizeof(request.flags), slot);
+
+	// e.g shaders/gpassVS.hlsl --> cooked/shaders/gpassVS.hlsl.0123456789abcdef.cso
+	return m_directory / fmt::format("{}.{:016x}.cso", request.path.filename().string(), slot);
+}
+
+bool ShaderCache::load(const std::filesystem::path& path, uint64_t key, std::vector<uint8_t>& bytecode, float& compile_ms) const
+{
+	VirtualFile file(path);
+	if (!file.is_open() || file.size() < sizeof(CacheHeader))
+		return false;
+
+	CacheHeader hdr;
+	std::memcpy(&hdr, file.data(), sizeof(hdr));
+	if (std::memcmp(hdr.magic, CacheHeader().magic, sizeof(hdr.magic)) != 0 || hdr.version != VERSION || hdr.key != key ||
+		hdr.bytecode_size == 0 || hdr.bytecode_size != file.size() - sizeof(CacheHeader))
+		return false;
+
+	bytecode.assign(file.data() + sizeof(CacheHeader), file.data() + file.size());
+	compile_ms = hdr.compile_ms;
+	return true;
+}
+
+bool ShaderCache::store(const std::filesystem::path& path, uint64_t key, const std::vector<uint8_t>& bytecode, float compile_ms) const
+{
+	CacheHeader hdr;
+	hdr.key = key;
+	hdr.bytecode_size = bytecode.size();
+	hdr.compile_ms = compile_ms;
+
+	std::error_code ec;
+	std::filesystem::create_directories(path.parent_path(), ec);
+
+	// Write to a temporary first so a partially written file is never picked up
+	auto tmp_path = path;
+	tmp_path += ".tmp";
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+		file.write((const char*)&hdr, sizeof(hdr));
+		file.write((const char*)bytecode.data(), bytecode.size());
+		if (!file.good())
+			return false;
+	}
+
+	std::filesystem::rename(tmp_path, path, ec);
+	return !ec;
+}
+
+ShaderCache::Stats ShaderCache::get_stats() const
+{
+	std::lock_guard lock(m_stats_mutex);
+	return m_stats;
+}
+
+bool ShaderCache::compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& error, std::vector<std::filesystem::path>* files)
+{
+	Timer lookup_timer;
+	std::vector<std::filesystem::path> sources;
+	if (m_enabled || files)
+		sources = gather_files(request.path);
+	const uint64_t key = m_enabled ? compute_key(request, sources) : 0;
+	if (files)
+		*files = sources;
+	const auto cache_path = get_cache_path(request);
+
+	float recorded_ms = 0.f;
+	const bool hit = key != 0 && load(cache_path, key, bytecode, recorded_ms);
+	const float lookup_ms = lookup_timer.elapsed();
+	if (hit)
+	{
+		std::lock_guard lock(m_stats_mutex);
+		++m_stats.requests;
+		++m_stats.hits;
+		m_stats.lookup_ms += lookup_ms;
+		m_stats.saved_ms += (std::max)(recorded_ms - lookup_ms, 0.f);
+		return true;
+	}
+
+	Timer compile_timer;
+	const bool compiled = m_compiler->compile(request, bytecode, error);
+	const float compile_ms = compile_timer.elapsed();
+	{
+		std::lock_guard lock(m_stats_mutex);
+		++m_stats.requests;
+		m_stats.lookup_ms += lookup_ms;
+		m_stats.compile_ms += compile_ms;
+		++(compiled ? m_stats.compiles : m_stats.failures);
+	}
+	if (!compiled)
+		return false;
+
+	if (key != 0 && !store(cache_path, key, bytecode, compile_ms))
+		fmt::print(fg(fmt::color::red), "Failed to write shader cache entry {}\n", cache_path.string());
+	return true;
+}
@@ -0,0 +1,100 @@
+#include "pch.h"
+#include "Graphics/API/ShaderCompiler.h"
+#include "Graphics/API/DXDevice.h"
+#include "VirtualFile.h"
+
+namespace
+{
+	// Resolves includes relative to the including file like D3D_COMPILE_STANDARD_FILE_INCLUDE, but through VirtualFile
+	class VirtualFileInclude : public ID3DInclude
+	{
+	public:
+		VirtualFileInclude(const std::filesystem::path& source, const VirtualFile& file)
+		{
+			m_directories.insert({ file.data(), source.parent_path() });
+		}
+
+		HRESULT __stdcall Open(D3D_INCLUDE_TYPE, LPCSTR file_name, LPCVOID parent_data, LPCVOID* data, UINT* bytes) override
+		{
+			auto parent = m_directories.find(parent_data);
+			const auto path = (parent != m_directories.end() ? parent->second : std::filesystem::path()) / file_name;
+
+			auto file = make_unique<VirtualFile>(path);
+			if (!file->is_open())
+				return E_FAIL;
+
+			*data = file->data();
+			*bytes = (UINT)file->size();
+			m_directories.insert({ file->data(), path.parent_path() });
+			m_files.push_back(std::move(file));
+			return S_OK;
+		}
+
+		// Included files stay open until the compilation is done
+		HRESULT __stdcall Close(LPCVOID) override
+		{
+			return S_OK;
+		}
+
+	private:
+		std::map<const void*, std::filesystem::path> m_directories;		// file contents --> directory its includes are relative to
+		std::vector<unique_ptr<VirtualFile>> m_files;
+	};
+}
+
+bool D3DShaderCompiler::compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& error)
+{
+	VirtualFile source(request.path);
+	if (!source.is_open())
+	{
+		error = "Failed to read " + request.path.string();
+		return false;
+	}
+
+	VirtualFileInclude include(request.path, source);
+	BlobPtr shader_blob;
+	BlobPtr error_blob;
+	auto HR = D3DCompile(
+		source.data(), source.size(),
+		request.path.string().c_str(),		// file name in the compiler messages
+		nullptr,
+		&include,
+		request.entry.c_str(),
+		request.target.c_str(),
+		request.flags, 0,
+		shader_blob.ReleaseAndGetAddressOf(), error_blob.ReleaseAndGetAddressOf()
+	);
+	if (FAILED(HR) || !shader_blob)
+	{
+		error = error_blob ? (const char*)error_blob->GetBufferPointer() : "Failed to compile " + request.path.string();
+		return false;
+	}
+
+	bytecode.resize(shader_blob->GetBufferSize());
+	std::memcpy(bytecode.data(), shader_blob->GetBufferPointer(), shader_blob->GetBufferSize());
+	return true;
+}
+
+uint64_t D3DShaderCompiler::get_version() const
+{
+	return D3D_COMPILER_VERSION;
+}
+
+bool StubShaderCompiler::compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& error)
+{
+	VirtualFile source(request.path);
+	if (!source.is_open())
+	{
+		error = "Failed to read " + request.path.string();
+		return false;
+	}
+
+	uint64_t hash = utils::hash_bytes(source.data(), source.size());
+	hash = utils::hash_bytes(request.entry.data(), request.entry.size(), hash);
+	hash = utils::hash_bytes(request.target.data(), request.target.size(), hash);
+	hash = utils::hash_bytes(&request.flags, sizeof(request.flags), hash);
+
+	bytecode.resize(sizeof(hash));
+	std::memcpy(bytecode.data(), &hash, sizeof(hash));
+	return true;
+}
@@ -0,0 +1,71 @@
+#include "pch.h"
+#include "Graphics/AssetReloader.h"
+#include "Graphics/API/GfxDevice.h"
+#include "Graphics/MaterialManager.h"
+#include "Graphics/ModelManager.h"
+#include <algorithm>
+#include <cctype>
+
+AssetReloader::AssetReloader(GfxDevice* dev, MaterialManager* mat_mgr, ModelManager* model_mgr, const std::vector<std::filesystem::path>& directories) :
+	m_dev(dev),
+	m_mat_mgr(mat_mgr),
+	m_model_mgr(model_mgr)
+{
+	for (const auto& directory : directories)
+	{
+		if (!std::filesystem::is_directory(directory))
+			continue;
+		m_watchers.push_back(make_unique<FileWatcher>(directory, FileWatcher::Settings()));
+	}
+
+	// Shaders also include headers from outside the asset directories (e.g ../inc/DepthDefines.h)
+	FileWatcher::Settings include_settings;
+	include_settings.recursive = false;
+	for (const auto& directory : m_dev->get_shader_directories())
+	{
+		const bool watched = std::any_of(m_watchers.cbegin(), m_watchers.cend(), [&](const auto& watcher)
+			{
+				const auto relative = directory.lexically_relative(watcher->get_directory().lexically_normal());
+				return !relative.empty() && *relative.begin() != "..";
+			});
+		if (!watched && std::filesystem::is_directory(directory))
+			m_watchers.push_back(make_unique<FileWatcher>(directory, include_settings));
+	}
+}
+
+void AssetReloader::update()
+{
+	for (auto& watcher : m_watchers)
+	{
+		for (const auto& file : watcher->poll())
+			reload(file);
+	}
+}
+
+void AssetReloader::reload(const std::filesystem::path& file)
+{
+	auto extension = file.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	if (extension == ".hlsl" || extension == ".hlsli" || extension == ".h")
+	{
+		const auto stats = m_dev->reload_shaders(file);
+		if (stats.shaders + stats.failures > 0)
+			++m_stats.shader_files;
+		else
+			++m_stats.ignored;
+	}
+	else if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp")
+	{
+		if (m_mat_mgr->reload_texture(file))
+			++m_stats.textures;
+		else
+			++m_stats.ignored;
+	}
+	else
+	{
+		const uint32_t models = m_model_mgr->reload_models(file);
+		m_stats.models += models;
+		m_stats.ignored += models == 0 ? 1 : 0;
+	}
+}
@@ -0,0 +1,238 @@
+#include "pch.h"
+#include "Graphics/BakedModel.h"
+#include <cstring>
+
+namespace
+{
+	constexpr uint64_t s_alignment = 16;
+
+	uint64_t align_up(uint64_t offset)
+	{
+		return (offset + s_alignment - 1) & ~(s_alignment - 1);
+	}
+
+	uint64_t hash_file(const std::filesystem::path& path, uint64_t seed)
+	{
+		VirtualFile file(path);
+		if (!file.is_open())
+			return seed;
+		return utils::hash_bytes(file.data(), file.size(), seed);
+	}
+
+	// Material libraries referenced by an .obj ("mtllib <file>" lines)
+	std::vector<std::filesystem::path> get_obj_material_libs(const std::filesystem::path& source, const VirtualFile& file)
+	{
+		std::vector<std::filesystem::path> libs;
+
+		const auto begin = (const char*)file.data();
+		const auto end = begin + file.size();
+		static constexpr std::string_view keyword = "mtllib ";
+
+		for (auto line = begin; line < end;)
+		{
+			auto line_end = (const char*)std::memchr(line, '\n', end - line);
+			if (!line_end)
+				line_end = end;
+
+			if ((size_t)(line_end - line) > keyword.size() && std::string_view(line, keyword.size()) == keyword)
+			{
+				auto name = std::string(line + keyword.size(), line_end);
+				while (!name.empty() && (name.back() == '\r' || name.back() == ' '))
+					name.pop_back();
+				libs.push_back(source.parent_path() / name);
+			}
+
+			line = line_end + 1;
+		}
+		return libs;
+	}
+}
+
+uint64_t BakedModel::hash_source(const std::filesystem::path& source)
+{
+	VirtualFile file(source);
+	if (!file.is_open())
+		return 0;
+
+	auto hash = utils::hash_bytes(file.data(), file.size());
+	if (source.extension() == ".obj")
+	{
+		for (const auto& lib : get_obj_material_libs(source, file))
+			hash = hash_file(lib, hash);
+	}
+	return hash != 0 ? hash : 1;
+}
+
+std::filesystem::path BakedModel::get_cooked_path(const std::filesystem::path& source)
+{
+	auto cooked = std::filesystem::path(COOKED_DIRECTORY) / source.relative_path();
+	cooked += ".dxbm";
+	return cooked;
+}
+
+bool BakedModel::cook(const ModelSourceView& source, uint64_t source_hash, const std::filesystem::path& out_path)
+{
+	// String table
+	std::string strings;
+	auto add_string = [&strings](const std::filesystem::path& path)
+	{
+		const auto offset = (uint32_t)strings.size();
+		strings += path.string();
+		strings.push_back('\0');
+		return offset;
+	};
+
+	std::vector<Material> materials;
+	for (const auto& mat : source.materials)
+	{
+		const auto& paths = std::get<AssimpMaterialData::PhongPaths>(mat.file_paths);
+		materials.push_back({ add_string(paths.diffuse), add_string(paths.normal), add_string(paths.specular), add_string(paths.opacity) });
+	}
+
+	// Layout
+	Header hdr{};
+	hdr.source_hash = source_hash;
+	hdr.vertex_count = source.vertex_count;
+	hdr.uv_count = source.uv_count;
+	hdr.index_bytes = source.index_bytes;
+	hdr.mesh_count = (uint32_t)source.meshes.size();
+	hdr.cluster_count = source.cluster_count;
+	hdr.lod_count = source.lod_count;
+	hdr.material_count = (uint32_t)materials.size();
+
+	uint64_t offset = align_up(sizeof(Header));
+	auto place = [&offset](uint64_t& section_offset, uint64_t size)
+	{
+		section_offset = offset;
+		offset = align_up(offset + size);
+	};
+
+	place(hdr.positions_offset, (uint64_t)source.vertex_count * 3 * sizeof(float));
+	place(hdr.uvs_offset, (uint64_t)source.uv_count * 2 * sizeof(float));
+	place(hdr.normals_offset, (uint64_t)source.vertex_count * 3 * sizeof(float));
+	place(hdr.indices_offset, source.index_bytes);
+	place(hdr.meshes_offset, source.meshes.size() * sizeof(AssimpMeshData));
+	place(hdr.clusters_offset, (uint64_t)source.cluster_count * sizeof(MeshCluster));
+	place(hdr.lods_offset, (uint64_t)source.lod_count * sizeof(MeshLod));
+	place(hdr.materials_offset, materials.size() * sizeof(Material));
+	place(hdr.strings_offset, strings.size());
+	hdr.strings_size = strings.size();
+	hdr.file_size = offset;
+
+	// Fill
+	std::vector<uint8_t> blob(hdr.file_size, 0);
+	auto write = [&blob](uint64_t at, const void* data, size_t size)
+	{
+		if (size > 0)
+			std::memcpy(blob.data() + at, data, size);
+	};
+
+	write(0, &hdr, sizeof(Header));
+	write(hdr.positions_offset, source.positions, (size_t)source.vertex_count * 3 * sizeof(float));
+	write(hdr.uvs_offset, source.uvs, (size_t)source.uv_count * 2 * sizeof(float));
+	write(hdr.normals_offset, source.normals, (size_t)source.vertex_count * 3 * sizeof(float));
+	write(hdr.indices_offset, source.indices, (size_t)source.index_bytes);
+	write(hdr.meshes_offset, source.meshes.data(), source.meshes.size() * sizeof(AssimpMeshData));
+	write(hdr.clusters_offset, source.clusters, (size_t)source.cluster_count * sizeof(MeshCluster));
+	write(hdr.lods_offset, source.lods, (size_t)source.lod_count * sizeof(MeshLod));
+	write(hdr.materials_offset, materials.data(), materials.size() * sizeof(Material));
+	write(hdr.strings_offset, strings.data(), strings.size());
+
+	// Write to a temporary first so a partially written file is never picked up
+	std::error_code ec;
+	std::filesystem::create_directories(out_path.parent_path(), ec);
+
+	auto tmp_path = out_path;
+	tmp_path += ".tmp";
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+		file.write((const char*)blob.data(), blob.size());
+		if (!file.good())
+			return false;
+	}
+
+	std::filesystem::rename(tmp_path, out_path, ec);
+	return !ec;
+}
+
+BakedModel::BakedModel(const std::filesystem::path& path) :
+	m_file(path)
+{
+	if (!m_file.is_open() || m_file.size() < sizeof(Header))
+		return;
+
+	const auto hdr = get_header();
+	if (std::memcmp(hdr->magic, Header().magic, sizeof(hdr->magic)) != 0 || hdr->version != VERSION || hdr->file_size != m_file.size())
+		return;
+
+	// Sections must lie within the file
+	auto in_file = [&](uint64_t offset, uint64_t size) { return offset <= m_file.size() && size <= m_file.size() - offset; };
+	m_well_formed =
+		in_file(hdr->positions_offset, (uint64_t)hdr->vertex_count * 3 * sizeof(float)) &&
+		in_file(hdr->uvs_offset, (uint64_t)hdr->uv_count * 2 * sizeof(float)) &&
+		in_file(hdr->normals_offset, (uint64_t)hdr->vertex_count * 3 * sizeof(float)) &&
+		in_file(hdr->indices_offset, hdr->index_bytes) &&
+		in_file(hdr->meshes_offset, (uint64_t)hdr->mesh_count * sizeof(AssimpMeshData)) &&
+		in_file(hdr->clusters_offset, (uint64_t)hdr->cluster_count * sizeof(MeshCluster)) &&
+		in_file(hdr->lods_offset, (uint64_t)hdr->lod_count * sizeof(MeshLod)) &&
+		in_file(hdr->materials_offset, (uint64_t)hdr->material_count * sizeof(Material)) &&
+		in_file(hdr->strings_offset, hdr->strings_size) &&
+		(hdr->strings_size == 0 || m_file.data()[hdr->strings_offset + hdr->strings_size - 1] == '\0');
+}
+
+const BakedModel::Header* BakedModel::get_header() const
+{
+	return (const Header*)m_file.data();
+}
+
+bool BakedModel::is_valid(uint64_t source_hash) const
+{
+	return m_well_formed && source_hash != 0 && get_header()->source_hash == source_hash;
+}
+
+ModelSourceView BakedModel::get_view() const
+{
+	assert(m_well_formed);
+
+	const auto base = m_file.data();
+	const auto hdr = get_header();
+
+	ModelSourceView view;
+	view.positions = (const float*)(base + hdr->positions_offset);
+	view.uvs = (const float*)(base + hdr->uvs_offset);
+	view.normals = (const float*)(base + hdr->normals_offset);
+	view.vertex_count = hdr->vertex_count;
+	view.uv_count = hdr->uv_count;
+	view.indices = base + hdr->indices_offset;
+	view.index_bytes = hdr->index_bytes;
+
+	const auto meshes = (const AssimpMeshData*)(base + hdr->meshes_offset);
+	view.meshes.assign(meshes, meshes + hdr->mesh_count);
+
+	view.clusters = (const MeshCluster*)(base + hdr->clusters_offset);
+	view.cluster_count = hdr->cluster_count;
+
+	view.lods = (const MeshLod*)(base + hdr->lods_offset);
+	view.lod_count = hdr->lod_count;
+
+	const auto strings = (const char*)(base + hdr->strings_offset);
+	const auto materials = (const Material*)(base + hdr->materials_offset);
+	for (uint32_t i = 0; i < hdr->material_count; ++i)
+	{
+		const auto& mat = materials[i];
+		auto string_at = [&](uint32_t offset) { return offset < hdr->strings_size ? std::filesystem::path(strings + offset) : std::filesystem::path(); };
+
+		AssimpMaterialData::PhongPaths paths;
+		paths.diffuse = string_at(mat.diffuse);
+		paths.normal = string_at(mat.normal);
+		paths.specular = string_at(mat.specular);
+		paths.opacity = string_at(mat.opacity);
+
+		AssimpMaterialData data;
+		data.file_paths = paths;
+		view.materials.push_back(data);
+	}
+	return view;
+}
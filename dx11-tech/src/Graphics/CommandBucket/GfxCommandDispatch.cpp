@@ -35,7 +35,7 @@ void gfxcommand_dispatch::draw(const void* data)
 
 	// Draw
 	gfx::dev->bind_pipeline(cmd->pipeline);
-	gfx::dev->bind_index_buffer(cmd->ib);
+	gfx::dev->bind_index_buffer(cmd->ib, cmd->ib_format);
 	gfx::dev->draw_indexed(cmd->index_count, cmd->index_start, cmd->vertex_start);
 }
 
@@ -1,12 +1,19 @@
 #include "pch.h"
 #include "Graphics/DiskTextureManager.h"
 #include "Graphics/API/GfxDevice.h"
+#include "Profiler/StartupProfiler.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+#include "VirtualFile.h"
+#include <algorithm>
+#include <unordered_set>
 
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 namespace gfx { DiskTextureManager* tex_mgr = nullptr; }
+namespace jobs { extern ThreadPool* pool; }
 
 void DiskTextureManager::initialize(GfxDevice* dev)
 {
@@ -24,7 +31,8 @@ void DiskTextureManager::shutdown()
 }
 
 DiskTextureManager::DiskTextureManager(GfxDevice* dev) :
-	m_dev(dev)
+	m_dev(dev),
+	m_streamer(dev)
 {
 }
 
@@ -32,54 +40,588 @@ DiskTextureManager::~DiskTextureManager()
 {
 }
 
-TextureHandle DiskTextureManager::load_from(const std::filesystem::path& fpath)
+uint64_t DiskTextureManager::hash_file(const std::filesystem::path& fpath)
 {
-	auto it = m_path_to_tex.find(fpath.string());
-	if (it != m_path_to_tex.end())
-		return it->second;
+	VirtualFile source(fpath);
+	if (!source.is_open())
+		return 0;
+	return utils::hash_bytes(source.data(), source.size());
+}
+
+DiskTextureManager::DecodedImage DiskTextureManager::decode(const std::filesystem::path& fpath, bool cook, uint64_t content_hash, uint32_t stream_max_size)
+{
+	auto _ = StartupProfiler::Scoped("Decode: " + fpath.filename().string(), "decode");
+
+	DecodedImage image;
+	VirtualFile source(fpath);
+	if (!source.is_open())
+		return image;
+	image.file_bytes = source.size();
+	image.content_hash = content_hash;
+
+	// Up to date cooked version?
+	const auto cooked_path = TextureCooker::get_cooked_path(fpath);
+	if (cook)
+	{
+		image.cooked = TextureCooker::read_dds(cooked_path, content_hash, 0, stream_max_size);
+		if (image.cooked.is_valid())
+		{
+			image.width = (int)image.cooked.width;
+			image.height = (int)image.cooked.height;
+			image.cache_hit = true;
+			return image;
+		}
+	}
 
 	// Load with STB Image 
-	int width = 0;
-	int height = 0;
 	int channels = 0;
-	auto image_data = stbi_load(fpath.string().c_str(), &width, &height, &channels, 4);
-	int row_in_bytes = width * 4;		// width * 4 bytes (R8G8B8A8)
+	image.data = stbi_load_from_memory(source.data(), (int)source.size(), &image.width, &image.height, &channels, 4);
 
+	if (cook && image.data && TextureCooker::can_cook(image.width, image.height))
+	{
+		auto _ = StartupProfiler::Scoped("Cook: " + fpath.filename().string(), "cook");
+		image.cooked = TextureCooker::cook(image.data, image.width, image.height);
+		if (!TextureCooker::write_dds(image.cooked, content_hash, cooked_path))
+			fmt::print(fg(fmt::color::red), "Failed to write cooked texture {}\n", cooked_path.string());
+		else if (stream_max_size > 0)
+		{
+			// Streamed from the file just written, starting with the low mips
+			auto low_mips = TextureCooker::read_dds(cooked_path, content_hash, 0, stream_max_size);
+			if (low_mips.is_valid())
+				image.cooked = std::move(low_mips);
+		}
+
+		stbi_image_free(image.data);
+		image.data = nullptr;
+	}
+
+	return image;
+}
+
+TextureHandle DiskTextureManager::upload(const std::filesystem::path& fpath, DecodedImage& image)
+{
 	// If failed to load..
-	if (width == 0 || height == 0)
+	if (image.width == 0 || image.height == 0)
 	{
+		stbi_image_free(image.data);
+		image.data = nullptr;
 		return TextureHandle{0};
 	}
 
-	// Always assuming SRGB
-	auto desc = TextureDesc::make_2d(
-		DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, width, height, 
-		D3D11_BIND_SHADER_RESOURCE, 0, 1, D3D11_USAGE_DEFAULT, 0, 1, 0,
-		D3D11_RESOURCE_MISC_GENERATE_MIPS);
-	
-	auto tex = m_dev->create_texture(desc, SubresourceData(image_data, row_in_bytes, 0));
+	TextureHandle tex{0};
+	TextureEntry entry{ image.content_hash, { fpath.string() } };
+	create_texture(fpath, image, tex, entry);
 
-	// Free data from host
-	stbi_image_free(image_data);
-	
-	m_path_to_tex.insert({ fpath.string(), tex});
-	m_tex_to_path.insert({ tex, fpath.string()});
+	m_path_to_tex.insert({ fpath.string(), tex });
+	m_content_cache.insert(image.content_hash, tex, entry.bytes);
+	m_textures.insert({ tex, std::move(entry) });
 
 	return tex;
 }
 
-void DiskTextureManager::remove(TextureHandle texture)
+void DiskTextureManager::create_texture(const std::filesystem::path& fpath, DecodedImage& image, TextureHandle& tex, TextureEntry& entry)
 {
-	// Delete from bimap
+	auto create = [&](const TextureDesc& desc, const std::vector<SubresourceData>& subres)
+	{
+		auto _ = StartupProfiler::Scoped("Upload: " + fpath.filename().string(), "upload");
+		if (tex.hdl != 0)
+			m_dev->replace_texture(tex, desc, subres);
+		else
+			tex = m_dev->create_texture(desc, subres);
+	};
+
+	entry.packable_format = DXGI_FORMAT_UNKNOWN;
+
+	// Block compressed with a precomputed mip chain
+	if (image.cooked.is_valid())
+	{
+		const auto& cooked = image.cooked;
+		auto desc = TextureDesc::make_2d(cooked.format, cooked.mips[0].width, cooked.mips[0].height, D3D11_BIND_SHADER_RESOURCE, (UINT)cooked.mips.size());
+
+		std::vector<SubresourceData> subres;
+		subres.reserve(cooked.mips.size());
+		for (const auto& mip : cooked.mips)
+			subres.push_back(SubresourceData((void*)(cooked.data.data() + mip.offset), mip.row_pitch, 0));
+
+		create(desc, subres);
+
+		entry.bytes = cooked.data.size();
+		if (cooked.first_mip > 0)
+			m_streamer.add(tex, TextureCooker::get_cooked_path(fpath), image.content_hash, cooked);
+		else
+		{
+			// The streamer recreates its textures with other mip counts, those can't share an array
+			entry.packable_format = cooked.format;
+			entry.width = cooked.mips[0].width;
+			entry.height = cooked.mips[0].height;
+			entry.mip_count = (uint32_t)cooked.mips.size();
+		}
+		image.cooked = {};
+	}
+	else
+	{
+		int row_in_bytes = image.width * 4;		// width * 4 bytes (R8G8B8A8)
+
+		// Always assuming SRGB
+		auto desc = TextureDesc::make_2d(
+			DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, image.width, image.height, 
+			D3D11_BIND_SHADER_RESOURCE, 0, 1, D3D11_USAGE_DEFAULT, 0, 1, 0,
+			D3D11_RESOURCE_MISC_GENERATE_MIPS);
+	
+		create(desc, { SubresourceData(image.data, row_in_bytes, 0) });
+
+		entry.bytes = (uint64_t)row_in_bytes * image.height;
+
+		// Free data from host
+		stbi_image_free(image.data);
+		image.data = nullptr;
+	}
+}
+
+TextureHandle DiskTextureManager::get_texture(const std::filesystem::path& fpath) const
+{
+	// Paths are kept as they were loaded with
+	const auto normal = fpath.lexically_normal();
+	auto it = std::find_if(m_path_to_tex.cbegin(), m_path_to_tex.cend(), [&](const auto& entry)
+		{
+			return std::filesystem::path(entry.first).lexically_normal() == normal;
+		});
+	return it != m_path_to_tex.cend() ? it->second : TextureHandle{0};
+}
+
+bool DiskTextureManager::reload(const std::filesystem::path& fpath)
+{
+	const auto tex = get_texture(fpath);
+	if (tex.hdl == 0)
+		return false;
+
+	auto& entry = m_textures[tex];
+
+	// Unreadable (e.g still being written) or saved without changes
+	const auto content_hash = hash_file(fpath);
+	if (content_hash == 0 || content_hash == entry.content_hash)
+		return false;
+
+	Timer timer;
+
+	// The new content is already loaded as another texture, the edited path joins it without decoding
+	if (auto shared = m_content_cache.find(content_hash); shared && shared->hdl != tex.hdl)
+	{
+		const auto shared_tex = *shared;
+		const auto normal = fpath.lexically_normal();
+		auto path = std::find_if(entry.paths.begin(), entry.paths.end(), [&](const std::string& p) { return std::filesystem::path(p).lexically_normal() == normal; });
+		const std::string key = *path;
+		entry.paths.erase(path);
+		m_path_to_tex[key] = shared_tex;
+		m_textures[shared_tex].paths.push_back(key);
 
-	auto it = m_tex_to_path.find(texture);
+		// Materials of the path move to the shared texture (MaterialManager::reload_texture) and release this one
+		if (entry.paths.empty() && entry.refs == 0)
+			remove(tex);
 
-	if (it == m_tex_to_path.end())
-		return; // Didn't find the texture
+		fmt::print("Reloaded {} as an already loaded texture in {:.1f} ms\n", fpath.string(), timer.elapsed());
+		return true;
+	}
+	std::vector<DecodedImage> images;
+	images.push_back(decode(fpath, m_cook_textures, content_hash, get_stream_max_size()));
+	m_decode_stats += measure_decode(images, timer.elapsed());
+
+	auto& image = images[0];
+	if (image.width == 0 || image.height == 0)
+	{
+		stbi_image_free(image.data);
+		fmt::print(fg(fmt::color::red), "Failed to reload {}, keeping the loaded texture\n", fpath.string());
+		return false;
+	}
+
+	// Other paths share the texture by content, only the edited path moves to a texture of its own
+	if (entry.paths.size() > 1)
+	{
+		const auto normal = fpath.lexically_normal();
+		auto path = std::find_if(entry.paths.begin(), entry.paths.end(), [&](const std::string& p) { return std::filesystem::path(p).lexically_normal() == normal; });
+		const std::string key = *path;
+		entry.paths.erase(path);
+
+		TextureHandle split_tex{0};
+		TextureEntry split{ content_hash, { key } };
+		create_texture(fpath, image, split_tex, split);
+		m_path_to_tex[key] = split_tex;
+		m_content_cache.insert(content_hash, split_tex, split.bytes);
+		m_textures.insert({ split_tex, std::move(split) });
+
+		fmt::print("Reloaded {} into a texture of its own in {:.1f} ms\n", fpath.string(), timer.elapsed());
+		return true;
+	}
+
+	// Streamed again from the new cooked file
+	m_streamer.remove(tex);
+	erase_content(tex, entry.content_hash);
+
+	auto replaced = tex;
+	create_texture(fpath, image, replaced, entry);
+	m_content_cache.insert(content_hash, tex, entry.bytes);
+	entry.content_hash = content_hash;
+
+	// Same shape, the slice takes the new content. Otherwise the texture is bound on its own again
+	if (auto packed = m_packed.find(tex); packed != m_packed.end())
+	{
+		const auto& array = m_arrays[packed->second.array];
+		if (entry.packable_format == array.format && entry.width == array.width && entry.height == array.height && entry.mip_count == array.mip_count)
+		{
+			copy_to_slice(tex, packed->second, entry.mip_count);
+			m_dev->discard_texture(tex);
+		}
+		else
+			unpack(tex);
+	}
+
+	fmt::print("Reloaded {} in {:.1f} ms\n", fpath.string(), timer.elapsed());
+	return true;
+}
+
+void DiskTextureManager::erase_content(TextureHandle tex, uint64_t content_hash)
+{
+	// The content may be cached for another texture (e.g one split off by reload), which keeps its entry
+	if (auto cached = m_content_cache.get(content_hash); cached && cached->hdl == tex.hdl)
+		m_content_cache.erase(content_hash);
+}
+
+void DiskTextureManager::add_alias(const std::filesystem::path& fpath, TextureHandle tex)
+{
+	m_path_to_tex.insert({ fpath.string(), tex });
+	m_textures[tex].paths.push_back(fpath.string());
+}
+
+DiskTextureManager::DecodeStats& DiskTextureManager::DecodeStats::operator+=(const DecodeStats& rhs)
+{
+	textures += rhs.textures;
+	cache_hits += rhs.cache_hits;
+	cooked += rhs.cooked;
+	file_bytes += rhs.file_bytes;
+	decoded_bytes += rhs.decoded_bytes;
+	time_ms += rhs.time_ms;
+	return *this;
+}
+
+DiskTextureManager::DecodeStats DiskTextureManager::measure_decode(const std::vector<DecodedImage>& images, float time_ms)
+{
+	DecodeStats stats;
+	for (const auto& image : images)
+	{
+		if (!image.data && !image.cooked.is_valid())
+			continue;
+
+		++stats.textures;
+		stats.file_bytes += image.file_bytes;
+		if (image.cooked.is_valid())
+		{
+			stats.decoded_bytes += image.cooked.data.size();
+			stats.cache_hits += image.cache_hit ? 1 : 0;
+			stats.cooked += image.cache_hit ? 0 : 1;
+		}
+		else
+			stats.decoded_bytes += (uint64_t)image.width * image.height * 4;
+	}
+	stats.time_ms = time_ms;
+	return stats;
+}
+
+TextureHandle DiskTextureManager::load_from(const std::filesystem::path& fpath)
+{
+	auto it = m_path_to_tex.find(fpath.string());
+	if (it != m_path_to_tex.end())
+		return it->second;
+
+	auto _ = StartupProfiler::Scoped("Texture: " + fpath.filename().string(), "texture");
+
+	const auto content_hash = hash_file(fpath);
+	if (auto shared = m_content_cache.find(content_hash))
+	{
+		add_alias(fpath, *shared);
+		return *shared;
+	}
+
+	Timer decode_timer;
+	std::vector<DecodedImage> images;
+	images.push_back(decode(fpath, m_cook_textures, content_hash, get_stream_max_size()));
+	m_decode_stats += measure_decode(images, decode_timer.elapsed());
+
+	return upload(fpath, images[0]);
+}
 
+std::vector<TextureHandle> DiskTextureManager::load_batch(const std::vector<std::filesystem::path>& fpaths)
+{
+	// Paths not yet loaded, content already loaded through other paths isn't decoded again
+	std::vector<std::filesystem::path> new_paths;
+	for (const auto& fpath : fpaths)
+	{
+		if (m_path_to_tex.find(fpath.string()) == m_path_to_tex.end())
+			new_paths.push_back(fpath);
+	}
+
+	return upload_batch(decode_batch(new_paths, &m_content_cache), fpaths);
+}
+
+DiskTextureManager::DecodedBatch DiskTextureManager::decode_batch(const std::vector<std::filesystem::path>& fpaths) const
+{
+	return decode_batch(fpaths, nullptr);
+}
+
+DiskTextureManager::DecodedBatch DiskTextureManager::decode_batch(const std::vector<std::filesystem::path>& fpaths, const ContentCache<TextureHandle>* loaded) const
+{
+	DecodedBatch batch;
+
+	// Each path hashed once even if repeated in the batch
+	std::unordered_set<std::string> seen;
+	for (const auto& fpath : fpaths)
+	{
+		if (seen.insert(fpath.string()).second)
+			batch.paths.push_back(fpath);
+	}
+	if (batch.paths.empty())
+		return batch;
+
+	const uint32_t count = (uint32_t)batch.paths.size();
+	auto _ = StartupProfiler::Scoped("Texture batch: " + std::to_string(count) + " textures", "texture");
+
+	batch.hashes.resize(count);
+	{
+		auto _ = StartupProfiler::Scoped("Content hash: " + std::to_string(count) + " files", "decode");
+		jobs::pool->parallel_for(count, [&](uint32_t i) { batch.hashes[i] = hash_file(batch.paths[i]); });
+	}
+
+	// Only content seen for the first time is decoded, other paths alias it once uploaded
+	std::vector<uint32_t> to_decode;
+	std::unordered_set<uint64_t> batch_hashes;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const auto hash = batch.hashes[i];
+		if (hash == 0 || !((loaded && loaded->contains(hash)) || !batch_hashes.insert(hash).second))
+			to_decode.push_back(i);
+	}
+
+	batch.images.resize(count);
+	const uint32_t stream_max_size = get_stream_max_size();
+	Timer decode_timer;
+	jobs::pool->parallel_for((uint32_t)to_decode.size(), [&](uint32_t i)
+		{
+			const uint32_t path = to_decode[i];
+			batch.images[path] = decode(batch.paths[path], m_cook_textures, batch.hashes[path], stream_max_size);
+		});
+	batch.decode_ms = decode_timer.elapsed();
+
+	return batch;
+}
+
+std::vector<TextureHandle> DiskTextureManager::upload_batch(DecodedBatch&& batch, const std::vector<std::filesystem::path>& fpaths)
+{
+	if (!batch.paths.empty())
+	{
+		auto _ = StartupProfiler::Scoped("Texture upload: " + std::to_string(batch.paths.size()) + " textures", "texture");
+
+		const auto batch_stats = measure_decode(batch.images, batch.decode_ms);
+		m_decode_stats += batch_stats;
+
+		// Upload in batch order, a path or content loaded first (earlier in the batch or since the decode) is shared
+		uint32_t shared_count = 0;
+		for (size_t i = 0; i < batch.paths.size(); ++i)
+		{
+			const auto& fpath = batch.paths[i];
+			auto& image = batch.images[i];
+			if (m_path_to_tex.find(fpath.string()) != m_path_to_tex.end())
+				continue;
+
+			if (auto shared = batch.hashes[i] != 0 ? m_content_cache.find(batch.hashes[i]) : nullptr)
+			{
+				add_alias(fpath, *shared);
+				++shared_count;
+			}
+			else
+				upload(fpath, image);
+		}
+
+		fmt::print("Decoded {} textures ({:.1f} MB -> {:.1f} MB, {} from cooked cache, {} cooked, {} shared by content) in {:.1f} ms on {} threads: {:.1f} MB/s\n",
+			batch_stats.textures, batch_stats.file_bytes / (1024.f * 1024.f), batch_stats.decoded_bytes / (1024.f * 1024.f),
+			batch_stats.cache_hits, batch_stats.cooked, shared_count, batch_stats.time_ms, jobs::pool->get_thread_count() + 1, batch_stats.get_throughput_mb_per_s());
+	}
+
+	std::vector<TextureHandle> textures(fpaths.size());
+	for (size_t i = 0; i < fpaths.size(); ++i)
+	{
+		auto it = m_path_to_tex.find(fpaths[i].string());
+		textures[i] = it != m_path_to_tex.end() ? it->second : TextureHandle{0};
+	}
+
+	if (m_pack_textures)
+		pack(textures);
+
+	return textures;
+}
+
+DiskTextureManager::DecodedBatch::~DecodedBatch()
+{
+	// Uploads take the data, the rest was never needed
+	for (auto& image : images)
+		stbi_image_free(image.data);
+}
+
+DiskTextureManager::DecodedBatch::DecodedBatch(DecodedBatch&& rhs) noexcept :
+	paths(std::move(rhs.paths)),
+	hashes(std::move(rhs.hashes)),
+	images(std::move(rhs.images)),
+	decode_ms(rhs.decode_ms)
+{
+	rhs.images.clear();
+}
+
+DiskTextureManager::DecodedBatch& DiskTextureManager::DecodedBatch::operator=(DecodedBatch&& rhs) noexcept
+{
+	// The previous images go with rhs
+	std::swap(paths, rhs.paths);
+	std::swap(hashes, rhs.hashes);
+	std::swap(images, rhs.images);
+	decode_ms = rhs.decode_ms;
+	return *this;
+}
+
+uint32_t DiskTextureManager::pack(const std::vector<TextureHandle>& textures, uint32_t min_slices)
+{
+	auto _ = StartupProfiler::Scoped("Texture packing", "texture");
+
+	// Format, width, height, mip count --> textures of that shape, each once and in order of the list
+	std::map<std::tuple<DXGI_FORMAT, uint32_t, uint32_t, uint32_t>, std::vector<TextureHandle>> groups;
+	std::unordered_set<TextureHandle> seen;
+	for (const auto tex : textures)
+	{
+		auto it = m_textures.find(tex);
+		if (it == m_textures.end() || it->second.packable_format == DXGI_FORMAT_UNKNOWN || m_packed.find(tex) != m_packed.end() || !seen.insert(tex).second)
+			continue;
+
+		const auto& entry = it->second;
+		groups[{ entry.packable_format, entry.width, entry.height, entry.mip_count }].push_back(tex);
+	}
+
+	uint32_t packed_count = 0;
+	for (const auto& [shape, group] : groups)
+	{
+		if (group.size() < (std::max)(min_slices, 1u))
+			continue;
+
+		const auto [format, width, height, mip_count] = shape;
+		if (group.size() > D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION)
+		{
+			fmt::print(fg(fmt::color::red), "{} textures of {}x{} exceed the array size limit, not packed\n", group.size(), width, height);
+			continue;
+		}
+
+		ArrayEntry array;
+		array.format = format;
+		array.width = width;
+		array.height = height;
+		array.mip_count = mip_count;
+		array.live_slices = (uint32_t)group.size();
+
+		// Filled on the GPU from the loaded textures, which are discarded once copied (the array replaces them)
+		const auto array_tex = m_dev->create_texture(TextureDesc::make_2d(format, width, height, D3D11_BIND_SHADER_RESOURCE, mip_count, (UINT)group.size()));
+		for (uint32_t slice = 0; slice < (uint32_t)group.size(); ++slice)
+		{
+			const PackedTexture packed{ array_tex, slice };
+			copy_to_slice(group[slice], packed, mip_count);
+			m_dev->discard_texture(group[slice]);
+			m_packed.insert({ group[slice], packed });
+			array.bytes += m_textures[group[slice]].bytes;
+		}
+
+		++m_pack_stats.arrays;
+		m_pack_stats.slices += array.live_slices;
+		m_pack_stats.bytes += array.bytes;
+		packed_count += array.live_slices;
+		m_arrays.insert({ array_tex, array });
+	}
+
+	if (packed_count > 0)
+		fmt::print("Packed {} textures into {} texture arrays ({:.1f} MB)\n", packed_count, m_pack_stats.arrays, m_pack_stats.bytes / (1024.f * 1024.f));
+	return packed_count;
+}
+
+void DiskTextureManager::copy_to_slice(TextureHandle tex, const PackedTexture& packed, uint32_t mip_count)
+{
+	for (uint32_t mip = 0; mip < mip_count; ++mip)
+		m_dev->copy_resource_region(packed.array, CopyRegionDst(D3D11CalcSubresource(mip, packed.slice, mip_count)), tex, mip);
+}
+
+const DiskTextureManager::PackedTexture* DiskTextureManager::get_packed(TextureHandle tex) const
+{
+	auto it = m_packed.find(tex);
+	return it != m_packed.end() ? &it->second : nullptr;
+}
+
+uint64_t DiskTextureManager::unpack(TextureHandle tex)
+{
+	auto it = m_packed.find(tex);
+	if (it == m_packed.end())
+		return 0;
+
+	const auto array_tex = it->second.array;
+	m_packed.erase(it);
+	--m_pack_stats.slices;
+
+	// The slice stays allocated until the whole array goes
+	auto& array = m_arrays[array_tex];
+	if (--array.live_slices > 0)
+		return 0;
+
+	const uint64_t bytes = array.bytes;
+	--m_pack_stats.arrays;
+	m_pack_stats.bytes -= bytes;
+	m_dev->free_texture(array_tex);
+	m_arrays.erase(array_tex);
+	return bytes;
+}
+
+uint64_t DiskTextureManager::remove(TextureHandle texture)
+{
+	// Every path sharing the texture goes with it
+	auto it = m_textures.find(texture);
+	if (it == m_textures.end())
+		return 0; // Didn't find the texture
+
+	// A packed texture only holds memory in its array
+	uint64_t bytes = m_streamer.is_streamed(texture) ? m_streamer.get_resident_bytes(texture) : it->second.bytes;
+	if (m_packed.find(texture) != m_packed.end())
+		bytes = unpack(texture);
+
+	m_streamer.remove(texture);
 	m_dev->free_texture(texture);
-	m_tex_to_path.erase(texture);
 
-	const auto associated_path = it->second;
-	m_path_to_tex.erase(associated_path);
+	for (const auto& path : it->second.paths)
+		m_path_to_tex.erase(path);
+	erase_content(texture, it->second.content_hash);
+	m_textures.erase(it);
+	return bytes;
+}
+
+void DiskTextureManager::add_ref(TextureHandle tex)
+{
+	auto it = m_textures.find(tex);
+	if (it == m_textures.end())
+	{
+		assert(false);		// not loaded through the manager
+		return;
+	}
+	++it->second.refs;
+}
+
+uint64_t DiskTextureManager::release(TextureHandle tex)
+{
+	auto it = m_textures.find(tex);
+	if (it == m_textures.end() || it->second.refs == 0)
+	{
+		assert(false);		// not referenced
+		return 0;
+	}
+
+	if (--it->second.refs > 0)
+		return 0;
+	return remove(tex);
 }
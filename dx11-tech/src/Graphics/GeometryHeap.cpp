@@ -0,0 +1,201 @@
+#include "pch.h"
+#include "Graphics/GeometryHeap.h"
+#include "Graphics/API/GfxDevice.h"
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+	// Filled with update_subresource, so not immutable like BufferDesc::vertex/index
+	BufferDesc chunk_desc(uint64_t bytes, UINT bind_flags, BufferType type)
+	{
+		return BufferDesc(CD3D11_BUFFER_DESC((UINT)bytes, bind_flags, D3D11_USAGE_DEFAULT), type);
+	}
+
+	D3D11_BOX byte_range(uint64_t start, uint64_t end)
+	{
+		return CD3D11_BOX((LONG)start, 0, 0, (LONG)end, 1, 1);
+	}
+}
+
+GeometryHeap::GeometryHeap(GfxDevice* dev, const Settings& settings) :
+	m_dev(dev),
+	m_settings(settings)
+{
+}
+
+GeometryHeap::~GeometryHeap()
+{
+	for (const auto& chunk : m_vertex_chunks)
+	{
+		for (const auto& vb : chunk.vbs)
+			m_dev->free_buffer(std::get<0>(vb));
+	}
+	for (const auto& chunk : m_index_chunks)
+	{
+		if (chunk.ib.hdl != 0)
+			m_dev->free_buffer(chunk.ib);
+	}
+}
+
+uint32_t GeometryHeap::allocate_vertices(const std::vector<UINT>& strides, uint32_t vertex_count, uint32_t& base_vertex)
+{
+	for (uint32_t i = 0; i < (uint32_t)m_vertex_chunks.size(); ++i)
+	{
+		auto& chunk = m_vertex_chunks[i];
+		if (chunk.vbs.empty() || chunk.strides != strides)
+			continue;
+
+		const uint64_t offset = chunk.vertices.allocate(vertex_count);
+		if (offset != RangeAllocator::INVALID_OFFSET)
+		{
+			base_vertex = (uint32_t)offset;
+			return i;
+		}
+	}
+
+	// No room, a new chunk in the first freed slot
+	auto slot = std::find_if(m_vertex_chunks.begin(), m_vertex_chunks.end(), [](const VertexChunk& chunk) { return chunk.vbs.empty(); });
+	const uint32_t index = (uint32_t)(slot - m_vertex_chunks.begin());
+	if (slot == m_vertex_chunks.end())
+		m_vertex_chunks.push_back(VertexChunk{ {}, {}, RangeAllocator(0) });
+
+	const uint32_t capacity = (std::max)(m_settings.chunk_vertices, vertex_count);
+	auto& chunk = m_vertex_chunks[index];
+	chunk.strides = strides;
+	chunk.vertices = RangeAllocator(capacity);
+	for (const auto stride : strides)
+		chunk.vbs.push_back({ m_dev->create_buffer(chunk_desc((uint64_t)capacity * stride, D3D11_BIND_VERTEX_BUFFER, BufferType::eVertex)), stride, 0 });
+
+	base_vertex = (uint32_t)chunk.vertices.allocate(vertex_count);
+	return index;
+}
+
+uint32_t GeometryHeap::allocate_indices(uint64_t index_bytes, uint64_t& offset)
+{
+	// 4 byte aligned for 32 bit ranges
+	static constexpr uint64_t alignment = sizeof(uint32_t);
+
+	for (uint32_t i = 0; i < (uint32_t)m_index_chunks.size(); ++i)
+	{
+		auto& chunk = m_index_chunks[i];
+		if (chunk.ib.hdl == 0)
+			continue;
+
+		offset = chunk.bytes.allocate(index_bytes, alignment);
+		if (offset != RangeAllocator::INVALID_OFFSET)
+			return i;
+	}
+
+	auto slot = std::find_if(m_index_chunks.begin(), m_index_chunks.end(), [](const IndexChunk& chunk) { return chunk.ib.hdl == 0; });
+	const uint32_t index = (uint32_t)(slot - m_index_chunks.begin());
+	if (slot == m_index_chunks.end())
+		m_index_chunks.push_back(IndexChunk{ {}, RangeAllocator(0) });
+
+	const uint64_t capacity = (std::max)(m_settings.chunk_index_bytes, index_bytes);
+	auto& chunk = m_index_chunks[index];
+	chunk.bytes = RangeAllocator(capacity);
+	chunk.ib = m_dev->create_buffer(chunk_desc(capacity, D3D11_BIND_INDEX_BUFFER, BufferType::eIndex));
+
+	offset = chunk.bytes.allocate(index_bytes, alignment);
+	return index;
+}
+
+GeometryHeap::Allocation GeometryHeap::allocate(const std::vector<Stream>& streams, uint32_t vertex_count, const void* indices, uint64_t index_bytes)
+{
+	std::vector<UINT> strides;
+	for (const auto& stream : streams)
+		strides.push_back(stream.stride);
+
+	// Empty ranges can't be allocated, only the reservation is padded, the uploads are the caller's sizes
+	Allocation allocation;
+	allocation.vertex_chunk = allocate_vertices(strides, (std::max)(vertex_count, 1u), allocation.base_vertex);
+	allocation.index_chunk = allocate_indices((std::max)(index_bytes, (uint64_t)sizeof(uint32_t)), allocation.index_offset);
+
+	const auto& vbs = m_vertex_chunks[allocation.vertex_chunk].vbs;
+	for (size_t i = 0; i < streams.size(); ++i)
+	{
+		const uint64_t start = (uint64_t)allocation.base_vertex * streams[i].stride;
+		const uint64_t end = start + (uint64_t)vertex_count * streams[i].stride;
+		if (streams[i].data && end > start)
+			m_dev->update_subresource(std::get<0>(vbs[i]), SubresourceData((void*)streams[i].data), byte_range(start, end));
+		allocation.vertex_bytes += end - start;
+	}
+
+	if (indices && index_bytes > 0)
+		m_dev->update_subresource(m_index_chunks[allocation.index_chunk].ib, SubresourceData((void*)indices),
+			byte_range(allocation.index_offset, allocation.index_offset + index_bytes));
+
+	allocation.bytes = allocation.vertex_bytes + index_bytes;
+	return allocation;
+}
+
+void GeometryHeap::free(const Allocation& allocation)
+{
+	if (!allocation.is_valid())
+		return;
+
+	auto& vertex_chunk = m_vertex_chunks[allocation.vertex_chunk];
+	vertex_chunk.vertices.free(allocation.base_vertex);
+	if (vertex_chunk.vertices.is_empty())
+	{
+		for (const auto& vb : vertex_chunk.vbs)
+			m_dev->free_buffer(std::get<0>(vb));
+		vertex_chunk.vbs.clear();
+	}
+
+	auto& index_chunk = m_index_chunks[allocation.index_chunk];
+	index_chunk.bytes.free(allocation.index_offset);
+	if (index_chunk.bytes.is_empty())
+	{
+		m_dev->free_buffer(index_chunk.ib);
+		index_chunk.ib = BufferHandle{};
+	}
+}
+
+const std::vector<std::tuple<BufferHandle, UINT, UINT>>& GeometryHeap::get_vbs(const Allocation& allocation) const
+{
+	return m_vertex_chunks[allocation.vertex_chunk].vbs;
+}
+
+BufferHandle GeometryHeap::get_ib(const Allocation& allocation) const
+{
+	return m_index_chunks[allocation.index_chunk].ib;
+}
+
+GeometryHeap::Stats GeometryHeap::get_stats() const
+{
+	Stats stats;
+	uint64_t free_bytes = 0;
+	float weighted_fragmentation = 0.f;		// each chunk's fragmentation scaled by its free bytes
+
+	auto add = [&](const RangeAllocator::Stats& range, uint64_t unit_bytes)
+	{
+		stats.capacity_bytes += range.capacity * unit_bytes;
+		stats.used_bytes += range.used * unit_bytes;
+		stats.free_ranges += range.free_ranges;
+		free_bytes += range.get_free() * unit_bytes;
+		weighted_fragmentation += range.get_fragmentation() * (range.get_free() * unit_bytes);
+	};
+
+	for (const auto& chunk : m_vertex_chunks)
+	{
+		if (chunk.vbs.empty())
+			continue;
+		++stats.vertex_chunks;
+		const auto range = chunk.vertices.get_stats();
+		stats.allocations += range.allocations;		// one vertex range per model
+		add(range, std::accumulate(chunk.strides.begin(), chunk.strides.end(), (uint64_t)0));
+	}
+
+	for (const auto& chunk : m_index_chunks)
+	{
+		if (chunk.ib.hdl == 0)
+			continue;
+		++stats.index_chunks;
+		add(chunk.bytes.get_stats(), 1);
+	}
+
+	stats.fragmentation = free_bytes > 0 ? weighted_fragmentation / free_bytes : 0.f;
+	return stats;
+}
@@ -1,16 +1,10 @@
 #include "pch.h"
 #include "Graphics/Material.h"
 
-Material& Material::set_texture(Material::Texture type, TextureHandle tex)
+uint64_t Material::get_hash() const
 {
-	m_textures.insert({ type, tex });
-	return *this;
-}
-
-TextureHandle Material::get_texture(Material::Texture type) const
-{
-	auto it = m_textures.find(type);
-	if (it == m_textures.cend())
-		return TextureHandle{0};
-	return it->second;
+	std::array<res_handle, (size_t)Texture::eCount> handles;
+	for (size_t i = 0; i < m_textures.size(); ++i)
+		handles[i] = m_textures[i].hdl;
+	return utils::hash_bytes(handles.data(), sizeof(handles));
 }
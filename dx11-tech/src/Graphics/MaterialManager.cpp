@@ -26,52 +26,225 @@ MaterialManager::MaterialManager(DiskTextureManager* disk_tex_mgr) :
 
 const Material* MaterialManager::load_material(const AssimpMaterialData& mat_data, const std::string& name)
 {
-	if (m_mats.find(name) != m_mats.cend())
-		assert(false);		// Name already taken
-
-	Material* mat_ret = nullptr;
-
 	// Handle material
 	const auto& paths = std::get<AssimpMaterialData::PhongPaths>(mat_data.file_paths);
 
 	// Load textures
 	auto diffuse = m_disk_tex_mgr->load_from(paths.diffuse);
 
+	return add_material(diffuse, paths.diffuse, name);
+}
+
+namespace
+{
+	std::vector<std::filesystem::path> get_diffuse_paths(const std::vector<AssimpMaterialData>& mat_datas)
+	{
+		std::vector<std::filesystem::path> diffuse_paths;
+		diffuse_paths.reserve(mat_datas.size());
+		for (const auto& mat_data : mat_datas)
+			diffuse_paths.push_back(std::get<AssimpMaterialData::PhongPaths>(mat_data.file_paths).diffuse);
+		return diffuse_paths;
+	}
+}
+
+std::vector<const Material*> MaterialManager::load_materials(const std::vector<AssimpMaterialData>& mat_datas)
+{
+	const auto diffuse_paths = get_diffuse_paths(mat_datas);
+	const auto diffuses = m_disk_tex_mgr->load_batch(diffuse_paths);
+
+	std::vector<const Material*> mats;
+	mats.reserve(mat_datas.size());
+	for (size_t i = 0; i < diffuses.size(); ++i)
+		mats.push_back(add_material(diffuses[i], diffuse_paths[i], ""));
+	return mats;
+}
+
+std::vector<const Material*> MaterialManager::load_materials(const std::vector<AssimpMaterialData>& mat_datas, DiskTextureManager::DecodedBatch&& textures)
+{
+	const auto diffuse_paths = get_diffuse_paths(mat_datas);
+	const auto diffuses = m_disk_tex_mgr->upload_batch(std::move(textures), diffuse_paths);
+
+	std::vector<const Material*> mats;
+	mats.reserve(mat_datas.size());
+	for (size_t i = 0; i < diffuses.size(); ++i)
+		mats.push_back(add_material(diffuses[i], diffuse_paths[i], ""));
+	return mats;
+}
+
+DiskTextureManager::DecodedBatch MaterialManager::decode_textures(const std::vector<AssimpMaterialData>& mat_datas) const
+{
+	return m_disk_tex_mgr->decode_batch(get_diffuse_paths(mat_datas));
+}
+
+const Material* MaterialManager::add_material(TextureHandle diffuse, const std::filesystem::path& diffuse_path, const std::string& name)
+{
+	if (m_ids_by_name.find(name) != m_ids_by_name.cend())
+		assert(false);		// Name already taken
+
 	// Load a default texture if no texture loaded
+	auto albedo_path = diffuse_path.lexically_normal();
 	if (diffuse.hdl == 0)
-		diffuse = m_disk_tex_mgr->load_from("textures/pink.jpg");
+	{
+		albedo_path = std::filesystem::path("textures/pink.jpg").lexically_normal();
+		diffuse = m_disk_tex_mgr->load_from(albedo_path);
+	}
 
 	// Create material
 	auto mat = Material().
 		set_texture(Material::Texture::eAlbedo, diffuse);
 
 	// Check if material exists
-	auto it = std::find_if(m_mats.begin(), m_mats.end(), [&](const auto& pair) { return mat == pair.second; });
-	if (it == m_mats.end())
+	const auto hash = mat.get_hash();
+	auto [first, last] = m_ids_by_hash.equal_range(hash);
+	for (auto it = first; it != last; ++it)
 	{
-		std::string mat_name = name;
-		if (mat_name.empty())
-			mat_name = "Mat" + std::to_string(m_def_counter++);
+		if (m_mats[it->second] == mat && m_albedo_paths[it->second] == albedo_path)
+		{
+			// Get existing material
+			++m_refs[it->second];
+			return &m_mats[it->second];
+		}
+	}
 
-		// Save material
-		auto it = m_mats.insert({ mat_name, mat });
-		mat_ret = &(it.first->second);
+	// Dense IDs, freed ones first
+	uint16_t id = Material::INVALID_ID;
+	if (!m_free_ids.empty())
+	{
+		id = m_free_ids.back();
+		m_free_ids.pop_back();
+	}
+	else if (m_mats.size() < Material::INVALID_ID)
+	{
+		id = (uint16_t)m_mats.size();
+		m_mats.emplace_back();
+		m_refs.push_back(0);
+		m_names.emplace_back();
+		m_albedo_paths.emplace_back();
 	}
 	else
 	{
-		// Get existing material
-		mat_ret = &(it->second);
+		fmt::print(fg(fmt::color::red), "Out of material IDs ({} materials)\n", m_mats.size());
+		assert(false);
+		return &m_mats.front();
+	}
+
+	std::string mat_name = name;
+	if (mat_name.empty())
+		mat_name = "Mat" + std::to_string(m_def_counter++);
+
+	// Save material, it keeps its textures alive
+	mat.m_id = id;
+	m_mats[id] = mat;
+	m_refs[id] = 1;
+	m_names[id] = mat_name;
+	m_albedo_paths[id] = albedo_path;
+	m_ids_by_name.insert({ mat_name, id });
+	m_ids_by_hash.insert({ hash, id });
+
+	for (size_t i = 0; i < (size_t)Material::Texture::eCount; ++i)
+	{
+		const auto tex = mat.get_texture((Material::Texture)i);
+		if (tex.hdl != 0)
+			m_disk_tex_mgr->add_ref(tex);
 	}
 
-	return mat_ret;
+	return &m_mats[id];
 }
 
 const Material* MaterialManager::get_material(const std::string& name)
 {
-	return &(m_mats.find(name)->second);
+	return &m_mats[m_ids_by_name.find(name)->second];
+}
+
+const Material* MaterialManager::get_material(uint16_t id) const
+{
+	return &m_mats[id];
+}
+
+uint64_t MaterialManager::remove_material(const std::string& name)
+{
+	auto it = m_ids_by_name.find(name);
+	if (it == m_ids_by_name.end())
+		return 0;
+	return remove_material(it->second);
 }
 
-void MaterialManager::remove_material(const std::string& name)
+uint64_t MaterialManager::remove_material(uint16_t id)
 {
-	m_mats.erase(name);
+	auto& mat = m_mats[id];
+	auto [first, last] = m_ids_by_hash.equal_range(mat.get_hash());
+	for (auto hash_it = first; hash_it != last; ++hash_it)
+	{
+		if (hash_it->second == id)
+		{
+			m_ids_by_hash.erase(hash_it);
+			break;
+		}
+	}
+
+	uint64_t freed = 0;
+	for (size_t i = 0; i < (size_t)Material::Texture::eCount; ++i)
+	{
+		const auto tex = mat.get_texture((Material::Texture)i);
+		if (tex.hdl != 0)
+			freed += m_disk_tex_mgr->release(tex);
+	}
+
+	m_ids_by_name.erase(m_names[id]);
+	m_names[id].clear();
+	m_albedo_paths[id].clear();
+	m_refs[id] = 0;
+	mat = Material();
+	m_free_ids.push_back(id);
+	return freed;
+}
+
+uint64_t MaterialManager::release(const Material* mat)
+{
+	const uint16_t id = mat->get_id();
+	if (id >= m_mats.size() || m_refs[id] == 0)
+	{
+		assert(false);		// not referenced
+		return 0;
+	}
+
+	if (--m_refs[id] > 0)
+		return 0;
+	return remove_material(id);
+}
+
+bool MaterialManager::reload_texture(const std::filesystem::path& fpath)
+{
+	const auto before = m_disk_tex_mgr->get_texture(fpath);
+	if (!m_disk_tex_mgr->reload(fpath))
+		return false;
+
+	const auto after = m_disk_tex_mgr->get_texture(fpath);
+	if (after.hdl == before.hdl)
+		return true;
+
+	// Only the materials of the edited path follow it, the others keep the shared texture
+	const auto normal = fpath.lexically_normal();
+	for (uint16_t id = 0; id < (uint16_t)m_mats.size(); ++id)
+	{
+		auto& mat = m_mats[id];
+		if (m_refs[id] == 0 || m_albedo_paths[id] != normal || mat.get_texture(Material::Texture::eAlbedo).hdl != before.hdl)
+			continue;
+
+		auto [first, last] = m_ids_by_hash.equal_range(mat.get_hash());
+		for (auto hash_it = first; hash_it != last; ++hash_it)
+		{
+			if (hash_it->second == id)
+			{
+				m_ids_by_hash.erase(hash_it);
+				break;
+			}
+		}
+
+		mat.set_texture(Material::Texture::eAlbedo, after);
+		m_ids_by_hash.insert({ mat.get_hash(), id });
+		m_disk_tex_mgr->add_ref(after);
+		m_disk_tex_mgr->release(before);
+	}
+	return true;
 }
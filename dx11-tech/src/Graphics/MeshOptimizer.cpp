@@ -0,0 +1,762 @@
+#include "pch.h"
+#include "Graphics/MeshOptimizer.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <queue>
+
+namespace jobs { extern ThreadPool* pool; }
+
+namespace
+{
+	// Forsyth scoring, see https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+	constexpr uint32_t s_lru_size = 32;
+	constexpr float s_last_triangle_score = 0.75f;
+	constexpr float s_cache_decay_power = 1.5f;
+	constexpr float s_valence_boost_scale = 2.f;
+	constexpr float s_valence_boost_power = 0.5f;
+
+	float vertex_score(int32_t cache_position, uint32_t live_triangles)
+	{
+		if (live_triangles == 0)
+			return -1.f;		// no triangles left to emit, never picked again
+
+		float score = 0.f;
+		if (cache_position >= 0)
+		{
+			// The last triangle's vertices get a fixed score so the next triangle doesn't simply reuse its edge
+			if (cache_position < 3)
+				score = s_last_triangle_score;
+			else
+				score = std::pow(1.f - (cache_position - 3) / float(s_lru_size - 3), s_cache_decay_power);
+		}
+
+		return score + s_valence_boost_scale * std::pow((float)live_triangles, -s_valence_boost_power);
+	}
+
+	struct Float3
+	{
+		float x = 0.f, y = 0.f, z = 0.f;
+
+		Float3 operator+(const Float3& o) const { return { x + o.x, y + o.y, z + o.z }; }
+		Float3 operator-(const Float3& o) const { return { x - o.x, y - o.y, z - o.z }; }
+		Float3 operator*(float s) const { return { x * s, y * s, z * s }; }
+		float dot(const Float3& o) const { return x * o.x + y * o.y + z * o.z; }
+		float length() const { return std::sqrt(dot(*this)); }
+		Float3 cross(const Float3& o) const { return { y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x }; }
+	};
+
+	Float3 load_position(const float* positions, uint32_t vertex)
+	{
+		return { positions[3 * vertex + 0], positions[3 * vertex + 1], positions[3 * vertex + 2] };
+	}
+
+	// Cache misses per triangle for a FIFO cache
+	std::vector<uint32_t> simulate_misses(const uint32_t* indices, size_t index_count, uint32_t vertex_count, uint32_t cache_size)
+	{
+		// A vertex is cached while fewer than cache_size misses happened since it was last inserted
+		std::vector<uint32_t> inserted_at(vertex_count, 0);
+		uint32_t timestamp = cache_size + 1;
+
+		std::vector<uint32_t> misses(index_count / 3, 0);
+		for (size_t i = 0; i < index_count; ++i)
+		{
+			const uint32_t v = indices[i];
+			if (timestamp - inserted_at[v] > cache_size)
+			{
+				inserted_at[v] = timestamp++;
+				++misses[i / 3];
+			}
+		}
+		return misses;
+	}
+
+	template <typename Func>
+	void for_each_mesh(uint32_t count, Func&& func)
+	{
+		if (jobs::pool)
+			jobs::pool->parallel_for(count, func);
+		else
+		{
+			for (uint32_t i = 0; i < count; ++i)
+				func(i);
+		}
+	}
+}
+
+ModelSourceView MeshOptimizer::Result::get_view() const
+{
+	ModelSourceView view;
+	view.positions = positions.data();
+	view.uvs = uvs.data();
+	view.normals = normals.data();
+	view.vertex_count = (uint32_t)(positions.size() / 3);
+	view.uv_count = (uint32_t)(uvs.size() / 2);
+	view.indices = indices.data();
+	view.index_bytes = indices.size();
+	view.meshes = meshes;
+	view.materials = materials;
+	view.clusters = clusters.data();
+	view.cluster_count = (uint32_t)clusters.size();
+	view.lods = lods.data();
+	view.lod_count = (uint32_t)lods.size();
+	return view;
+}
+
+float MeshOptimizer::compute_acmr(const uint32_t* indices, size_t index_count, uint32_t vertex_count, uint32_t cache_size)
+{
+	if (index_count < 3)
+		return 0.f;
+
+	const auto misses = simulate_misses(indices, index_count, vertex_count, cache_size);
+	return std::accumulate(misses.begin(), misses.end(), 0ull) / float(index_count / 3);
+}
+
+float MeshOptimizer::compute_fetch_ratio(const uint32_t* indices, size_t index_count, uint32_t vertex_count, uint32_t vertex_stride)
+{
+	constexpr uint32_t line_size = 64;
+	constexpr uint32_t cache_lines = 64;		// 4 KB, roughly what a vertex fetch unit keeps around
+
+	if (vertex_count == 0)
+		return 0.f;
+
+	const uint64_t line_count = ((uint64_t)vertex_count * vertex_stride + line_size - 1) / line_size;
+	std::vector<uint32_t> inserted_at(line_count, 0);
+	uint32_t timestamp = cache_lines + 1;
+
+	uint64_t fetched = 0;
+	auto touch = [&](uint64_t line)
+	{
+		if (timestamp - inserted_at[line] > cache_lines)
+		{
+			inserted_at[line] = timestamp++;
+			fetched += line_size;
+		}
+	};
+
+	for (size_t i = 0; i < index_count; ++i)
+	{
+		// A vertex may straddle two lines
+		const uint64_t begin = (uint64_t)indices[i] * vertex_stride;
+		const uint64_t end = begin + vertex_stride - 1;
+		for (uint64_t line = begin / line_size; line <= end / line_size; ++line)
+			touch(line);
+	}
+
+	return fetched / float((uint64_t)vertex_count * vertex_stride);
+}
+
+void MeshOptimizer::optimize_vertex_cache(uint32_t* indices, size_t index_count, uint32_t vertex_count)
+{
+	const size_t tri_count = index_count / 3;
+	if (tri_count == 0)
+		return;
+
+	// Vertex to triangle adjacency, live triangles of a vertex are kept at the front of its list
+	std::vector<uint32_t> live(vertex_count, 0);
+	for (size_t i = 0; i < tri_count * 3; ++i)
+		++live[indices[i]];
+
+	std::vector<uint32_t> adjacency_offset(vertex_count + 1, 0);
+	for (uint32_t v = 0; v < vertex_count; ++v)
+		adjacency_offset[v + 1] = adjacency_offset[v] + live[v];
+
+	std::vector<uint32_t> adjacency(adjacency_offset.back());
+	{
+		std::vector<uint32_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+		for (size_t t = 0; t < tri_count; ++t)
+			for (size_t k = 0; k < 3; ++k)
+				adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+	}
+
+	std::vector<int32_t> cache_position(vertex_count, -1);
+	std::vector<float> score(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; ++v)
+		score[v] = vertex_score(-1, live[v]);
+
+	std::vector<float> tri_score(tri_count);
+	for (size_t t = 0; t < tri_count; ++t)
+		tri_score[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+	std::vector<bool> emitted(tri_count, false);
+	std::vector<uint32_t> output;
+	output.reserve(tri_count * 3);
+
+	uint32_t cache[s_lru_size + 3];
+	uint32_t cache_count = 0;
+	uint32_t new_cache[s_lru_size + 3];
+
+	int64_t best = 0;
+	size_t scan_cursor = 0;
+
+	for (size_t emitted_count = 0; emitted_count < tri_count; ++emitted_count)
+	{
+		// Nothing adjacent to the cache is left, continue with the next unemitted triangle in input order
+		if (best < 0)
+		{
+			while (emitted[scan_cursor])
+				++scan_cursor;
+			best = (int64_t)scan_cursor;
+		}
+
+		const uint32_t* tri = &indices[best * 3];
+		output.insert(output.end(), tri, tri + 3);
+		emitted[best] = true;
+
+		// Drop the triangle from the live lists of its vertices
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			const uint32_t v = tri[k];
+			uint32_t* list = &adjacency[adjacency_offset[v]];
+			for (uint32_t i = 0; i < live[v]; ++i)
+			{
+				if (list[i] == (uint32_t)best)
+				{
+					std::swap(list[i], list[live[v] - 1]);
+					break;
+				}
+			}
+			--live[v];
+		}
+
+		// LRU update: the triangle's vertices move to the front
+		uint32_t new_count = 0;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			if (std::find(new_cache, new_cache + new_count, tri[k]) == new_cache + new_count)
+				new_cache[new_count++] = tri[k];
+		}
+		for (uint32_t i = 0; i < cache_count; ++i)
+		{
+			const uint32_t v = cache[i];
+			if (std::find(new_cache, new_cache + new_count, v) == new_cache + new_count)
+				new_cache[new_count++] = v;
+		}
+
+		// Evicted vertices lose their cache score
+		for (uint32_t i = s_lru_size; i < new_count; ++i)
+			cache_position[new_cache[i]] = -1;
+
+		// Rescore the cached and evicted vertices, propagate the change to their live triangles
+		best = -1;
+		float best_score = -FLT_MAX;
+		for (uint32_t i = 0; i < new_count; ++i)
+		{
+			const uint32_t v = new_cache[i];
+			if (i < s_lru_size)
+				cache_position[v] = (int32_t)i;
+
+			const float new_score = vertex_score(cache_position[v], live[v]);
+			const float delta = new_score - score[v];
+			score[v] = new_score;
+
+			const uint32_t* list = &adjacency[adjacency_offset[v]];
+			for (uint32_t j = 0; j < live[v]; ++j)
+			{
+				const uint32_t t = list[j];
+				tri_score[t] += delta;
+				if (tri_score[t] > best_score)
+				{
+					best_score = tri_score[t];
+					best = t;
+				}
+			}
+		}
+
+		cache_count = (std::min)(new_count, s_lru_size);
+		std::memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+	}
+
+	std::memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+uint32_t MeshOptimizer::optimize_overdraw(uint32_t* indices, size_t index_count, const float* positions, uint32_t vertex_count, float threshold)
+{
+	const size_t tri_count = index_count / 3;
+	if (tri_count < 2)
+		return (uint32_t)tri_count;
+
+	constexpr uint32_t cache_size = 16;
+	const auto misses = simulate_misses(indices, index_count, vertex_count, cache_size);
+	const float mesh_acmr = std::accumulate(misses.begin(), misses.end(), 0ull) / float(tri_count);
+
+	/*
+		Clusters: a triangle missing all three vertices starts a new strip of reuse (hard boundary).
+		Within those, cut once the ACMR of the cluster is within the threshold (soft boundary).
+		Clusters end up in any order, so each one is simulated from a cold cache.
+	*/
+	std::vector<uint32_t> inserted_at(vertex_count, 0);
+	uint32_t timestamp = cache_size + 1;
+
+	std::vector<uint32_t> cluster_starts;
+	uint32_t cluster_misses = 0;
+	uint32_t cluster_tris = 0;
+	bool soft = false;
+	for (size_t t = 0; t < tri_count; ++t)
+	{
+		if (t == 0 || misses[t] == 3 || soft)
+		{
+			cluster_starts.push_back((uint32_t)t);
+			cluster_misses = 0;
+			cluster_tris = 0;
+			timestamp += cache_size + 1;		// flush
+		}
+
+		for (size_t k = 0; k < 3; ++k)
+		{
+			const uint32_t v = indices[t * 3 + k];
+			if (timestamp - inserted_at[v] > cache_size)
+			{
+				inserted_at[v] = timestamp++;
+				++cluster_misses;
+			}
+		}
+		++cluster_tris;
+
+		soft = cluster_misses <= threshold * mesh_acmr * cluster_tris;
+	}
+	const auto cluster_count = (uint32_t)cluster_starts.size();
+	cluster_starts.push_back((uint32_t)tri_count);
+
+	// Area weighted centroid and normal per cluster
+	std::vector<Float3> centroids(cluster_count), normals(cluster_count);
+	std::vector<float> areas(cluster_count, 0.f);
+	Float3 mesh_centroid;
+	float mesh_area = 0.f;
+
+	for (uint32_t c = 0; c < cluster_count; ++c)
+	{
+		for (uint32_t t = cluster_starts[c]; t < cluster_starts[c + 1]; ++t)
+		{
+			const Float3 p0 = load_position(positions, indices[t * 3 + 0]);
+			const Float3 p1 = load_position(positions, indices[t * 3 + 1]);
+			const Float3 p2 = load_position(positions, indices[t * 3 + 2]);
+
+			const Float3 n = (p1 - p0).cross(p2 - p0);
+			const float area = std::sqrt(n.dot(n));
+			centroids[c] = centroids[c] + (p0 + p1 + p2) * (area / 3.f);
+			normals[c] = normals[c] + n;
+			areas[c] += area;
+		}
+
+		mesh_centroid = mesh_centroid + centroids[c];
+		mesh_area += areas[c];
+	}
+
+	if (mesh_area > 0.f)
+		mesh_centroid = mesh_centroid * (1.f / mesh_area);
+
+	// Clusters facing away from the center are in front of the rest, draw them first
+	std::vector<float> sort_keys(cluster_count, 0.f);
+	for (uint32_t c = 0; c < cluster_count; ++c)
+	{
+		const float length = std::sqrt(normals[c].dot(normals[c]));
+		if (areas[c] > 0.f && length > 0.f)
+			sort_keys[c] = (centroids[c] * (1.f / areas[c]) - mesh_centroid).dot(normals[c] * (1.f / length));
+	}
+
+	std::vector<uint32_t> order(cluster_count);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sort_keys[a] > sort_keys[b]; });
+
+	std::vector<uint32_t> output;
+	output.reserve(index_count);
+	for (auto c : order)
+		output.insert(output.end(), indices + cluster_starts[c] * 3, indices + cluster_starts[c + 1] * 3);
+
+	std::memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+	return cluster_count;
+}
+
+std::vector<MeshCluster> MeshOptimizer::build_clusters(uint32_t* indices, size_t index_count, const float* positions, uint32_t vertex_count,
+	uint32_t max_triangles, uint32_t max_vertices)
+{
+	const size_t tri_count = index_count / 3;
+	std::vector<MeshCluster> clusters;
+	if (tri_count == 0)
+		return clusters;
+
+	// Vertex to triangle adjacency
+	std::vector<uint32_t> adjacency_offset(vertex_count + 1, 0);
+	for (size_t i = 0; i < tri_count * 3; ++i)
+		++adjacency_offset[indices[i] + 1];
+	for (uint32_t v = 0; v < vertex_count; ++v)
+		adjacency_offset[v + 1] += adjacency_offset[v];
+
+	std::vector<uint32_t> adjacency(adjacency_offset.back());
+	{
+		std::vector<uint32_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+		for (size_t t = 0; t < tri_count; ++t)
+			for (size_t k = 0; k < 3; ++k)
+				adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+	}
+
+	std::vector<bool> assigned(tri_count, false);
+	std::vector<uint32_t> vertex_stamp(vertex_count, 0);
+	uint32_t stamp = 0;
+
+	std::vector<uint32_t> output;
+	output.reserve(index_count);
+
+	/*
+		Grow each cluster from the first unassigned triangle, always taking the earliest adjacent triangle
+		so the cache/overdraw order is kept as far as possible.
+	*/
+	std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> candidates;
+	for (size_t seed = 0; seed < tri_count; ++seed)
+	{
+		if (assigned[seed])
+			continue;
+
+		const auto cluster_start = (uint32_t)output.size();
+		uint32_t cluster_vertices = 0, cluster_triangles = 0;
+		++stamp;
+
+		candidates = {};
+		candidates.push((uint32_t)seed);
+		while (!candidates.empty() && cluster_triangles < max_triangles)
+		{
+			const uint32_t t = candidates.top();
+			candidates.pop();
+			if (assigned[t])
+				continue;
+
+			const uint32_t* tri = &indices[t * 3];
+			uint32_t new_vertices = 0;
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				const bool repeated = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+				new_vertices += vertex_stamp[tri[k]] != stamp && !repeated ? 1 : 0;
+			}
+			if (cluster_vertices + new_vertices > max_vertices)
+				continue;
+
+			assigned[t] = true;
+			output.insert(output.end(), tri, tri + 3);
+			cluster_vertices += new_vertices;
+			++cluster_triangles;
+
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				vertex_stamp[tri[k]] = stamp;
+				for (uint32_t i = adjacency_offset[tri[k]]; i < adjacency_offset[tri[k] + 1]; ++i)
+				{
+					if (!assigned[adjacency[i]])
+						candidates.push(adjacency[i]);
+				}
+			}
+		}
+
+		// Bounds
+		MeshCluster cluster;
+		cluster.index_start = cluster_start;
+		cluster.index_count = (uint32_t)output.size() - cluster_start;
+
+		Float3 aabb_min = load_position(positions, output[cluster_start]);
+		Float3 aabb_max = aabb_min;
+		Float3 normal_sum;
+		std::vector<Float3> normals;
+		normals.reserve(cluster_triangles);
+
+		for (uint32_t i = cluster_start; i < output.size(); i += 3)
+		{
+			Float3 p[3];
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				p[k] = load_position(positions, output[i + k]);
+				aabb_min = { (std::min)(aabb_min.x, p[k].x), (std::min)(aabb_min.y, p[k].y), (std::min)(aabb_min.z, p[k].z) };
+				aabb_max = { (std::max)(aabb_max.x, p[k].x), (std::max)(aabb_max.y, p[k].y), (std::max)(aabb_max.z, p[k].z) };
+			}
+
+			// Front faces are clockwise (left handed), their face normal points towards the viewer
+			const Float3 n = (p[1] - p[0]).cross(p[2] - p[0]);
+			const float length = n.length();
+			if (length > 0.f)
+			{
+				normals.push_back(n * (1.f / length));
+				normal_sum = normal_sum + normals.back();
+			}
+		}
+
+		const Float3 center = (aabb_min + aabb_max) * 0.5f;
+		float radius = 0.f;
+		for (uint32_t i = cluster_start; i < output.size(); ++i)
+			radius = (std::max)(radius, (load_position(positions, output[i]) - center).length());
+
+		cluster.center = DirectX::SimpleMath::Vector3(center.x, center.y, center.z);
+		cluster.radius = radius;
+		cluster.aabb_min = DirectX::SimpleMath::Vector3(aabb_min.x, aabb_min.y, aabb_min.z);
+		cluster.aabb_max = DirectX::SimpleMath::Vector3(aabb_max.x, aabb_max.y, aabb_max.z);
+
+		// Cone around the average normal, only kept if every normal is within ~84 degrees of it
+		const float axis_length = normal_sum.length();
+		if (axis_length > 0.f)
+		{
+			const Float3 axis = normal_sum * (1.f / axis_length);
+			float min_dot = 1.f;
+			for (const auto& n : normals)
+				min_dot = (std::min)(min_dot, n.dot(axis));
+
+			cluster.cone_axis = DirectX::SimpleMath::Vector3(axis.x, axis.y, axis.z);
+			cluster.cone_cutoff = min_dot > 0.1f ? std::sqrt(1.f - min_dot * min_dot) : 1.f;
+		}
+
+		clusters.push_back(cluster);
+	}
+
+	std::memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+	return clusters;
+}
+
+void MeshOptimizer::optimize_vertex_fetch(uint32_t* indices, size_t index_count, uint32_t vertex_count, std::vector<uint32_t>& remap)
+{
+	constexpr uint32_t unused = ~0u;
+	std::vector<uint32_t> new_index(vertex_count, unused);
+
+	remap.clear();
+	for (size_t i = 0; i < index_count; ++i)
+	{
+		uint32_t& v = new_index[indices[i]];
+		if (v == unused)
+		{
+			v = (uint32_t)remap.size();
+			remap.push_back(indices[i]);
+		}
+		indices[i] = v;
+	}
+}
+
+MeshOptimizer::Result MeshOptimizer::optimize(const ModelSourceView& source, const Settings& settings)
+{
+	// Every vertex needs a uv for the vertices to be reordered (see AssimpLoader)
+	assert(source.uv_count == 0 || source.uv_count == source.vertex_count);
+	const bool has_uvs = source.uv_count == source.vertex_count;
+
+	struct MeshOutput
+	{
+		std::vector<uint32_t> indices;
+		std::vector<uint32_t> remap;		// local output vertex --> local source vertex
+		std::vector<MeshCluster> clusters;	// index_start local to the mesh
+		std::vector<std::vector<uint32_t>> lods;	// levels after the full mesh
+		std::vector<float> lod_errors;
+	};
+
+	const auto mesh_count = (uint32_t)source.meshes.size();
+	const auto src_indices = (const uint32_t*)source.indices;
+
+	Result result;
+	result.materials = source.materials;
+	result.meshes.resize(mesh_count);
+	result.stats.resize(mesh_count);
+	std::vector<MeshOutput> outputs(mesh_count);
+
+	// Meshes are independent
+	for_each_mesh(mesh_count, [&](uint32_t m)
+		{
+			const auto& mesh = source.meshes[m];
+			auto& out = outputs[m];
+			auto& stats = result.stats[m];
+
+			out.indices.assign(src_indices + mesh.index_start, src_indices + mesh.index_start + mesh.index_count);
+
+			// Indices are local to the mesh, its vertices are the ones up to the highest index
+			uint32_t vertex_count = 0;
+			for (auto i : out.indices)
+				vertex_count = (std::max)(vertex_count, i + 1);
+			vertex_count = (std::min)(vertex_count, source.vertex_count - mesh.vertex_start);
+
+			const float* positions = source.positions + (size_t)mesh.vertex_start * 3;
+			const size_t index_count = out.indices.size();
+
+			stats.triangle_count = (uint32_t)(index_count / 3);
+			stats.acmr_before = compute_acmr(out.indices.data(), index_count, vertex_count);
+			stats.fetch_before = compute_fetch_ratio(out.indices.data(), index_count, vertex_count, 3 * sizeof(float));
+			stats.index_bytes_before = index_count * sizeof(uint32_t);
+
+			if (settings.vertex_cache)
+				optimize_vertex_cache(out.indices.data(), index_count, vertex_count);
+
+			if (settings.overdraw)
+				stats.overdraw_clusters = optimize_overdraw(out.indices.data(), index_count, positions, vertex_count, settings.overdraw_threshold);
+
+			if (settings.clusters)
+			{
+				out.clusters = build_clusters(out.indices.data(), index_count, positions, vertex_count, settings.cluster_max_triangles, settings.cluster_max_vertices);
+				stats.clusters = (uint32_t)out.clusters.size();
+			}
+
+			// Each level is simplified from the previous one, errors add up
+			const float max_error = settings.lod_max_error * MeshSimplifier::compute_extent(out.indices.data(), index_count, positions);
+			float lod_error = 0.f;
+			const std::vector<uint32_t>* previous = &out.indices;
+			for (uint32_t level = 1; level < settings.lod_count; ++level)
+			{
+				const auto target = (size_t)(previous->size() / 3 * settings.lod_reduction) * 3;
+				float error = 0.f;
+				auto lod = MeshSimplifier::simplify(previous->data(), previous->size(), positions, vertex_count, target, max_error, &error);
+				if (lod.empty() || lod.size() > previous->size() * settings.lod_min_reduction)
+					break;
+
+				optimize_vertex_cache(lod.data(), lod.size(), vertex_count);
+				lod_error += error;
+				out.lods.push_back(std::move(lod));
+				out.lod_errors.push_back(lod_error);
+				previous = &out.lods.back();
+			}
+
+			if (settings.vertex_fetch)
+				optimize_vertex_fetch(out.indices.data(), index_count, vertex_count, out.remap);
+			else
+			{
+				out.remap.resize(vertex_count);
+				std::iota(out.remap.begin(), out.remap.end(), 0);
+			}
+
+			// LODs only reference vertices of the full mesh
+			if (!out.lods.empty())
+			{
+				std::vector<uint32_t> new_index(vertex_count, 0);
+				for (uint32_t v = 0; v < (uint32_t)out.remap.size(); ++v)
+					new_index[out.remap[v]] = v;
+				for (auto& lod : out.lods)
+				{
+					for (auto& i : lod)
+						i = new_index[i];
+				}
+			}
+			stats.lods = out.lods.empty() ? 0 : (uint32_t)out.lods.size() + 1;
+			stats.last_lod_triangles = (uint32_t)((out.lods.empty() ? index_count : out.lods.back().size()) / 3);
+
+			stats.vertex_count = (uint32_t)out.remap.size();
+			stats.acmr_after = compute_acmr(out.indices.data(), index_count, stats.vertex_count);
+			stats.fetch_after = compute_fetch_ratio(out.indices.data(), index_count, stats.vertex_count, 3 * sizeof(float));
+
+			const bool fits_16bit = settings.index_16bit && stats.vertex_count <= 65536;
+			result.meshes[m].index_stride = fits_16bit ? sizeof(uint16_t) : sizeof(uint32_t);
+			stats.index_bytes_after = index_count * result.meshes[m].index_stride;
+		});
+
+	// Vertices, in mesh order
+	size_t total_vertices = 0;
+	for (const auto& out : outputs)
+		total_vertices += out.remap.size();
+
+	result.positions.reserve(total_vertices * 3);
+	result.normals.reserve(total_vertices * 3);
+	if (has_uvs)
+		result.uvs.reserve(total_vertices * 2);
+
+	for (uint32_t m = 0; m < mesh_count; ++m)
+	{
+		const uint32_t base = source.meshes[m].vertex_start;
+		result.meshes[m].vertex_start = (uint32_t)(result.positions.size() / 3);
+
+		for (auto v : outputs[m].remap)
+		{
+			const size_t src = (size_t)base + v;
+			result.positions.insert(result.positions.end(), source.positions + src * 3, source.positions + src * 3 + 3);
+			result.normals.insert(result.normals.end(), source.normals + src * 3, source.normals + src * 3 + 3);
+			if (has_uvs)
+				result.uvs.insert(result.uvs.end(), source.uvs + src * 2, source.uvs + src * 2 + 2);
+		}
+	}
+
+	// Indices: all 16 bit meshes, padding to 4 bytes, all 32 bit meshes
+	uint64_t bytes_16 = 0, bytes_32 = 0;
+	for (uint32_t m = 0; m < mesh_count; ++m)
+	{
+		uint64_t count = outputs[m].indices.size();
+		for (const auto& lod : outputs[m].lods)
+			count += lod.size();
+
+		if (result.meshes[m].index_stride == sizeof(uint16_t))
+			bytes_16 += count * sizeof(uint16_t);
+		else
+			bytes_32 += count * sizeof(uint32_t);
+	}
+
+	const uint64_t offset_32 = (bytes_16 + 3) & ~3ull;
+	result.indices.resize(offset_32 + bytes_32, 0);
+
+	uint64_t cursor_16 = 0, cursor_32 = offset_32;
+	for (uint32_t m = 0; m < mesh_count; ++m)
+	{
+		auto& mesh = result.meshes[m];
+
+		// Returns the index_start of the written range
+		auto write_indices = [&](const std::vector<uint32_t>& indices)
+		{
+			if (mesh.index_stride == sizeof(uint16_t))
+			{
+				const auto start = (uint32_t)(cursor_16 / sizeof(uint16_t));
+				auto dst = (uint16_t*)(result.indices.data() + cursor_16);
+				for (size_t i = 0; i < indices.size(); ++i)
+					dst[i] = (uint16_t)indices[i];
+				cursor_16 += indices.size() * sizeof(uint16_t);
+				return start;
+			}
+
+			const auto start = (uint32_t)(cursor_32 / sizeof(uint32_t));
+			std::memcpy(result.indices.data() + cursor_32, indices.data(), indices.size() * sizeof(uint32_t));
+			cursor_32 += indices.size() * sizeof(uint32_t);
+			return start;
+		};
+
+		mesh.index_count = (uint32_t)outputs[m].indices.size();
+		mesh.index_start = write_indices(outputs[m].indices);
+
+		if (!outputs[m].lods.empty())
+		{
+			mesh.lod_start = (uint32_t)result.lods.size();
+			mesh.lod_count = (uint32_t)outputs[m].lods.size() + 1;
+			result.lods.push_back({ mesh.index_start, mesh.index_count, 0.f });
+			for (size_t l = 0; l < outputs[m].lods.size(); ++l)
+			{
+				const auto& lod = outputs[m].lods[l];
+				result.lods.push_back({ write_indices(lod), (uint32_t)lod.size(), outputs[m].lod_errors[l] });
+			}
+		}
+
+		mesh.cluster_start = (uint32_t)result.clusters.size();
+		mesh.cluster_count = (uint32_t)outputs[m].clusters.size();
+		for (auto cluster : outputs[m].clusters)
+		{
+			cluster.index_start += mesh.index_start;
+			result.clusters.push_back(cluster);
+		}
+	}
+
+	return result;
+}
+
+void MeshOptimizer::print_stats(const std::filesystem::path& path, const std::vector<MeshStats>& stats)
+{
+	uint64_t triangles = 0, misses_before = 0, misses_after = 0;
+	uint64_t index_bytes_before = 0, index_bytes_after = 0;
+	uint32_t meshes_16bit = 0;
+
+	fmt::print("Mesh optimization: {}\n", path.string());
+	for (size_t i = 0; i < stats.size(); ++i)
+	{
+		const auto& s = stats[i];
+		fmt::print("\tmesh {:4}: {:7} tris {:7} verts   ACMR {:.3f} -> {:.3f}   fetch {:.2f} -> {:.2f}   {:5} overdraw clusters   {:5} clusters   {} LODs (last {} tris)   index bytes saved {}\n",
+			i, s.triangle_count, s.vertex_count, s.acmr_before, s.acmr_after, s.fetch_before, s.fetch_after, s.overdraw_clusters, s.clusters,
+			s.lods, s.last_lod_triangles, s.index_bytes_before - s.index_bytes_after);
+
+		triangles += s.triangle_count;
+		misses_before += (uint64_t)std::llround(s.acmr_before * s.triangle_count);
+		misses_after += (uint64_t)std::llround(s.acmr_after * s.triangle_count);
+		index_bytes_before += s.index_bytes_before;
+		index_bytes_after += s.index_bytes_after;
+		meshes_16bit += s.index_bytes_after < s.index_bytes_before ? 1 : 0;
+	}
+
+	if (triangles == 0)
+		return;
+
+	fmt::print("\ttotal: {} meshes ({} with 16 bit indices), ACMR {:.3f} -> {:.3f}, index bytes {} -> {}\n",
+		stats.size(), meshes_16bit, misses_before / (double)triangles, misses_after / (double)triangles, index_bytes_before, index_bytes_after);
+}
@@ -0,0 +1,306 @@
+#include "pch.h"
+#include "Graphics/MeshSimplifier.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+	struct Vec3
+	{
+		double x = 0.0, y = 0.0, z = 0.0;
+
+		Vec3 operator-(const Vec3& o) const { return { x - o.x, y - o.y, z - o.z }; }
+		double dot(const Vec3& o) const { return x * o.x + y * o.y + z * o.z; }
+		Vec3 cross(const Vec3& o) const { return { y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x }; }
+		double length() const { return std::sqrt(dot(*this)); }
+	};
+
+	Vec3 load_position(const float* positions, uint32_t vertex)
+	{
+		return { positions[3 * vertex + 0], positions[3 * vertex + 1], positions[3 * vertex + 2] };
+	}
+
+	// Symmetric 4x4 plane quadric plus the area it was accumulated from
+	struct Quadric
+	{
+		double a2 = 0, ab = 0, ac = 0, ad = 0;
+		double b2 = 0, bc = 0, bd = 0;
+		double c2 = 0, cd = 0;
+		double d2 = 0;
+		double weight = 0;
+
+		static Quadric from_plane(const Vec3& n, double d, double weight)
+		{
+			Quadric q;
+			q.a2 = n.x * n.x * weight; q.ab = n.x * n.y * weight; q.ac = n.x * n.z * weight; q.ad = n.x * d * weight;
+			q.b2 = n.y * n.y * weight; q.bc = n.y * n.z * weight; q.bd = n.y * d * weight;
+			q.c2 = n.z * n.z * weight; q.cd = n.z * d * weight;
+			q.d2 = d * d * weight;
+			q.weight = weight;
+			return q;
+		}
+
+		Quadric& operator+=(const Quadric& o)
+		{
+			a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+			b2 += o.b2; bc += o.bc; bd += o.bd;
+			c2 += o.c2; cd += o.cd;
+			d2 += o.d2;
+			weight += o.weight;
+			return *this;
+		}
+
+		// Area weighted squared distance of p to the planes
+		double evaluate(const Vec3& p) const
+		{
+			const double rx = a2 * p.x + ab * p.y + ac * p.z + ad;
+			const double ry = ab * p.x + b2 * p.y + bc * p.z + bd;
+			const double rz = ac * p.x + bc * p.y + c2 * p.z + cd;
+			const double rw = ad * p.x + bd * p.y + cd * p.z + d2;
+			const double e = rx * p.x + ry * p.y + rz * p.z + rw;
+			return weight > 0.0 ? std::abs(e) / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double error;
+	};
+
+	// Vertex to triangle adjacency of the current index list
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		void build(const std::vector<uint32_t>& indices, uint32_t vertex_count)
+		{
+			offsets.assign(vertex_count + 1, 0);
+			for (auto i : indices)
+				++offsets[i + 1];
+			for (uint32_t v = 0; v < vertex_count; ++v)
+				offsets[v + 1] += offsets[v];
+
+			triangles.resize(indices.size());
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); ++i)
+				triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+		}
+	};
+}
+
+float MeshSimplifier::compute_extent(const uint32_t* indices, size_t index_count, const float* positions)
+{
+	if (index_count == 0)
+		return 0.f;
+
+	Vec3 min = { DBL_MAX, DBL_MAX, DBL_MAX }, max = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+	for (size_t i = 0; i < index_count; ++i)
+	{
+		const Vec3 p = load_position(positions, indices[i]);
+		min = { (std::min)(min.x, p.x), (std::min)(min.y, p.y), (std::min)(min.z, p.z) };
+		max = { (std::max)(max.x, p.x), (std::max)(max.y, p.y), (std::max)(max.z, p.z) };
+	}
+	return (float)(max - min).length();
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(const uint32_t* source_indices, size_t index_count, const float* positions, uint32_t vertex_count,
+	size_t target_index_count, float target_error, float* result_error)
+{
+	std::vector<uint32_t> indices(source_indices, source_indices + index_count);
+	if (result_error)
+		*result_error = 0.f;
+	if (index_count <= target_index_count)
+		return indices;
+
+	// Vertices sharing a position are one wedge, a wedge with more than one vertex is an attribute seam
+	std::vector<uint32_t> wedge(vertex_count);
+	std::vector<bool> locked(vertex_count, false);
+	{
+		struct PositionHash
+		{
+			size_t operator()(const std::array<float, 3>& p) const
+			{
+				uint32_t h[3];
+				std::memcpy(h, p.data(), sizeof(h));
+				return ((size_t)h[0] * 73856093u) ^ ((size_t)h[1] * 19349663u) ^ ((size_t)h[2] * 83492791u);
+			}
+		};
+
+		std::unordered_map<std::array<float, 3>, uint32_t, PositionHash> first_vertex;
+		first_vertex.reserve(vertex_count);
+		std::vector<uint32_t> wedge_size(vertex_count, 0);
+		for (uint32_t v = 0; v < vertex_count; ++v)
+		{
+			const std::array<float, 3> p = { positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2] };
+			wedge[v] = first_vertex.insert({ p, v }).first->second;
+			++wedge_size[wedge[v]];
+		}
+		for (uint32_t v = 0; v < vertex_count; ++v)
+			locked[v] = wedge_size[wedge[v]] > 1;
+	}
+
+	// Open border: a directed edge between wedges without its opposite
+	{
+		std::unordered_map<uint64_t, uint32_t> edges;
+		edges.reserve(index_count);
+		auto key = [](uint32_t a, uint32_t b) { return ((uint64_t)a << 32) | b; };
+		for (size_t i = 0; i < index_count; i += 3)
+			for (uint32_t k = 0; k < 3; ++k)
+				++edges[key(wedge[indices[i + k]], wedge[indices[i + (k + 1) % 3]])];
+
+		for (size_t i = 0; i < index_count; i += 3)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				const uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+				if (edges.find(key(wedge[b], wedge[a])) == edges.end())
+				{
+					locked[a] = true;
+					locked[b] = true;
+				}
+			}
+		}
+	}
+
+	// Plane quadrics of the source triangles, area weighted
+	std::vector<Quadric> quadrics(vertex_count);
+	for (size_t i = 0; i < index_count; i += 3)
+	{
+		const Vec3 p0 = load_position(positions, indices[i + 0]);
+		const Vec3 p1 = load_position(positions, indices[i + 1]);
+		const Vec3 p2 = load_position(positions, indices[i + 2]);
+
+		Vec3 n = (p1 - p0).cross(p2 - p0);
+		const double length = n.length();
+		if (length <= 0.0)
+			continue;
+		n = { n.x / length, n.y / length, n.z / length };
+
+		const auto q = Quadric::from_plane(n, -n.dot(p0), length * 0.5);
+		for (uint32_t k = 0; k < 3; ++k)
+			quadrics[indices[i + k]] += q;
+	}
+
+	const double error_limit = (double)target_error * target_error;
+	double max_error = 0.0;
+
+	Adjacency adjacency;
+	std::vector<uint32_t> remap(vertex_count);
+	std::vector<bool> touched(vertex_count);
+	std::vector<Collapse> collapses;
+
+	/*
+		Passes of independent collapses: every vertex gets its cheapest edge, the cheapest ones are applied as long as
+		they don't touch the one-ring of a vertex collapsed earlier in the same pass, then the index list is rebuilt.
+	*/
+	while (indices.size() > target_index_count)
+	{
+		adjacency.build(indices, vertex_count);
+
+		collapses.clear();
+		std::vector<Collapse> best(vertex_count, { 0, 0, DBL_MAX });
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				const uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+				for (const auto [from, to] : { std::pair{ a, b }, std::pair{ b, a } })
+				{
+					if (locked[from])
+						continue;
+
+					Quadric q = quadrics[from];
+					q += quadrics[to];
+					const double error = q.evaluate(load_position(positions, to));
+					if (error < best[from].error)
+						best[from] = { from, to, error };
+				}
+			}
+		}
+		for (const auto& c : best)
+		{
+			if (c.error <= error_limit)
+				collapses.push_back(c);
+		}
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+		// An interior collapse removes two triangles
+		const size_t collapse_goal = (std::max)((indices.size() - target_index_count) / 6, (size_t)1);
+		size_t collapsed = 0;
+
+		std::iota(remap.begin(), remap.end(), 0);
+		std::fill(touched.begin(), touched.end(), false);
+
+		for (const auto& c : collapses)
+		{
+			if (collapsed >= collapse_goal)
+				break;
+			if (touched[c.from] || touched[c.to])
+				continue;
+
+			// Reject collapses flipping or badly distorting a remaining triangle
+			const Vec3 target = load_position(positions, c.to);
+			bool flips = false;
+			for (uint32_t t = adjacency.offsets[c.from]; t < adjacency.offsets[c.from + 1] && !flips; ++t)
+			{
+				const uint32_t* tri = &indices[adjacency.triangles[t] * 3];
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+					continue;		// degenerates and is removed
+
+				Vec3 before[3], after[3];
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					before[k] = load_position(positions, tri[k]);
+					after[k] = tri[k] == c.from ? target : before[k];
+				}
+				const Vec3 n0 = (before[1] - before[0]).cross(before[2] - before[0]);
+				const Vec3 n1 = (after[1] - after[0]).cross(after[2] - after[0]);
+				flips = n0.dot(n1) <= 0.25 * n0.length() * n1.length();
+			}
+			if (flips)
+				continue;
+
+			remap[c.from] = c.to;
+			quadrics[c.to] += quadrics[c.from];
+			max_error = (std::max)(max_error, c.error);
+			++collapsed;
+
+			// The one-ring of the collapsed vertex changed, no more collapses around it this pass
+			for (uint32_t t = adjacency.offsets[c.from]; t < adjacency.offsets[c.from + 1]; ++t)
+			{
+				const uint32_t* tri = &indices[adjacency.triangles[t] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+		}
+
+		if (collapsed == 0)
+			break;
+
+		// Apply, dropping the degenerate triangles
+		size_t write = 0;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			const uint32_t a = remap[indices[i + 0]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+	}
+
+	if (result_error)
+		*result_error = (float)std::sqrt(max_error);
+	return indices;
+}
@@ -0,0 +1,425 @@
+#include "pch.h"
+#include "Graphics/MipGenerator.h"
+#include "Graphics/API/GfxHelperTypes.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace jobs { extern ThreadPool* pool; }
+
+// The AVX2 paths are built into every binary and picked at runtime (MSVC emits AVX intrinsics without /arch:AVX2)
+#if defined(_MSC_VER)
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+namespace
+{
+	using Format = MipGenerator::Format;
+
+	// Levels with fewer rows than this are filtered on the calling thread, the split costs more than the work
+	constexpr uint32_t MIN_PARALLEL_ROWS = 64;
+
+	bool has_avx2()
+	{
+		static const bool avx2 = []()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			// The OS has to save the YMM registers too (OSXSAVE + AVX, then XCR0)
+			__cpuid(info, 1);
+			if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+				return false;
+
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2") != 0;
+#endif
+		}();
+		return avx2;
+	}
+
+	template <typename Func>
+	void for_each_row(uint32_t rows, bool parallel, Func&& func)
+	{
+		if (parallel && jobs::pool)
+			jobs::pool->parallel_for(rows, func);
+		else
+		{
+			for (uint32_t i = 0; i < rows; ++i)
+				func(i);
+		}
+	}
+
+	const std::array<float, 256>& get_srgb_to_linear()
+	{
+		static const auto table = []()
+		{
+			std::array<float, 256> t{};
+			for (int i = 0; i < 256; ++i)
+			{
+				const float c = i / 255.f;
+				t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return t;
+		}();
+		return table;
+	}
+
+	// Indexed by linear * 65535, fine enough for the steep part of the curve near black
+	const std::vector<uint8_t>& get_linear_to_srgb()
+	{
+		static const auto table = []()
+		{
+			std::vector<uint8_t> t(65536);
+			for (size_t i = 0; i < t.size(); ++i)
+			{
+				const float v = i / 65535.f;
+				const float c = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.f / 2.4f) - 0.055f;
+				t[i] = (uint8_t)(std::clamp(c, 0.f, 1.f) * 255.f + 0.5f);
+			}
+			return t;
+		}();
+		return table;
+	}
+
+	uint32_t clamp_index(int64_t i, uint32_t count)
+	{
+		return (uint32_t)std::clamp<int64_t>(i, 0, (int64_t)count - 1);
+	}
+
+	void decode_row(const uint8_t* src, float* dst, uint32_t width, Format format)
+	{
+		if (format == Format::eRGBA32_FLOAT)
+		{
+			std::memcpy(dst, src, (size_t)width * 4 * sizeof(float));
+			return;
+		}
+
+		const auto& to_linear = get_srgb_to_linear();
+		const bool srgb = format == Format::eRGBA8_SRGB;
+		for (uint32_t i = 0; i < width * 4; ++i)
+			dst[i] = srgb && (i & 3) != 3 ? to_linear[src[i]] : src[i] / 255.f;
+	}
+
+	void encode_row(const float* src, uint8_t* dst, uint32_t width, Format format, bool simd)
+	{
+		if (format == Format::eRGBA32_FLOAT)
+		{
+			std::memcpy(dst, src, (size_t)width * 4 * sizeof(float));
+			return;
+		}
+
+		const auto& to_srgb = get_linear_to_srgb();
+		const bool srgb = format == Format::eRGBA8_SRGB;
+
+		if (!simd)
+		{
+			for (uint32_t i = 0; i < width * 4; ++i)
+			{
+				const float v = std::clamp(src[i], 0.f, 1.f);
+				dst[i] = srgb && (i & 3) != 3 ? to_srgb[(size_t)(v * 65535.f + 0.5f)] : (uint8_t)(v * 255.f + 0.5f);
+			}
+			return;
+		}
+
+		// Color to LUT indices (sRGB) or 8 bit values, alpha always to 8 bit
+		const __m128 scale = srgb ? _mm_setr_ps(65535.f, 65535.f, 65535.f, 255.f) : _mm_set1_ps(255.f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + 4 * x), zero), one);
+			const __m128i q = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half));
+
+			if (srgb)
+			{
+				alignas(16) int32_t idx[4];
+				_mm_store_si128((__m128i*)idx, q);
+				dst[4 * x + 0] = to_srgb[idx[0]];
+				dst[4 * x + 1] = to_srgb[idx[1]];
+				dst[4 * x + 2] = to_srgb[idx[2]];
+				dst[4 * x + 3] = (uint8_t)idx[3];
+			}
+			else
+			{
+				const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q, q), _mm_setzero_si128());
+				const int32_t texel = _mm_cvtsi128_si32(packed);
+				std::memcpy(dst + 4 * x, &texel, 4);
+			}
+		}
+	}
+
+	// 2x2 box of source rows r0 and r1
+	void box_row_scalar(const float* r0, const float* r1, float* out, uint32_t src_w, uint32_t dst_w)
+	{
+		for (uint32_t x = 0; x < dst_w; ++x)
+		{
+			const uint32_t x0 = clamp_index(2 * (int64_t)x, src_w);
+			const uint32_t x1 = clamp_index(2 * (int64_t)x + 1, src_w);
+			for (uint32_t c = 0; c < 4; ++c)
+				out[4 * x + c] = (r0[4 * x0 + c] + r0[4 * x1 + c] + r1[4 * x0 + c] + r1[4 * x1 + c]) * 0.25f;
+		}
+	}
+
+	// Two destination texels per iteration while all four source texels are in range, returns the texels done
+	AVX2_TARGET uint32_t box_row_avx2(const float* r0, const float* r1, float* out, uint32_t src_w, uint32_t dst_w)
+	{
+		uint32_t x = 0;
+		const __m256 quarter8 = _mm256_set1_ps(0.25f);
+		for (; x + 1 < dst_w && 2 * x + 3 < src_w; x += 2)
+		{
+			// Summed in the same order as the SSE path so both give the same texels
+			const __m256 a0 = _mm256_loadu_ps(r0 + 8 * x), b0 = _mm256_loadu_ps(r0 + 8 * x + 8);		// texels 2x, 2x+1 and 2x+2, 2x+3
+			const __m256 a1 = _mm256_loadu_ps(r1 + 8 * x), b1 = _mm256_loadu_ps(r1 + 8 * x + 8);
+			const __m256 top = _mm256_add_ps(_mm256_permute2f128_ps(a0, b0, 0x20), _mm256_permute2f128_ps(a0, b0, 0x31));
+			const __m256 bottom = _mm256_add_ps(_mm256_permute2f128_ps(a1, b1, 0x20), _mm256_permute2f128_ps(a1, b1, 0x31));
+			_mm256_storeu_ps(out + 4 * x, _mm256_mul_ps(_mm256_add_ps(top, bottom), quarter8));
+		}
+		return x;
+	}
+
+	void box_row_simd(const float* r0, const float* r1, float* out, uint32_t src_w, uint32_t dst_w, bool avx2)
+	{
+		uint32_t x = avx2 ? box_row_avx2(r0, r1, out, src_w, dst_w) : 0;
+
+		const __m128 quarter = _mm_set1_ps(0.25f);
+		for (; x < dst_w; ++x)
+		{
+			const uint32_t x0 = clamp_index(2 * (int64_t)x, src_w);
+			const uint32_t x1 = clamp_index(2 * (int64_t)x + 1, src_w);
+			const __m128 top = _mm_add_ps(_mm_loadu_ps(r0 + 4 * x0), _mm_loadu_ps(r0 + 4 * x1));
+			const __m128 bottom = _mm_add_ps(_mm_loadu_ps(r1 + 4 * x0), _mm_loadu_ps(r1 + 4 * x1));
+			_mm_storeu_ps(out + 4 * x, _mm_mul_ps(_mm_add_ps(top, bottom), quarter));
+		}
+	}
+
+	// Horizontal [1 3 3 1] / 8 over source texels 2x-1 .. 2x+2
+	void tent_h_row_scalar(const float* src, float* out, uint32_t src_w, uint32_t dst_w)
+	{
+		for (uint32_t x = 0; x < dst_w; ++x)
+		{
+			const uint32_t x0 = clamp_index(2 * (int64_t)x - 1, src_w);
+			const uint32_t x1 = clamp_index(2 * (int64_t)x, src_w);
+			const uint32_t x2 = clamp_index(2 * (int64_t)x + 1, src_w);
+			const uint32_t x3 = clamp_index(2 * (int64_t)x + 2, src_w);
+			for (uint32_t c = 0; c < 4; ++c)
+				out[4 * x + c] = (src[4 * x0 + c] + 3.f * (src[4 * x1 + c] + src[4 * x2 + c]) + src[4 * x3 + c]) * 0.125f;
+		}
+	}
+
+	// Interior only: two destination texels per iteration from source texels 2x-1 .. 2x+4, from x = 1 up to the returned end
+	AVX2_TARGET uint32_t tent_h_row_avx2(const float* src, float* out, uint32_t src_w, uint32_t dst_w)
+	{
+		const __m256 three8 = _mm256_set1_ps(3.f);
+		const __m256 eighth8 = _mm256_set1_ps(0.125f);
+
+		uint32_t x = 1;
+		for (; x + 1 < dst_w && 2 * x + 4 < src_w; x += 2)
+		{
+			const float* s = src + 4 * (2 * x - 1);
+			const __m256 l0 = _mm256_loadu_ps(s);			// 2x-1, 2x
+			const __m256 l1 = _mm256_loadu_ps(s + 8);		// 2x+1, 2x+2
+			const __m256 l2 = _mm256_loadu_ps(s + 16);		// 2x+3, 2x+4
+			const __m256 t0 = _mm256_permute2f128_ps(l0, l1, 0x20);
+			const __m256 t1 = _mm256_permute2f128_ps(l0, l1, 0x31);
+			const __m256 t2 = _mm256_permute2f128_ps(l1, l2, 0x20);
+			const __m256 t3 = _mm256_permute2f128_ps(l1, l2, 0x31);
+			const __m256 sum = _mm256_add_ps(_mm256_add_ps(t0, t3), _mm256_mul_ps(_mm256_add_ps(t1, t2), three8));
+			_mm256_storeu_ps(out + 4 * x, _mm256_mul_ps(sum, eighth8));
+		}
+		return x;
+	}
+
+	void tent_h_row_simd(const float* src, float* out, uint32_t src_w, uint32_t dst_w, bool avx2)
+	{
+		const __m128 three = _mm_set1_ps(3.f);
+		const __m128 eighth = _mm_set1_ps(0.125f);
+
+		// Texel 0 clamps on the left, the interior goes to AVX2, the rest (right edge) below
+		const uint32_t interior_end = avx2 && dst_w > 1 ? tent_h_row_avx2(src, out, src_w, dst_w) : 1;
+
+		for (uint32_t x = 0; x < dst_w; x = (x == 0 && interior_end > 1) ? interior_end : x + 1)
+		{
+			const __m128 p0 = _mm_loadu_ps(src + 4 * clamp_index(2 * (int64_t)x - 1, src_w));
+			const __m128 p1 = _mm_loadu_ps(src + 4 * clamp_index(2 * (int64_t)x, src_w));
+			const __m128 p2 = _mm_loadu_ps(src + 4 * clamp_index(2 * (int64_t)x + 1, src_w));
+			const __m128 p3 = _mm_loadu_ps(src + 4 * clamp_index(2 * (int64_t)x + 2, src_w));
+			const __m128 sum = _mm_add_ps(_mm_add_ps(p0, p3), _mm_mul_ps(_mm_add_ps(p1, p2), three));
+			_mm_storeu_ps(out + 4 * x, _mm_mul_ps(sum, eighth));
+		}
+	}
+
+	// Vertical [1 3 3 1] / 8 of four horizontally filtered rows
+	void tent_v_row_scalar(const float* a, const float* b, const float* c, const float* d, float* out, uint32_t floats)
+	{
+		for (uint32_t i = 0; i < floats; ++i)
+			out[i] = (a[i] + 3.f * (b[i] + c[i]) + d[i]) * 0.125f;
+	}
+
+	// Returns the floats done, a multiple of 8
+	AVX2_TARGET uint32_t tent_v_row_avx2(const float* a, const float* b, const float* c, const float* d, float* out, uint32_t floats)
+	{
+		uint32_t i = 0;
+		const __m256 three8 = _mm256_set1_ps(3.f);
+		const __m256 eighth8 = _mm256_set1_ps(0.125f);
+		for (; i + 8 <= floats; i += 8)
+		{
+			const __m256 outer = _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(d + i));
+			const __m256 inner = _mm256_add_ps(_mm256_loadu_ps(b + i), _mm256_loadu_ps(c + i));
+			_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_add_ps(outer, _mm256_mul_ps(inner, three8)), eighth8));
+		}
+		return i;
+	}
+
+	void tent_v_row_simd(const float* a, const float* b, const float* c, const float* d, float* out, uint32_t floats, bool avx2)
+	{
+		uint32_t i = avx2 ? tent_v_row_avx2(a, b, c, d, out, floats) : 0;
+
+		const __m128 three = _mm_set1_ps(3.f);
+		const __m128 eighth = _mm_set1_ps(0.125f);
+		for (; i < floats; i += 4)
+		{
+			const __m128 outer = _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(d + i));
+			const __m128 inner = _mm_add_ps(_mm_loadu_ps(b + i), _mm_loadu_ps(c + i));
+			_mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(outer, _mm_mul_ps(inner, three)), eighth));
+		}
+	}
+}
+
+DXGI_FORMAT MipGenerator::MipChain::get_dxgi_format() const
+{
+	switch (format)
+	{
+	case Format::eRGBA8_SRGB:
+		return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	case Format::eRGBA8_UNORM:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case Format::eRGBA32_FLOAT:
+		return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	default:
+		assert(false);
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+std::vector<SubresourceData> MipGenerator::MipChain::get_subresources() const
+{
+	std::vector<SubresourceData> subres;
+	subres.reserve(levels.size());
+	for (const auto& level : levels)
+		subres.push_back(SubresourceData((void*)(data.data() + level.offset), level.row_pitch, 0));
+	return subres;
+}
+
+uint32_t MipGenerator::get_bytes_per_texel(Format format)
+{
+	return format == Format::eRGBA32_FLOAT ? 4 * sizeof(float) : 4;
+}
+
+uint32_t MipGenerator::get_level_count(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	for (uint32_t size = (std::max)(width, height); size > 1; size >>= 1)
+		++count;
+	return count;
+}
+
+MipGenerator::MipChain MipGenerator::generate(const void* pixels, uint32_t width, uint32_t height, Format format, const Settings& settings)
+{
+	MipChain chain;
+	chain.format = format;
+	if (!pixels || width == 0 || height == 0)
+		return chain;
+
+	uint32_t level_count = get_level_count(width, height);
+	if (settings.max_levels > 0)
+		level_count = (std::min)(level_count, settings.max_levels);
+
+	// Layout
+	const uint32_t bytes_per_texel = get_bytes_per_texel(format);
+	size_t offset = 0;
+	chain.levels.resize(level_count);
+	for (uint32_t i = 0; i < level_count; ++i)
+	{
+		auto& level = chain.levels[i];
+		level.width = (std::max)(width >> i, 1u);
+		level.height = (std::max)(height >> i, 1u);
+		level.row_pitch = level.width * bytes_per_texel;
+		level.offset = offset;
+		offset += (size_t)level.row_pitch * level.height;
+	}
+	chain.data.resize(offset);
+	std::memcpy(chain.data.data(), pixels, (size_t)chain.levels[0].row_pitch * height);
+
+	// Every level is filtered from the linear float version of the previous one
+	std::vector<float> src((size_t)width * height * 4);
+	for_each_row(height, settings.parallel, [&](uint32_t y)
+		{
+			decode_row(chain.data.data() + (size_t)y * chain.levels[0].row_pitch, &src[(size_t)y * width * 4], width, format);
+		});
+
+	const bool avx2 = settings.simd && settings.avx2 && has_avx2();
+
+	std::vector<float> dst;
+	for (uint32_t i = 1; i < level_count; ++i)
+	{
+		const auto& prev = chain.levels[i - 1];
+		const auto& cur = chain.levels[i];
+		dst.resize((size_t)cur.width * cur.height * 4);
+
+		for_each_row(cur.height, settings.parallel && cur.height >= MIN_PARALLEL_ROWS, [&](uint32_t y)
+			{
+				float* out = &dst[(size_t)y * cur.width * 4];
+				auto src_row = [&](int64_t sy) { return &src[(size_t)clamp_index(sy, prev.height) * prev.width * 4]; };
+
+				if (settings.filter == Filter::eBox)
+				{
+					if (settings.simd)
+						box_row_simd(src_row(2 * (int64_t)y), src_row(2 * (int64_t)y + 1), out, prev.width, cur.width, avx2);
+					else
+						box_row_scalar(src_row(2 * (int64_t)y), src_row(2 * (int64_t)y + 1), out, prev.width, cur.width);
+				}
+				else
+				{
+					// Horizontal pass of source rows 2y-1 .. 2y+2, then the vertical pass
+					thread_local std::vector<float> rows;
+					const size_t row_floats = (size_t)cur.width * 4;
+					rows.resize(4 * row_floats);
+
+					for (uint32_t k = 0; k < 4; ++k)
+					{
+						const float* s = src_row(2 * (int64_t)y - 1 + k);
+						if (settings.simd)
+							tent_h_row_simd(s, &rows[k * row_floats], prev.width, cur.width, avx2);
+						else
+							tent_h_row_scalar(s, &rows[k * row_floats], prev.width, cur.width);
+					}
+
+					if (settings.simd)
+						tent_v_row_simd(&rows[0], &rows[row_floats], &rows[2 * row_floats], &rows[3 * row_floats], out, (uint32_t)row_floats, avx2);
+					else
+						tent_v_row_scalar(&rows[0], &rows[row_floats], &rows[2 * row_floats], &rows[3 * row_floats], out, (uint32_t)row_floats);
+				}
+
+				encode_row(out, chain.data.data() + cur.offset + (size_t)y * cur.row_pitch, cur.width, format, settings.simd);
+			});
+
+		std::swap(src, dst);
+	}
+
+	return chain;
+}
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Graphics/Model.h"
+#include <algorithm>
 
 Model& Model::set_vbs(const std::vector<std::tuple<BufferHandle, UINT, UINT>>& vbs_strides_offsets)
 {
@@ -26,6 +27,51 @@ Model& Model::add_mesh(Mesh mesh, const Material* mat)
 	return *this;
 }
 
+Model& Model::set_clusters(std::vector<MeshCluster> clusters)
+{
+	m_clusters = std::move(clusters);
+	return *this;
+}
+
+Model& Model::set_lods(std::vector<MeshLod> lods, const DirectX::BoundingSphere& bounds)
+{
+	m_lods = std::move(lods);
+	m_bounds = bounds;
+
+	uint32_t levels = 1;
+	for (const auto& mesh : m_meshes)
+		levels = (std::max)(levels, mesh.lod_count);
+
+	m_lod_errors.assign(levels, 0.f);
+	for (const auto& mesh : m_meshes)
+	{
+		for (uint32_t level = 0; level < levels; ++level)
+			m_lod_errors[level] = (std::max)(m_lod_errors[level], get_mesh_lod(mesh, level).error);
+	}
+	return *this;
+}
+
+Model& Model::set_texel_densities(std::vector<MeshTexelDensity> densities)
+{
+	assert(densities.size() == m_meshes.size());
+	m_texel_densities = std::move(densities);
+	return *this;
+}
+
+const MeshLod Model::get_mesh_lod(const Mesh& mesh, uint32_t level) const
+{
+	if (mesh.lod_count == 0)
+		return { mesh.index_start, mesh.index_count, 0.f };
+	return m_lods[mesh.lod_start + (std::min)(level, mesh.lod_count - 1)];
+}
+
+Model& Model::set_dequantization(const DirectX::SimpleMath::Matrix& dequantization)
+{
+	m_quantized = true;
+	m_dequantization = dequantization;
+	return *this;
+}
+
 //const std::vector<GPUBuffer>& Model::get_vbs() const
 //{
 //	return m_vbs;
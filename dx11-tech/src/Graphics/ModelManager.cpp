@@ -3,6 +3,11 @@
 #include "Graphics/API/GfxDevice.h"
 #include "Graphics/MaterialManager.h"
 #include "Graphics/ModelManager.h"
+#include "Graphics/VertexQuantizer.h"
+#include "Profiler/StartupProfiler.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cmath>
 
 namespace gfx { ModelManager* model_mgr = nullptr; }
 
@@ -22,86 +27,393 @@ void ModelManager::shutdown()
 	}
 }
 
+namespace
+{
+	ModelSourceView get_source_view(AssimpLoader& loader)
+	{
+		static_assert(sizeof(aiVector3D) == 3 * sizeof(float) && sizeof(aiVector2D) == 2 * sizeof(float));
+
+		ModelSourceView view;
+		view.positions = (const float*)loader.get_positions().data();
+		view.uvs = (const float*)loader.get_uvs().data();
+		view.normals = (const float*)loader.get_normals().data();
+		view.vertex_count = (uint32_t)loader.get_positions().size();
+		view.uv_count = (uint32_t)loader.get_uvs().size();
+		view.indices = (const uint8_t*)loader.get_indices().data();
+		view.index_bytes = loader.get_indices().size() * sizeof(uint32_t);
+		view.meshes = loader.get_meshes();
+		view.materials = loader.get_materials();
+		return view;
+	}
+
+	MeshTexelDensity compute_texel_density(const ModelSourceView& source, const AssimpMeshData& mesh)
+	{
+		MeshTexelDensity density;
+		if (mesh.index_count == 0)
+			return density;
+
+		auto get_index = [&](UINT i) -> uint32_t
+		{
+			const uint8_t* index = source.indices + ((uint64_t)mesh.index_start + i) * mesh.index_stride;
+			if (mesh.index_stride == sizeof(uint16_t))
+				return mesh.vertex_start + *(const uint16_t*)index;
+			return mesh.vertex_start + *(const uint32_t*)index;
+		};
+
+		using DirectX::SimpleMath::Vector2;
+		using DirectX::SimpleMath::Vector3;
+		const auto* positions = (const Vector3*)source.positions;
+		const auto* uvs = (const Vector2*)source.uvs;
+
+		Vector3 min = positions[get_index(0)], max = min;
+		double surface_area = 0.0, uv_area = 0.0;
+		for (UINT i = 0; i + 2 < mesh.index_count; i += 3)
+		{
+			const uint32_t v[3] = { get_index(i), get_index(i + 1), get_index(i + 2) };
+			for (auto vertex : v)
+			{
+				min = Vector3::Min(min, positions[vertex]);
+				max = Vector3::Max(max, positions[vertex]);
+			}
+
+			surface_area += 0.5 * (positions[v[1]] - positions[v[0]]).Cross(positions[v[2]] - positions[v[0]]).Length();
+			if (source.uv_count > 0)
+			{
+				const auto e0 = uvs[v[1]] - uvs[v[0]], e1 = uvs[v[2]] - uvs[v[0]];
+				uv_area += 0.5 * std::abs(e0.x * e1.y - e0.y * e1.x);
+			}
+		}
+
+		DirectX::BoundingSphere::CreateFromBoundingBox(density.bounds, DirectX::BoundingBox((min + max) * 0.5f, (max - min) * 0.5f));
+		density.uv_per_unit = surface_area > 0.0 ? (float)std::sqrt(uv_area / surface_area) : 0.f;
+		return density;
+	}
+}
+
 ModelManager::ModelManager(GfxDevice* dev, MaterialManager* mat_mgr) :
 	m_dev(dev),
-	m_mat_mgr(mat_mgr)
+	m_mat_mgr(mat_mgr),
+	m_geometry_heap(dev, GeometryHeap::Settings())
+{
+
+}
+
+ModelImport::ModelImport() = default;
+ModelImport::~ModelImport() = default;
+ModelImport::ModelImport(ModelImport&&) noexcept = default;
+ModelImport& ModelImport::operator=(ModelImport&&) noexcept = default;
+
+ModelImport ModelManager::import_model(const std::filesystem::path& path)
 {
+	auto _ = StartupProfiler::Scoped("Model import: " + path.string(), "model");
+
+	ModelImport import;
+	import.path = path;
+
+	/*
+		Prefer the baked model, only import through Assimp (and re-cook) if it is missing or stale.
+		Imported geometry goes through the MeshOptimizer first so the cook stores the optimized meshes.
+	*/
+	const auto source_hash = BakedModel::hash_source(path);
+	const auto cooked_path = BakedModel::get_cooked_path(path);
+	{
+		auto _ = StartupProfiler::Scoped("Load baked: " + path.filename().string(), "import");
+		import.baked = BakedModel(cooked_path);
+	}
+
+	if (import.baked.is_valid(source_hash))
+		import.source = import.baked.get_view();
+	else
+	{
+		{
+			AssimpLoader loader(path);
+
+			auto _ = StartupProfiler::Scoped("Mesh optimization: " + path.filename().string(), "import");
+			import.optimized = MeshOptimizer::optimize(get_source_view(loader), MeshOptimizer::Settings());
+		}
+		MeshOptimizer::print_stats(path, import.optimized.stats);
+		import.source = import.optimized.get_view();
+
+		auto _ = StartupProfiler::Scoped("Cook: " + path.filename().string(), "import");
+		if (BakedModel::cook(import.source, source_hash, cooked_path))
+			fmt::print("Cooked {} to {}\n", path.string(), cooked_path.string());
+		else
+			fmt::print(fg(fmt::color::red), "Failed to cook {} to {}\n", path.string(), cooked_path.string());
+	}
+
+	// Content key of the GPU buffers
+	{
+		auto _ = StartupProfiler::Scoped("Content hash: " + path.filename().string(), "import");
+		const auto& s = import.source;
+		uint64_t hash = utils::hash_bytes(s.positions, (size_t)s.vertex_count * 3 * sizeof(float));
+		hash = utils::hash_bytes(s.uvs, (size_t)s.uv_count * 2 * sizeof(float), hash);
+		hash = utils::hash_bytes(s.normals, (size_t)s.vertex_count * 3 * sizeof(float), hash);
+		import.geometry_hash = utils::hash_bytes(s.indices, (size_t)s.index_bytes, hash);
+	}
+
+	return import;
+}
 
+void ModelManager::decode_textures(ModelImport& import) const
+{
+	import.textures = m_mat_mgr->decode_textures(import.source.materials);
 }
 
 const Model* ModelManager::load_model(const std::filesystem::path& path, const std::string& name)
 {
 	// If path already exists, return the model
+	if (auto existing = find_model(path))
+		return existing;
+
+	return create_model(import_model(path), name);
+}
+
+const Model* ModelManager::find_model(const std::filesystem::path& path)
+{
 	auto it = m_path_mapper.find(path);
 	if (it != m_path_mapper.cend())
-		return &(m_models.find(it->second)->second);
+		return &(m_models.find(it->second)->second.model);
+	return nullptr;
+}
+
+const Model* ModelManager::create_model(ModelImport&& import, const std::string& name)
+{
+	const auto& path = import.path;
+
+	// The same path may have been imported more than once (e.g sync and async load in flight)
+	if (auto existing = find_model(path))
+		return existing;
 
 	if (m_models.find(name) != m_models.cend())
 		assert(false);		// name already taken
 
-	AssimpLoader loader(path);
+	auto model = build_model(import);
+
+	std::string model_name = name;
+	if (model_name.empty())
+		model_name = "Model" + std::to_string(m_def_counter++);
+
+	m_path_mapper.insert({ path, model_name });
+	auto ret_it = m_models.insert({ model_name, std::move(model) });
+	return &(ret_it.first->second.model);
+}
+
+ModelManager::LoadedModel ModelManager::build_model(ModelImport& import)
+{
+	const auto& path = import.path;
+	const auto& source = import.source;
+
+	auto _ = StartupProfiler::Scoped("Model: " + path.string(), "model");
 
-	const auto& positions = loader.get_positions();
-	const auto& uvs = loader.get_uvs();
-	const auto& normals = loader.get_normals();
-	const auto& indices = loader.get_indices();
-	const auto& meshes = loader.get_meshes();
-	const auto& mats = loader.get_materials();
+	const auto& meshes = source.meshes;
+	const auto& mats = source.materials;
 	assert(meshes.size() == mats.size());
 
-	auto pos_buffer = m_dev->create_buffer(BufferDesc::vertex(positions.size() * sizeof(positions[0])), SubresourceData((void*)positions.data()));
-	auto uv_buffer = m_dev->create_buffer(BufferDesc::vertex(uvs.size() * sizeof(uvs[0])), SubresourceData((void*)uvs.data()));
-	auto nor_buffer = m_dev->create_buffer(BufferDesc::vertex(normals.size() * sizeof(normals[0])), SubresourceData((void*)normals.data()));
-	auto idx_buffer = m_dev->create_buffer(BufferDesc::index(indices.size() * sizeof(indices[0])), SubresourceData((void*)indices.data()));
+	// Streams (data, stride, count), full precision or quantized
+	struct Stream
+	{
+		const void* data;
+		UINT stride;
+		UINT count;
+	};
+	std::array<Stream, 3> streams =
+	{ {
+		{ source.positions, 3 * sizeof(float), source.vertex_count },
+		{ source.uvs, 2 * sizeof(float), source.uv_count },
+		{ source.normals, 3 * sizeof(float), source.vertex_count }
+	} };
+
+	// Identical geometry already uploaded (quantized and full precision streams are different content)
+	const auto geometry_key = utils::hash_bytes(&m_quantize_vertices, sizeof(m_quantize_vertices), import.geometry_hash);
+	const SharedGeometry* geometry = m_geometry_cache.find(geometry_key);
+	if (geometry)
+		fmt::print("{} shares the GPU geometry of an identical model\n", path.string());
+	else
+	{
+		SharedGeometry new_geometry;
+
+		VertexQuantizer::Result quantized;
+		if (m_quantize_vertices)
+		{
+			{
+				auto _ = StartupProfiler::Scoped("Vertex quantization: " + path.filename().string(), "model");
+				quantized = VertexQuantizer::quantize(source);
+			}
+			VertexQuantizer::print_report(path, quantized);
+
+			streams[0] = { quantized.positions.data(), sizeof(VertexQuantizer::Position), (UINT)quantized.positions.size() };
+			streams[1] = { quantized.uvs.data(), sizeof(VertexQuantizer::UV), (UINT)quantized.uvs.size() };
+			streams[2] = { quantized.normals.data(), sizeof(VertexQuantizer::Normal), (UINT)quantized.normals.size() };
+
+			new_geometry.quantized = true;
+			new_geometry.dequantization = quantized.get_dequantization();
+		}
+
+		{
+			auto _ = StartupProfiler::Scoped("Geometry upload: " + path.filename().string(), "upload");
+
+			// Streams without data (no texture coordinates) still get their range, every stream shares the base vertex
+			std::vector<GeometryHeap::Stream> heap_streams;
+			for (const auto& stream : streams)
+				heap_streams.push_back({ stream.count == source.vertex_count ? stream.data : nullptr, stream.stride });
+			new_geometry.allocation = m_geometry_heap.allocate(heap_streams, source.vertex_count, source.indices, source.index_bytes);
+		}
 
-	std::vector<std::tuple<BufferHandle, UINT, UINT>> vbs_and_strides;
-	vbs_and_strides.push_back({ pos_buffer, (UINT)sizeof(positions[0]), 0 });
-	vbs_and_strides.push_back({ uv_buffer, (UINT)sizeof(uvs[0]), 0 });
-	vbs_and_strides.push_back({ nor_buffer, (UINT)sizeof(normals[0]), 0 });
+		m_vertex_bytes += new_geometry.allocation.vertex_bytes;
+		const uint64_t geometry_bytes = new_geometry.allocation.bytes;
+		geometry = &m_geometry_cache.insert(geometry_key, std::move(new_geometry), geometry_bytes);
+	}
 
 	// Set partial geometry data for model
-	auto model = Model().set_ib(idx_buffer).set_vbs(vbs_and_strides);
+	const auto& allocation = geometry->allocation;
+	auto model = Model().set_ib(m_geometry_heap.get_ib(allocation)).set_vbs(m_geometry_heap.get_vbs(allocation));
+	if (geometry->quantized)
+		model.set_dequantization(geometry->dequantization);
+
+	// Ranges of the source are relative to its own data, the heap placed it at the base vertex and index offset
+	std::vector<MeshCluster> clusters(source.clusters, source.clusters + source.cluster_count);
+	std::vector<MeshLod> lods(source.lods, source.lods + source.lod_count);
+
+	// Textures of all materials are decoded as one batch, unless the import already did
+	const auto materials = import.textures ? m_mat_mgr->load_materials(mats, std::move(*import.textures)) : m_mat_mgr->load_materials(mats);
+	import.textures.reset();
 
 	for (int i = 0; i < meshes.size(); ++i)
 	{
 		// Add submesh data
+		static_assert(sizeof(Mesh) == sizeof(AssimpMeshData));
 		Mesh mesh;
 		const auto& assimp_mesh = meshes[i];
 		std::memcpy(&mesh, &assimp_mesh, sizeof(AssimpMeshData));
 
+		// Offsets are 4 byte aligned, a whole number of indices of either stride
+		const UINT index_base = (UINT)(allocation.index_offset / mesh.index_stride);
+		mesh.vertex_start += allocation.base_vertex;
+		mesh.index_start += index_base;
+		for (UINT c = mesh.cluster_start; c < mesh.cluster_start + mesh.cluster_count; ++c)
+			clusters[c].index_start += index_base;
+		for (UINT l = mesh.lod_start; l < mesh.lod_start + mesh.lod_count; ++l)
+			lods[l].index_start += index_base;
+
 		// Get material
-		const auto& assimp_mat = mats[i];
-		//auto mat = load_material(assimp_mat);
-		auto mat = m_mat_mgr->load_material(assimp_mat);
+		auto mat = materials[i];
 
 		// Add mesh/material pair
 		model.add_mesh(mesh, mat);
 	}
 
-	std::string model_name = name;
-	if (model_name.empty())
-		model_name = "Model" + std::to_string(m_def_counter++);
+	// Model bounds for the LOD selection
+	DirectX::BoundingSphere bounds;
+	if (source.vertex_count > 0)
+		DirectX::BoundingSphere::CreateFromPoints(bounds, source.vertex_count, (const DirectX::XMFLOAT3*)source.positions, 3 * sizeof(float));
+	model.set_clusters(std::move(clusters));
+	model.set_lods(std::move(lods), bounds);
 
-	m_path_mapper.insert({ path, model_name });
-	auto ret_it = m_models.insert({ model_name, model });
-	return &(ret_it.first->second);
+	// Texel density per mesh for texture streaming
+	std::vector<MeshTexelDensity> densities;
+	densities.reserve(meshes.size());
+	for (const auto& mesh : meshes)
+		densities.push_back(compute_texel_density(source, mesh));
+	model.set_texel_densities(std::move(densities));
+
+	// One reference per model using the geometry
+	++m_geometry_refs[geometry_key];
+	return LoadedModel{ std::move(model), geometry_key };
+}
+
+uint32_t ModelManager::reload_models(const std::filesystem::path& file)
+{
+	// Models loaded from the file, otherwise the ones next to it (e.g .mtl libraries)
+	const auto normal = file.lexically_normal();
+	std::vector<std::pair<std::filesystem::path, std::string>> models;
+	for (const auto& [path, name] : m_path_mapper)
+	{
+		if (path.lexically_normal() == normal)
+			models.push_back({ path, name });
+	}
+	if (models.empty())
+	{
+		for (const auto& [path, name] : m_path_mapper)
+		{
+			if (path.lexically_normal().parent_path() == normal.parent_path())
+				models.push_back({ path, name });
+		}
+	}
+
+	for (const auto& [path, name] : models)
+	{
+		// An unchanged source loads the baked model and shares the existing GPU geometry
+		Timer timer;
+		auto import = import_model(path);
+		auto model = build_model(import);
+
+		// The new model references its resources before the old one lets go, so unchanged ones are kept
+		auto& loaded = m_models[name];
+		const uint64_t freed = release(loaded);
+		loaded = std::move(model);
+		fmt::print("Reloaded {} in {:.1f} ms, {:.2f} MB of GPU memory freed\n", path.string(), timer.elapsed(), freed / (1024.f * 1024.f));
+	}
+
+	return (uint32_t)models.size();
 }
 
 const Model* ModelManager::get_model(const std::string& name)
 {
-	return &(m_models.find(name)->second);
+	return &(m_models.find(name)->second.model);
+}
+
+uint64_t ModelManager::release(const LoadedModel& loaded)
+{
+	// Materials release the textures no other material uses
+	uint64_t freed = 0;
+	for (const auto mat : loaded.model.get_materials())
+		freed += m_mat_mgr->release(mat);
+
+	auto refs = m_geometry_refs.find(loaded.geometry_key);
+	if (refs == m_geometry_refs.end() || --refs->second > 0)
+		return freed;
+
+	if (auto geometry = m_geometry_cache.get(loaded.geometry_key))
+	{
+		// Back to the heap, its chunks are freed once empty
+		m_geometry_heap.free(geometry->allocation);
+
+		m_vertex_bytes -= geometry->allocation.vertex_bytes;
+		freed += geometry->allocation.bytes;
+	}
+	m_geometry_cache.erase(loaded.geometry_key);
+	m_geometry_refs.erase(refs);
+	return freed;
 }
 
-void ModelManager::remove_model(const std::string& name)
+uint64_t ModelManager::remove_model(const std::string& name)
 {
+	auto it = m_models.find(name);
+	if (it == m_models.end())
+		return 0;
+
+	const uint64_t freed = release(it->second);
+	fmt::print("Unloaded {}: {:.2f} MB of GPU memory freed\n", name, freed / (1024.f * 1024.f));
+
 	// Remove model
-	m_models.erase(name);
+	m_models.erase(it);
 
 	// Remove path
-	std::map<std::filesystem::path, std::string>::iterator del_it;
-	for (auto it = m_path_mapper.begin(); it != m_path_mapper.end(); ++it)
-		if (it->second == name)
-			del_it = it;
-	if (del_it != m_path_mapper.end())
-		m_path_mapper.erase(del_it);
+	for (auto path_it = m_path_mapper.begin(); path_it != m_path_mapper.end(); ++path_it)
+	{
+		if (path_it->second == name)
+		{
+			m_path_mapper.erase(path_it);
+			break;
+		}
+	}
+	return freed;
+}
+
+uint64_t ModelManager::remove_model(const Model* model)
+{
+	auto it = std::find_if(m_models.cbegin(), m_models.cend(), [model](const auto& entry) { return &entry.second.model == model; });
+	if (it == m_models.cend())
+		return 0;
+	return remove_model(std::string(it->first));
 }
@@ -4,6 +4,8 @@
 #include "Graphics/Renderer/Renderer.h"
 #include "Graphics/Renderer/ModelRenderer.h"
 #include "Graphics/ModelManager.h"
+#include "Camera/Camera.h"
+#include "ThreadPool.h"
 
 #include "Graphics/CommandBucket/GfxCommand.h"
 //#include "Graphics/CommandBucket/GfxCommandPacket.h"
@@ -11,12 +13,19 @@
 // temp
 #include "Graphics/DiskTextureManager.h"
 
+#include <algorithm>
 #include <random>
 
 namespace gfx 
 { 
 	extern GfxDevice* dev;
 	extern ModelManager* model_mgr; 
+	extern DiskTextureManager* tex_mgr;
+}
+
+namespace jobs
+{
+	extern ThreadPool* pool;
 }
 
 namespace perf
@@ -39,15 +48,111 @@ ModelHandle ModelRenderer::load_model(const std::filesystem::path& rel_path)
 	// Temporarily copy to our memory
 	//std::memcpy(p.second->data, mod, sizeof(Model));
 	p.second->data = mod;
+	++m_model_users[mod];
 
 	return hdl;
 }
 
-void ModelRenderer::free_model(ModelHandle hdl)
+ModelHandle ModelRenderer::load_model_async(const std::filesystem::path& rel_path)
 {
+	auto p = m_loaded_models.get_next_free_handle();
+	p.second->data = gfx::model_mgr->find_model(rel_path);
+
+	ModelHandle hdl;
+	hdl.hdl = p.first;
+
+	if (p.second->data)
+	{
+		++m_model_users[p.second->data];
+		return hdl;
+	}
+
+	auto it = m_pending_loads.find(rel_path);
+	if (it == m_pending_loads.end())
+	{
+		PendingLoad load;
+		// Textures are decoded on the job as well, finish_load only uploads
+		load.import = jobs::pool->submit([rel_path]()
+			{
+				auto import = ModelManager::import_model(rel_path);
+				gfx::model_mgr->decode_textures(import);
+				return import;
+			});
+		it = m_pending_loads.insert({ rel_path, std::move(load) }).first;
+	}
+	it->second.handles.push_back(hdl.hdl);
+
+	return hdl;
+}
+
+bool ModelRenderer::is_ready(ModelHandle hdl)
+{
+	return m_loaded_models.is_valid(hdl.hdl) && m_loaded_models.look_up(hdl.hdl)->data;
+}
+
+void ModelRenderer::process_loads()
+{
+	for (auto it = m_pending_loads.begin(); it != m_pending_loads.end();)
+	{
+		if (it->second.import.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		finish_load(it->first, it->second);
+		it = m_pending_loads.erase(it);
+	}
+}
+
+void ModelRenderer::wait_for_loads()
+{
+	for (auto& [path, load] : m_pending_loads)
+	{
+		jobs::pool->wait(load.import);		// not get(), finish_load consumes the result
+		finish_load(path, load);
+	}
+	m_pending_loads.clear();
+}
+
+void ModelRenderer::finish_load(const std::filesystem::path& path, PendingLoad& load)
+{
+	auto mod = gfx::model_mgr->create_model(load.import.get(), "Some_Model" + std::to_string(m_counter++));
+
+	uint32_t users = 0;
+	for (auto handle : load.handles)
+	{
+		// Freed while loading
+		if (!m_loaded_models.is_valid(handle))
+			continue;
+		m_loaded_models.look_up(handle)->data = mod;
+		++users;
+	}
+
+	if (users > 0)
+		m_model_users[mod] += users;
+	else if (m_model_users.find(mod) == m_model_users.end())
+		gfx::model_mgr->remove_model(mod);		// every handle was freed before the model was ready
+}
+
+uint64_t ModelRenderer::free_model(ModelHandle hdl)
+{
+	if (!m_loaded_models.is_valid(hdl.hdl))
+		return 0;
+
+	const Model* mod = m_loaded_models.look_up(hdl.hdl)->data;
 	m_loaded_models.free_handle(hdl.hdl);
 
-	// Add manual removal later
+	// Still loading, finish_load skips the handle
+	if (!mod)
+		return 0;
+
+	// The last handle of a model unloads it
+	auto users = m_model_users.find(mod);
+	if (users == m_model_users.end() || --users->second > 0)
+		return 0;
+	m_model_users.erase(users);
+	return gfx::model_mgr->remove_model(mod);
 }
 
 
@@ -62,6 +167,26 @@ ModelRenderer::ModelRenderer(Renderer* master_renderer) :
 
 void ModelRenderer::begin()
 {
+	process_loads();
+	if (m_texture_streaming)
+		gfx::tex_mgr->get_streamer()->update();
+
+	m_cluster_stats = {};
+	m_lod_stats = {};
+	++m_frame;
+	const auto cam = m_master_renderer->get_camera();
+	m_has_camera = cam != nullptr;
+	if (m_has_camera)
+	{
+		// View space frustum to world space
+		DirectX::BoundingFrustum::CreateFromMatrix(m_frustum, cam->get_proj_mat());
+		m_frustum.Transform(m_frustum, cam->get_view_mat().Invert());
+		const auto& pos = cam->get_position();
+		m_eye = DirectX::SimpleMath::Vector3(pos.x, pos.y, pos.z);
+		m_proj_scale = cam->get_proj_mat()._22;
+		m_screen_height = (float)m_master_renderer->get_resolution().second;
+	}
+
 	m_per_object_data = (PerObjectData*)m_per_object_data_allocator->allocate(MAX_SUBMISSION_PER_FRAME * sizeof(PerObjectData));
 }
 
@@ -72,55 +197,223 @@ void ModelRenderer::end()
 	auto big_copy = copy_bucket->add_command<gfxcommand::CopyToBuffer>(0, 0);
 	big_copy->buffer = m_per_object_cb;
 	big_copy->data = m_per_object_data;
-	big_copy->data_size = m_submission_count * sizeof(PerObjectData);
+	big_copy->data_size = m_object_count * sizeof(PerObjectData);
 
-	m_submission_count = 0;
+	m_object_count = 0;
 	m_per_object_data_allocator->reset();
 }
 
+uint32_t ModelRenderer::select_lod(const Model* model, const DirectX::SimpleMath::Matrix& wm, uint32_t previous) const
+{
+	const uint32_t levels = model->get_lod_count();
+	if (!m_lod_selection || !m_has_camera || levels <= 1)
+		return 0;
+
+	// Largest axis scale, errors and bounds are in model space
+	const float scale = (std::max)({ wm.Right().Length(), wm.Up().Length(), wm.Backward().Length() });
+
+	DirectX::BoundingSphere bounds;
+	model->get_bounds().Transform(bounds, wm);
+	const float distance = DirectX::SimpleMath::Vector3::Distance(m_eye, bounds.Center) - bounds.Radius;
+	if (distance <= 0.f)
+		return 0;		// inside the bounds
+
+	// NDC spans 2 units of screen height
+	const float to_screen = scale * m_proj_scale * 0.5f / distance;
+	for (uint32_t level = levels - 1; level > 0; --level)
+	{
+		const float threshold = level > previous ? m_lod_threshold * (1.f - LOD_HYSTERESIS) : m_lod_threshold;
+		if (model->get_lod_error(level) * to_screen <= threshold)
+			return level;
+	}
+	return 0;
+}
+
 void ModelRenderer::submit(ModelHandle hdl, const DirectX::SimpleMath::Matrix& wm, ModelRenderSpec spec)
 {
 	auto _ = FrameProfiler::ScopedCPUAccum("Model Submission");
 
-	const auto& model = m_loaded_models.look_up(hdl.hdl)->data;
+	auto internal = m_loaded_models.look_up(hdl.hdl);
+	const auto& model = internal->data;
+	if (!model)
+		return;		// still loading
+
+	// Out of per object entries (texture array slices take extra ones), the submission is dropped
+	if (m_object_count >= MAX_SUBMISSION_PER_FRAME)
+		return;
+
+	// LOD of this submission, the same handle may be submitted several times a frame
+	if (internal->frame != m_frame)
+	{
+		internal->frame = m_frame;
+		internal->frame_submissions = 0;
+	}
+	const uint32_t ordinal = internal->frame_submissions++;
+	if (internal->lod_levels.size() <= ordinal)
+		internal->lod_levels.resize(ordinal + 1, 0);
+
+	const uint32_t lod = select_lod(model, wm, internal->lod_levels[ordinal]);
+	internal->lod_levels[ordinal] = (uint8_t)lod;
+	++m_lod_stats.submissions_per_level[(std::min)(lod, (uint32_t)m_lod_stats.submissions_per_level.size() - 1)];
+
 	const auto& meshes = model->get_meshes();
 	const auto& materials = model->get_materials();
+	const auto& densities = model->get_texel_densities();
+	const bool stream_textures = m_texture_streaming && m_has_camera && densities.size() == meshes.size();
+
+	// Largest axis scale, texel densities are in model space
+	const float scale = (std::max)({ wm.Right().Length(), wm.Up().Length(), wm.Backward().Length() });
+
+	// Store world matrix for this submission, quantized positions are brought to model space first
+	const uint32_t object = m_object_count++;
+	m_per_object_data[object].world_mat = model->is_quantized() ? model->get_dequantization() * wm : wm;
+	m_per_object_data[object].albedo_slice = 0;
+
+	// Entry of the submission drawing from a texture array slice, UINT32_MAX once out of entries
+	m_slice_objects.clear();
+	auto get_slice_object = [&](uint32_t slice) -> uint32_t
+	{
+		if (slice == 0)
+			return object;
+		if (m_slice_objects.size() <= slice)
+			m_slice_objects.resize(slice + 1, UINT32_MAX);
+
+		auto& slice_object = m_slice_objects[slice];
+		if (slice_object == UINT32_MAX && m_object_count < MAX_SUBMISSION_PER_FRAME)
+		{
+			slice_object = m_object_count++;
+			m_per_object_data[slice_object].world_mat = m_per_object_data[object].world_mat;
+			m_per_object_data[slice_object].albedo_slice = slice;
+		}
+		return slice_object;
+	};
 
-	// Store world matrix for this submission
-	m_per_object_data[m_submission_count].world_mat = wm;
+	const auto gpass_pipe = model->is_quantized() ? m_shared_resources->deferred_gpass_quantized_pipe : m_shared_resources->deferred_gpass_pipe;
+	const auto gpass_array_pipe = model->is_quantized() ? m_shared_resources->deferred_gpass_array_quantized_pipe : m_shared_resources->deferred_gpass_array_pipe;
+	const auto depth_only_pipe = model->is_quantized() ? m_shared_resources->depth_only_quantized_pipe : m_shared_resources->depth_only_pipe;
 
 	auto opaque_bucket = m_master_renderer->get_opaque_bucket();
 	auto transp_bucket = m_master_renderer->get_transparent_bucket();
 	auto shadow_bucket = m_master_renderer->get_shadow_bucket();
 
+	// Clusters are in model space (before dequantization), bring the camera there instead of transforming every cluster
+	const auto& clusters = model->get_clusters();
+	const bool cull_clusters = m_cluster_culling && m_has_camera && !clusters.empty();
+	DirectX::BoundingFrustum model_frustum;
+	DirectX::SimpleMath::Vector3 model_eye;
+	if (cull_clusters)
+	{
+		const auto inv_wm = wm.Invert();
+		m_frustum.Transform(model_frustum, inv_wm);
+		model_eye = DirectX::SimpleMath::Vector3::Transform(m_eye, inv_wm);
+	}
+
 	for (int i = 0; i < meshes.size(); ++i)
 	{
 		const auto& mesh = meshes[i];
 		const auto& mat = materials[i];
 
-		uint64_t key = mat->get_texture(Material::Texture::eAlbedo).hdl;
-		
-		// .. Setup header for payload ..
-		auto hdr = gfxcommand::aux::bindtable::Header()
-			.set_vbs((uint8_t)model->get_vb().size())
-			.set_cbs(1)
-			.set_tex_reads(1);
-
-		// .. and allocate command ..
-		auto cmd = opaque_bucket->add_command<gfxcommand::Draw>(key, hdr.size());
-		cmd->ib = model->get_ib();
-		cmd->index_count = mesh.index_count;
-		cmd->index_start = mesh.index_start;
-		cmd->vertex_start = mesh.vertex_start;
-		cmd->pipeline = m_shared_resources->deferred_gpass_pipe;
-
-		// .. and fill binding table
-		auto payload = gfxcommand::aux::bindtable::Filler(gfxcommandpacket::get_aux_memory(cmd), hdr);
-		for (int i = 0; i < model->get_vb().size(); ++i)
-			payload.add_vb(std::get<0>(model->get_vb()[i]), std::get<1>(model->get_vb()[i]), std::get<2>(model->get_vb()[i]));
-		payload
-			.add_cb(ShaderStage::eVertex, 1, m_per_object_cb, m_submission_count)
-			.add_read_tex(ShaderStage::ePixel, 0, mat->get_texture(Material::Texture::eAlbedo));
+		// Packed albedos bind their array, the slice is in the per object entry
+		const auto albedo = mat->get_texture(Material::Texture::eAlbedo);
+		auto packed = gfx::tex_mgr->get_packed(albedo);
+		uint32_t draw_object = object;
+		if (packed)
+			draw_object = get_slice_object(packed->slice);
+
+		const TextureHandle albedo_srv = packed ? packed->array : albedo;
+		const auto draw_pipe = packed ? gpass_array_pipe : gpass_pipe;
+
+		// Draws binding the same pipeline and albedo end up next to each other, then by material
+		const uint64_t key = ((uint64_t)(packed != nullptr) << 63) | ((uint64_t)(uint32_t)albedo_srv.hdl << 16) | mat->get_id();
+
+		if (stream_textures)
+		{
+			DirectX::BoundingSphere bounds;
+			densities[i].bounds.Transform(bounds, wm);
+			if (m_frustum.Contains(bounds) != DirectX::DISJOINT)
+			{
+				// Texture coordinate span of one pixel, finest from inside the bounds (NDC spans 2 units of screen height)
+				const float distance = DirectX::SimpleMath::Vector3::Distance(m_eye, bounds.Center) - bounds.Radius;
+				const float uv_per_pixel = distance > 0.f ? densities[i].uv_per_unit * distance / (scale * m_proj_scale * 0.5f * m_screen_height) : 0.f;
+				gfx::tex_mgr->get_streamer()->request(albedo, uv_per_pixel);
+			}
+		}
+		const DXGI_FORMAT index_format = mesh.index_stride == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		const MeshLod mesh_lod = model->get_mesh_lod(mesh, lod);
+		const bool full_detail = mesh_lod.index_start == mesh.index_start;		// clusters only exist for the full mesh
+		m_lod_stats.triangles_full += mesh.index_count / 3;
+
+		auto add_gpass_draw = [&](UINT index_start, UINT index_count)
+		{
+			// Out of entries, a packed texture has no memory of its own to draw unpacked with (the shadow draw stays)
+			if (draw_object == UINT32_MAX)
+				return;
+
+			// .. Setup header for payload ..
+			auto hdr = gfxcommand::aux::bindtable::Header()
+				.set_vbs((uint8_t)model->get_vb().size())
+				.set_cbs(1)
+				.set_tex_reads(1);
+
+			// .. and allocate command ..
+			auto cmd = opaque_bucket->add_command<gfxcommand::Draw>(key, hdr.size());
+			cmd->ib = model->get_ib();
+			cmd->ib_format = index_format;
+			cmd->index_count = index_count;
+			cmd->index_start = index_start;
+			cmd->vertex_start = mesh.vertex_start;
+			cmd->pipeline = draw_pipe;
+
+			// .. and fill binding table
+			auto payload = gfxcommand::aux::bindtable::Filler(gfxcommandpacket::get_aux_memory(cmd), hdr);
+			for (int i = 0; i < model->get_vb().size(); ++i)
+				payload.add_vb(std::get<0>(model->get_vb()[i]), std::get<1>(model->get_vb()[i]), std::get<2>(model->get_vb()[i]));
+			payload
+				.add_cb(ShaderStage::eVertex, 1, m_per_object_cb, draw_object)
+				.add_read_tex(ShaderStage::ePixel, 0, albedo_srv);
+
+			++m_cluster_stats.draws;
+			m_lod_stats.triangles_submitted += index_count / 3;
+		};
+
+		if (!cull_clusters || !full_detail || mesh.cluster_count == 0)
+			add_gpass_draw(mesh_lod.index_start, mesh_lod.index_count);
+		else
+		{
+			// Visible clusters are contiguous in the index buffer, runs of them become one draw
+			UINT run_start = 0, run_count = 0;
+			for (UINT c = mesh.cluster_start; c < mesh.cluster_start + mesh.cluster_count; ++c)
+			{
+				const auto& cluster = clusters[c];
+				++m_cluster_stats.clusters;
+
+				bool visible = true;
+				const auto to_cluster = cluster.center - model_eye;
+				if (to_cluster.Dot(cluster.cone_axis) >= cluster.cone_cutoff * to_cluster.Length() + cluster.radius)
+				{
+					visible = false;
+					++m_cluster_stats.culled_backface;
+				}
+				else if (model_frustum.Contains(DirectX::BoundingSphere(cluster.center, cluster.radius)) == DirectX::DISJOINT ||
+					model_frustum.Contains(DirectX::BoundingBox((cluster.aabb_min + cluster.aabb_max) * 0.5f, (cluster.aabb_max - cluster.aabb_min) * 0.5f)) == DirectX::DISJOINT)
+				{
+					visible = false;
+					++m_cluster_stats.culled_frustum;
+				}
+
+				if (visible && run_count > 0 && run_start + run_count == cluster.index_start)
+					run_count += cluster.index_count;
+				else
+				{
+					if (run_count > 0)
+						add_gpass_draw(run_start, run_count);
+					run_start = cluster.index_start;
+					run_count = visible ? cluster.index_count : 0;
+				}
+			}
+			if (run_count > 0)
+				add_gpass_draw(run_start, run_count);
+		}
 
 
 		// Replicate draw for shadow, but only using positions
@@ -132,17 +425,15 @@ void ModelRenderer::submit(ModelHandle hdl, const DirectX::SimpleMath::Matrix& w
 			
 			auto shadow_cmd = shadow_bucket->add_command<gfxcommand::Draw>(0, shadow_hdr.size());
 			shadow_cmd->ib = model->get_ib();
-			shadow_cmd->index_count = mesh.index_count;
-			shadow_cmd->index_start = mesh.index_start;
+			shadow_cmd->ib_format = index_format;
+			shadow_cmd->index_count = mesh_lod.index_count;
+			shadow_cmd->index_start = mesh_lod.index_start;
 			shadow_cmd->vertex_start = mesh.vertex_start;
-			shadow_cmd->pipeline = m_shared_resources->depth_only_pipe;	// Always uses depth only pipe for shadow rendering
+			shadow_cmd->pipeline = depth_only_pipe;	// Always uses depth only pipe for shadow rendering
 
 			gfxcommand::aux::bindtable::Filler(gfxcommandpacket::get_aux_memory(shadow_cmd), shadow_hdr)
 				.add_vb(std::get<0>(model->get_vb()[0]), std::get<1>(model->get_vb()[0]), std::get<2>(model->get_vb()[0]))
-				.add_cb(ShaderStage::eVertex, 1, m_per_object_cb, m_submission_count);
+				.add_cb(ShaderStage::eVertex, 1, m_per_object_cb, object);
 		}
 	}
-
-
-	++m_submission_count;
 }
\ No newline at end of file
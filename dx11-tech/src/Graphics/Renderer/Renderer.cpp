@@ -3,6 +3,8 @@
 #include "Graphics/API/GfxDevice.h"
 #include "Graphics/API/ImGuiDevice.h"
 #include "Graphics/CommandBucket/GfxCommand.h"
+#include "Graphics/VertexQuantizer.h"
+#include "Profiler/StartupProfiler.h"
 #include "Profiler/FrameProfiler.h"
 #include "Camera/Camera.h"
 
@@ -52,6 +54,25 @@ Renderer::Renderer()
 	ImGuiDevice::add_ui("profiler", [&]() { declare_profiler_ui();  });
 	ImGuiDevice::add_ui("shader reloading", [&]() { declare_shader_reloader_ui();  });
 
+	// Every shader compiles in the background, each pipeline below only waits for its own
+	auto shaders = gfx::dev->compile_shaders(
+		{
+			{ ShaderStage::eVertex, "depthOnlyVS.hlsl" },
+			{ ShaderStage::eGeometry, "depthOnlyGS.hlsl" },
+			{ ShaderStage::ePixel, "depthOnlyPS.hlsl" },
+			{ ShaderStage::eVertex, "lightPassVS.hlsl" },
+			{ ShaderStage::ePixel, "lightPassPS.hlsl" },
+			{ ShaderStage::eVertex, "finalQuadVS.hlsl" },
+			{ ShaderStage::ePixel, "finalQuadPS.hlsl" },
+			{ ShaderStage::eVertex, "gpassVS.hlsl" },
+			{ ShaderStage::ePixel, "gpassPS.hlsl" },
+			{ ShaderStage::ePixel, "gpassArrayPS.hlsl" },
+			{ ShaderStage::eVertex, "gpassQuantizedVS.hlsl" },
+			{ ShaderStage::eCompute, "SDSM_ReduceTexToBuffer.hlsl" },
+			{ ShaderStage::eCompute, "SDSM_FinalReduction.hlsl" },
+			{ ShaderStage::eCompute, "SDSM_ComputeSplits.hlsl" }
+		});
+
 	m_cb_per_frame = gfx::dev->create_buffer(BufferDesc::constant(sizeof(PerFrameData)));
 
 	auto sc_dim = gfx::dev->get_sc_dim();
@@ -63,7 +84,10 @@ Renderer::Renderer()
 	};
 
 	// setup geometry pass 
-	create_resolution_dependent_resources(sc_dim.first, sc_dim.second);
+	{
+		auto _ = StartupProfiler::Scoped("Resolution dependent resources", "renderer");
+		create_resolution_dependent_resources(sc_dim.first, sc_dim.second);
+	}
 
 	// setup depth only pass for shadow
 	{
@@ -74,9 +98,9 @@ Renderer::Renderer()
 		// depth only pass (no render targets)
 		m_dir_rp = gfx::dev->create_renderpass(RenderPassDesc({}, m_dir_d32));
 
-		auto vs_depth = gfx::dev->compile_and_create_shader(ShaderStage::eVertex, "depthOnlyVS.hlsl");
-		auto gs_depth = gfx::dev->compile_and_create_shader(ShaderStage::eGeometry, "depthOnlyGS.hlsl");	// PSSM instancing
-		auto ps_depth = gfx::dev->compile_and_create_shader(ShaderStage::ePixel, "depthOnlyPS.hlsl");
+		auto vs_depth = shaders.get(ShaderStage::eVertex, "depthOnlyVS.hlsl");
+		auto gs_depth = shaders.get(ShaderStage::eGeometry, "depthOnlyGS.hlsl");	// PSSM instancing
+		auto ps_depth = shaders.get(ShaderStage::ePixel, "depthOnlyPS.hlsl");
 		auto do_layout = InputLayoutDesc().append("POSITION", DXGI_FORMAT_R32G32B32_FLOAT, 0);			// position only
 
 		m_shared_resources.depth_only_pipe = gfx::dev->create_pipeline(PipelineDesc()
@@ -84,6 +108,12 @@ Renderer::Renderer()
 			.set_input_layout(do_layout)
 			.set_rasterizer(RasterizerDesc::no_backface_cull()));
 
+		// UNORM positions read as float4 with w = 1, the same shaders work
+		m_shared_resources.depth_only_quantized_pipe = gfx::dev->create_pipeline(PipelineDesc()
+			.set_shaders(VertexShader(vs_depth), PixelShader(ps_depth), GeometryShader(gs_depth))
+			.set_input_layout(VertexQuantizer::get_position_layout())
+			.set_rasterizer(RasterizerDesc::no_backface_cull()));
+
 		// structured buffer with NUM_CASCADE amount of CascadeInfo
 		m_cascades_info_buffer = gfx::dev->create_buffer(BufferDesc::structured(sizeof(CascadeInfo), { 0, NUM_CASCADES }, D3D11_BIND_SHADER_RESOURCE, true));
 	}
@@ -91,8 +121,8 @@ Renderer::Renderer()
 	// setup light pass
 	{
 		ShaderHandle fs_vs, fs_ps;
-		fs_vs = gfx::dev->compile_and_create_shader(ShaderStage::eVertex, "lightPassVS.hlsl");
-		fs_ps = gfx::dev->compile_and_create_shader(ShaderStage::ePixel, "lightPassPS.hlsl");
+		fs_vs = shaders.get(ShaderStage::eVertex, "lightPassVS.hlsl");
+		fs_ps = shaders.get(ShaderStage::ePixel, "lightPassPS.hlsl");
 
 		m_lightpass_pipe = gfx::dev->create_pipeline(PipelineDesc()
 			.set_shaders(VertexShader(fs_vs), PixelShader(fs_ps)));
@@ -104,8 +134,8 @@ Renderer::Renderer()
 		m_backbuffer_out_rp = gfx::dev->create_renderpass(RenderPassDesc({ gfx::dev->get_backbuffer() }));
 
 		ShaderHandle vs, ps;
-		vs = gfx::dev->compile_and_create_shader(ShaderStage::eVertex, "finalQuadVS.hlsl");
-		ps = gfx::dev->compile_and_create_shader(ShaderStage::ePixel, "finalQuadPS.hlsl");
+		vs = shaders.get(ShaderStage::eVertex, "finalQuadVS.hlsl");
+		ps = shaders.get(ShaderStage::ePixel, "finalQuadPS.hlsl");
 
 		m_final_pipe = gfx::dev->create_pipeline(PipelineDesc()
 			.set_shaders(VertexShader(vs), PixelShader(ps)));
@@ -167,8 +197,8 @@ Renderer::Renderer()
 	// deferred gpass pipe
 	{
 		ShaderHandle vs, ps;
-		vs = gfx::dev->compile_and_create_shader(ShaderStage::eVertex, "gpassVS.hlsl");
-		ps = gfx::dev->compile_and_create_shader(ShaderStage::ePixel, "gpassPS.hlsl");
+		vs = shaders.get(ShaderStage::eVertex, "gpassVS.hlsl");
+		ps = shaders.get(ShaderStage::ePixel, "gpassPS.hlsl");
 
 		// interleaved layout
 		auto layout = InputLayoutDesc()
@@ -182,29 +212,46 @@ Renderer::Renderer()
 			.set_input_layout(layout);
 
 		m_shared_resources.deferred_gpass_pipe = gfx::dev->create_pipeline(p_d);
+
+		// quantized streams, normals are decoded in the vertex shader
+		auto vs_quantized = shaders.get(ShaderStage::eVertex, "gpassQuantizedVS.hlsl");
+		m_shared_resources.deferred_gpass_quantized_pipe = gfx::dev->create_pipeline(PipelineDesc()
+			.set_shaders(VertexShader(vs_quantized), PixelShader(ps))
+			.set_input_layout(VertexQuantizer::get_input_layout()));
+
+		// albedo from a texture array slice (DiskTextureManager::pack)
+		auto ps_array = shaders.get(ShaderStage::ePixel, "gpassArrayPS.hlsl");
+		m_shared_resources.deferred_gpass_array_pipe = gfx::dev->create_pipeline(PipelineDesc()
+			.set_shaders(VertexShader(vs), PixelShader(ps_array))
+			.set_input_layout(layout));
+		m_shared_resources.deferred_gpass_array_quantized_pipe = gfx::dev->create_pipeline(PipelineDesc()
+			.set_shaders(VertexShader(vs_quantized), PixelShader(ps_array))
+			.set_input_layout(VertexQuantizer::get_input_layout()));
 	}
 
 
 
 
 
-	setup_SDSM();
+	setup_SDSM(shaders);
 }
 
-void Renderer::setup_SDSM()
+void Renderer::setup_SDSM(ShaderBatch& shaders)
 {
+	auto _ = StartupProfiler::Scoped("setup_SDSM", "renderer");
+
 	// Parallel min/max reduction
 	{
 		// Texture to block reduction
-		ShaderHandle cs = gfx::dev->compile_and_create_shader(ShaderStage::eCompute, "SDSM_ReduceTexToBuffer.hlsl");
+		ShaderHandle cs = shaders.get(ShaderStage::eCompute, "SDSM_ReduceTexToBuffer.hlsl");
 		m_compute_pipe = gfx::dev->create_compute_pipeline(ComputePipelineDesc(ComputeShader(cs)));
 
 		// Block to block reduction
-		ShaderHandle cs2 = gfx::dev->compile_and_create_shader(ShaderStage::eCompute, "SDSM_FinalReduction.hlsl");
+		ShaderHandle cs2 = shaders.get(ShaderStage::eCompute, "SDSM_FinalReduction.hlsl");
 		m_compute_pipe2 = gfx::dev->create_compute_pipeline(ComputePipelineDesc(ComputeShader(cs2)));
 
 		// Compute splits
-		ShaderHandle cs3 = gfx::dev->compile_and_create_shader(ShaderStage::eCompute, "SDSM_ComputeSplits.hlsl");
+		ShaderHandle cs3 = shaders.get(ShaderStage::eCompute, "SDSM_ComputeSplits.hlsl");
 		m_compute_pipe3 = gfx::dev->create_compute_pipeline(ComputePipelineDesc(ComputeShader(cs3)));
 
 
@@ -849,11 +896,12 @@ void Renderer::declare_shader_reloader_ui()
 		const std::string path = "shaders";
 		for (const auto& entry : std::filesystem::directory_iterator(path))
 		{
-			// discard non .hlsl
-			if (std::filesystem::path(entry).extension() != ".hlsl")
+			// sources and the headers they include (reloading a header recompiles the shaders including it)
+			const auto extension = std::filesystem::path(entry).extension();
+			if (extension != ".hlsl" && extension != ".hlsli" && extension != ".h")
 				continue;
 
-			shader_filenames.insert(std::filesystem::path(entry).stem().string());
+			shader_filenames.insert(std::filesystem::path(entry).filename().string());
 
 		}
 		selected_item = shader_filenames.cbegin()->c_str();
@@ -882,7 +930,10 @@ void Renderer::declare_shader_reloader_ui()
 		ImGui::EndCombo();
 	}
 	if (ImGui::SmallButton("Reload"))
-		gfx::dev->recompile_pipeline_shaders_by_name(std::string(selected_item));
+		last_shader_reload = gfx::dev->reload_shaders(std::filesystem::path("shaders") / selected_item);
+
+	ImGui::Text(fmt::format("Last reload: {} shader(s), {} failed, {} pipeline(s), {:.1f} ms",
+		last_shader_reload.shaders, last_shader_reload.failures, last_shader_reload.pipelines, last_shader_reload.ms).c_str());
 
 	ImGui::End();
 }
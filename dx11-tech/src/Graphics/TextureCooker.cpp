@@ -0,0 +1,621 @@
+#include "pch.h"
+#include "Graphics/TextureCooker.h"
+#include "Graphics/MipGenerator.h"
+#include "ThreadPool.h"
+#include "VirtualFile.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace jobs { extern ThreadPool* pool; }
+
+namespace
+{
+	// https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+	struct DDSPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t four_cc;
+		uint32_t rgb_bit_count;
+		uint32_t r_mask, g_mask, b_mask, a_mask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitch_or_linear_size;
+		uint32_t depth;
+		uint32_t mip_map_count;
+		uint32_t reserved1[11];
+		DDSPixelFormat ddspf;
+		uint32_t caps, caps2, caps3, caps4;
+		uint32_t reserved2;
+	};
+
+	struct DDSHeaderDX10
+	{
+		uint32_t dxgi_format;
+		uint32_t resource_dimension;
+		uint32_t misc_flag;
+		uint32_t array_size;
+		uint32_t misc_flags2;
+	};
+
+	static_assert(sizeof(DDSHeader) == 124 && sizeof(DDSHeaderDX10) == 20);
+
+	constexpr uint32_t make_four_cc(char a, char b, char c, char d)
+	{
+		return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+	}
+
+	constexpr uint32_t DDS_MAGIC = make_four_cc('D', 'D', 'S', ' ');
+	constexpr uint32_t DDS_DX10 = make_four_cc('D', 'X', '1', '0');
+	constexpr uint32_t COOK_MAGIC = make_four_cc('D', 'X', 'T', 'C');		// reserved1[0], followed by cooker version and source hash
+
+	constexpr uint32_t DDSD_CAPS = 0x1;
+	constexpr uint32_t DDSD_HEIGHT = 0x2;
+	constexpr uint32_t DDSD_WIDTH = 0x4;
+	constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+	constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+	constexpr uint32_t DDPF_FOURCC = 0x4;
+	constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+	constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+	constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+	constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+	constexpr size_t DDS_HEADERS_SIZE = sizeof(uint32_t) + sizeof(DDSHeader) + sizeof(DDSHeaderDX10);
+
+	bool is_supported(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_BC1_UNORM_SRGB || format == DXGI_FORMAT_BC3_UNORM_SRGB || format == DXGI_FORMAT_BC7_UNORM_SRGB;
+	}
+
+	uint32_t get_block_bytes(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_BC1_UNORM_SRGB ? 8 : 16;
+	}
+
+	std::vector<TextureCooker::Mip> get_mip_layout(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mip_count)
+	{
+		std::vector<TextureCooker::Mip> mips(mip_count);
+		uint64_t offset = 0;
+		for (uint32_t i = 0; i < mip_count; ++i)
+		{
+			auto& mip = mips[i];
+			mip.width = (std::max)(width >> i, 1u);
+			mip.height = (std::max)(height >> i, 1u);
+			mip.row_pitch = ((mip.width + 3) / 4) * get_block_bytes(format);
+			mip.size = (uint64_t)mip.row_pitch * ((mip.height + 3) / 4);
+			mip.offset = offset;
+			offset += mip.size;
+		}
+		return mips;
+	}
+
+	// Rows are independent, spread them over the pool when there is one
+	template <typename Func>
+	void for_each_row(uint32_t rows, Func&& func)
+	{
+		if (jobs::pool)
+			jobs::pool->parallel_for(rows, func);
+		else
+		{
+			for (uint32_t i = 0; i < rows; ++i)
+				func(i);
+		}
+	}
+
+	/*
+		Endpoints along the principal axis of the block colors (first C channels),
+		inset by 1/16 of the range to reduce the error of the quantized extremes.
+	*/
+	template <int C>
+	void fit_endpoints(const uint8_t* block, float* e0, float* e1)
+	{
+		float mean[C]{};
+		float lo[C], hi[C];
+		for (int c = 0; c < C; ++c)
+		{
+			lo[c] = 255.f;
+			hi[c] = 0.f;
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < C; ++c)
+			{
+				const float v = block[i * 4 + c];
+				mean[c] += v;
+				lo[c] = (std::min)(lo[c], v);
+				hi[c] = (std::max)(hi[c], v);
+			}
+		}
+		for (int c = 0; c < C; ++c)
+			mean[c] /= 16.f;
+
+		float cov[C][C]{};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int r = 0; r < C; ++r)
+				for (int c = 0; c < C; ++c)
+					cov[r][c] += (block[i * 4 + r] - mean[r]) * (block[i * 4 + c] - mean[c]);
+		}
+
+		// Power iteration, starting from the bounding box diagonal
+		float axis[C];
+		float len = 0.f;
+		for (int c = 0; c < C; ++c)
+		{
+			axis[c] = hi[c] - lo[c];
+			len += axis[c] * axis[c];
+		}
+
+		if (len == 0.f)
+		{
+			for (int c = 0; c < C; ++c)
+				e0[c] = e1[c] = mean[c];
+			return;
+		}
+
+		for (int iter = 0; iter < 8; ++iter)
+		{
+			float next[C]{};
+			float next_len = 0.f;
+			for (int r = 0; r < C; ++r)
+			{
+				for (int c = 0; c < C; ++c)
+					next[r] += cov[r][c] * axis[c];
+				next_len += next[r] * next[r];
+			}
+
+			if (next_len < 1e-12f)
+				break;
+
+			next_len = std::sqrt(next_len);
+			for (int c = 0; c < C; ++c)
+				axis[c] = next[c] / next_len;
+		}
+
+		len = 0.f;
+		for (int c = 0; c < C; ++c)
+			len += axis[c] * axis[c];
+		len = std::sqrt(len);
+		for (int c = 0; c < C; ++c)
+			axis[c] /= len;
+
+		float t_min = FLT_MAX, t_max = -FLT_MAX;
+		for (int i = 0; i < 16; ++i)
+		{
+			float t = 0.f;
+			for (int c = 0; c < C; ++c)
+				t += (block[i * 4 + c] - mean[c]) * axis[c];
+			t_min = (std::min)(t_min, t);
+			t_max = (std::max)(t_max, t);
+		}
+
+		const float inset = (t_max - t_min) / 16.f;
+		t_min += inset;
+		t_max -= inset;
+
+		for (int c = 0; c < C; ++c)
+		{
+			e0[c] = std::clamp(mean[c] + axis[c] * t_max, 0.f, 255.f);
+			e1[c] = std::clamp(mean[c] + axis[c] * t_min, 0.f, 255.f);
+		}
+	}
+
+	uint16_t to_565(const float* rgb)
+	{
+		const auto r = (uint16_t)std::lround(rgb[0] * 31.f / 255.f);
+		const auto g = (uint16_t)std::lround(rgb[1] * 63.f / 255.f);
+		const auto b = (uint16_t)std::lround(rgb[2] * 31.f / 255.f);
+		return (r << 11) | (g << 5) | b;
+	}
+
+	void from_565(uint16_t v, int* rgb)
+	{
+		const int r = (v >> 11) & 31;
+		const int g = (v >> 5) & 63;
+		const int b = v & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	template <int C>
+	int get_nearest(const uint8_t* pixel, const int (*palette)[4], int palette_size)
+	{
+		int best = 0;
+		int best_dist = INT_MAX;
+		for (int i = 0; i < palette_size; ++i)
+		{
+			int dist = 0;
+			for (int c = 0; c < C; ++c)
+			{
+				const int d = pixel[c] - palette[i][c];
+				dist += d * d;
+			}
+
+			if (dist < best_dist)
+			{
+				best_dist = dist;
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	// BC4 style 8 value alpha block (a0 > a1)
+	void encode_alpha_block(const uint8_t* block, uint8_t* out)
+	{
+		uint8_t a0 = 0, a1 = 255;
+		for (int i = 0; i < 16; ++i)
+		{
+			a0 = (std::max)(a0, block[i * 4 + 3]);
+			a1 = (std::min)(a1, block[i * 4 + 3]);
+		}
+
+		out[0] = a0;
+		out[1] = a1;
+
+		uint64_t bits = 0;
+		if (a0 != a1)
+		{
+			int palette[8][4]{};
+			palette[0][0] = a0;
+			palette[1][0] = a1;
+			for (int i = 1; i < 7; ++i)
+				palette[i + 1][0] = ((7 - i) * a0 + i * a1) / 7;
+
+			for (int i = 0; i < 16; ++i)
+				bits |= (uint64_t)get_nearest<1>(&block[i * 4 + 3], palette, 8) << (3 * i);
+		}
+
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = (uint8_t)(bits >> (8 * i));
+	}
+
+	struct BitWriter
+	{
+		uint8_t* out;
+		uint32_t pos = 0;
+
+		void write(uint32_t value, uint32_t bits)
+		{
+			for (uint32_t i = 0; i < bits; ++i, ++pos)
+			{
+				if ((value >> i) & 1)
+					out[pos / 8] |= (uint8_t)(1 << (pos % 8));
+			}
+		}
+	};
+}
+
+bool TextureCooker::can_cook(uint32_t width, uint32_t height)
+{
+	return width > 0 && height > 0 && width % 4 == 0 && height % 4 == 0;
+}
+
+void TextureCooker::encode_bc1_block(const uint8_t* block, uint8_t* out)
+{
+	float e0[3], e1[3];
+	fit_endpoints<3>(block, e0, e1);
+
+	uint16_t c0 = to_565(e0);
+	uint16_t c1 = to_565(e1);
+	uint32_t indices = 0;
+
+	// c0 > c1 selects the 4 color mode, equal endpoints leave every index at c0
+	if (c0 != c1)
+	{
+		if (c0 < c1)
+			std::swap(c0, c1);
+
+		int palette[4][4]{};
+		from_565(c0, palette[0]);
+		from_565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; ++i)
+			indices |= (uint32_t)get_nearest<3>(&block[i * 4], palette, 4) << (2 * i);
+	}
+
+	std::memcpy(out, &c0, 2);
+	std::memcpy(out + 2, &c1, 2);
+	std::memcpy(out + 4, &indices, 4);
+}
+
+void TextureCooker::encode_bc3_block(const uint8_t* block, uint8_t* out)
+{
+	encode_alpha_block(block, out);
+	encode_bc1_block(block, out + 8);
+}
+
+void TextureCooker::encode_bc7_block(const uint8_t* block, uint8_t* out)
+{
+	// Mode 6: RGBA endpoints with 7 bits per channel + one p-bit per endpoint, 4 bit indices
+	static constexpr int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	float e[2][4];
+	fit_endpoints<4>(block, e[0], e[1]);
+
+	int q[2][4]{};
+	int pbit[2]{};
+	for (int ep = 0; ep < 2; ++ep)
+	{
+		float best_err = FLT_MAX;
+		for (int p = 0; p < 2; ++p)
+		{
+			int candidate[4];
+			float err = 0.f;
+			for (int c = 0; c < 4; ++c)
+			{
+				candidate[c] = std::clamp((int)std::lround((e[ep][c] - p) / 2.f), 0, 127);
+				const float d = (float)((candidate[c] << 1) | p) - e[ep][c];
+				err += d * d;
+			}
+
+			if (err < best_err)
+			{
+				best_err = err;
+				pbit[ep] = p;
+				std::memcpy(q[ep], candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	int palette[16][4];
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			const int a = (q[0][c] << 1) | pbit[0];
+			const int b = (q[1][c] << 1) | pbit[1];
+			palette[i][c] = ((64 - weights[i]) * a + weights[i] * b + 32) >> 6;
+		}
+	}
+
+	int indices[16];
+	for (int i = 0; i < 16; ++i)
+		indices[i] = get_nearest<4>(&block[i * 4], palette, 16);
+
+	// The anchor index (first pixel) is stored without its MSB, swap the endpoints if it is set
+	if (indices[0] >= 8)
+	{
+		std::swap(q[0], q[1]);
+		std::swap(pbit[0], pbit[1]);
+		for (auto& idx : indices)
+			idx = 15 - idx;
+	}
+
+	std::memset(out, 0, 16);
+	BitWriter writer{ out };
+	writer.write(1 << 6, 7);
+	for (int c = 0; c < 4; ++c)
+	{
+		writer.write(q[0][c], 7);
+		writer.write(q[1][c], 7);
+	}
+	writer.write(pbit[0], 1);
+	writer.write(pbit[1], 1);
+	writer.write(indices[0], 3);
+	for (int i = 1; i < 16; ++i)
+		writer.write(indices[i], 4);
+}
+
+TextureCooker::CookedTexture TextureCooker::cook(const uint8_t* rgba, uint32_t width, uint32_t height, Format format)
+{
+	CookedTexture tex;
+	if (!can_cook(width, height))
+		return tex;
+
+	if (format == Format::eAuto)
+	{
+		bool opaque = true;
+		for (size_t i = 0; i < (size_t)width * height && opaque; ++i)
+			opaque = rgba[i * 4 + 3] == 255;
+		format = opaque ? Format::eBC1 : Format::eBC3;
+	}
+
+	void (*encode)(const uint8_t*, uint8_t*) = nullptr;
+	switch (format)
+	{
+	case Format::eBC1:
+		tex.format = DXGI_FORMAT_BC1_UNORM_SRGB;
+		encode = &encode_bc1_block;
+		break;
+	case Format::eBC3:
+		tex.format = DXGI_FORMAT_BC3_UNORM_SRGB;
+		encode = &encode_bc3_block;
+		break;
+	case Format::eBC7:
+		tex.format = DXGI_FORMAT_BC7_UNORM_SRGB;
+		encode = &encode_bc7_block;
+		break;
+	default:
+		assert(false);
+		return tex;
+	}
+
+	MipGenerator::Settings mip_settings;
+	mip_settings.filter = MipGenerator::Filter::eTent;
+	const auto chain = MipGenerator::generate(rgba, width, height, MipGenerator::Format::eRGBA8_SRGB, mip_settings);
+	const uint32_t block_bytes = get_block_bytes(tex.format);
+
+	tex.width = width;
+	tex.height = height;
+	tex.mip_count = (uint32_t)chain.levels.size();
+	tex.mips = get_mip_layout(tex.format, width, height, (uint32_t)chain.levels.size());
+	tex.data.resize(tex.mips.back().offset + tex.mips.back().size);
+
+	for (uint32_t level = 0; level < (uint32_t)chain.levels.size(); ++level)
+	{
+		const auto& mip = tex.mips[level];
+		const uint8_t* src = chain.get_level_data(level);
+		const uint32_t blocks_x = (mip.width + 3) / 4;
+		const uint32_t blocks_y = (mip.height + 3) / 4;
+
+		for_each_row(blocks_y, [&](uint32_t by)
+			{
+				uint8_t block[64];
+				for (uint32_t bx = 0; bx < blocks_x; ++bx)
+				{
+					// Mips smaller than a block repeat their edge pixels
+					for (uint32_t py = 0; py < 4; ++py)
+					{
+						const uint32_t sy = (std::min)(by * 4 + py, mip.height - 1);
+						for (uint32_t px = 0; px < 4; ++px)
+						{
+							const uint32_t sx = (std::min)(bx * 4 + px, mip.width - 1);
+							std::memcpy(&block[(py * 4 + px) * 4], &src[((size_t)sy * mip.width + sx) * 4], 4);
+						}
+					}
+
+					encode(block, &tex.data[mip.offset + (size_t)by * mip.row_pitch + (size_t)bx * block_bytes]);
+				}
+			});
+	}
+
+	return tex;
+}
+
+std::filesystem::path TextureCooker::get_cooked_path(const std::filesystem::path& source)
+{
+	auto cooked = std::filesystem::path(COOKED_DIRECTORY) / source.relative_path();
+	cooked += ".dds";
+	return cooked;
+}
+
+bool TextureCooker::write_dds(const CookedTexture& texture, uint64_t source_hash, const std::filesystem::path& path)
+{
+	// Partially read textures can't be written back
+	if (!texture.is_valid() || texture.first_mip != 0)
+		return false;
+
+	DDSHeader hdr{};
+	hdr.size = sizeof(DDSHeader);
+	hdr.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	hdr.height = texture.height;
+	hdr.width = texture.width;
+	hdr.pitch_or_linear_size = (uint32_t)texture.mips[0].size;
+	hdr.mip_map_count = (uint32_t)texture.mips.size();
+	hdr.reserved1[0] = COOK_MAGIC;
+	hdr.reserved1[1] = VERSION;
+	hdr.reserved1[2] = (uint32_t)source_hash;
+	hdr.reserved1[3] = (uint32_t)(source_hash >> 32);
+	hdr.ddspf.size = sizeof(DDSPixelFormat);
+	hdr.ddspf.flags = DDPF_FOURCC;
+	hdr.ddspf.four_cc = DDS_DX10;
+	hdr.caps = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+	DDSHeaderDX10 dx10{};
+	dx10.dxgi_format = texture.format;
+	dx10.resource_dimension = DDS_DIMENSION_TEXTURE2D;
+	dx10.array_size = 1;
+
+	std::error_code ec;
+	std::filesystem::create_directories(path.parent_path(), ec);
+
+	// Write to a temporary first so a partially written file is never picked up
+	auto tmp_path = path;
+	tmp_path += ".tmp";
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+		file.write((const char*)&hdr, sizeof(hdr));
+		file.write((const char*)&dx10, sizeof(dx10));
+		file.write((const char*)texture.data.data(), texture.data.size());
+		if (!file.good())
+			return false;
+	}
+
+	std::filesystem::rename(tmp_path, path, ec);
+	return !ec;
+}
+
+uint32_t TextureCooker::get_valid_first_mip(uint32_t width, uint32_t height, uint32_t mip_count, uint32_t first_mip, uint32_t max_top_size)
+{
+	if (mip_count == 0)
+		return 0;
+
+	first_mip = (std::min)(first_mip, mip_count - 1);
+	if (max_top_size > 0)
+	{
+		while (first_mip + 1 < mip_count && (std::max)(width >> first_mip, height >> first_mip) > max_top_size)
+			++first_mip;
+	}
+
+	// Towards the full mip until both dimensions are a multiple of 4, mip 0 always is (see can_cook)
+	while (first_mip > 0 && (((width >> first_mip) % 4) != 0 || ((height >> first_mip) % 4) != 0))
+		--first_mip;
+	return first_mip;
+}
+
+uint64_t TextureCooker::get_chain_size(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mip_count, uint32_t first_mip)
+{
+	if (first_mip >= mip_count)
+		return 0;
+
+	const auto mips = get_mip_layout(format, width, height, mip_count);
+	return mips.back().offset + mips.back().size - mips[first_mip].offset;
+}
+
+TextureCooker::CookedTexture TextureCooker::read_dds(const std::filesystem::path& path, uint64_t source_hash, uint32_t first_mip, uint32_t max_top_size)
+{
+	CookedTexture tex;
+
+	VirtualFile file(path);
+	if (!file.is_open() || file.size() < DDS_HEADERS_SIZE)
+		return tex;
+
+	uint32_t magic = 0;
+	DDSHeader hdr{};
+	DDSHeaderDX10 dx10{};
+	std::memcpy(&magic, file.data(), sizeof(magic));
+	std::memcpy(&hdr, file.data() + sizeof(magic), sizeof(hdr));
+	std::memcpy(&dx10, file.data() + sizeof(magic) + sizeof(hdr), sizeof(dx10));
+
+	const bool up_to_date =
+		magic == DDS_MAGIC && hdr.size == sizeof(DDSHeader) && hdr.ddspf.four_cc == DDS_DX10 &&
+		hdr.reserved1[0] == COOK_MAGIC && hdr.reserved1[1] == VERSION &&
+		hdr.reserved1[2] == (uint32_t)source_hash && hdr.reserved1[3] == (uint32_t)(source_hash >> 32);
+
+	const auto format = (DXGI_FORMAT)dx10.dxgi_format;
+	if (!up_to_date || !is_supported(format) || dx10.resource_dimension != DDS_DIMENSION_TEXTURE2D || dx10.array_size != 1 ||
+		!can_cook(hdr.width, hdr.height) || hdr.mip_map_count == 0 || hdr.mip_map_count > 16)
+		return tex;
+
+	auto mips = get_mip_layout(format, hdr.width, hdr.height, hdr.mip_map_count);
+	const uint64_t data_size = mips.back().offset + mips.back().size;
+	if (data_size != file.size() - DDS_HEADERS_SIZE)
+		return tex;
+
+	first_mip = get_valid_first_mip(hdr.width, hdr.height, hdr.mip_map_count, first_mip, max_top_size);
+	const uint64_t skipped = mips[first_mip].offset;
+	mips.erase(mips.begin(), mips.begin() + first_mip);
+	for (auto& mip : mips)
+		mip.offset -= skipped;
+
+	tex.format = format;
+	tex.width = hdr.width;
+	tex.height = hdr.height;
+	tex.first_mip = first_mip;
+	tex.mip_count = hdr.mip_map_count;
+	tex.mips = std::move(mips);
+	tex.data.assign(file.data() + DDS_HEADERS_SIZE + skipped, file.data() + file.size());
+	return tex;
+}
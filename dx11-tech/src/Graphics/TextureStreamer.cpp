@@ -0,0 +1,269 @@
+#include "pch.h"
+#include "Graphics/TextureStreamer.h"
+#include "Graphics/API/GfxDevice.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace jobs { extern ThreadPool* pool; }
+
+TextureStreamer::TextureStreamer(GfxDevice* dev) :
+	m_dev(dev)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	for (auto& [tex, texture] : m_textures)
+	{
+		if (texture.load.valid())
+			jobs::pool->wait(texture.load);
+	}
+}
+
+uint64_t TextureStreamer::get_size(const StreamedTexture& texture, uint32_t first_mip) const
+{
+	return TextureCooker::get_chain_size(texture.format, texture.width, texture.height, texture.mip_count, first_mip);
+}
+
+void TextureStreamer::add(TextureHandle tex, const std::filesystem::path& cooked_path, uint64_t source_hash, const TextureCooker::CookedTexture& cooked)
+{
+	if (!cooked.is_valid() || is_streamed(tex))
+		return;
+
+	StreamedTexture texture;
+	texture.cooked_path = cooked_path;
+	texture.source_hash = source_hash;
+	texture.format = cooked.format;
+	texture.width = cooked.width;
+	texture.height = cooked.height;
+	texture.mip_count = cooked.mip_count;
+	texture.base_mip = cooked.first_mip;
+	texture.resident_mip = cooked.first_mip;
+	texture.resident_bytes = cooked.data.size();
+
+	++m_stats.textures;
+	m_stats.resident_bytes += texture.resident_bytes;
+	m_stats.full_bytes += get_size(texture, 0);
+
+	m_textures.insert({ tex, std::move(texture) });
+}
+
+void TextureStreamer::remove(TextureHandle tex)
+{
+	auto it = m_textures.find(tex);
+	if (it == m_textures.end())
+		return;
+
+	auto& texture = it->second;
+	if (texture.load.valid())
+	{
+		// The job owns its inputs, the result is simply dropped
+		m_pending_bytes -= texture.load_bytes;
+		--m_stats.pending;
+	}
+
+	--m_stats.textures;
+	m_stats.resident_bytes -= texture.resident_bytes;
+	m_stats.full_bytes -= get_size(texture, 0);
+	m_textures.erase(it);
+}
+
+uint32_t TextureStreamer::get_resident_mip(TextureHandle tex) const
+{
+	auto it = m_textures.find(tex);
+	return it != m_textures.end() ? it->second.resident_mip : 0;
+}
+
+uint64_t TextureStreamer::get_resident_bytes(TextureHandle tex) const
+{
+	auto it = m_textures.find(tex);
+	return it != m_textures.end() ? it->second.resident_bytes : 0;
+}
+
+void TextureStreamer::request(TextureHandle tex, float uv_per_pixel)
+{
+	auto it = m_textures.find(tex);
+	if (it == m_textures.end())
+		return;
+
+	auto& texture = it->second;
+
+	// One texel per pixel along the larger dimension
+	const float texels_per_pixel = (std::max)(texture.width, texture.height) * uv_per_pixel;
+	uint32_t mip = 0;
+	if (texels_per_pixel >= (float)(1u << 16))
+		mip = texture.base_mip;
+	else if (texels_per_pixel > 1.f)
+		mip = (std::min)((uint32_t)std::log2(texels_per_pixel), texture.base_mip);
+	mip = TextureCooker::get_valid_first_mip(texture.width, texture.height, texture.mip_count, mip);
+
+	if (texture.last_used_frame != m_frame)
+	{
+		texture.last_used_frame = m_frame;
+		texture.requested_mip = mip;
+	}
+	else
+		texture.requested_mip = (std::min)(texture.requested_mip, mip);
+}
+
+bool TextureStreamer::apply(TextureHandle tex, StreamedTexture& texture, const TextureCooker::CookedTexture& cooked)
+{
+	if (!cooked.is_valid())
+	{
+		fmt::print(fg(fmt::color::red), "Failed to stream {}\n", texture.cooked_path.string());
+		return false;
+	}
+
+	auto desc = TextureDesc::make_2d(cooked.format, cooked.mips[0].width, cooked.mips[0].height, D3D11_BIND_SHADER_RESOURCE, (UINT)cooked.mips.size());
+
+	std::vector<SubresourceData> subres;
+	subres.reserve(cooked.mips.size());
+	for (const auto& mip : cooked.mips)
+		subres.push_back(SubresourceData((void*)(cooked.data.data() + mip.offset), mip.row_pitch, 0));
+
+	m_dev->replace_texture(tex, desc, subres);
+
+	m_stats.resident_bytes = m_stats.resident_bytes - texture.resident_bytes + cooked.data.size();
+	texture.resident_mip = cooked.first_mip;
+	texture.resident_bytes = cooked.data.size();
+	return true;
+}
+
+void TextureStreamer::trim(TextureHandle tex, StreamedTexture& texture, uint32_t first_mip)
+{
+	auto desc = TextureDesc::make_2d(texture.format, (std::max)(texture.width >> first_mip, 1u), (std::max)(texture.height >> first_mip, 1u),
+		D3D11_BIND_SHADER_RESOURCE, texture.mip_count - first_mip);
+	m_dev->trim_texture(tex, desc, first_mip - texture.resident_mip);
+
+	const uint64_t bytes = get_size(texture, first_mip);
+	m_stats.resident_bytes = m_stats.resident_bytes - texture.resident_bytes + bytes;
+	texture.resident_mip = first_mip;
+	texture.resident_bytes = bytes;
+}
+
+bool TextureStreamer::is_evictable(const StreamedTexture& texture) const
+{
+	return texture.last_used_frame != m_frame && !texture.load.valid() && texture.resident_mip < texture.base_mip;
+}
+
+uint64_t TextureStreamer::get_available_bytes() const
+{
+	uint64_t evictable = 0;
+	for (const auto& [tex, texture] : m_textures)
+	{
+		if (is_evictable(texture))
+			evictable += texture.resident_bytes - get_size(texture, texture.base_mip);
+	}
+
+	const uint64_t used = m_stats.resident_bytes + m_pending_bytes - evictable;
+	return used < m_settings.budget_bytes ? m_settings.budget_bytes - used : 0;
+}
+
+bool TextureStreamer::make_room(uint64_t bytes)
+{
+	const uint64_t used = m_stats.resident_bytes + m_pending_bytes;
+	if (used + bytes <= m_settings.budget_bytes)
+		return true;
+	uint64_t needed = used + bytes - m_settings.budget_bytes;
+
+	// Least recently used first, textures requested this frame or loading are left alone
+	std::vector<std::pair<TextureHandle, StreamedTexture*>> victims;
+	uint64_t evictable = 0;
+	for (auto& [tex, texture] : m_textures)
+	{
+		if (!is_evictable(texture))
+			continue;
+		victims.push_back({ tex, &texture });
+		evictable += texture.resident_bytes - get_size(texture, texture.base_mip);
+	}
+	if (evictable < needed)
+		return false;
+
+	std::sort(victims.begin(), victims.end(), [](const auto& a, const auto& b) { return a.second->last_used_frame < b.second->last_used_frame; });
+
+	for (auto& [tex, texture] : victims)
+	{
+		// One top mip at a time, until enough is freed or the texture is back to its initial mips
+		uint32_t mip = texture->resident_mip;
+		uint64_t freed = 0;
+		while (mip < texture->base_mip && freed < needed)
+		{
+			++mip;
+			if (TextureCooker::get_valid_first_mip(texture->width, texture->height, texture->mip_count, mip) != mip)
+				continue;
+			freed = texture->resident_bytes - get_size(*texture, mip);
+		}
+
+		// The resident texture already holds the lower mips, no read needed
+		trim(tex, *texture, mip);
+		++m_stats.evicted;
+		needed -= (std::min)(freed, needed);
+
+		if (needed == 0)
+			break;
+	}
+	return needed == 0;
+}
+
+void TextureStreamer::update()
+{
+	// Finished loads
+	for (auto& [tex, texture] : m_textures)
+	{
+		if (!texture.load.valid() || texture.load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			continue;
+
+		m_pending_bytes -= texture.load_bytes;
+		--m_stats.pending;
+		if (apply(tex, texture, texture.load.get()))
+			++m_stats.streamed_in;
+	}
+
+	// The budget may have been lowered
+	make_room(0);
+
+	// Textures requested this frame wanting finer mips than resident, largest mip difference first
+	std::vector<std::pair<TextureHandle, StreamedTexture*>> wanted;
+	for (auto& [tex, texture] : m_textures)
+	{
+		if (texture.last_used_frame == m_frame && !texture.load.valid() && texture.requested_mip < texture.resident_mip)
+			wanted.push_back({ tex, &texture });
+	}
+	std::sort(wanted.begin(), wanted.end(), [](const auto& a, const auto& b)
+		{
+			return a.second->resident_mip - a.second->requested_mip > b.second->resident_mip - b.second->requested_mip;
+		});
+
+	for (auto& [tex, texture] : wanted)
+	{
+		if (m_stats.pending >= m_settings.max_in_flight)
+			break;
+
+		// Finest mip that fits in the budget once everything evictable is, then evicted for only once
+		const uint64_t available = get_available_bytes();
+		uint32_t mip = texture->requested_mip;
+		for (; mip < texture->resident_mip; ++mip)
+		{
+			if (TextureCooker::get_valid_first_mip(texture->width, texture->height, texture->mip_count, mip) == mip &&
+				get_size(*texture, mip) - texture->resident_bytes <= available)
+				break;
+		}
+
+		if (mip != texture->requested_mip)
+			++m_stats.clamped;
+		if (mip >= texture->resident_mip || !make_room(get_size(*texture, mip) - texture->resident_bytes))
+			continue;
+
+		texture->load_bytes = get_size(*texture, mip) - texture->resident_bytes;
+		m_pending_bytes += texture->load_bytes;
+		++m_stats.pending;
+
+		texture->load = jobs::pool->submit([path = texture->cooked_path, hash = texture->source_hash, mip]()
+			{
+				return TextureCooker::read_dds(path, hash, mip);
+			});
+	}
+
+	++m_frame;
+}
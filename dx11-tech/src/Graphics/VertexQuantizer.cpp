@@ -0,0 +1,206 @@
+#include "pch.h"
+#include "Graphics/VertexQuantizer.h"
+#include "Graphics/API/GfxDescriptorsPrimitive.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX::SimpleMath;
+
+namespace
+{
+	constexpr float s_unorm16_max = 65535.f;
+	constexpr float s_snorm16_max = 32767.f;
+	constexpr float s_radians_to_degrees = 57.2957795f;
+
+	float sign_not_zero(float v)
+	{
+		return v >= 0.f ? 1.f : -1.f;
+	}
+
+	int16_t to_snorm16(float v)
+	{
+		return (int16_t)std::lround(std::clamp(v, -1.f, 1.f) * s_snorm16_max);
+	}
+
+	float from_snorm16(int16_t v)
+	{
+		return (std::max)(v / s_snorm16_max, -1.f);
+	}
+}
+
+Matrix VertexQuantizer::Result::get_dequantization() const
+{
+	return Matrix::CreateScale(bounds_max - bounds_min) * Matrix::CreateTranslation(bounds_min);
+}
+
+VertexQuantizer::Position VertexQuantizer::encode_position(const Vector3& p, const Vector3& min, const Vector3& extent)
+{
+	auto quantize = [](float v, float min, float extent)
+	{
+		const float t = extent > 0.f ? (v - min) / extent : 0.f;
+		return (uint16_t)std::lround(std::clamp(t, 0.f, 1.f) * s_unorm16_max);
+	};
+
+	return { quantize(p.x, min.x, extent.x), quantize(p.y, min.y, extent.y), quantize(p.z, min.z, extent.z), (uint16_t)s_unorm16_max };
+}
+
+Vector3 VertexQuantizer::decode_position(const Position& p, const Vector3& min, const Vector3& extent)
+{
+	return Vector3(
+		min.x + p.x / s_unorm16_max * extent.x,
+		min.y + p.y / s_unorm16_max * extent.y,
+		min.z + p.z / s_unorm16_max * extent.z);
+}
+
+VertexQuantizer::Normal VertexQuantizer::encode_normal(const Vector3& n)
+{
+	// Project onto the octahedron, fold the lower hemisphere over the diagonals
+	const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	if (l1 <= 0.f)
+		return { 0, 0 };
+
+	float x = n.x / l1;
+	float y = n.y / l1;
+	if (n.z < 0.f)
+	{
+		const float fx = (1.f - std::abs(y)) * sign_not_zero(x);
+		const float fy = (1.f - std::abs(x)) * sign_not_zero(y);
+		x = fx;
+		y = fy;
+	}
+
+	/*
+		Rounding each axis on its own isn't always the closest encoding,
+		pick the best of the four neighbouring grid points instead.
+	*/
+	const float base_x = std::floor(std::clamp(x, -1.f, 1.f) * s_snorm16_max);
+	const float base_y = std::floor(std::clamp(y, -1.f, 1.f) * s_snorm16_max);
+
+	Vector3 unit = n;
+	unit.Normalize();
+
+	Normal best = { to_snorm16(x), to_snorm16(y) };
+	float best_dot = -FLT_MAX;
+	for (int i = 0; i < 4; ++i)
+	{
+		const Normal candidate = { to_snorm16((base_x + (i & 1)) / s_snorm16_max), to_snorm16((base_y + (i >> 1)) / s_snorm16_max) };
+		const float d = decode_normal(candidate).Dot(unit);
+		if (d > best_dot)
+		{
+			best_dot = d;
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+Vector3 VertexQuantizer::decode_normal(const Normal& e)
+{
+	// Same as oct_decode in gpassQuantizedVS.hlsl
+	Vector3 n(from_snorm16(e.x), from_snorm16(e.y), 0.f);
+	n.z = 1.f - std::abs(n.x) - std::abs(n.y);
+
+	const float t = std::clamp(-n.z, 0.f, 1.f);
+	n.x += n.x >= 0.f ? -t : t;
+	n.y += n.y >= 0.f ? -t : t;
+
+	n.Normalize();
+	return n;
+}
+
+VertexQuantizer::UV VertexQuantizer::encode_uv(const Vector2& uv)
+{
+	return { DirectX::PackedVector::XMConvertFloatToHalf(uv.x), DirectX::PackedVector::XMConvertFloatToHalf(uv.y) };
+}
+
+Vector2 VertexQuantizer::decode_uv(const UV& uv)
+{
+	return Vector2(DirectX::PackedVector::XMConvertHalfToFloat(uv.u), DirectX::PackedVector::XMConvertHalfToFloat(uv.v));
+}
+
+VertexQuantizer::Result VertexQuantizer::quantize(const ModelSourceView& source)
+{
+	Result result;
+	const uint32_t count = source.vertex_count;
+	if (count == 0)
+		return result;
+
+	// Bounds
+	result.bounds_min = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	result.bounds_max = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const Vector3 p(&source.positions[i * 3]);
+		result.bounds_min = Vector3::Min(result.bounds_min, p);
+		result.bounds_max = Vector3::Max(result.bounds_max, p);
+	}
+	const Vector3 extent = result.bounds_max - result.bounds_min;
+
+	result.positions.resize(count);
+	result.normals.resize(count);
+	result.uvs.resize(source.uv_count);
+
+	// Encode and measure the round trip error
+	auto& errors = result.errors;
+	double position_sum = 0.0, normal_sum = 0.0, uv_sum = 0.0;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const Vector3 p(&source.positions[i * 3]);
+		result.positions[i] = encode_position(p, result.bounds_min, extent);
+		const float position_error = Vector3::Distance(p, decode_position(result.positions[i], result.bounds_min, extent));
+		errors.max_position = (std::max)(errors.max_position, position_error);
+		position_sum += position_error;
+
+		Vector3 n(&source.normals[i * 3]);
+		n.Normalize();
+		result.normals[i] = encode_normal(n);
+		const float normal_error = std::acos(std::clamp(n.Dot(decode_normal(result.normals[i])), -1.f, 1.f)) * s_radians_to_degrees;
+		errors.max_normal_degrees = (std::max)(errors.max_normal_degrees, normal_error);
+		normal_sum += normal_error;
+	}
+
+	for (uint32_t i = 0; i < source.uv_count; ++i)
+	{
+		const Vector2 uv(&source.uvs[i * 2]);
+		result.uvs[i] = encode_uv(uv);
+		const Vector2 decoded = decode_uv(result.uvs[i]);
+		const float uv_error = (std::max)(std::abs(uv.x - decoded.x), std::abs(uv.y - decoded.y));
+		errors.max_uv = (std::max)(errors.max_uv, uv_error);
+		uv_sum += uv_error;
+	}
+
+	errors.avg_position = (float)(position_sum / count);
+	errors.avg_normal_degrees = (float)(normal_sum / count);
+	errors.avg_uv = source.uv_count > 0 ? (float)(uv_sum / source.uv_count) : 0.f;
+
+	return result;
+}
+
+void VertexQuantizer::print_report(const std::filesystem::path& path, const Result& result)
+{
+	const size_t vertices = result.positions.size();
+	const size_t full_bytes = vertices * 6 * sizeof(float) + result.uvs.size() * 2 * sizeof(float);
+	const size_t quantized_bytes = vertices * (sizeof(Position) + sizeof(Normal)) + result.uvs.size() * sizeof(UV);
+	const float extent = (result.bounds_max - result.bounds_min).Length();
+	const auto& e = result.errors;
+
+	fmt::print("Quantized {}: {} vertices, {:.2f} MB -> {:.2f} MB\n", path.string(), vertices, full_bytes / (1024.0 * 1024.0), quantized_bytes / (1024.0 * 1024.0));
+	fmt::print("\tposition error max {:.5f} avg {:.5f} (bounds diagonal {:.2f}), normal error max {:.4f} avg {:.4f} deg, uv error max {:.6f} avg {:.6f}\n",
+		e.max_position, e.avg_position, extent, e.max_normal_degrees, e.avg_normal_degrees, e.max_uv, e.avg_uv);
+}
+
+InputLayoutDesc VertexQuantizer::get_input_layout()
+{
+	return InputLayoutDesc()
+		.append("POSITION", DXGI_FORMAT_R16G16B16A16_UNORM, 0)
+		.append("UV", DXGI_FORMAT_R16G16_FLOAT, 1)
+		.append("NORMAL", DXGI_FORMAT_R16G16_SNORM, 2);
+}
+
+InputLayoutDesc VertexQuantizer::get_position_layout()
+{
+	return InputLayoutDesc().append("POSITION", DXGI_FORMAT_R16G16B16A16_UNORM, 0);
+}
@@ -0,0 +1,342 @@
+#include "pch.h"
+#include "Json.h"
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	void escape_to(std::string& out, const std::string& str)
+	{
+		out += '"';
+		for (const char c : str)
+		{
+			switch (c)
+			{
+			case '"':	out += "\\\""; break;
+			case '\\':	out += "\\\\"; break;
+			case '\n':	out += "\\n"; break;
+			case '\r':	out += "\\r"; break;
+			case '\t':	out += "\\t"; break;
+			default:
+				if ((unsigned char)c < 0x20)
+					out += fmt::format("\\u{:04x}", (unsigned)c);
+				else
+					out += c;
+			}
+		}
+		out += '"';
+	}
+
+	void indent_to(std::string& out, uint32_t depth)
+	{
+		out += '\n';
+		out.append(depth, '\t');
+	}
+
+	class Parser
+	{
+	public:
+		Parser(const std::string& text) : m_text(text) {}
+
+		std::optional<JsonValue> parse_document()
+		{
+			auto value = parse_value();
+			skip_ws();
+			if (!value || m_pos != m_text.size())
+				return {};
+			return value;
+		}
+
+	private:
+		void skip_ws()
+		{
+			while (m_pos < m_text.size() && std::isspace((unsigned char)m_text[m_pos]))
+				++m_pos;
+		}
+
+		bool consume(char c)
+		{
+			skip_ws();
+			if (m_pos < m_text.size() && m_text[m_pos] == c)
+			{
+				++m_pos;
+				return true;
+			}
+			return false;
+		}
+
+		bool consume_literal(const char* lit)
+		{
+			const auto len = std::strlen(lit);
+			if (m_text.compare(m_pos, len, lit) != 0)
+				return false;
+			m_pos += len;
+			return true;
+		}
+
+		std::optional<std::string> parse_string()
+		{
+			if (!consume('"'))
+				return {};
+
+			std::string str;
+			while (m_pos < m_text.size())
+			{
+				const char c = m_text[m_pos++];
+				if (c == '"')
+					return str;
+				if (c != '\\')
+				{
+					str += c;
+					continue;
+				}
+				if (m_pos >= m_text.size())
+					return {};
+
+				const char esc = m_text[m_pos++];
+				switch (esc)
+				{
+				case '"':	str += '"'; break;
+				case '\\':	str += '\\'; break;
+				case '/':	str += '/'; break;
+				case 'b':	str += '\b'; break;
+				case 'f':	str += '\f'; break;
+				case 'n':	str += '\n'; break;
+				case 'r':	str += '\r'; break;
+				case 't':	str += '\t'; break;
+				case 'u':
+				{
+					// We only ever write ASCII control characters this way, anything wider is replaced
+					if (m_pos + 4 > m_text.size())
+						return {};
+					uint32_t code = 0;
+					for (size_t i = 0; i < 4; ++i)
+					{
+						const char h = m_text[m_pos + i];
+						if (h >= '0' && h <= '9')
+							code = code * 16 + (h - '0');
+						else if (h >= 'a' && h <= 'f')
+							code = code * 16 + (h - 'a' + 10);
+						else if (h >= 'A' && h <= 'F')
+							code = code * 16 + (h - 'A' + 10);
+						else
+							return {};		// not 4 hex digits
+					}
+					str += code < 0x80 ? (char)code : '?';
+					m_pos += 4;
+					break;
+				}
+				default:
+					return {};
+				}
+			}
+			return {};
+		}
+
+		std::optional<JsonValue> parse_value()
+		{
+			skip_ws();
+			if (m_pos >= m_text.size())
+				return {};
+
+			const char c = m_text[m_pos];
+			if (c == '{')
+			{
+				++m_pos;
+				auto obj = JsonValue::object();
+				if (consume('}'))
+					return obj;
+				do
+				{
+					auto key = parse_string();
+					if (!key || !consume(':'))
+						return {};
+					auto value = parse_value();
+					if (!value)
+						return {};
+					obj.as_object().push_back({ std::move(*key), std::move(*value) });
+				} while (consume(','));
+
+				if (!consume('}'))
+					return {};
+				return obj;
+			}
+			if (c == '[')
+			{
+				++m_pos;
+				auto arr = JsonValue::array();
+				if (consume(']'))
+					return arr;
+				do
+				{
+					auto value = parse_value();
+					if (!value)
+						return {};
+					arr.push_back(std::move(*value));
+				} while (consume(','));
+
+				if (!consume(']'))
+					return {};
+				return arr;
+			}
+			if (c == '"')
+			{
+				auto str = parse_string();
+				if (!str)
+					return {};
+				return JsonValue(*str);
+			}
+			if (consume_literal("true"))
+				return JsonValue(true);
+			if (consume_literal("false"))
+				return JsonValue(false);
+			if (consume_literal("null"))
+				return JsonValue(nullptr);
+
+			// Number
+			const char* begin = m_text.c_str() + m_pos;
+			char* end = nullptr;
+			const double num = std::strtod(begin, &end);
+			if (end == begin)
+				return {};
+			m_pos += end - begin;
+			return JsonValue(num);
+		}
+
+	private:
+		const std::string& m_text;
+		size_t m_pos = 0;
+	};
+}
+
+JsonValue& JsonValue::operator[](const std::string& key)
+{
+	if (is_null())
+		m_value = Object();
+
+	auto& obj = as_object();
+	for (auto& [k, v] : obj)
+		if (k == key)
+			return v;
+
+	obj.push_back({ key, JsonValue() });
+	return obj.back().second;
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const
+{
+	if (!is_object())
+		return nullptr;
+
+	for (const auto& [k, v] : as_object())
+		if (k == key)
+			return &v;
+	return nullptr;
+}
+
+JsonValue& JsonValue::push_back(JsonValue value)
+{
+	if (is_null())
+		m_value = Array();
+
+	auto& arr = as_array();
+	arr.push_back(std::move(value));
+	return arr.back();
+}
+
+std::string JsonValue::dump(bool pretty) const
+{
+	std::string out;
+	dump_internal(out, pretty, 0);
+	return out;
+}
+
+void JsonValue::dump_internal(std::string& out, bool pretty, uint32_t depth) const
+{
+	switch (m_value.index())
+	{
+	case 0:
+		out += "null";
+		break;
+	case 1:
+		out += as_bool() ? "true" : "false";
+		break;
+	case 2:
+	{
+		// Integers are written without a fraction, NaN/inf are not valid JSON
+		const double num = as_number();
+		if (!std::isfinite(num))
+			out += "null";
+		else if (num == std::floor(num) && std::abs(num) < 1e15)
+			out += fmt::format("{}", (int64_t)num);
+		else
+			out += fmt::format("{:.6g}", num);
+		break;
+	}
+	case 3:
+		escape_to(out, as_string());
+		break;
+	case 4:
+	{
+		const auto& arr = as_array();
+		out += '[';
+		for (size_t i = 0; i < arr.size(); ++i)
+		{
+			if (i != 0)
+				out += ',';
+			if (pretty)
+				indent_to(out, depth + 1);
+			arr[i].dump_internal(out, pretty, depth + 1);
+		}
+		if (pretty && !arr.empty())
+			indent_to(out, depth);
+		out += ']';
+		break;
+	}
+	case 5:
+	{
+		const auto& obj = as_object();
+		out += '{';
+		for (size_t i = 0; i < obj.size(); ++i)
+		{
+			if (i != 0)
+				out += ',';
+			if (pretty)
+				indent_to(out, depth + 1);
+			escape_to(out, obj[i].first);
+			out += pretty ? ": " : ":";
+			obj[i].second.dump_internal(out, pretty, depth + 1);
+		}
+		if (pretty && !obj.empty())
+			indent_to(out, depth);
+		out += '}';
+		break;
+	}
+	}
+}
+
+std::optional<JsonValue> JsonValue::parse(const std::string& text)
+{
+	return Parser(text).parse_document();
+}
+
+bool JsonValue::write_file(const std::filesystem::path& path, bool pretty) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	const auto text = dump(pretty);
+	file.write(text.data(), text.size());
+	return file.good();
+}
+
+std::optional<JsonValue> JsonValue::read_file(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return {};
+
+	std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return parse(text);
+}
@@ -0,0 +1,180 @@
+#include "pch.h"
+#include "Lz4.h"
+#include <cstring>
+
+namespace
+{
+	constexpr size_t MIN_MATCH = 4;
+	constexpr size_t LAST_LITERALS = 5;		// the last 5 bytes of a block are always literals
+	constexpr size_t MATCH_LIMIT = 12;		// and the last match starts at least 12 bytes before the end
+	constexpr size_t MAX_DISTANCE = 65535;
+	constexpr uint32_t HASH_BITS = 12;
+
+	uint32_t read32(const uint8_t* p)
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	uint32_t hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// 15 in the token nibble, the rest as a run of 255s and a final byte
+	uint8_t* write_length(uint8_t* op, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+			*op++ = 255;
+		*op++ = (uint8_t)length;
+		return op;
+	}
+
+	// Token, literals and (unless last) the match, nullptr if it doesn't fit
+	uint8_t* write_sequence(uint8_t* op, const uint8_t* end, const uint8_t* literals, size_t literal_count, size_t distance, size_t match_length, bool last)
+	{
+		const size_t worst = 1 + literal_count / 255 + 1 + literal_count + 2 + match_length / 255 + 1;
+		if ((size_t)(end - op) < worst)
+			return nullptr;
+
+		const size_t match_code = last ? 0 : match_length - MIN_MATCH;
+		uint8_t* token = op++;
+		*token = (uint8_t)(((std::min)(literal_count, (size_t)15) << 4) | (std::min)(match_code, (size_t)15));
+
+		if (literal_count >= 15)
+			op = write_length(op, literal_count - 15);
+		std::memcpy(op, literals, literal_count);
+		op += literal_count;
+
+		if (last)
+			return op;
+
+		*op++ = (uint8_t)(distance & 0xff);
+		*op++ = (uint8_t)(distance >> 8);
+		if (match_code >= 15)
+			op = write_length(op, match_code - 15);
+		return op;
+	}
+
+	bool read_length(const uint8_t* src, size_t compressed_size, size_t& ip, size_t& length)
+	{
+		uint8_t byte = 0;
+		do
+		{
+			if (ip >= compressed_size)
+				return false;
+			byte = src[ip++];
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+}
+
+namespace lz4
+{
+	size_t compress_bound(size_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	size_t compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity)
+	{
+		uint8_t* op = dst;
+		const uint8_t* end = dst + capacity;
+		size_t anchor = 0;
+
+		if (size > MATCH_LIMIT)
+		{
+			uint32_t table[1 << HASH_BITS] = {};		// sequence hash --> last position
+			uint32_t misses = 0;
+
+			for (size_t ip = 0; ip + MATCH_LIMIT < size;)
+			{
+				const uint32_t sequence = read32(src + ip);
+				const uint32_t h = hash(sequence);
+				size_t ref = table[h];
+				table[h] = (uint32_t)ip;
+
+				if (ref >= ip || ip - ref > MAX_DISTANCE || read32(src + ref) != sequence)
+				{
+					// Skip ahead faster through data that doesn't compress
+					ip += 1 + (misses++ >> 6);
+					continue;
+				}
+				misses = 0;
+
+				// Extend backwards over the pending literals, then forwards up to the trailing literals
+				while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1])
+				{
+					--ip;
+					--ref;
+				}
+				size_t length = MIN_MATCH;
+				const size_t max_length = size - LAST_LITERALS - ip;
+				while (length < max_length && src[ref + length] == src[ip + length])
+					++length;
+
+				op = write_sequence(op, end, src + anchor, ip - anchor, ip - ref, length, false);
+				if (!op)
+					return 0;
+
+				ip += length;
+				anchor = ip;
+			}
+		}
+
+		op = write_sequence(op, end, src + anchor, size - anchor, 0, 0, true);
+		return op ? (size_t)(op - dst) : 0;
+	}
+
+	bool decompress(const uint8_t* src, size_t compressed_size, uint8_t* dst, size_t size)
+	{
+		size_t ip = 0;
+		size_t op = 0;
+
+		while (ip < compressed_size)
+		{
+			const uint8_t token = src[ip++];
+
+			size_t literal_count = token >> 4;
+			if (literal_count == 15 && !read_length(src, compressed_size, ip, literal_count))
+				return false;
+			if (literal_count > compressed_size - ip || literal_count > size - op)
+				return false;
+			std::memcpy(dst + op, src + ip, literal_count);
+			ip += literal_count;
+			op += literal_count;
+
+			// The last sequence has no match
+			if (ip == compressed_size)
+				return op == size;
+
+			if (compressed_size - ip < 2)
+				return false;
+			const size_t distance = src[ip] | ((size_t)src[ip + 1] << 8);
+			ip += 2;
+			if (distance == 0 || distance > op)
+				return false;
+
+			size_t length = token & 15;
+			if (length == 15 && !read_length(src, compressed_size, ip, length))
+				return false;
+			length += MIN_MATCH;
+			if (length > size - op)
+				return false;
+
+			// Overlapping matches repeat the bytes just written
+			const uint8_t* match = dst + op - distance;
+			if (distance >= length)
+				std::memcpy(dst + op, match, length);
+			else
+			{
+				for (size_t i = 0; i < length; ++i)
+					dst[op + i] = match[i];
+			}
+			op += length;
+		}
+		return false;
+	}
+}
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "Memory/RangeAllocator.h"
+
+RangeAllocator::RangeAllocator(uint64_t capacity) :
+	m_capacity(capacity)
+{
+	if (capacity > 0)
+		add_free(0, capacity);
+}
+
+void RangeAllocator::add_free(uint64_t offset, uint64_t size)
+{
+	m_free_by_offset.insert({ offset, size });
+	m_free_by_size.insert({ size, offset });
+}
+
+void RangeAllocator::remove_free(std::map<uint64_t, uint64_t>::iterator it)
+{
+	auto [first, last] = m_free_by_size.equal_range(it->second);
+	for (auto size_it = first; size_it != last; ++size_it)
+	{
+		if (size_it->second == it->first)
+		{
+			m_free_by_size.erase(size_it);
+			break;
+		}
+	}
+	m_free_by_offset.erase(it);
+}
+
+uint64_t RangeAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+	if (size == 0)
+		return INVALID_OFFSET;
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+	// Smallest range that fits, larger ones only if the alignment padding doesn't
+	for (auto size_it = m_free_by_size.lower_bound(size); size_it != m_free_by_size.end(); ++size_it)
+	{
+		const uint64_t range_offset = size_it->second;
+		const uint64_t range_size = size_it->first;
+		const uint64_t offset = (range_offset + alignment - 1) & ~(alignment - 1);
+		if (offset + size > range_offset + range_size)
+			continue;
+
+		remove_free(m_free_by_offset.find(range_offset));
+		if (offset > range_offset)
+			add_free(range_offset, offset - range_offset);
+		if (offset + size < range_offset + range_size)
+			add_free(offset + size, range_offset + range_size - offset - size);
+
+		m_allocations.insert({ offset, size });
+		m_used += size;
+		return offset;
+	}
+	return INVALID_OFFSET;
+}
+
+void RangeAllocator::free(uint64_t offset)
+{
+	auto alloc = m_allocations.find(offset);
+	if (alloc == m_allocations.end())
+	{
+		assert(false);		// not allocated
+		return;
+	}
+
+	uint64_t start = offset;
+	uint64_t end = offset + alloc->second;
+	m_used -= alloc->second;
+	m_allocations.erase(alloc);
+
+	// Merge with the free neighbours
+	auto next = m_free_by_offset.lower_bound(end);
+	if (next != m_free_by_offset.end() && next->first == end)
+	{
+		end += next->second;
+		remove_free(next);
+	}
+
+	auto prev = m_free_by_offset.lower_bound(start);
+	if (prev != m_free_by_offset.begin())
+	{
+		--prev;
+		if (prev->first + prev->second == start)
+		{
+			start = prev->first;
+			remove_free(prev);
+		}
+	}
+
+	add_free(start, end - start);
+}
+
+RangeAllocator::Stats RangeAllocator::get_stats() const
+{
+	Stats stats;
+	stats.capacity = m_capacity;
+	stats.used = m_used;
+	stats.largest_free = m_free_by_size.empty() ? 0 : m_free_by_size.rbegin()->first;
+	stats.allocations = (uint32_t)m_allocations.size();
+	stats.free_ranges = (uint32_t)m_free_by_offset.size();
+	return stats;
+}
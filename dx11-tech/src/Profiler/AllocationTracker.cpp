@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "Profiler/AllocationTracker.h"
+#include <atomic>
+#include <malloc.h>
+#include <new>
+
+namespace
+{
+	// Relaxed is enough, we only care about the totals.
+	// The flag is only written when tracking starts or stops, so untracked allocations just read a shared cache line.
+	std::atomic<bool> s_enabled = false;
+	std::atomic<uint64_t> s_alloc_count = 0;
+	std::atomic<uint64_t> s_alloc_bytes = 0;
+
+	void count(size_t size)
+	{
+		if (!s_enabled.load(std::memory_order_relaxed))
+			return;
+		s_alloc_count.fetch_add(1, std::memory_order_relaxed);
+		s_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void* counted_alloc(size_t size)
+	{
+		count(size);
+
+		if (size == 0)
+			size = 1;
+		void* ptr = std::malloc(size);
+		if (!ptr)
+			throw std::bad_alloc();
+		return ptr;
+	}
+
+	void* counted_aligned_alloc(size_t size, std::align_val_t alignment)
+	{
+		count(size);
+
+		if (size == 0)
+			size = 1;
+		void* ptr = _aligned_malloc(size, (size_t)alignment);
+		if (!ptr)
+			throw std::bad_alloc();
+		return ptr;
+	}
+}
+
+namespace perf
+{
+	AllocationStats get_allocation_stats()
+	{
+		return { s_alloc_count.load(std::memory_order_relaxed), s_alloc_bytes.load(std::memory_order_relaxed) };
+	}
+
+	AllocationTracking::AllocationTracking()
+	{
+		s_enabled = true;
+	}
+
+	AllocationTracking::~AllocationTracking()
+	{
+		s_enabled = false;
+	}
+}
+
+/*
+	Global replacements, the over-aligned forms go through _aligned_malloc so they have to be freed with _aligned_free.
+*/
+void* operator new(size_t size) { return counted_alloc(size); }
+void* operator new[](size_t size) { return counted_alloc(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+
+void* operator new(size_t size, std::align_val_t alignment) { return counted_aligned_alloc(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return counted_aligned_alloc(size, alignment); }
+void operator delete(void* ptr, std::align_val_t) noexcept { _aligned_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { _aligned_free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { _aligned_free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { _aligned_free(ptr); }
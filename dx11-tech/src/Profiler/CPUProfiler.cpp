@@ -55,6 +55,11 @@ const CPUProfiler::FrameData& CPUProfiler::get_frame_statistics()
 	return m_frame_data;
 }
 
+const CPUProfiler::FrameData& CPUProfiler::get_last_frame_statistics() const
+{
+	return m_frame_data;
+}
+
 void CPUProfiler::frame_start()
 {
 	begin("*** Full Frame ***");
@@ -8,6 +8,13 @@ void GPUProfiler::begin(const std::string& name, bool annotate, bool get_pipelin
     assert(profile.query_started == false);
     //assert(profile.query_finished == false);
 
+    // Headless device, keep the scope bookkeeping only
+    if (!m_dev)
+    {
+        profile.query_started = true;
+        return;
+    }
+
     if (!profile.disjoint[m_curr_frame])
     {
         auto& dev = m_dev->get_device();
@@ -54,6 +61,14 @@ void GPUProfiler::end(const std::string& name)
     assert(profile.query_started == true);
     //assert(profile.query_finished == false);
 
+    if (!m_dev)
+    {
+        profile.query_started = false;
+        profile.query_finished = true;
+        m_frame_finished = true;
+        return;
+    }
+
     if (profile.annotate)
         m_dev->get_annotation()->EndEvent();
 
@@ -89,6 +104,19 @@ void GPUProfiler::frame_end()
 {
     end("*** Full Frame ***");
 
+    if (!m_dev)
+    {
+        // No queries to wait on, report zeroed times so the scopes still show up
+        ++m_curr_frame;
+        m_curr_frame = m_curr_frame % gfxconstants::QUERY_LATENCY;
+
+        FrameData frame_data{};
+        for (const auto& it : m_profiles)
+            frame_data.profiles.insert({ it.first, 0.f });
+        m_frame_datas[m_curr_frame] = frame_data;
+        return;
+    }
+
     auto& ctx = m_dev->get_context();
 
     // Go to "oldest frame" in list
@@ -0,0 +1,216 @@
+#include "pch.h"
+#include "Profiler/StartupProfiler.h"
+#include "Json.h"
+#include <algorithm>
+#include <cstring>
+
+namespace perf
+{
+	StartupProfiler* startup_profiler = nullptr;
+}
+
+void StartupProfiler::initialize()
+{
+	if (!perf::startup_profiler)
+		perf::startup_profiler = new StartupProfiler();
+}
+
+void StartupProfiler::shutdown()
+{
+	if (perf::startup_profiler)
+	{
+		delete perf::startup_profiler;
+		perf::startup_profiler = nullptr;
+	}
+}
+
+StartupProfiler::Scoped::Scoped(const std::string& name, const char* category)
+{
+	if (!perf::startup_profiler || !perf::startup_profiler->is_recording())
+		return;
+
+	m_active = true;
+	perf::startup_profiler->begin(name, category);
+}
+
+StartupProfiler::Scoped::~Scoped()
+{
+	if (m_active)
+		perf::startup_profiler->end();
+}
+
+StartupProfiler::StartupProfiler() :
+	m_start(std::chrono::steady_clock::now())
+{
+	get_thread_index(std::this_thread::get_id());
+}
+
+double StartupProfiler::now_ms() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+uint32_t StartupProfiler::get_thread_index(std::thread::id id)
+{
+	auto it = m_thread_indices.find(id);
+	if (it != m_thread_indices.cend())
+		return it->second;
+
+	const auto idx = (uint32_t)m_thread_indices.size();
+	m_thread_indices.insert({ id, idx });
+	return idx;
+}
+
+bool StartupProfiler::is_recording() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_recording;
+}
+
+void StartupProfiler::begin(const std::string& name, const char* category)
+{
+	const double start = now_ms();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_recording)
+		return;
+
+	const auto thread = get_thread_index(std::this_thread::get_id());
+	auto& stack = m_open_scopes[thread];
+
+	Event e{ name, category, thread, (uint32_t)stack.size(), start, 0.0 };
+	stack.push_back(m_events.size());
+	m_events.push_back(std::move(e));
+}
+
+void StartupProfiler::end()
+{
+	const double end = now_ms();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const auto thread = get_thread_index(std::this_thread::get_id());
+	auto& stack = m_open_scopes[thread];
+	if (stack.empty())
+		return;		// begun before finish() but ended after, already closed off
+
+	auto& e = m_events[stack.back()];
+	e.duration_ms = end - e.start_ms;
+	stack.pop_back();
+}
+
+void StartupProfiler::finish(const std::optional<std::filesystem::path>& trace_path)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_recording)
+			return;
+
+		m_recording = false;
+		m_total_ms = now_ms();
+
+		// Close whatever is still open (e.g scopes on worker threads)
+		for (auto& [thread, stack] : m_open_scopes)
+		{
+			for (auto idx : stack)
+				m_events[idx].duration_ms = m_total_ms - m_events[idx].start_ms;
+			stack.clear();
+		}
+	}
+
+	print_report();
+
+	if (trace_path)
+	{
+		if (write_trace(*trace_path))
+			fmt::print("Startup trace written to {}\n", trace_path->string());
+		else
+			fmt::print(fg(fmt::color::red), "Failed to write startup trace to {}\n", trace_path->string());
+	}
+}
+
+const std::vector<StartupProfiler::Event>& StartupProfiler::get_events() const
+{
+	return m_events;
+}
+
+double StartupProfiler::get_total_time() const
+{
+	return m_total_ms;
+}
+
+std::map<std::string, double> StartupProfiler::get_category_totals() const
+{
+	std::map<std::string, double> totals;
+
+	// Events are stored in begin order per thread, so a scope's parents always precede it
+	std::map<uint32_t, std::vector<const Event*>> stacks;
+	for (const auto& e : m_events)
+	{
+		auto& stack = stacks[e.thread];
+		stack.resize(e.depth);
+
+		const bool nested_in_same_category = std::any_of(stack.cbegin(), stack.cend(),
+			[&](const Event* parent) { return std::strcmp(parent->category, e.category) == 0; });
+		if (!nested_in_same_category)
+			totals[e.category] += e.duration_ms;
+
+		stack.push_back(&e);
+	}
+	return totals;
+}
+
+void StartupProfiler::print_report() const
+{
+	fmt::print("\n===== Startup: {:.2f} ms =====\n", m_total_ms);
+
+	// Timeline of the initializing thread, other threads are covered by the totals below
+	for (const auto& e : m_events)
+	{
+		if (e.thread != 0)
+			continue;
+		fmt::print("{:>10.2f} ms {:5.1f}%  {}{} [{}]\n", e.duration_ms, e.duration_ms / m_total_ms * 100.0,
+			std::string(e.depth * 2, ' '), e.name, e.category);
+	}
+
+	std::vector<std::pair<std::string, double>> categories;
+	for (const auto& total : get_category_totals())
+		categories.push_back(total);
+	std::sort(categories.begin(), categories.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+	fmt::print("\n----- By category -----\n");
+	for (const auto& [category, time] : categories)
+		fmt::print("{:>10.2f} ms  {}\n", time, category);
+
+	std::vector<const Event*> slowest;
+	for (const auto& e : m_events)
+		slowest.push_back(&e);
+	std::sort(slowest.begin(), slowest.end(), [](const Event* a, const Event* b) { return a->duration_ms > b->duration_ms; });
+	slowest.resize((std::min)(slowest.size(), (size_t)15));
+
+	fmt::print("\n----- Slowest scopes -----\n");
+	for (const auto e : slowest)
+		fmt::print("{:>10.2f} ms  {} [{}] (thread {})\n", e->duration_ms, e->name, e->category, e->thread);
+	fmt::print("\n");
+}
+
+bool StartupProfiler::write_trace(const std::filesystem::path& path) const
+{
+	auto events = JsonValue::array();
+	for (const auto& e : m_events)
+	{
+		auto json_event = JsonValue::object();
+		json_event["name"] = e.name;
+		json_event["cat"] = e.category;
+		json_event["ph"] = "X";		// complete event
+		json_event["ts"] = e.start_ms * 1000.0;
+		json_event["dur"] = e.duration_ms * 1000.0;
+		json_event["pid"] = 1;
+		json_event["tid"] = e.thread;
+		events.push_back(std::move(json_event));
+	}
+
+	auto root = JsonValue::object();
+	root["traceEvents"] = std::move(events);
+	root["displayTimeUnit"] = "ms";
+	return root.write_file(path, false);
+}
@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+namespace jobs
+{
+	ThreadPool* pool = nullptr;
+}
+
+void ThreadPool::initialize(uint32_t thread_count)
+{
+	if (thread_count == 0)
+		thread_count = (std::max)(std::thread::hardware_concurrency(), 2u) - 1;
+
+	if (!jobs::pool)
+		jobs::pool = new ThreadPool(thread_count);
+}
+
+void ThreadPool::shutdown()
+{
+	if (jobs::pool)
+	{
+		delete jobs::pool;
+		jobs::pool = nullptr;
+	}
+}
+
+ThreadPool::ThreadPool(uint32_t thread_count)
+{
+	m_threads.reserve(thread_count);
+	for (uint32_t i = 0; i < thread_count; ++i)
+		m_threads.emplace_back([this]() { worker_loop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	// Queued jobs are still run before the workers exit
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_cv.notify_all();
+
+	for (auto& thread : m_threads)
+		thread.join();
+}
+
+void ThreadPool::push(std::function<void()>&& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+	m_cv.notify_one();
+}
+
+bool ThreadPool::run_pending_job()
+{
+	std::function<void()> job;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_jobs.empty())
+			return false;
+		job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+	}
+
+	job();
+	return true;
+}
+
+void ThreadPool::worker_loop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+			if (m_jobs.empty())
+				return;
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		job();
+	}
+}
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Utilities.h"
+#include <cstring>
 
 namespace utils
 {
@@ -36,6 +37,84 @@ namespace utils
 		return buffer;
 	}
 
+	namespace
+	{
+		// See https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+		constexpr uint64_t s_prime64_1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t s_prime64_2 = 0xC2B2AE3D27D4EB4Full;
+		constexpr uint64_t s_prime64_3 = 0x165667B19E3779F9ull;
+		constexpr uint64_t s_prime64_4 = 0x85EBCA77C2B2AE63ull;
+		constexpr uint64_t s_prime64_5 = 0x27D4EB2F165667C5ull;
+
+		uint64_t rotl64(uint64_t v, int r) { return (v << r) | (v >> (64 - r)); }
+
+		uint64_t read64(const uint8_t* p) { uint64_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+		uint32_t read32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+
+		uint64_t xxh64_round(uint64_t acc, uint64_t input)
+		{
+			acc += input * s_prime64_2;
+			return rotl64(acc, 31) * s_prime64_1;
+		}
+
+		uint64_t xxh64_merge(uint64_t acc, uint64_t v)
+		{
+			acc ^= xxh64_round(0, v);
+			return acc * s_prime64_1 + s_prime64_4;
+		}
+	}
+
+	uint64_t hash_bytes(const void* data, size_t size, uint64_t seed)
+	{
+		auto p = (const uint8_t*)data;
+		const auto end = p + size;
+		uint64_t hash;
+
+		// Four independent lanes over 32 byte stripes
+		if (size >= 32)
+		{
+			uint64_t v1 = seed + s_prime64_1 + s_prime64_2;
+			uint64_t v2 = seed + s_prime64_2;
+			uint64_t v3 = seed;
+			uint64_t v4 = seed - s_prime64_1;
+			for (const auto limit = end - 32; p <= limit; p += 32)
+			{
+				v1 = xxh64_round(v1, read64(p));
+				v2 = xxh64_round(v2, read64(p + 8));
+				v3 = xxh64_round(v3, read64(p + 16));
+				v4 = xxh64_round(v4, read64(p + 24));
+			}
+			hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+			hash = xxh64_merge(hash, v1);
+			hash = xxh64_merge(hash, v2);
+			hash = xxh64_merge(hash, v3);
+			hash = xxh64_merge(hash, v4);
+		}
+		else
+			hash = seed + s_prime64_5;
+
+		hash += (uint64_t)size;
+
+		// Tail
+		for (; p + 8 <= end; p += 8)
+			hash = rotl64(hash ^ xxh64_round(0, read64(p)), 27) * s_prime64_1 + s_prime64_4;
+		if (p + 4 <= end)
+		{
+			hash = rotl64(hash ^ (read32(p) * s_prime64_1), 23) * s_prime64_2 + s_prime64_3;
+			p += 4;
+		}
+		for (; p < end; ++p)
+			hash = rotl64(hash ^ (*p * s_prime64_5), 11) * s_prime64_1;
+
+		// Avalanche
+		hash ^= hash >> 33;
+		hash *= s_prime64_2;
+		hash ^= hash >> 29;
+		hash *= s_prime64_3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
 	void constrained_incr(float& num, float min, float max)
 	{
 		++num;
@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "VirtualFile.h"
+#include "AssetPackage.h"
+#include "Timer.h"
+#include <mutex>
+
+namespace
+{
+	std::vector<unique_ptr<AssetPackage>> s_packages;
+
+	std::mutex s_stats_mutex;
+	VirtualFile::Stats s_stats;
+}
+
+bool VirtualFile::mount(const std::filesystem::path& package)
+{
+	auto mounted = make_unique<AssetPackage>(package);
+	if (!mounted->is_open())
+	{
+		fmt::print(fg(fmt::color::red), "Failed to mount package {}\n", package.string());
+		return false;
+	}
+
+	fmt::print("Mounted {} ({} files)\n", package.string(), mounted->get_stats().files);
+	s_packages.push_back(std::move(mounted));
+	return true;
+}
+
+void VirtualFile::unmount_all()
+{
+	s_packages.clear();
+
+	std::lock_guard lock(s_stats_mutex);
+	s_stats = Stats();
+}
+
+uint32_t VirtualFile::get_package_files()
+{
+	uint32_t files = 0;
+	for (const auto& package : s_packages)
+		files += package->get_stats().files;
+	return files;
+}
+
+uint64_t VirtualFile::get_package_bytes()
+{
+	uint64_t bytes = 0;
+	for (const auto& package : s_packages)
+		bytes += package->get_stats().stored_bytes;
+	return bytes;
+}
+
+VirtualFile::Stats VirtualFile::get_stats()
+{
+	std::lock_guard lock(s_stats_mutex);
+	return s_stats;
+}
+
+VirtualFile::VirtualFile(const std::filesystem::path& path)
+{
+	if (!s_packages.empty())
+	{
+		Timer timer;
+		for (auto it = s_packages.rbegin(); it != s_packages.rend() && !m_packaged; ++it)
+			m_packaged = (*it)->read(path, m_storage, m_view, m_size);
+
+		if (m_packaged)
+		{
+			const float read_ms = timer.elapsed();
+			std::lock_guard lock(s_stats_mutex);
+			++s_stats.package_reads;
+			s_stats.decompressed_bytes += m_storage.size();
+			s_stats.package_read_ms += read_ms;
+			return;
+		}
+	}
+
+	m_disk = MappedFile(path);
+	std::lock_guard lock(s_stats_mutex);
+	++s_stats.disk_reads;
+}
+
+const uint8_t* VirtualFile::data() const
+{
+	return m_packaged ? m_view : m_disk.data();
+}
+
+size_t VirtualFile::size() const
+{
+	return m_packaged ? m_size : m_disk.size();
+}
@@ -1,11 +1,17 @@
 #include "pch.h"
 #include "Application.h"
+#include "AssetPackage.h"
+#include "ThreadPool.h"
+#include "Benchmark/HeadlessBenchmark.h"
+#include "Benchmark/MicroBenchmarks.h"
+#include "Benchmark/BenchmarkCompare.h"
+#include "Benchmark/FlythroughBenchmark.h"
 
 #define _CRTDBG_MAP_ALLOC
 #include <stdlib.h>
 #include <crtdbg.h>
 
-int main()
+int main(int argc, char** argv)
 {
 	// https://docs.microsoft.com/en-us/visualstudio/debugger/finding-memory-leaks-using-the-crt-library?view=vs-2022
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -20,13 +26,51 @@ int main()
 		console manually.
 	*/
 
+	// Packs asset files into a single package, mounted by the Application and --package
+	if (auto package_settings = AssetPackage::parse_args(argc, argv); package_settings)
+	{
+		ThreadPool::initialize();
+		const bool built = AssetPackage::build(*package_settings);
+		ThreadPool::shutdown();
+		return built ? 0 : 1;
+	}
+
+	// Diff of two benchmark result files
+	if (auto compare_settings = BenchmarkCompare::parse_args(argc, argv); compare_settings)
+		return BenchmarkCompare::run(*compare_settings);
+
+	// Microbenchmarks of the core CPU data structures
+	if (auto micro_settings = MicroBenchmarks::parse_args(argc, argv); micro_settings)
+	{
+		int exit_code = 0;
+		{
+			unique_ptr<MicroBenchmarks> bench = make_unique<MicroBenchmarks>(*micro_settings);
+			exit_code = bench->run();
+		}
+		_CrtDumpMemoryLeaks();
+		return exit_code;
+	}
+
+	// Headless CPU benchmark of the render path (no window/device)
+	if (auto bench_settings = HeadlessBenchmark::parse_args(argc, argv); bench_settings)
+	{
+		int exit_code = 0;
+		{
+			unique_ptr<HeadlessBenchmark> bench = make_unique<HeadlessBenchmark>(*bench_settings);
+			exit_code = bench->run();
+		}
+		_CrtDumpMemoryLeaks();
+		return exit_code;
+	}
+
 	// Destructor should be called before dumping memory leaks.
+	int exit_code = 0;
 	{
-		unique_ptr<Application> app = make_unique<Application>();
-		app->run();
+		unique_ptr<Application> app = make_unique<Application>(FlythroughBenchmark::parse_args(argc, argv));
+		exit_code = app->run();
 	}
 
 	_CrtDumpMemoryLeaks();
 
-	return 0;
+	return exit_code;
 }
\ No newline at end of file